@@ -19,8 +19,8 @@ TARGET_NAME="nettf"
 
 # Compiler settings
 CC="${CC:-gcc}"
-CFLAGS="-Wall -Wextra -std=c99 -O2"
-LDFLAGS=""
+CFLAGS="-Wall -Wextra -std=c99 -O2 -pthread"
+LDFLAGS="-pthread"
 
 # Detect system information
 detect_system() {
@@ -8,10 +8,28 @@
 
 #define _GNU_SOURCE  // Enable snprintf() on older systems
 #include "adaptive.h"
+#include "probes.h"  // USDT static tracepoints
+#include "chunktrace.h"  // Per-chunk traces
 #include <stdio.h>
 #include <string.h>
 #include <math.h>
 
+static size_t initial_chunk_size = INITIAL_CHUNK_SIZE;  // Chunk size adaptive_init() starts from
+
+/**
+ * @brief Set the chunk size adaptive_init() starts from
+ */
+void adaptive_set_initial_chunk_size(size_t chunk_size) {
+    if (chunk_size == 0) {
+        chunk_size = INITIAL_CHUNK_SIZE;
+    } else if (chunk_size < MIN_CHUNK_SIZE) {
+        chunk_size = MIN_CHUNK_SIZE;
+    } else if (chunk_size > MAX_CHUNK_SIZE) {
+        chunk_size = MAX_CHUNK_SIZE;
+    }
+    initial_chunk_size = chunk_size;
+}
+
 /**
  * @brief Initialize adaptive state for a new transfer
  */
@@ -22,7 +40,7 @@ void adaptive_init(AdaptiveState *state, uint64_t total_bytes) {
 
     memset(state, 0, sizeof(AdaptiveState));
 
-    state->current_chunk_size = INITIAL_CHUNK_SIZE;
+    state->current_chunk_size = initial_chunk_size;
     state->last_adjustment_time = time(NULL);
     state->transfer_start_time = time(NULL);
     state->bytes_transferred = 0;
@@ -35,6 +53,18 @@ void adaptive_init(AdaptiveState *state, uint64_t total_bytes) {
     for (int i = 0; i < SPEED_SAMPLES; i++) {
         state->speed_samples[i] = 0.0;
     }
+
+    chunktrace_file(total_bytes, 0);
+}
+
+/**
+ * @brief Continue with the next file of the same transfer
+ */
+void adaptive_next_file(AdaptiveState *state, uint64_t file_bytes) {
+    if (state == NULL) {
+        return;
+    }
+    chunktrace_file(file_bytes, 1);
 }
 
 /**
@@ -65,8 +95,9 @@ size_t adaptive_get_chunk_size(AdaptiveState *state) {
  * - < 100 MB/s → 1 MB
  * - ≥ 100 MB/s → 2 MB   (MAX_CHUNK_SIZE)
  */
-static size_t calculate_new_chunk_size(double avg_speed) {
+size_t adaptive_policy_threshold(const AdaptiveState *state, double avg_speed) {
     const double MB = 1024.0 * 1024.0;
+    (void)state;
 
     if (avg_speed < 1.0 * MB) {
         return MIN_CHUNK_SIZE;  // 8 KB
@@ -81,11 +112,67 @@ static size_t calculate_new_chunk_size(double avg_speed) {
     }
 }
 
+/**
+ * @brief Proportional policy: the bytes moved in 10 ms at the average speed
+ */
+size_t adaptive_policy_proportional(const AdaptiveState *state, double avg_speed) {
+    (void)state;
+    double target = avg_speed * 0.010;
+    size_t chunk_size = MIN_CHUNK_SIZE;
+    while (chunk_size < MAX_CHUNK_SIZE && chunk_size < target) {
+        chunk_size *= 2;
+    }
+    return chunk_size;
+}
+
+/**
+ * @brief Static policy: keep the current chunk size
+ */
+size_t adaptive_policy_static(const AdaptiveState *state, double avg_speed) {
+    (void)avg_speed;
+    return state->current_chunk_size;
+}
+
+/**
+ * @brief Look up a policy by name
+ */
+int adaptive_policy_by_name(const char *name, AdaptivePolicy *policy) {
+    if (strcmp(name, "threshold") == 0) {
+        *policy = adaptive_policy_threshold;
+    } else if (strcmp(name, "proportional") == 0) {
+        *policy = adaptive_policy_proportional;
+    } else if (strcmp(name, "static") == 0) {
+        *policy = adaptive_policy_static;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
 /**
  * @brief Update state after transferring a chunk
  */
 void adaptive_update(AdaptiveState *state, size_t bytes_transferred, double elapsed_time) {
-    if (state == NULL || elapsed_time <= 0.0) {
+    if (state == NULL) {
+        return;
+    }
+    chunktrace_chunk(state->current_chunk_size, bytes_transferred, elapsed_time);
+
+    // Most chunks have no elapsed time and return before the clock is used:
+    // keep the time() call off their path
+    adaptive_update_at(state, bytes_transferred, elapsed_time, elapsed_time > 0.0 ? time(NULL) : 0);
+}
+
+/**
+ * @brief Update state after transferring a chunk, at a given time
+ */
+void adaptive_update_at(AdaptiveState *state, size_t bytes_transferred, double elapsed_time, time_t now) {
+    if (state == NULL) {
+        return;
+    }
+    size_t old_chunk_size = state->current_chunk_size;
+    if (elapsed_time <= 0.0) {
+        PROBE4(adaptive, bytes_transferred, 0, old_chunk_size, old_chunk_size);
         return;
     }
 
@@ -105,7 +192,7 @@ void adaptive_update(AdaptiveState *state, size_t bytes_transferred, double elap
     state->bytes_sent_or_received += bytes_transferred;
 
     // Check if it's time to adjust chunk size
-    time_t current_time = time(NULL);
+    time_t current_time = now;
     double time_since_adjustment = difftime(current_time, state->last_adjustment_time);
 
     if (time_since_adjustment >= ADJUSTMENT_INTERVAL) {
@@ -119,7 +206,13 @@ void adaptive_update(AdaptiveState *state, size_t bytes_transferred, double elap
         }
 
         // Calculate and apply new chunk size
-        size_t new_chunk_size = calculate_new_chunk_size(avg_speed);
+        AdaptivePolicy policy = state->policy ? state->policy : adaptive_policy_threshold;
+        size_t new_chunk_size = policy(state, avg_speed);
+
+        // Slower sends to a receiver that cannot keep up say nothing about the network
+        if (state->receiver_bound && new_chunk_size < state->current_chunk_size) {
+            new_chunk_size = state->current_chunk_size;
+        }
 
         if (new_chunk_size != state->current_chunk_size) {
             char old_str[32], new_str[32];
@@ -134,6 +227,9 @@ void adaptive_update(AdaptiveState *state, size_t bytes_transferred, double elap
         state->last_adjustment_time = current_time;
         state->bytes_transferred = 0;  // Reset for next interval
     }
+
+    PROBE4(adaptive, bytes_transferred, (uint64_t)(elapsed_time * 1e6), old_chunk_size,
+           state->current_chunk_size);
 }
 
 /**
@@ -160,12 +256,14 @@ void adaptive_reset(AdaptiveState *state) {
         return;
     }
 
-    // Preserve current chunk size but reset everything else
+    // Preserve current chunk size and policy but reset everything else
     size_t saved_chunk_size = state->current_chunk_size;
+    AdaptivePolicy saved_policy = state->policy;
 
     memset(state, 0, sizeof(AdaptiveState));
 
     state->current_chunk_size = saved_chunk_size;
+    state->policy = saved_policy;
     state->last_adjustment_time = time(NULL);
     state->transfer_start_time = time(NULL);
 
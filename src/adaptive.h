@@ -4,6 +4,11 @@
  *
  * Dynamically adjusts transfer chunk size (8KB-2MB) based on network conditions.
  * Uses aggressive adaptation with 2-3 second intervals for quick response.
+ *
+ * The rule mapping the average speed to a chunk size is a policy that can be
+ * replaced per state, and adaptive_update_at() takes the clock as an
+ * argument, so the adaptive-sim tool can replay recorded chunk traces (see
+ * chunktrace.h) against other policies with a simulated clock.
  */
 
 #ifndef ADAPTIVE_H
@@ -38,13 +43,28 @@
  */
 #define SPEED_SAMPLES      5
 
+struct AdaptiveState;
+
+/**
+ * @brief Chunk sizing policy
+ *
+ * Called every ADJUSTMENT_INTERVAL seconds with the average speed of the
+ * recent chunks; returns the chunk size to use next (clamped to
+ * MIN_CHUNK_SIZE..MAX_CHUNK_SIZE by adaptive_get_chunk_size()).
+ *
+ * @param state Adaptive state being adjusted
+ * @param avg_speed Average speed of the recent chunks in bytes per second
+ * @return New chunk size in bytes
+ */
+typedef size_t (*AdaptivePolicy)(const struct AdaptiveState *state, double avg_speed);
+
 /**
  * @brief Adaptive chunk size state tracker
  *
  * Maintains state for adaptive chunk sizing including current chunk size,
  * speed tracking, and transfer statistics.
  */
-typedef struct {
+typedef struct AdaptiveState {
     size_t current_chunk_size;        // Current chunk size in bytes
     time_t last_adjustment_time;      // Time of last size adjustment
     uint64_t bytes_transferred;       // Bytes since last adjustment
@@ -58,6 +78,9 @@ typedef struct {
     // Statistics
     uint64_t total_bytes;             // Total bytes in transfer
     uint64_t bytes_sent_or_received;  // Bytes transferred so far
+
+    AdaptivePolicy policy;            // Chunk sizing policy, NULL for the default thresholds
+    int receiver_bound;               // Receiver reports it is the bottleneck (see feedback.h): never shrink
 } AdaptiveState;
 
 /**
@@ -70,6 +93,29 @@ typedef struct {
  */
 void adaptive_init(AdaptiveState *state, uint64_t total_bytes);
 
+/**
+ * @brief Set the chunk size adaptive_init() starts from
+ *
+ * Lets a transfer start from what earlier transfers with the same peer
+ * learned (see peerprofile.h) instead of INITIAL_CHUNK_SIZE.
+ *
+ * @param chunk_size Initial chunk size (clamped to MIN_CHUNK_SIZE..MAX_CHUNK_SIZE),
+ *                   0 for INITIAL_CHUNK_SIZE
+ */
+void adaptive_set_initial_chunk_size(size_t chunk_size);
+
+/**
+ * @brief Continue with the next file of the same transfer
+ *
+ * Keeps the chunk size, speed samples and adjustment clock, so a transfer of
+ * many files adapts as one stream; only the file boundary is recorded in
+ * the chunk trace.
+ *
+ * @param state Pointer to AdaptiveState structure
+ * @param file_bytes Size of the next file
+ */
+void adaptive_next_file(AdaptiveState *state, uint64_t file_bytes);
+
 /**
  * @brief Get current chunk size
  *
@@ -93,6 +139,49 @@ size_t adaptive_get_chunk_size(AdaptiveState *state);
  */
 void adaptive_update(AdaptiveState *state, size_t bytes_transferred, double elapsed_time);
 
+/**
+ * @brief Update state after transferring a chunk, at a given time
+ *
+ * Same as adaptive_update() with the current time supplied by the caller,
+ * for replaying traces with a simulated clock.
+ *
+ * @param state Pointer to AdaptiveState structure
+ * @param bytes_transferred Actual number of bytes sent/received
+ * @param elapsed_time Time taken for this chunk (in seconds)
+ * @param now Current time
+ */
+void adaptive_update_at(AdaptiveState *state, size_t bytes_transferred, double elapsed_time, time_t now);
+
+/**
+ * @brief Default policy: fixed speed thresholds
+ *
+ * < 1 MB/s → 8 KB, < 10 MB/s → 64 KB, < 50 MB/s → 256 KB, < 100 MB/s → 1 MB,
+ * otherwise 2 MB.
+ */
+size_t adaptive_policy_threshold(const AdaptiveState *state, double avg_speed);
+
+/**
+ * @brief Proportional policy: the bytes moved in 10 ms at the average speed
+ *
+ * Rounded up to a power of two, so the chunk size tracks the link speed
+ * continuously instead of in five steps.
+ */
+size_t adaptive_policy_proportional(const AdaptiveState *state, double avg_speed);
+
+/**
+ * @brief Static policy: keep the current chunk size
+ */
+size_t adaptive_policy_static(const AdaptiveState *state, double avg_speed);
+
+/**
+ * @brief Look up a policy by name ("threshold", "proportional" or "static")
+ *
+ * @param name Policy name
+ * @param policy Output: the policy
+ * @return 0 on success, -1 if the name is unknown
+ */
+int adaptive_policy_by_name(const char *name, AdaptivePolicy *policy);
+
 /**
  * @brief Calculate and return current transfer speed
  *
@@ -0,0 +1,277 @@
+/**
+ * @file beacon.c
+ * @brief Receiver announcement beacon implementation
+ *
+ * The announce thread owns one UDP socket bound to BEACON_PORT. It sends an
+ * announcement to the limited broadcast address and to the broadcast address
+ * of every interface each BEACON_INTERVAL seconds, and in between waits for
+ * queries, answering each with a unicast announcement to the querying socket.
+ */
+
+#define _GNU_SOURCE  // Enable statvfs() and gethostname() on Linux systems
+#include "beacon.h"
+#include "platform.h"  // platform_monotonic_ns()
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/statvfs.h>
+
+// Largest beacon datagram: header and a 255-byte hostname
+#define BEACON_MAX_SIZE (BEACON_HEADER_SIZE + 256)
+
+/**
+ * @brief What the announce thread advertises
+ */
+typedef struct {
+    int fd;                 // Socket bound to BEACON_PORT
+    int port;               // TCP port of the receiver
+    uint32_t capabilities;  // BEACON_CAP_* bits
+} BeaconState;
+
+/**
+ * @brief Fill in a beacon header
+ */
+static void beacon_header(BeaconHeader *header, uint16_t type, int port, uint32_t capabilities,
+                          uint64_t free_bytes, size_t hostname_len) {
+    memcpy(header->magic, "NTBC", 4);
+    header->version = htons(BEACON_VERSION);
+    header->type = htons(type);
+    header->port = htons((uint16_t)port);
+    header->hostname_len = htons((uint16_t)hostname_len);
+    header->capabilities = htonl(capabilities);
+    header->free_bytes = htonll(free_bytes);
+}
+
+/**
+ * @brief Build an announcement for this receiver
+ *
+ * @return Datagram length
+ */
+static size_t build_announcement(const BeaconState *state, unsigned char *buf) {
+    char hostname[256];
+    if (gethostname(hostname, sizeof(hostname)) != 0) {
+        hostname[0] = '\0';
+    }
+    hostname[sizeof(hostname) - 1] = '\0';
+    size_t hostname_len = strlen(hostname);
+
+    // Free space where received files are written
+    uint64_t free_bytes = 0;
+    struct statvfs vfs;
+    if (statvfs(".", &vfs) == 0) {
+        free_bytes = (uint64_t)vfs.f_bavail * vfs.f_frsize;
+    }
+
+    BeaconHeader header;
+    beacon_header(&header, BEACON_TYPE_ANNOUNCE, state->port, state->capabilities, free_bytes, hostname_len);
+    memcpy(buf, &header, BEACON_HEADER_SIZE);
+    memcpy(buf + BEACON_HEADER_SIZE, hostname, hostname_len);
+    return BEACON_HEADER_SIZE + hostname_len;
+}
+
+/**
+ * @brief Send a datagram to BEACON_PORT on every broadcast address
+ */
+static void send_broadcast(int fd, const void *buf, size_t len) {
+    struct sockaddr_in to;
+    memset(&to, 0, sizeof(to));
+    to.sin_family = AF_INET;
+    to.sin_port = htons(BEACON_PORT);
+
+    // The limited broadcast address only reaches the default interface
+    to.sin_addr.s_addr = htonl(INADDR_BROADCAST);
+    sendto(fd, buf, len, 0, (struct sockaddr *)&to, sizeof(to));
+
+    NetworkInterface interfaces[16];
+    int count = get_network_interfaces(interfaces, 16);
+    for (int i = 0; i < count; i++) {
+        if (interfaces[i].broadcast[0] == '\0' ||
+            inet_pton(AF_INET, interfaces[i].broadcast, &to.sin_addr) != 1) {
+            continue;
+        }
+        sendto(fd, buf, len, 0, (struct sockaddr *)&to, sizeof(to));
+    }
+}
+
+/**
+ * @brief Check that a datagram is a beacon of a known version
+ *
+ * @return Beacon type, or 0 if the datagram is not a valid beacon
+ */
+static int parse_beacon(const unsigned char *buf, ssize_t len, BeaconHeader *header) {
+    if (len < BEACON_HEADER_SIZE) {
+        return 0;
+    }
+    memcpy(header, buf, BEACON_HEADER_SIZE);
+    if (memcmp(header->magic, "NTBC", 4) != 0 || ntohs(header->version) != BEACON_VERSION) {
+        return 0;
+    }
+    if ((size_t)len < BEACON_HEADER_SIZE + (size_t)ntohs(header->hostname_len)) {
+        return 0;
+    }
+    return ntohs(header->type);
+}
+
+/**
+ * @brief Announce thread: periodic broadcasts and answers to queries
+ */
+static void *beacon_thread(void *arg) {
+    BeaconState *state = (BeaconState *)arg;
+    unsigned char buf[BEACON_MAX_SIZE];
+    time_t next_announce = 0;
+
+    while (1) {
+        time_t now = time(NULL);
+        if (now >= next_announce) {
+            size_t len = build_announcement(state, buf);
+            send_broadcast(state->fd, buf, len);
+            next_announce = now + BEACON_INTERVAL;
+        }
+
+        struct pollfd pfd;
+        pfd.fd = state->fd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        if (poll(&pfd, 1, (int)(next_announce - now) * 1000) <= 0) {
+            continue;
+        }
+
+        struct sockaddr_in from;
+        socklen_t from_len = sizeof(from);
+        ssize_t n = recvfrom(state->fd, buf, sizeof(buf), 0, (struct sockaddr *)&from, &from_len);
+        BeaconHeader header;
+        if (n < 0 || parse_beacon(buf, n, &header) != BEACON_TYPE_QUERY) {
+            continue;  // Our own broadcasts and other receivers' announcements land here too
+        }
+
+        size_t len = build_announcement(state, buf);
+        sendto(state->fd, buf, len, 0, (struct sockaddr *)&from, from_len);
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Start announcing a receiver in a background thread
+ */
+int beacon_start(int port, const ReceiveOptions *options) {
+    static BeaconState state;
+
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) {
+        perror("beacon socket");
+        return -1;
+    }
+
+    // Several receivers on one host may share the beacon port
+    int opt = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    setsockopt(fd, SOL_SOCKET, SO_BROADCAST, &opt, sizeof(opt));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(BEACON_PORT);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        perror("beacon bind");
+        close(fd);
+        return -1;
+    }
+
+    state.fd = fd;
+    state.port = port;
+    state.capabilities = BEACON_CAP_VERIFY | BEACON_CAP_EXT_DIR | BEACON_CAP_EXT_FILE;
+    if (options && options->link_duplicates) {
+        state.capabilities |= BEACON_CAP_LINK_DUPLICATES;
+    }
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, beacon_thread, &state) != 0) {
+        fprintf(stderr, "Error: Could not start beacon thread\n");
+        close(fd);
+        return -1;
+    }
+    pthread_detach(thread);
+    return 0;
+}
+
+/**
+ * @brief Find receivers by querying for their announcements
+ */
+int beacon_discover(NetworkDevice *devices, int max_devices, int listen_ms) {
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) {
+        perror("socket");
+        return -1;
+    }
+    int opt = 1;
+    setsockopt(fd, SOL_SOCKET, SO_BROADCAST, &opt, sizeof(opt));
+
+    BeaconHeader query;
+    beacon_header(&query, BEACON_TYPE_QUERY, 0, 0, 0, 0);
+    send_broadcast(fd, &query, BEACON_HEADER_SIZE);
+
+    uint64_t start = platform_monotonic_ns();
+    int count = 0;
+
+    while (count < max_devices) {
+        long elapsed = (long)((platform_monotonic_ns() - start) / 1000000);
+        if (elapsed >= listen_ms) {
+            break;
+        }
+
+        struct pollfd pfd;
+        pfd.fd = fd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        if (poll(&pfd, 1, (int)(listen_ms - elapsed)) <= 0) {
+            continue;
+        }
+
+        unsigned char buf[BEACON_MAX_SIZE];
+        struct sockaddr_in from;
+        socklen_t from_len = sizeof(from);
+        ssize_t n = recvfrom(fd, buf, sizeof(buf), 0, (struct sockaddr *)&from, &from_len);
+        uint64_t now = platform_monotonic_ns();
+        BeaconHeader header;
+        if (n < 0 || parse_beacon(buf, n, &header) != BEACON_TYPE_ANNOUNCE) {
+            continue;
+        }
+
+        // The query went out on several broadcast addresses; keep one answer per receiver
+        char ip[INET_ADDRSTRLEN];
+        inet_ntop(AF_INET, &from.sin_addr, ip, sizeof(ip));
+        int port = ntohs(header.port);
+        int duplicate = 0;
+        for (int i = 0; i < count; i++) {
+            if (strcmp(devices[i].ip_address, ip) == 0 && devices[i].service_port == port) {
+                duplicate = 1;
+                break;
+            }
+        }
+        if (duplicate) {
+            continue;
+        }
+
+        NetworkDevice *device = &devices[count++];
+        memset(device, 0, sizeof(NetworkDevice));
+        snprintf(device->ip_address, sizeof(device->ip_address), "%s", ip);
+        size_t hostname_len = ntohs(header.hostname_len);
+        if (hostname_len >= sizeof(device->hostname)) {
+            hostname_len = sizeof(device->hostname) - 1;
+        }
+        memcpy(device->hostname, buf + BEACON_HEADER_SIZE, hostname_len);
+        device->hostname[hostname_len] = '\0';
+        device->is_active = 1;
+        device->has_nettf_service = 1;
+        device->service_port = port;
+        device->capabilities = ntohl(header.capabilities);
+        device->free_bytes = ntohll(header.free_bytes);
+        device->response_time = (now - start) / 1e6;
+    }
+
+    close(fd);
+    return count;
+}
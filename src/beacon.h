@@ -0,0 +1,87 @@
+/**
+ * @file beacon.h
+ * @brief Receiver announcement beacons for NETTF network discovery
+ *
+ * A running receiver periodically broadcasts a small UDP datagram carrying
+ * its TCP port, hostname, free disk space and capabilities, and answers
+ * query datagrams with the same announcement sent straight back. Discovery
+ * broadcasts one query and collects the answers for a few hundred
+ * milliseconds, which finds every receiver on the local network without
+ * scanning it.
+ *
+ * Datagram format (all integers in network byte order):
+ *   BeaconHeader, then hostname_len bytes of hostname (ANNOUNCE only)
+ */
+
+#ifndef BEACON_H
+#define BEACON_H
+
+#include "discovery.h"  // NetworkDevice
+#include "protocol.h"   // ReceiveOptions
+#include <stdint.h>
+
+// UDP port receivers listen on for queries (and send announcements to)
+#define BEACON_PORT 9877
+
+// Wire size of a beacon header
+#define BEACON_HEADER_SIZE 24
+
+// Beacon format version
+#define BEACON_VERSION 1
+
+// Seconds between periodic announcements
+#define BEACON_INTERVAL 5
+
+// How long discovery waits for answers to its query
+#define BEACON_LISTEN_MS 300
+
+// Beacon types
+#define BEACON_TYPE_ANNOUNCE 1  // Receiver announcement
+#define BEACON_TYPE_QUERY    2  // Request for announcements
+
+// Receiver capabilities
+#define BEACON_CAP_VERIFY          0x1  // Answers remote verification (verify.h)
+#define BEACON_CAP_EXT_DIR         0x2  // Accepts extended directories (dedup, sparse)
+#define BEACON_CAP_EXT_FILE        0x4  // Accepts extended files (sparse)
+#define BEACON_CAP_LINK_DUPLICATES 0x8  // Recreates duplicates as hard links
+
+/**
+ * @brief Beacon datagram header
+ */
+typedef struct {
+    char magic[4];          // "NTBC"
+    uint16_t version;       // BEACON_VERSION
+    uint16_t type;          // BEACON_TYPE_* type
+    uint16_t port;          // TCP port the receiver listens on
+    uint16_t hostname_len;  // Length of the hostname that follows
+    uint32_t capabilities;  // BEACON_CAP_* bits
+    uint64_t free_bytes;    // Free space in the receive directory
+} BeaconHeader;
+
+/**
+ * @brief Start announcing a receiver in a background thread
+ *
+ * Failing to start (e.g. the beacon port is taken) is not fatal: the
+ * receiver can still be found by scanning.
+ *
+ * @param port TCP port the receiver listens on
+ * @param options Receiver options (advertised as capabilities)
+ * @return 0 on success, -1 on error
+ */
+int beacon_start(int port, const ReceiveOptions *options);
+
+/**
+ * @brief Find receivers by querying for their announcements
+ *
+ * Broadcasts a query on every interface and collects announcements for
+ * listen_ms milliseconds. Found receivers have has_nettf_service set and
+ * their hostname, port, free space and capabilities filled in.
+ *
+ * @param devices Array to store discovered receivers
+ * @param max_devices Maximum number of devices to store
+ * @param listen_ms How long to wait for answers
+ * @return Number of receivers found, -1 on error
+ */
+int beacon_discover(NetworkDevice *devices, int max_devices, int listen_ms);
+
+#endif // BEACON_H
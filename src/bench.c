@@ -0,0 +1,950 @@
+/**
+ * @file bench.c
+ * @brief Built-in loopback throughput benchmark implementation
+ *
+ * The source tree is generated once in a scratch directory before any run
+ * is timed. Each run connects a fresh socket pair (or accepts a loopback TCP
+ * connection), starts the receiver in a thread with the scratch destination
+ * as its working directory, and sends from the calling thread through the
+ * same dispatch as "nettf send". A run is timed from the first byte sent
+ * until the receiver has finished, and CPU time is taken from getrusage(),
+ * which covers both sides. Performance counters are opened once for the
+ * process and sampled around each run, from before the receiver thread
+ * starts until every thread of the run has been joined.
+ */
+
+#define _GNU_SOURCE  // Enable mkdtemp() and realpath() on Linux systems
+#include "bench.h"
+#include "platform.h"  // Cross-platform socket abstraction
+#include "protocol.h"  // Transfer protocols, SendOptions and ReceiveOptions
+#include "phases.h"    // Operation counts for syscalls per MB
+#include "netem.h"     // Impaired links
+#include "perfcount.h" // Cycles, instructions, cache misses, context switches, page faults
+#include "signals.h"   // Stop between runs on Ctrl+C
+#include "zeroscan.h"  // Zero-scan implementation in the header line
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <time.h>
+
+// Forward declarations for functions implemented in other modules
+void send_path(SOCKET_T client_socket, const char *filepath, const char *target_dir,
+               const SendOptions *options);
+int receive_transfer(SOCKET_T client_socket, const ReceiveOptions *options);
+
+// Block size for draining the null sink
+#define BENCH_BLOCK_SIZE (1024 * 1024)
+
+// Target directory used by the TARG and TDIR runs
+#define BENCH_TARGET_DIR "bench-target"
+
+/**
+ * @brief One connected benchmark run on the receiving side
+ */
+typedef struct {
+    SOCKET_T socket;     // Receiving end of the connection
+    int null_sink;       // Discard the stream instead of parsing it
+    int result;          // 0 on success, -1 on error
+} BenchReceiver;
+
+static const char *transport_names[] = {"tcp", "socketpair"};
+static const char *data_names[] = {"zeros", "random", "text"};
+static const char *shape_names[] = {"small", "mixed", "deep"};
+
+/**
+ * @brief User plus system CPU time of the process in seconds
+ */
+static double cpu_seconds(void) {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0.0;
+    }
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+           usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+/**
+ * @brief Format a path, failing if it does not fit
+ */
+static int format_path(char *out, size_t size, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(out, size, format, args);
+    va_end(args);
+    if (n < 0 || (size_t)n >= size) {
+        fprintf(stderr, "Error: Path too long: %s\n", out);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Generate the directory tree of a shape under root/<shape name>
+ *
+ * @param files Output: number of files generated
+ * @param bytes Output: total size of the files
+ */
+static int build_shape(const char *root, int shape_index, TreegenData data, uint64_t *files, uint64_t *bytes) {
+    char dir[4096];
+    char path[4096];
+    uint64_t seed = 1000000ULL * (uint64_t)(shape_index + 1);
+    *files = 0;
+    *bytes = 0;
+
+    if (format_path(dir, sizeof(dir), "%s/%s", root, shape_names[shape_index]) != 0 ||
+        create_directory_recursive(dir) != 0) {
+        return -1;
+    }
+
+    if (shape_index == 0) {
+        // Many small files spread over a few directories
+        for (int d = 0; d < 20; d++) {
+            if (format_path(path, sizeof(path), "%s/d%02d", dir, d) != 0 ||
+                create_directory_recursive(path) != 0) {
+                return -1;
+            }
+            for (int f = 0; f < 100; f++) {
+                if (format_path(path, sizeof(path), "%s/d%02d/f%03d.dat", dir, d, f) != 0 ||
+                    treegen_write_file(path, 4096, data, seed++) != 0) {
+                    return -1;
+                }
+                (*files)++;
+                *bytes += 4096;
+            }
+        }
+    } else if (shape_index == 1) {
+        // Mostly medium files with a few large ones
+        for (int f = 0; f < 208; f++) {
+            uint64_t size = f < 200 ? 64 * 1024 : 8 * 1024 * 1024;
+            if (format_path(path, sizeof(path), "%s/f%03d.dat", dir, f) != 0 ||
+                treegen_write_file(path, size, data, seed++) != 0) {
+                return -1;
+            }
+            (*files)++;
+            *bytes += size;
+        }
+    } else {
+        // A deep chain of nested directories
+        for (int level = 0; level < 10; level++) {
+            size_t len = strlen(dir);
+            if (format_path(dir + len, sizeof(dir) - len, "/level%d", level) != 0 ||
+                create_directory_recursive(dir) != 0) {
+                return -1;
+            }
+            for (int f = 0; f < 20; f++) {
+                if (format_path(path, sizeof(path), "%s/f%02d.dat", dir, f) != 0 ||
+                    treegen_write_file(path, 256 * 1024, data, seed++) != 0) {
+                    return -1;
+                }
+                (*files)++;
+                *bytes += 256 * 1024;
+            }
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Remove everything below a directory, and the directory itself if remove_self
+ */
+static int remove_tree(const char *path, int remove_self) {
+    DIR *dir = opendir(path);
+    if (!dir) {
+        fprintf(stderr, "Error: Cannot open %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    int result = 0;
+    struct dirent *entry;
+    char child[4096];
+    while ((entry = readdir(dir)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+        struct stat st;
+        if (format_path(child, sizeof(child), "%s/%s", path, entry->d_name) != 0 || lstat(child, &st) != 0) {
+            result = -1;
+        } else if (S_ISDIR(st.st_mode)) {
+            if (remove_tree(child, 1) != 0) {
+                result = -1;
+            }
+        } else if (unlink(child) != 0) {
+            fprintf(stderr, "Error: Cannot remove %s: %s\n", child, strerror(errno));
+            result = -1;
+        }
+    }
+    closedir(dir);
+
+    if (remove_self && rmdir(path) != 0) {
+        fprintf(stderr, "Error: Cannot remove %s: %s\n", path, strerror(errno));
+        result = -1;
+    }
+    return result;
+}
+
+/**
+ * @brief Receiver thread: receive one transfer or drain it into the null sink
+ */
+static void *receiver_thread(void *arg) {
+    BenchReceiver *receiver = (BenchReceiver *)arg;
+
+    if (!receiver->null_sink) {
+        ReceiveOptions options;
+        memset(&options, 0, sizeof(options));
+        options.no_announce = 1;
+        receiver->result = receive_transfer(receiver->socket, &options);
+        return NULL;
+    }
+
+    static char sink[BENCH_BLOCK_SIZE];
+    receiver->result = 0;
+    while (1) {
+        uint64_t phase_start = phases_clock();
+        ssize_t received = recv(receiver->socket, sink, sizeof(sink), 0);
+        if (received == 0) {
+            break;  // Sender finished
+        }
+        if (received < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("recv");
+            receiver->result = -1;
+            break;
+        }
+        phases_record(PHASE_NET_RECV, phase_start);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Connect the sender and receiver ends of a run
+ *
+ * @param listener Loopback listening socket (TCP transport)
+ * @return 0 on success, -1 on error
+ */
+static int connect_pair(const BenchOptions *options, SOCKET_T listener, const struct sockaddr_in *address,
+                        SOCKET_T *sender, SOCKET_T *receiver) {
+    if (options->transport == BENCH_TRANSPORT_SOCKETPAIR) {
+        int fds[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+            perror("socketpair");
+            return -1;
+        }
+        *sender = fds[0];
+        *receiver = fds[1];
+        return 0;
+    }
+
+    // The handshake completes in the listen backlog, so connect before accept
+    *sender = socket(AF_INET, SOCK_STREAM, 0);
+    if (*sender == INVALID_SOCKET_T) {
+        perror("socket");
+        return -1;
+    }
+    optimize_socket(*sender);
+    if (connect(*sender, (const struct sockaddr *)address, sizeof(*address)) != 0) {
+        perror("connect");
+        close_socket(*sender);
+        return -1;
+    }
+    *receiver = accept(listener, NULL, NULL);
+    if (*receiver == INVALID_SOCKET_T) {
+        perror("accept");
+        close_socket(*sender);
+        return -1;
+    }
+    optimize_socket(*receiver);
+    return 0;
+}
+
+/**
+ * @brief Connection of one run, through an impairment relay with --netem
+ */
+typedef struct {
+    SOCKET_T sender;              // Sending end
+    SOCKET_T receiver;            // Receiving end
+    SOCKET_T relay[2];            // Relay ends facing the sender and the receiver
+    const NetemProfile *profile;  // Impairments, NULL without a relay
+    pthread_t relay_thread;       // Thread running the relay
+} BenchLink;
+
+/**
+ * @brief Relay thread: forward between the two relay ends with impairments
+ */
+static void *relay_thread(void *arg) {
+    BenchLink *link = (BenchLink *)arg;
+    netem_relay(link->relay[0], link->relay[1], link->profile, NULL);
+    return NULL;
+}
+
+/**
+ * @brief Connect the ends of a run, with a relay between them if impaired
+ *
+ * @return 0 on success, -1 on error
+ */
+static int link_open(BenchLink *link, const BenchOptions *options, SOCKET_T listener,
+                     const struct sockaddr_in *address) {
+    link->profile = options->netem ? &options->netem_profile : NULL;
+    if (connect_pair(options, listener, address, &link->sender, &link->relay[0]) != 0) {
+        return -1;
+    }
+    if (!link->profile) {
+        link->receiver = link->relay[0];
+        return 0;
+    }
+    if (connect_pair(options, listener, address, &link->relay[1], &link->receiver) != 0) {
+        close_socket(link->sender);
+        close_socket(link->relay[0]);
+        return -1;
+    }
+    if (pthread_create(&link->relay_thread, NULL, relay_thread, link) != 0) {
+        fprintf(stderr, "Error: Cannot start the relay thread\n");
+        close_socket(link->sender);
+        close_socket(link->relay[0]);
+        close_socket(link->relay[1]);
+        close_socket(link->receiver);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Close the ends of a run, letting the relay finish first
+ */
+static void link_close(BenchLink *link) {
+    if (link->profile) {
+        shutdown(link->receiver, SHUT_WR);  // Ends the relay's return direction
+        pthread_join(link->relay_thread, NULL);
+        close_socket(link->relay[0]);
+        close_socket(link->relay[1]);
+    }
+    close_socket(link->sender);
+    close_socket(link->receiver);
+}
+
+/**
+ * @brief Shared state of a benchmark
+ */
+typedef struct {
+    const BenchOptions *options;
+    SOCKET_T listener;            // Loopback listening socket (TCP transport)
+    struct sockaddr_in address;   // Its address
+    FILE *out;                    // Results (stdout is silenced during runs)
+    FILE *results;                // JSON results file, NULL for none
+    PerfCounters counters;        // Performance counters of the process
+    int counter_count;            // Counters available, 0 for none
+    int failures;                 // Runs that failed
+} BenchContext;
+
+/**
+ * @brief Measurements of one run
+ */
+typedef struct {
+    const char *type;             // Transfer type label
+    const char *engine;           // "standard" or "ext"
+    const char *workload;         // Workload label
+    const TreegenSpec *tree;      // Generated tree, NULL for other workloads
+    int ok;                       // Nonzero if everything arrived
+    uint64_t files;               // Files transferred
+    uint64_t bytes;               // Bytes of file content transferred
+    double seconds;               // Wall-clock duration
+    double cpu_seconds;           // User plus system CPU time of both sides
+    uint64_t calls;               // I/O operations of both sides
+    uint64_t meta_calls;          // Opens, creations and directory creations among them
+    long peak_rss_kb;             // Peak resident set size of the process so far
+    PerfSample perf;              // Performance counters of both sides
+} BenchResult;
+
+/**
+ * @brief Peak resident set size of the process in KB
+ */
+static long peak_rss_kb(void) {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024;  // Bytes on macOS
+#else
+    return usage.ru_maxrss;         // KB on Linux
+#endif
+}
+
+/**
+ * @brief Format a count per GB compactly, e.g. "12.3G", or "-" if unmeasured
+ */
+static void format_per_gb(const PerfSample *perf, PerfCounter counter, double gb, char *out, size_t size) {
+    if (!perf->valid[counter] || gb <= 0) {
+        snprintf(out, size, "-");
+        return;
+    }
+    double value = perf->values[counter] / gb;
+    if (value >= 1e9) {
+        snprintf(out, size, "%.2fG", value / 1e9);
+    } else if (value >= 1e6) {
+        snprintf(out, size, "%.2fM", value / 1e6);
+    } else if (value >= 1e3) {
+        snprintf(out, size, "%.2fK", value / 1e3);
+    } else {
+        snprintf(out, size, "%.0f", value);
+    }
+}
+
+/**
+ * @brief Print the result line of a run and append it to the results file
+ */
+static void report_result(BenchContext *context, const BenchResult *result) {
+    const BenchOptions *options = context->options;
+    double mb = result->bytes / (1024.0 * 1024.0);
+    double gb = mb / 1024.0;
+    double mb_per_sec = mb / result->seconds;
+    double files_per_sec = result->files / result->seconds;
+    double meta_per_sec = result->meta_calls / result->seconds;
+    double cpu_per_gb = gb > 0 ? result->cpu_seconds / gb : 0.0;
+    double calls_per_mb = mb > 0 ? result->calls / mb : 0.0;
+
+    char size_text[32];
+    format_bytes(result->bytes, size_text, sizeof(size_text));
+    if (result->ok) {
+        fprintf(context->out, "%-5s %-9s %-12s %11s %10.1f %10.0f %10.0f %9.2f %12.1f %9ld MB",
+                result->type, result->engine, result->workload, size_text, mb_per_sec, files_per_sec,
+                meta_per_sec, cpu_per_gb, calls_per_mb, result->peak_rss_kb / 1024);
+        if (context->counter_count > 0) {
+            for (int c = 0; c < PERFCOUNT_COUNT; c++) {
+                char count_text[16];
+                format_per_gb(&result->perf, (PerfCounter)c, gb, count_text, sizeof(count_text));
+                fprintf(context->out, " %10s", count_text);
+            }
+        }
+        fprintf(context->out, "\n");
+    } else {
+        fprintf(context->out, "%-5s %-9s %-12s %11s  FAILED\n", result->type, result->engine,
+                result->workload, size_text);
+    }
+    fflush(context->out);
+
+    if (!context->results) {
+        return;
+    }
+    fprintf(context->results,
+            "{\"time\":%lld,\"transport\":\"%s\",\"data\":\"%s\",\"sink\":\"%s\",\"type\":\"%s\","
+            "\"engine\":\"%s\",\"workload\":\"%s\",\"zeroscan\":\"%s\",",
+            (long long)time(NULL), transport_names[options->transport], data_names[options->data],
+            options->null_sink ? "null" : "disk", result->type, result->engine, result->workload,
+            zeroscan_impl_name());
+    if (options->netem) {
+        const NetemProfile *netem = &options->netem_profile;
+        fprintf(context->results,
+                "\"netem\":{\"latency_ms\":%.3f,\"jitter_ms\":%.3f,\"rate_mbit\":%.1f,\"stall_every_ms\":%d,"
+                "\"stall_ms\":%d,\"queue_bytes\":%zu,\"seed\":%llu},",
+                netem->latency_ms, netem->jitter_ms, netem->rate_mbit, netem->stall_every_ms, netem->stall_ms,
+                netem->queue_bytes, (unsigned long long)netem->seed);
+    }
+    if (result->tree) {
+        fprintf(context->results,
+                "\"tree\":{\"depth\":%d,\"fanout\":%d,\"files\":%llu,\"min_size\":%llu,"
+                "\"max_size\":%llu,\"seed\":%llu},",
+                result->tree->depth, result->tree->fanout, (unsigned long long)result->tree->files,
+                (unsigned long long)result->tree->min_size, (unsigned long long)result->tree->max_size,
+                (unsigned long long)result->tree->seed);
+    }
+    fprintf(context->results,
+            "\"ok\":%s,\"files\":%llu,\"bytes\":%llu,\"seconds\":%.6f,\"mb_per_sec\":%.2f,"
+            "\"files_per_sec\":%.1f,\"meta_ops_per_sec\":%.1f,\"cpu_per_gb\":%.3f,"
+            "\"syscalls_per_mb\":%.2f,\"peak_rss_kb\":%ld",
+            result->ok ? "true" : "false", (unsigned long long)result->files,
+            (unsigned long long)result->bytes, result->seconds, mb_per_sec, files_per_sec, meta_per_sec,
+            cpu_per_gb, calls_per_mb, result->peak_rss_kb);
+    if (context->counter_count > 0) {
+        // Raw counts and counts per GB of the counters that were measured
+        fprintf(context->results, ",\"perf\":{\"user_only\":%s", context->counters.user_only ? "true" : "false");
+        for (int c = 0; c < PERFCOUNT_COUNT; c++) {
+            if (result->perf.valid[c]) {
+                fprintf(context->results, ",\"%s\":%llu,\"%s_per_gb\":%.0f", perfcount_name((PerfCounter)c),
+                        (unsigned long long)result->perf.values[c], perfcount_name((PerfCounter)c),
+                        gb > 0 ? result->perf.values[c] / gb : 0.0);
+            }
+        }
+        fprintf(context->results, "}");
+    }
+    fprintf(context->results, "}\n");
+    fflush(context->results);
+}
+
+/**
+ * @brief Run one transfer and print its result line
+ *
+ * @param type Transfer type label (FILE, DIR, TARG, TDIR)
+ * @param engine BENCH_ENGINE_STANDARD or BENCH_ENGINE_EXT
+ * @param path Absolute path of the source file or directory
+ * @param workload Workload label
+ * @param tree Specification of a generated tree, NULL for other workloads
+ * @param files Number of files in the source
+ * @param bytes Total size of the source files
+ */
+static void run_one(BenchContext *context, const char *type, int engine, const char *path,
+                    const char *workload, const TreegenSpec *tree, uint64_t files, uint64_t bytes) {
+    const BenchOptions *options = context->options;
+    int is_dir = strcmp(type, "DIR") == 0 || strcmp(type, "TDIR") == 0;
+    const char *target_dir = strcmp(type, "TARG") == 0 || strcmp(type, "TDIR") == 0 ? BENCH_TARGET_DIR : NULL;
+
+    SendOptions send_options;
+    memset(&send_options, 0, sizeof(send_options));
+    if (engine == BENCH_ENGINE_EXT) {
+        send_options.sparse = 1;
+        send_options.dedup = is_dir;
+    }
+
+    // Start each run with an empty destination
+    if (!options->null_sink && remove_tree(".", 0) != 0) {
+        context->failures++;
+        return;
+    }
+
+    BenchLink link;
+    if (link_open(&link, options, context->listener, &context->address) != 0) {
+        context->failures++;
+        return;
+    }
+
+    BenchReceiver receiver = {link.receiver, options->null_sink, -1};
+    phases_reset();
+    perfcount_start(&context->counters);
+    double cpu_start = cpu_seconds();
+    double start = platform_monotonic_ns() / 1e9;
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, receiver_thread, &receiver) != 0) {
+        fprintf(stderr, "Error: Cannot start the receiver thread\n");
+        shutdown(link.sender, SHUT_WR);
+        link_close(&link);
+        PerfSample unused;
+        perfcount_stop(&context->counters, &unused);
+        context->failures++;
+        return;
+    }
+    send_path(link.sender, path, target_dir, &send_options);
+    shutdown(link.sender, SHUT_WR);  // End of stream for the null sink
+    pthread_join(thread, NULL);
+
+    double seconds = platform_monotonic_ns() / 1e9 - start;
+    double cpu = cpu_seconds() - cpu_start;
+    uint64_t calls = 0;
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        calls += phases_calls((Phase)p);
+    }
+    link_close(&link);
+    PerfSample perf;
+    perfcount_stop(&context->counters, &perf);
+
+    // Check that the receiver wrote everything that was sent
+    int ok = receiver.result == 0;
+    if (ok && !options->null_sink) {
+        uint64_t received_files = 0, received_bytes = 0;
+        ok = count_directory_files(".", &received_files, &received_bytes) == 0 &&
+             received_files == files && received_bytes == bytes;
+    }
+
+    BenchResult result;
+    result.type = type;
+    result.engine = engine == BENCH_ENGINE_EXT ? "ext" : "standard";
+    result.workload = workload;
+    result.tree = tree;
+    result.ok = ok;
+    result.files = files;
+    result.bytes = bytes;
+    result.seconds = seconds > 0 ? seconds : 1e-9;
+    result.cpu_seconds = cpu;
+    result.calls = calls;
+    result.meta_calls = phases_calls(PHASE_OPEN) + phases_calls(PHASE_MKDIR);
+    result.peak_rss_kb = peak_rss_kb();
+    result.perf = perf;
+    report_result(context, &result);
+    if (!ok) {
+        context->failures++;
+    }
+}
+
+/**
+ * @brief Open the loopback listening socket for the TCP transport
+ */
+static int open_listener(BenchContext *context) {
+    context->listener = socket(AF_INET, SOCK_STREAM, 0);
+    if (context->listener == INVALID_SOCKET_T) {
+        perror("socket");
+        return -1;
+    }
+    optimize_socket(context->listener);
+
+    memset(&context->address, 0, sizeof(context->address));
+    context->address.sin_family = AF_INET;
+    context->address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    context->address.sin_port = 0;  // Any free port
+    socklen_t length = sizeof(context->address);
+    if (bind(context->listener, (struct sockaddr *)&context->address, sizeof(context->address)) != 0 ||
+        getsockname(context->listener, (struct sockaddr *)&context->address, &length) != 0 ||
+        listen(context->listener, 1) != 0) {
+        perror("bind");
+        close_socket(context->listener);
+        context->listener = INVALID_SOCKET_T;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Whether Ctrl+C asked the benchmark to stop
+ */
+static int interrupted(void) {
+    return signals_should_shutdown() != 0;
+}
+
+/**
+ * @brief Generate the sources and run every combination of the matrix
+ */
+static void run_matrix(BenchContext *context, const char *src_dir) {
+    const BenchOptions *options = context->options;
+    char path[4096];
+    char workload[32];
+
+    for (int engine = BENCH_ENGINE_STANDARD; engine <= BENCH_ENGINE_EXT && !interrupted(); engine <<= 1) {
+        if (!(options->engines & engine)) {
+            continue;
+        }
+
+        // Single files: FILE and TARG at every size
+        for (int i = 0; i < options->size_count && !interrupted(); i++) {
+            if (format_path(path, sizeof(path), "%s/file-%d.dat", src_dir, i) != 0) {
+                context->failures++;
+                continue;
+            }
+            run_one(context, "FILE", engine, path, "file", NULL, 1, options->sizes[i]);
+            if (!interrupted()) {
+                run_one(context, "TARG", engine, path, "file", NULL, 1, options->sizes[i]);
+            }
+        }
+
+        // Directory trees: DIR and TDIR for every shape
+        for (int s = 0; s < 3 && !interrupted(); s++) {
+            if (!(options->shapes & (1 << s))) {
+                continue;
+            }
+            uint64_t files = 0, bytes = 0;
+            if (format_path(path, sizeof(path), "%s/%s", src_dir, shape_names[s]) != 0 ||
+                count_directory_files(path, &files, &bytes) != 0) {
+                context->failures++;
+                continue;
+            }
+            snprintf(workload, sizeof(workload), "dir %s", shape_names[s]);
+            run_one(context, "DIR", engine, path, workload, NULL, files, bytes);
+            if (!interrupted()) {
+                run_one(context, "TDIR", engine, path, workload, NULL, files, bytes);
+            }
+        }
+
+        // Generated tree: DIR and TDIR
+        if (options->tree.files > 0 && !interrupted()) {
+            uint64_t files = 0, bytes = 0;
+            if (format_path(path, sizeof(path), "%s/tree", src_dir) != 0 ||
+                count_directory_files(path, &files, &bytes) != 0) {
+                context->failures++;
+                continue;
+            }
+            run_one(context, "DIR", engine, path, "dir tree", &options->tree, files, bytes);
+            if (!interrupted()) {
+                run_one(context, "TDIR", engine, path, "dir tree", &options->tree, files, bytes);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Fill in the default options
+ */
+void bench_default_options(BenchOptions *options) {
+    memset(options, 0, sizeof(*options));
+    options->transport = BENCH_TRANSPORT_TCP;
+    options->data = TREEGEN_DATA_RANDOM;
+    options->shapes = BENCH_SHAPE_ALL;
+    options->engines = BENCH_ENGINE_ALL;
+    options->tree.depth = TREEGEN_DEFAULT_DEPTH;
+    options->tree.fanout = TREEGEN_DEFAULT_FANOUT;
+    options->tree.seed = 1;
+    treegen_parse_sizes(TREEGEN_DEFAULT_SIZES, &options->tree);
+    bench_parse_sizes(BENCH_DEFAULT_SIZES, options);
+}
+
+/**
+ * @brief Parse a transport name
+ */
+int bench_parse_transport(const char *name, BenchOptions *options) {
+    for (int i = 0; i < 2; i++) {
+        if (strcmp(name, transport_names[i]) == 0) {
+            options->transport = (BenchTransport)i;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Parse a data kind
+ */
+int bench_parse_data(const char *name, BenchOptions *options) {
+    for (int i = 0; i < 3; i++) {
+        if (strcmp(name, data_names[i]) == 0) {
+            options->data = (TreegenData)i;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Parse a comma-separated list of file sizes
+ */
+int bench_parse_sizes(const char *list, BenchOptions *options) {
+    int count = 0;
+    const char *p = list;
+    if (strcmp(list, "none") == 0) {
+        options->size_count = 0;
+        return 0;
+    }
+    while (*p) {
+        const char *end;
+        uint64_t value;
+        if (treegen_parse_size(p, &end, &value) != 0) {
+            return -1;
+        }
+        if ((*end != ',' && *end != '\0') || count >= BENCH_MAX_SIZES) {
+            return -1;
+        }
+        options->sizes[count++] = value;
+        p = *end == ',' ? end + 1 : end;
+    }
+    if (count == 0) {
+        return -1;
+    }
+    options->size_count = count;
+    return 0;
+}
+
+/**
+ * @brief Parse a comma-separated list of shapes
+ */
+int bench_parse_shapes(const char *list, BenchOptions *options) {
+    int shapes = 0;
+    const char *p = list;
+    if (strcmp(list, "none") == 0) {
+        options->shapes = 0;
+        return 0;
+    }
+    while (*p) {
+        size_t len = strcspn(p, ",");
+        int found = 0;
+        if (len == 3 && strncmp(p, "all", 3) == 0) {
+            shapes |= BENCH_SHAPE_ALL;
+            found = 1;
+        }
+        for (int i = 0; i < 3 && !found; i++) {
+            if (strlen(shape_names[i]) == len && strncmp(p, shape_names[i], len) == 0) {
+                shapes |= 1 << i;
+                found = 1;
+            }
+        }
+        if (!found) {
+            return -1;
+        }
+        p += len;
+        if (*p == ',') {
+            p++;
+        }
+    }
+    if (shapes == 0) {
+        return -1;
+    }
+    options->shapes = shapes;
+    return 0;
+}
+
+/**
+ * @brief Parse an engine selection
+ */
+int bench_parse_engine(const char *name, BenchOptions *options) {
+    if (strcmp(name, "standard") == 0) {
+        options->engines = BENCH_ENGINE_STANDARD;
+    } else if (strcmp(name, "ext") == 0) {
+        options->engines = BENCH_ENGINE_EXT;
+    } else if (strcmp(name, "all") == 0) {
+        options->engines = BENCH_ENGINE_ALL;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Run the benchmark matrix and print one result line per run
+ */
+int bench_run(const BenchOptions *options) {
+    BenchContext context;
+    memset(&context, 0, sizeof(context));
+    context.options = options;
+    context.listener = INVALID_SOCKET_T;
+
+    // A failed receiver must not kill the process through SIGPIPE
+    signal(SIGPIPE, SIG_IGN);
+
+    // Scratch directory with the generated sources and the destination
+    const char *parent = options->scratch_dir;
+    if (!parent) {
+        parent = getenv("TMPDIR");
+    }
+    if (!parent || !*parent) {
+        parent = "/tmp";
+    }
+    char scratch_template[PATH_MAX];
+    if (format_path(scratch_template, sizeof(scratch_template), "%s/nettf-bench-XXXXXX", parent) != 0) {
+        return -1;
+    }
+    if (!mkdtemp(scratch_template)) {
+        fprintf(stderr, "Error: Cannot create a scratch directory in %s: %s\n", parent, strerror(errno));
+        return -1;
+    }
+    char scratch[PATH_MAX];
+    if (!realpath(scratch_template, scratch)) {
+        fprintf(stderr, "Error: Cannot resolve %s: %s\n", scratch_template, strerror(errno));
+        rmdir(scratch_template);
+        return -1;
+    }
+
+    char src_dir[PATH_MAX];
+    char dst_dir[PATH_MAX];
+    char path[PATH_MAX];
+    if (format_path(src_dir, sizeof(src_dir), "%s/src", scratch) != 0 ||
+        format_path(dst_dir, sizeof(dst_dir), "%s/dst", scratch) != 0) {
+        remove_tree(scratch, 1);
+        return -1;
+    }
+
+    printf("Generating %s source data in %s...\n", data_names[options->data], scratch);
+    fflush(stdout);
+    int result = create_directory_recursive(src_dir) == 0 && create_directory_recursive(dst_dir) == 0 ? 0 : -1;
+    for (int i = 0; i < options->size_count && result == 0; i++) {
+        if (format_path(path, sizeof(path), "%s/file-%d.dat", src_dir, i) != 0 ||
+            treegen_write_file(path, options->sizes[i], options->data, (uint64_t)i + 1) != 0) {
+            result = -1;
+        }
+    }
+    for (int s = 0; s < 3 && result == 0; s++) {
+        uint64_t files, bytes;
+        if (options->shapes & (1 << s)) {
+            result = build_shape(src_dir, s, options->data, &files, &bytes);
+        }
+    }
+    if (options->tree.files > 0 && result == 0) {
+        TreegenSpec tree = options->tree;
+        uint64_t dirs, bytes;
+        tree.data = options->data;
+        printf("Generating a tree of %llu files (depth %d, fanout %d)...\n",
+               (unsigned long long)tree.files, tree.depth, tree.fanout);
+        fflush(stdout);
+        result = format_path(path, sizeof(path), "%s/tree", src_dir);
+        if (result == 0) {
+            result = treegen_build(path, &tree, &dirs, &bytes);
+        }
+    }
+
+    // Open the results file before leaving the working directory
+    if (result == 0 && options->results_path) {
+        context.results = fopen(options->results_path, "a");
+        if (!context.results) {
+            fprintf(stderr, "Error: Cannot open %s: %s\n", options->results_path, strerror(errno));
+            result = -1;
+        }
+    }
+
+    char cwd[PATH_MAX];
+    int have_cwd = getcwd(cwd, sizeof(cwd)) != NULL;
+    if (result == 0 && options->transport == BENCH_TRANSPORT_TCP) {
+        result = open_listener(&context);
+    }
+    if (result == 0 && chdir(dst_dir) != 0) {
+        fprintf(stderr, "Error: Cannot enter %s: %s\n", dst_dir, strerror(errno));
+        result = -1;
+    }
+
+    if (result == 0) {
+        phases_enable();
+        context.counter_count = perfcount_open(&context.counters);
+
+        // Results go to the real stdout; transfer messages are discarded
+        fflush(stdout);
+        int out_fd = dup(STDOUT_FILENO);
+        int null_fd = open("/dev/null", O_WRONLY);
+        context.out = out_fd >= 0 ? fdopen(out_fd, "w") : NULL;
+        if (!context.out || null_fd < 0) {
+            fprintf(stderr, "Error: Cannot redirect standard output\n");
+            result = -1;
+        } else {
+            fprintf(context.out, "NETTF benchmark: %s transport, %s data, %s, %s zero scan\n",
+                    transport_names[options->transport], data_names[options->data],
+                    options->null_sink ? "null sink" : "disk sink", zeroscan_impl_name());
+            if (options->netem) {
+                char description[160];
+                netem_describe(&options->netem_profile, description, sizeof(description));
+                fprintf(context.out, "Impaired link: %s\n", description);
+            }
+            if (context.counter_count > 0) {
+                fprintf(context.out, "Counters per GB: %d of %d available%s\n", context.counter_count,
+                        PERFCOUNT_COUNT, context.counters.user_only ? ", user space only (perf_event_paranoid)" : "");
+            } else {
+                fprintf(context.out, "Counters per GB: unavailable (perf_event_open refused)\n");
+            }
+            fprintf(context.out, "%-5s %-9s %-12s %11s %10s %10s %10s %9s %12s %12s", "Type", "Engine",
+                    "Workload", "Size", "MB/s", "Files/s", "Meta ops/s", "CPU s/GB", "Syscalls/MB", "Peak RSS");
+            if (context.counter_count > 0) {
+                fprintf(context.out, " %10s %10s %10s %10s %10s", "Cycles", "Instrs", "Cache miss",
+                        "Ctx sw", "Faults");
+            }
+            fprintf(context.out, "\n");
+            fflush(context.out);
+            dup2(null_fd, STDOUT_FILENO);
+
+            run_matrix(&context, src_dir);
+
+            fflush(stdout);
+            dup2(out_fd, STDOUT_FILENO);
+            if (interrupted()) {
+                fprintf(context.out, "Benchmark interrupted.\n");
+            }
+            fclose(context.out);
+            if (context.failures > 0) {
+                result = -1;
+            }
+        }
+        if (null_fd >= 0) {
+            close(null_fd);
+        }
+        perfcount_close(&context.counters);
+    }
+
+    if (context.results) {
+        fclose(context.results);
+    }
+    if (context.listener != INVALID_SOCKET_T) {
+        close_socket(context.listener);
+    }
+    if (have_cwd && chdir(cwd) != 0) {
+        perror("chdir");
+    }
+    remove_tree(scratch, 1);
+    return result;
+}
@@ -0,0 +1,150 @@
+/**
+ * @file bench.h
+ * @brief Built-in loopback throughput benchmark for NETTF
+ *
+ * Runs a sender and a receiver in one process, connected over loopback TCP
+ * or a socket pair, and measures the real protocol code on synthetic data:
+ * single files of several sizes and directory trees of several shapes, sent
+ * with each transfer type (FILE, DIR, TARG, TDIR) and each engine (the
+ * standard protocols, or the extended ones with sparse and deduplication
+ * support). For every run it reports throughput, files per second, CPU time
+ * per GB, system calls per MB, metadata operations per second and the peak
+ * resident set size. On Linux it adds cycles, instructions, cache misses,
+ * context switches and page faults per GB from performance counters (see
+ * perfcount.h), where the kernel allows them.
+ *
+ * A generated tree of any depth, fanout, file count and size distribution
+ * (see treegen.h) can be added to the directory runs to measure transfers of
+ * many small files. With an impairment profile (see netem.h), every run
+ * goes through a relay that adds latency, jitter, a bandwidth cap and
+ * stalls, so adaptive chunk sizing and socket tuning can be measured under
+ * WAN-like conditions on one machine. Results can be appended to a file as JSON lines, one
+ * object per run, for comparing builds over time.
+ *
+ * The receiver writes into a scratch directory that is removed afterwards,
+ * or discards the data unparsed with the null sink to take the disk out of
+ * the measurement. System calls are the I/O operations the transfer code
+ * makes (reads, writes, sends, receives, opens, directory creation) as
+ * counted by phase tracing, which the benchmark enables; metadata operations
+ * are the file opens and creations and directory creations among them.
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "treegen.h"  // TreegenData, TreegenSpec
+#include "netem.h"    // NetemProfile
+#include <stdint.h>
+
+// Most file sizes one benchmark run takes
+#define BENCH_MAX_SIZES 16
+
+// Default file sizes for the FILE and TARG runs
+#define BENCH_DEFAULT_SIZES "1M,64M"
+
+/**
+ * @brief Connection between the benchmark sender and receiver
+ */
+typedef enum {
+    BENCH_TRANSPORT_TCP = 0,    // TCP over 127.0.0.1, tuned like real transfers
+    BENCH_TRANSPORT_SOCKETPAIR  // AF_UNIX socket pair (no TCP stack)
+} BenchTransport;
+
+/**
+ * @brief Directory shapes for the DIR and TDIR runs (bit mask)
+ */
+#define BENCH_SHAPE_SMALL 0x1  // 2000 files of 4 KB in 20 directories
+#define BENCH_SHAPE_MIXED 0x2  // 200 files of 64 KB and 8 files of 8 MB
+#define BENCH_SHAPE_DEEP  0x4  // 10 nested levels of 20 files of 256 KB
+#define BENCH_SHAPE_ALL   0x7
+
+/**
+ * @brief Transfer engines to compare (bit mask)
+ */
+#define BENCH_ENGINE_STANDARD 0x1  // Standard file and directory protocols
+#define BENCH_ENGINE_EXT      0x2  // Extended protocols (--sparse, and --dedup for directories)
+#define BENCH_ENGINE_ALL      0x3
+
+/**
+ * @brief Benchmark options selected on the command line
+ */
+typedef struct {
+    BenchTransport transport;         // How sender and receiver are connected
+    TreegenData data;                 // Source file content
+    int null_sink;                    // Receiver discards the stream instead of writing files
+    uint64_t sizes[BENCH_MAX_SIZES];  // File sizes for the FILE and TARG runs
+    int size_count;                   // Entries used in sizes
+    int shapes;                       // BENCH_SHAPE_* bits for the DIR and TDIR runs
+    int engines;                      // BENCH_ENGINE_* bits
+    TreegenSpec tree;                 // Generated tree for the DIR and TDIR runs (no files for none)
+    int netem;                        // Run every transfer through an impairment relay
+    NetemProfile netem_profile;       // Impairments of the relay
+    const char *scratch_dir;          // Parent of the scratch directory, NULL for $TMPDIR or /tmp
+    const char *results_path;         // File to append JSON results to, NULL for none
+} BenchOptions;
+
+/**
+ * @brief Fill in the default options
+ *
+ * @param options Options to initialize
+ */
+void bench_default_options(BenchOptions *options);
+
+/**
+ * @brief Parse a transport name ("tcp" or "socketpair")
+ *
+ * @param name Transport name
+ * @param options Options to update
+ * @return 0 on success, -1 if the name is unknown
+ */
+int bench_parse_transport(const char *name, BenchOptions *options);
+
+/**
+ * @brief Parse a data kind ("zeros", "random" or "text")
+ *
+ * @param name Data kind
+ * @param options Options to update
+ * @return 0 on success, -1 if the name is unknown
+ */
+int bench_parse_data(const char *name, BenchOptions *options);
+
+/**
+ * @brief Parse a comma-separated list of file sizes such as "4K,1M,1G"
+ *
+ * @param list Size list (suffixes K, M and G are powers of 1024), "none" to
+ *             skip the single-file runs
+ * @param options Options to update
+ * @return 0 on success, -1 on an invalid or empty list
+ */
+int bench_parse_sizes(const char *list, BenchOptions *options);
+
+/**
+ * @brief Parse a comma-separated list of shapes ("small", "mixed", "deep", "all")
+ *
+ * @param list Shape list, "none" to skip the directory runs
+ * @param options Options to update
+ * @return 0 on success, -1 on an unknown shape
+ */
+int bench_parse_shapes(const char *list, BenchOptions *options);
+
+/**
+ * @brief Parse an engine selection ("standard", "ext" or "all")
+ *
+ * @param name Engine selection
+ * @param options Options to update
+ * @return 0 on success, -1 if the name is unknown
+ */
+int bench_parse_engine(const char *name, BenchOptions *options);
+
+/**
+ * @brief Run the benchmark matrix and print one result line per run
+ *
+ * Transfer messages are suppressed; results go to standard output and
+ * errors to standard error. Stops early on Ctrl+C.
+ *
+ * @param options Benchmark options
+ * @return 0 if every run succeeded, -1 on error
+ */
+int bench_run(const BenchOptions *options);
+
+#endif // BENCH_H
@@ -0,0 +1,146 @@
+/**
+ * @file chunktrace.c
+ * @brief Per-chunk transfer traces implementation
+ *
+ * Records go through stdio buffering and are flushed at the end of each
+ * transfer, so tracing costs a clock read, a getsockopt() and a buffered
+ * line per chunk.
+ */
+
+#define _GNU_SOURCE  // Enable clock_gettime() on Linux systems
+#include "chunktrace.h"
+#include "platform.h"  // platform_monotonic_ns()
+#include <errno.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static FILE *trace_file = NULL;                     // Trace being written, NULL while off
+static SOCKET_T trace_socket = INVALID_SOCKET_T;    // Connection for TCP_INFO snapshots
+static uint64_t trace_start_us = 0;                 // Monotonic time of the trace start
+static uint64_t last_us = 0;                        // Time of the previous record
+
+/**
+ * @brief Start recording to a file
+ */
+int chunktrace_open(const char *path) {
+    trace_file = fopen(path, "w");
+    if (!trace_file) {
+        fprintf(stderr, "Error: Cannot create trace file %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    struct timespec wall;
+    clock_gettime(CLOCK_REALTIME, &wall);
+    trace_start_us = platform_monotonic_ns() / 1000;
+    last_us = trace_start_us;
+    fprintf(trace_file, "# nettf chunk trace %d\n", CHUNKTRACE_VERSION);
+    fprintf(trace_file, "# start %.6f\n", wall.tv_sec + wall.tv_nsec / 1e9);
+    fprintf(trace_file, "# F|N t_us file_bytes\n");
+    fprintf(trace_file, "# C t_us chunk_size bytes elapsed_s dur_us rtt_us rttvar_us cwnd mss retrans unacked\n");
+    return 0;
+}
+
+/**
+ * @brief Attach the connection of the next transfer
+ */
+void chunktrace_begin(SOCKET_T s) {
+    trace_socket = s;
+}
+
+/**
+ * @brief Record the start of a file
+ */
+void chunktrace_file(uint64_t file_bytes, int next) {
+    if (!trace_file) {
+        return;
+    }
+    last_us = platform_monotonic_ns() / 1000;
+    fprintf(trace_file, "%c\t%" PRIu64 "\t%" PRIu64 "\n", next ? 'N' : 'F', last_us - trace_start_us, file_bytes);
+}
+
+/**
+ * @brief Record a chunk
+ */
+void chunktrace_chunk(size_t chunk_size, size_t bytes, double elapsed) {
+    if (!trace_file) {
+        return;
+    }
+    uint64_t now = platform_monotonic_ns() / 1000;
+    long long rtt = -1, rttvar = -1, cwnd = -1, mss = -1, retrans = -1, unacked = -1;
+#ifdef __linux__
+    struct tcp_info info;
+    socklen_t len = sizeof(info);
+    if (trace_socket != INVALID_SOCKET_T && getsockopt(trace_socket, IPPROTO_TCP, TCP_INFO, &info, &len) == 0) {
+        rtt = info.tcpi_rtt;
+        rttvar = info.tcpi_rttvar;
+        cwnd = info.tcpi_snd_cwnd;
+        mss = info.tcpi_snd_mss;
+        retrans = info.tcpi_total_retrans;
+        unacked = info.tcpi_unacked;
+    }
+#endif
+    fprintf(trace_file, "C\t%" PRIu64 "\t%zu\t%zu\t%.6f\t%" PRIu64 "\t%lld\t%lld\t%lld\t%lld\t%lld\t%lld\n",
+            now - trace_start_us, chunk_size, bytes, elapsed, now - last_us, rtt, rttvar, cwnd, mss, retrans,
+            unacked);
+    last_us = now;
+}
+
+/**
+ * @brief Detach the connection and flush the trace
+ */
+void chunktrace_end(void) {
+    trace_socket = INVALID_SOCKET_T;
+    if (trace_file) {
+        fflush(trace_file);
+    }
+}
+
+/**
+ * @brief Read the next record of a trace
+ */
+int chunktrace_read(FILE *file, double *start, ChunktraceRecord *record, int *line) {
+    char buf[512];
+    while (fgets(buf, sizeof(buf), file)) {
+        (*line)++;
+        if (buf[0] == '#') {
+            double value;
+            if (start && sscanf(buf, "# start %lf", &value) == 1) {
+                *start = value;
+            }
+            continue;
+        }
+        if (buf[0] == '\n' || buf[0] == '\0') {
+            continue;
+        }
+
+        memset(record, 0, sizeof(*record));
+        record->kind = buf[0];
+        unsigned long long t = 0, file_bytes = 0, chunk_size = 0, bytes = 0, dur = 0;
+        long long rtt, rttvar, cwnd, mss, retrans, unacked;
+        if ((buf[0] == 'F' || buf[0] == 'N') && sscanf(buf + 1, "%llu %llu", &t, &file_bytes) == 2) {
+            record->t_us = t;
+            record->file_bytes = file_bytes;
+            return 1;
+        }
+        if (buf[0] == 'C' && sscanf(buf + 1, "%llu %llu %llu %lf %llu %lld %lld %lld %lld %lld %lld", &t,
+                                    &chunk_size, &bytes, &record->elapsed, &dur, &rtt, &rttvar, &cwnd, &mss,
+                                    &retrans, &unacked) == 11) {
+            record->t_us = t;
+            record->chunk_size = (size_t)chunk_size;
+            record->bytes = (size_t)bytes;
+            record->dur_us = dur;
+            record->rtt_us = rtt;
+            record->rttvar_us = rttvar;
+            record->cwnd = cwnd;
+            record->mss = mss;
+            record->retrans = retrans;
+            record->unacked = unacked;
+            return 1;
+        }
+        fprintf(stderr, "Error: Malformed trace record on line %d\n", *line);
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,110 @@
+/**
+ * @file chunktrace.h
+ * @brief Per-chunk transfer traces for offline tuning of adaptive chunk sizing
+ *
+ * With a trace file set ("--trace-file"), every chunk the transfer loops
+ * hand to adaptive_update() is recorded with its time, requested chunk size,
+ * bytes moved, the elapsed time the controller was given, the measured
+ * duration of the chunk and a TCP_INFO snapshot of the connection (round-trip
+ * time and variance, congestion window, MSS, retransmits, unacknowledged
+ * segments). Each file the adaptive state is initialized for starts with a
+ * file record; further files of a transfer that keeps one adaptive state
+ * (a directory session) start with a next-file record. The adaptive-sim
+ * tool replays such traces against any chunk sizing policy (see adaptive.h)
+ * to predict its throughput offline.
+ *
+ * The trace is tab-separated text, one record per line, after comment lines
+ * starting with '#':
+ *   # nettf chunk trace 1
+ *   # start <wall-clock seconds of time 0>
+ *   F <t_us> <file_bytes>
+ *   N <t_us> <file_bytes>
+ *   C <t_us> <chunk_size> <bytes> <elapsed_s> <dur_us> <rtt_us> <rttvar_us> <cwnd> <mss> <retrans> <unacked>
+ * t_us is microseconds since the trace was opened (monotonic); dur_us runs
+ * from the previous record. TCP fields are -1 where TCP_INFO is unavailable
+ * (other systems, socket pairs).
+ *
+ * Recording assumes one transfer at a time, as the sender and the receiver
+ * run them; with no trace file every hook returns at once.
+ */
+
+#ifndef CHUNKTRACE_H
+#define CHUNKTRACE_H
+
+#include "platform.h"  // SOCKET_T
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Format version written in the first line of a trace
+#define CHUNKTRACE_VERSION 1
+
+/**
+ * @brief One record of a trace
+ */
+typedef struct {
+    char kind;            // 'F' for a new adaptive state, 'N' for the next file of one, 'C' for a chunk
+    uint64_t t_us;        // Microseconds since the start of the trace
+    uint64_t file_bytes;  // File size ('F' and 'N' only)
+    size_t chunk_size;    // Chunk size the controller asked for
+    size_t bytes;         // Bytes moved in the chunk
+    double elapsed;       // Elapsed seconds the controller was given
+    uint64_t dur_us;      // Measured microseconds since the previous record
+    int64_t rtt_us;       // Smoothed round-trip time, -1 if unknown
+    int64_t rttvar_us;    // Round-trip time variance, -1 if unknown
+    int64_t cwnd;         // Congestion window in segments, -1 if unknown
+    int64_t mss;          // Sender maximum segment size, -1 if unknown
+    int64_t retrans;      // Total retransmitted segments, -1 if unknown
+    int64_t unacked;      // Segments sent but not acknowledged, -1 if unknown
+} ChunktraceRecord;
+
+/**
+ * @brief Start recording to a file
+ *
+ * @param path Trace file to create (truncated if it exists)
+ * @return 0 on success, -1 on error (message printed)
+ */
+int chunktrace_open(const char *path);
+
+/**
+ * @brief Attach the connection of the next transfer for TCP_INFO snapshots
+ *
+ * @param s Connected socket
+ */
+void chunktrace_begin(SOCKET_T s);
+
+/**
+ * @brief Record the start of a file (called by adaptive_init() and adaptive_next_file())
+ *
+ * @param file_bytes Size of the file, 0 if unknown
+ * @param next Nonzero if the file continues the previous adaptive state
+ */
+void chunktrace_file(uint64_t file_bytes, int next);
+
+/**
+ * @brief Record a chunk (called by adaptive_update())
+ *
+ * @param chunk_size Chunk size the controller had chosen
+ * @param bytes Bytes moved in the chunk
+ * @param elapsed Elapsed seconds given to the controller
+ */
+void chunktrace_chunk(size_t chunk_size, size_t bytes, double elapsed);
+
+/**
+ * @brief Detach the connection and flush the trace at the end of a transfer
+ */
+void chunktrace_end(void);
+
+/**
+ * @brief Read the next record of a trace
+ *
+ * @param file Trace opened for reading
+ * @param start Output: wall-clock seconds of time 0, updated when the
+ *              "start" comment is read (may be NULL)
+ * @param record Output: the record
+ * @param line Input/output: line number, for error messages
+ * @return 1 on a record, 0 at the end, -1 on a malformed line (message printed)
+ */
+int chunktrace_read(FILE *file, double *start, ChunktraceRecord *record, int *line);
+
+#endif // CHUNKTRACE_H
@@ -11,72 +11,59 @@
 #include "platform.h"  // Cross-platform socket abstraction
 #include "protocol.h"  // File transfer protocol definitions
 #include "signals.h"   // Signal handling
+#include "verify.h"    // Remote verification protocol
+#include "extdir.h"    // Extended directory protocol (deduplication, sparse files)
+#include "extfile.h"   // Extended file protocol (sparse files)
+#include "dialer.h"    // Hostname resolution and racing connects
+#include "progress.h"  // JSON progress events
+#include "chunktrace.h" // Per-chunk traces
+#include "peerprofile.h" // Per-peer tuning profiles
 
 /**
- * @brief Send a file to a remote server
- *
- * This function implements the complete client-side file sending workflow:
- * 1. Initialize network subsystem
- * 2. Create TCP socket
- * 3. Setup server address structure
- * 4. Connect to remote server
- * 5. Send file using protocol
- * 6. Clean up resources
+ * @brief Connect to a receiver
  *
- * The function includes comprehensive error handling at each step and ensures
- * proper cleanup of resources on both success and failure paths.
+ * Performs steps 1-4 of the client workflow shared by all client commands:
+ * initialize the network subsystem, resolve the target, and race TCP
+ * connections to its addresses until one succeeds or the deadline passes.
  *
- * @param target_ip IP address of the receiver (e.g., "192.168.1.100", "10.0.0.50", "172.16.1.200")
- * @param port Port number the receiver is listening on (e.g., 9876)
- * @param filepath Path to the file to send
- * @param target_dir Target directory on receiver (NULL for current directory)
- * @return Does not return on error (exits with EXIT_FAILURE)
+ * @param target Hostname or IP address (IPv4 or IPv6) of the receiver
+ * @param port Port number the receiver is listening on
+ * @param timeout_ms Connect deadline in milliseconds (0 for the default)
+ * @return Connected socket descriptor; does not return on error (exits with EXIT_FAILURE)
  */
-void send_file(const char *target_ip, int port, const char *filepath, const char *target_dir) {
+static SOCKET_T connect_to_receiver(const char *target, int port, int timeout_ms) {
     // Step 1: Initialize network subsystem
     // On Windows, this calls WSAStartup(); on POSIX systems, this does nothing
     net_init();
 
-    // Step 2: Create TCP socket for IPv4 communication
-    // AF_INET: IPv4 address family
-    // SOCK_STREAM: TCP (reliable, connection-oriented)
-    // 0: Let system choose protocol (TCP for SOCK_STREAM)
-    SOCKET_T client_socket = socket(AF_INET, SOCK_STREAM, 0);
+    // Steps 2-4: Resolve the target, create optimized sockets and connect
+    // This initiates the TCP three-way handshake (SYN, SYN-ACK, ACK) to every
+    // address in turn, keeping the first one that completes
+    SOCKET_T client_socket = dial_receiver(target, port, timeout_ms);
     if (client_socket == INVALID_SOCKET_T) {
-        perror("socket");              // Print system error for socket creation failure
-        net_cleanup();                 // Clean up network subsystem before exit
-        exit(EXIT_FAILURE);            // Cannot continue without a valid socket
-    }
-
-    // Optimize socket for high-speed transfers
-    optimize_socket(client_socket);
-
-    // Step 3: Setup server address structure
-    SOCKADDR_IN_T server_addr;         // IPv4 address structure
-    memset(&server_addr, 0, sizeof(server_addr));  // Zero-initialize structure
-    server_addr.sin_family = AF_INET;  // IPv4 address family
-    server_addr.sin_port = htons(port); // Port in network byte order
-
-    // Convert IP address string to binary format
-    // inet_pton: "Presentation to Network" - converts text IP to binary
-    if (inet_pton(AF_INET, target_ip, &server_addr.sin_addr) <= 0) {
-        fprintf(stderr, "Invalid IP address: %s\n", target_ip);
-        close_socket(client_socket);   // Clean up socket before exit
-        net_cleanup();                 // Clean up network subsystem
-        exit(EXIT_FAILURE);            // Cannot continue with invalid IP
-    }
-
-    // Step 4: Connect to remote server
-    // This initiates the TCP three-way handshake (SYN, SYN-ACK, ACK)
-    printf("Connecting to %s:%d...\n", target_ip, port);
-    if (connect(client_socket, (struct sockaddr *)&server_addr, sizeof(server_addr)) == SOCKET_ERROR) {
-        perror("connect");             // Print system error for connection failure
-        close_socket(client_socket);   // Clean up socket before exit
         net_cleanup();                 // Clean up network subsystem
         exit(EXIT_FAILURE);            // Cannot continue if connection fails
     }
 
-    // Step 5: Check if path is file or directory and send using appropriate protocol
+    return client_socket;
+}
+
+/**
+ * @brief Send a file or directory over a connected socket
+ *
+ * Picks the protocol from the path type and the options: the extended
+ * protocols for deduplication and sparse files, the target-directory
+ * variants when a target is given, the standard protocols otherwise.
+ *
+ * @param client_socket Connected socket of the receiver
+ * @param filepath Path to the file or directory to send
+ * @param target_dir Target directory on receiver (NULL for current directory)
+ * @param options Sender options (deduplication, sparse files), may be NULL
+ * @return Does not return on error (exits with EXIT_FAILURE)
+ */
+void send_path(SOCKET_T client_socket, const char *filepath, const char *target_dir,
+               const SendOptions *options) {
+    // Check if path is file or directory and send using appropriate protocol
     int is_dir = is_directory(filepath);
     if (is_dir == -1) {
         fprintf(stderr, "Error: Cannot access path '%s'\n", filepath);
@@ -87,7 +74,10 @@ void send_file(const char *target_ip, int port, const char *filepath, const char
 
     if (is_dir) {
         printf("Connected! Sending directory: %s\n", filepath);
-        if (target_dir && strlen(target_dir) > 0) {
+        if (options && (options->dedup || options->sparse || options->feedback)) {
+            // Duplicates, holes and feedback need the extended directory protocol
+            send_ext_directory_protocol(client_socket, filepath, target_dir, options);
+        } else if (target_dir && strlen(target_dir) > 0) {
             printf("Target directory: %s\n", target_dir);
             send_directory_with_target_protocol(client_socket, filepath, target_dir);
         } else {
@@ -95,15 +85,91 @@ void send_file(const char *target_ip, int port, const char *filepath, const char
         }
     } else {
         printf("Connected! Sending file: %s\n", filepath);
-        if (target_dir && strlen(target_dir) > 0) {
+        if (options && (options->sparse || options->feedback)) {
+            // Holes and feedback need the extended file protocol
+            send_ext_file_protocol(client_socket, filepath, target_dir, options);
+        } else if (target_dir && strlen(target_dir) > 0) {
             printf("Target directory: %s\n", target_dir);
             send_file_with_target_protocol(client_socket, filepath, target_dir);
         } else {
             send_file_protocol(client_socket, filepath);
         }
     }
+}
+
+/**
+ * @brief Send a file to a remote server
+ *
+ * This function implements the complete client-side file sending workflow:
+ * 1. Initialize network subsystem
+ * 2. Resolve the target to its IPv4/IPv6 addresses
+ * 3. Create TCP sockets
+ * 4. Race connections, keeping the first that succeeds
+ * 5. Send file using protocol
+ * 6. Clean up resources
+ *
+ * The function includes comprehensive error handling at each step and ensures
+ * proper cleanup of resources on both success and failure paths.
+ *
+ * @param target Hostname or IP address of the receiver (e.g., "192.168.1.100", "fd00::50", "nas.local")
+ * @param port Port number the receiver is listening on (e.g., 9876)
+ * @param filepath Path to the file to send
+ * @param target_dir Target directory on receiver (NULL for current directory)
+ * @param options Sender options (deduplication, sparse files, connect deadline)
+ * @return Does not return on error (exits with EXIT_FAILURE)
+ */
+void send_file(const char *target, int port, const char *filepath, const char *target_dir,
+               const SendOptions *options) {
+    // Steps 1-4: Initialize, create socket and connect
+    SOCKET_T client_socket = connect_to_receiver(target, port, options ? options->connect_timeout_ms : 0);
+
+    // Start from what earlier transfers learned about this receiver
+    PeerTuning tuning;
+    memset(&tuning, 0, sizeof(tuning));
+    if (!options || !options->no_profile) {
+        peerprofile_begin(&tuning, client_socket);
+    }
+
+    progress_begin("send", filepath);
+    chunktrace_begin(client_socket);
+
+    // Step 5: Send the file or directory using the appropriate protocol
+    send_path(client_socket, filepath, target_dir, options);
 
     // Step 6: Clean up resources on successful completion
+    chunktrace_end();
+    peerprofile_end(&tuning, client_socket, progress_bytes(), 1);
+    progress_end(client_socket, 1);
     close_socket(client_socket);       // Close TCP connection
     net_cleanup();                     // Clean up network subsystem
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Verify a local file or directory against a remote receiver
+ *
+ * Connects to the receiver and runs the verification protocol: both sides
+ * hash their copies and only digests are exchanged.
+ *
+ * @param target Hostname or IP address of the receiver
+ * @param port Port number the receiver is listening on
+ * @param path Local file or directory to compare
+ * @param target_dir Target directory on receiver (NULL for current directory)
+ * @param use_cache Nonzero to reuse digests from the local hash cache
+ * @return Number of files that differ or are missing, -1 on error
+ */
+int verify_remote(const char *target, int port, const char *path, const char *target_dir, int use_cache) {
+    // Fail early on unreadable paths, before touching the network
+    if (is_directory(path) == -1) {
+        fprintf(stderr, "Error: Cannot access path '%s'\n", path);
+        return -1;
+    }
+
+    SOCKET_T client_socket = connect_to_receiver(target, port, 0);
+    printf("Connected! Comparing digests with %s\n", target);
+
+    int result = send_verify_protocol(client_socket, path, target_dir, use_cache);
+
+    close_socket(client_socket);
+    net_cleanup();
+    return result;
+}
@@ -0,0 +1,261 @@
+/**
+ * @file dedup.c
+ * @brief Duplicate file detection implementation
+ *
+ * Both passes sort compact (key, key, index) records instead of building
+ * hash maps: sorting groups equal keys together and the index tiebreak makes
+ * the earliest entry of every group its source.
+ */
+
+#define _GNU_SOURCE  // Enable GNU extensions on Linux systems
+#include "dedup.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Files compared per hashing batch and buffer size for byte comparison
+#define DEDUP_HASH_BATCH 64
+#define DEDUP_COMPARE_BUFFER (1024 * 1024)
+
+/**
+ * @brief Sort record: two keys and the file list index
+ */
+typedef struct {
+    uint64_t key1;
+    uint64_t key2;
+    size_t index;
+} DedupKey;
+
+static int compare_keys(const void *a, const void *b) {
+    const DedupKey *x = (const DedupKey *)a;
+    const DedupKey *y = (const DedupKey *)b;
+    if (x->key1 != y->key1) return x->key1 < y->key1 ? -1 : 1;
+    if (x->key2 != y->key2) return x->key2 < y->key2 ? -1 : 1;
+    if (x->index != y->index) return x->index < y->index ? -1 : 1;
+    return 0;
+}
+
+/**
+ * @brief Compare two files byte for byte
+ *
+ * @return 1 if identical, 0 if different or unreadable
+ */
+static int files_identical(const char *path_a, const char *path_b, uint64_t size) {
+    FILE *a = fopen(path_a, "rb");
+    FILE *b = fopen(path_b, "rb");
+    char *buf_a = malloc(DEDUP_COMPARE_BUFFER);
+    char *buf_b = malloc(DEDUP_COMPARE_BUFFER);
+    int identical = a && b && buf_a && buf_b;
+
+    uint64_t remaining = size;
+    while (identical && remaining > 0) {
+        size_t n = remaining > DEDUP_COMPARE_BUFFER ? DEDUP_COMPARE_BUFFER : (size_t)remaining;
+        if (fread(buf_a, 1, n, a) != n || fread(buf_b, 1, n, b) != n || memcmp(buf_a, buf_b, n) != 0) {
+            identical = 0;
+        }
+        remaining -= n;
+    }
+
+    if (a) fclose(a);
+    if (b) fclose(b);
+    free(buf_a);
+    free(buf_b);
+    return identical;
+}
+
+/**
+ * @brief Mark entries that share (dev, inode) with an earlier entry
+ */
+static int find_hardlinks(DedupPlan *plan, const FileList *files) {
+    DedupKey *keys = malloc((files->count ? files->count : 1) * sizeof(DedupKey));
+    if (!keys) {
+        perror("malloc");
+        return -1;
+    }
+
+    size_t n = 0;
+    for (size_t i = 0; i < files->count; i++) {
+        if (files->entries[i].nlink > 1) {
+            keys[n].key1 = files->entries[i].dev;
+            keys[n].key2 = files->entries[i].ino;
+            keys[n].index = i;
+            n++;
+        }
+    }
+    qsort(keys, n, sizeof(DedupKey), compare_keys);
+
+    size_t first = 0;
+    for (size_t k = 1; k < n; k++) {
+        if (keys[k].key1 != keys[first].key1 || keys[k].key2 != keys[first].key2) {
+            first = k;  // New inode
+            continue;
+        }
+
+        size_t i = keys[k].index;
+        plan->source[i] = keys[first].index;
+        plan->hardlink[i] = 1;
+        plan->duplicates++;
+        plan->hardlinks++;
+        plan->saved_bytes += files->entries[i].size;
+    }
+
+    free(keys);
+    return 0;
+}
+
+/**
+ * @brief Whole-file digests of the given entries (batched, cache-assisted)
+ *
+ * @param ok Output: per-candidate flag, 0 if the file could not be hashed
+ */
+static int hash_candidates(const FileList *files, const size_t *candidates, size_t count,
+                           HashCache *cache, uint64_t *digests, uint8_t *ok) {
+    for (size_t start = 0; start < count; start += DEDUP_HASH_BATCH) {
+        size_t batch = count - start;
+        if (batch > DEDUP_HASH_BATCH) {
+            batch = DEDUP_HASH_BATCH;
+        }
+
+        HashJob jobs[DEDUP_HASH_BATCH];
+        const FileEntry *entries[DEDUP_HASH_BATCH];
+        memset(jobs, 0, sizeof(jobs));
+
+        for (size_t j = 0; j < batch; j++) {
+            const FileEntry *entry = &files->entries[candidates[start + j]];
+            entries[j] = entry;
+            jobs[j].path = entry->full_path;
+            jobs[j].file_size = entry->size;
+            jobs[j].range_count = hash_range_count(entry->size, HASH_RANGE_SIZE);
+            jobs[j].digests = malloc(jobs[j].range_count * sizeof(uint64_t));
+            if (!jobs[j].digests) {
+                perror("malloc");
+                for (size_t k = 0; k < j; k++) {
+                    free(jobs[k].digests);
+                }
+                return -1;
+            }
+        }
+
+        hashcache_hash_files(cache, entries, jobs, batch, HASH_RANGE_SIZE);
+
+        for (size_t j = 0; j < batch; j++) {
+            ok[start + j] = jobs[j].status == 0;
+            digests[start + j] = hash_combine_ranges(jobs[j].digests, jobs[j].range_count, jobs[j].file_size);
+            free(jobs[j].digests);
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Mark entries whose content equals an earlier entry
+ *
+ * Only files whose size collides with another unique file are hashed, and
+ * every digest match is confirmed by comparing the bytes.
+ */
+static int find_content_duplicates(DedupPlan *plan, const FileList *files, HashCache *cache) {
+    size_t total = files->count ? files->count : 1;
+    DedupKey *keys = malloc(total * sizeof(DedupKey));
+    size_t *candidates = calloc(total, sizeof(size_t));
+    uint64_t *digests = malloc(total * sizeof(uint64_t));
+    uint8_t *ok = malloc(total);
+    if (!keys || !candidates || !digests || !ok) {
+        perror("malloc");
+        free(keys);
+        free(candidates);
+        free(digests);
+        free(ok);
+        return -1;
+    }
+
+    // Group unique, non-empty files by size
+    size_t n = 0;
+    for (size_t i = 0; i < files->count; i++) {
+        if (plan->source[i] == DEDUP_UNIQUE && files->entries[i].size > 0) {
+            keys[n].key1 = files->entries[i].size;
+            keys[n].key2 = 0;
+            keys[n].index = i;
+            n++;
+        }
+    }
+    qsort(keys, n, sizeof(DedupKey), compare_keys);
+
+    size_t candidate_count = 0;
+    for (size_t k = 0; k < n; k++) {
+        int collides = (k > 0 && keys[k - 1].key1 == keys[k].key1) ||
+                       (k + 1 < n && keys[k + 1].key1 == keys[k].key1);
+        if (collides) {
+            candidates[candidate_count++] = keys[k].index;
+        }
+    }
+
+    int result = hash_candidates(files, candidates, candidate_count, cache, digests, ok);
+
+    // Group candidates by (size, digest); the first of each group is the source
+    n = 0;
+    for (size_t c = 0; result == 0 && c < candidate_count; c++) {
+        if (ok[c]) {
+            keys[n].key1 = files->entries[candidates[c]].size;
+            keys[n].key2 = digests[c];
+            keys[n].index = candidates[c];
+            n++;
+        }
+    }
+    qsort(keys, n, sizeof(DedupKey), compare_keys);
+
+    size_t first = 0;
+    for (size_t k = 1; k < n; k++) {
+        if (keys[k].key1 != keys[first].key1 || keys[k].key2 != keys[first].key2) {
+            first = k;
+            continue;
+        }
+
+        const FileEntry *source = &files->entries[keys[first].index];
+        const FileEntry *entry = &files->entries[keys[k].index];
+        if (files_identical(source->full_path, entry->full_path, entry->size)) {
+            plan->source[keys[k].index] = keys[first].index;
+            plan->duplicates++;
+            plan->saved_bytes += entry->size;
+        }
+    }
+
+    free(keys);
+    free(candidates);
+    free(digests);
+    free(ok);
+    return result;
+}
+
+/**
+ * @brief Find hard links and content duplicates in a file list
+ */
+int dedup_plan_build(DedupPlan *plan, const FileList *files, HashCache *cache) {
+    memset(plan, 0, sizeof(DedupPlan));
+
+    size_t total = files->count ? files->count : 1;
+    plan->source = malloc(total * sizeof(uint64_t));
+    plan->hardlink = calloc(total, 1);
+    if (!plan->source || !plan->hardlink) {
+        perror("malloc");
+        dedup_plan_free(plan);
+        return -1;
+    }
+    for (size_t i = 0; i < files->count; i++) {
+        plan->source[i] = DEDUP_UNIQUE;
+    }
+
+    if (find_hardlinks(plan, files) != 0 || find_content_duplicates(plan, files, cache) != 0) {
+        dedup_plan_free(plan);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Release all memory owned by a plan
+ */
+void dedup_plan_free(DedupPlan *plan) {
+    free(plan->source);
+    free(plan->hardlink);
+    memset(plan, 0, sizeof(DedupPlan));
+}
@@ -0,0 +1,58 @@
+/**
+ * @file dedup.h
+ * @brief Duplicate file detection for NETTF directory transfers
+ *
+ * Finds files of a transfer tree whose content is already being sent under
+ * another name, so each unique payload crosses the network once:
+ * - hard links are recognised by (dev, inode) without reading anything
+ * - content duplicates are found by hashing only files whose size collides
+ *   with another file, then confirmed byte for byte
+ *
+ * Digests come from the persistent hash cache when the file is unchanged.
+ */
+
+#ifndef DEDUP_H
+#define DEDUP_H
+
+#include "filelist.h"   // FileList
+#include "hashcache.h"  // HashCache
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief No earlier copy: the file's data must be sent
+ */
+#define DEDUP_UNIQUE ((uint64_t)-1)
+
+/**
+ * @brief Duplicate map of a file list
+ *
+ * source[i] is the index of an earlier entry with identical content, or
+ * DEDUP_UNIQUE. Sources always precede their duplicates in list order.
+ */
+typedef struct {
+    uint64_t *source;       // Per-entry source index or DEDUP_UNIQUE
+    uint8_t *hardlink;      // Per-entry flag: duplicate is a hard link of its source
+    uint64_t duplicates;    // Number of entries with a source
+    uint64_t hardlinks;     // Of those, entries that are hard links
+    uint64_t saved_bytes;   // Bytes that do not have to be sent
+} DedupPlan;
+
+/**
+ * @brief Find hard links and content duplicates in a file list
+ *
+ * @param plan Pointer to DedupPlan to fill
+ * @param files File list in send order
+ * @param cache Hash cache to consult and update (NULL to always hash)
+ * @return 0 on success, -1 on error
+ */
+int dedup_plan_build(DedupPlan *plan, const FileList *files, HashCache *cache);
+
+/**
+ * @brief Release all memory owned by a plan
+ *
+ * @param plan Pointer to DedupPlan
+ */
+void dedup_plan_free(DedupPlan *plan);
+
+#endif // DEDUP_H
@@ -0,0 +1,275 @@
+/**
+ * @file dialer.c
+ * @brief Hostname resolution and racing connects implementation
+ *
+ * All attempts are non-blocking connects watched by a single poll() loop.
+ * The loop wakes when an attempt completes or fails, when the next attempt
+ * is due, or at the deadline. A failed attempt starts the next address at
+ * once rather than after the remaining delay.
+ */
+
+#define _GNU_SOURCE  // Enable getaddrinfo() on Linux systems
+#include "dialer.h"
+#include "platform.h"  // platform_monotonic_ns()
+#include <errno.h>
+#ifdef _WIN32
+#define poll WSAPoll
+#else
+#include <fcntl.h>
+#include <poll.h>
+#endif
+
+/**
+ * @brief A connection attempt in flight
+ */
+typedef struct {
+    SOCKET_T fd;  // Non-blocking socket
+    int index;    // Position of its address in the race order
+} DialAttempt;
+
+/**
+ * @brief Switch a socket between blocking and non-blocking mode
+ */
+static void set_nonblocking(SOCKET_T s, int enable) {
+#ifdef _WIN32
+    u_long mode = enable ? 1 : 0;
+    ioctlsocket(s, FIONBIO, &mode);
+#else
+    int flags = fcntl(s, F_GETFL, 0);
+    fcntl(s, F_SETFL, enable ? flags | O_NONBLOCK : flags & ~O_NONBLOCK);
+#endif
+}
+
+/**
+ * @brief Error code of the last failed socket call
+ */
+static int last_socket_error(void) {
+#ifdef _WIN32
+    return WSAGetLastError();
+#else
+    return errno;
+#endif
+}
+
+/**
+ * @brief Whether a non-blocking connect is still in progress
+ */
+static int connect_pending(int error) {
+#ifdef _WIN32
+    return error == WSAEWOULDBLOCK;
+#else
+    return error == EINPROGRESS;
+#endif
+}
+
+/**
+ * @brief Order resolved addresses for the race, alternating families
+ *
+ * Keeps the resolver's preference within each family and starts with the
+ * family of its first answer (RFC 8305, section 4).
+ *
+ * @return Number of addresses stored in ordered
+ */
+static int order_addresses(struct addrinfo *list, struct addrinfo **ordered) {
+    struct addrinfo *preferred[DIALER_MAX_ADDRESSES];
+    struct addrinfo *other[DIALER_MAX_ADDRESSES];
+    int preferred_count = 0, other_count = 0;
+
+    for (struct addrinfo *ai = list; ai; ai = ai->ai_next) {
+        if (ai->ai_family != AF_INET && ai->ai_family != AF_INET6) {
+            continue;
+        }
+        if (ai->ai_family == list->ai_family && preferred_count < DIALER_MAX_ADDRESSES) {
+            preferred[preferred_count++] = ai;
+        } else if (ai->ai_family != list->ai_family && other_count < DIALER_MAX_ADDRESSES) {
+            other[other_count++] = ai;
+        }
+    }
+
+    int count = 0;
+    for (int i = 0; count < DIALER_MAX_ADDRESSES && (i < preferred_count || i < other_count); i++) {
+        if (i < preferred_count) {
+            ordered[count++] = preferred[i];
+        }
+        if (i < other_count && count < DIALER_MAX_ADDRESSES) {
+            ordered[count++] = other[i];
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief Race connection attempts to the ordered addresses
+ *
+ * @param error Output: error of the last failed attempt (ETIMEDOUT at the deadline)
+ * @return Index of the winning address (its socket in *out), -1 if none connected
+ */
+static int race_connects(struct addrinfo **addresses, int count, int timeout_ms, SOCKET_T *out, int *error) {
+    DialAttempt attempts[DIALER_MAX_ADDRESSES];
+    struct pollfd pfds[DIALER_MAX_ADDRESSES];
+    int active = 0;
+    int next = 0;
+    int winner = -1;
+    double start = platform_monotonic_ns() / 1e6;
+    double next_start = start;
+
+    *error = ETIMEDOUT;
+    while (winner < 0) {
+        double now = platform_monotonic_ns() / 1e6;
+        if (now - start >= timeout_ms) {
+            *error = ETIMEDOUT;
+            break;
+        }
+
+        // Start the next address when its turn comes or nothing else is pending
+        if (next < count && (active == 0 || now >= next_start)) {
+            struct addrinfo *ai = addresses[next];
+            SOCKET_T s = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+            if (s == INVALID_SOCKET_T) {
+                *error = last_socket_error();
+                next++;
+                continue;
+            }
+
+            // Buffer sizes must be set before the handshake to take effect
+            optimize_socket(s);
+            set_nonblocking(s, 1);
+            if (connect(s, ai->ai_addr, (socklen_t)ai->ai_addrlen) == 0) {
+                *out = s;
+                winner = next;
+                break;
+            }
+            int err = last_socket_error();
+            if (!connect_pending(err)) {
+                *error = err;  // Refused or unreachable right away: try the next address now
+                close_socket(s);
+                next++;
+                continue;
+            }
+
+            attempts[active].fd = s;
+            attempts[active].index = next;
+            active++;
+            next++;
+            next_start = now + DIALER_ATTEMPT_DELAY_MS;
+            continue;
+        }
+        if (active == 0) {
+            break;  // Every address failed
+        }
+
+        // Sleep until an attempt finishes, the next one is due or the deadline passes
+        double wait = start + timeout_ms - now;
+        if (next < count && next_start - now < wait) {
+            wait = next_start - now;
+        }
+        for (int i = 0; i < active; i++) {
+            pfds[i].fd = attempts[i].fd;
+            pfds[i].events = POLLOUT;
+            pfds[i].revents = 0;
+        }
+        int ready = poll(pfds, (unsigned)active, wait < 1 ? 1 : (int)wait);
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            *error = last_socket_error();
+            break;
+        }
+
+        // Walk backwards so removing an attempt only moves ones already checked
+        for (int i = active - 1; i >= 0 && winner < 0; i--) {
+            if (pfds[i].revents == 0) {
+                continue;
+            }
+            int so_error = 0;
+            socklen_t len = sizeof(so_error);
+            if (getsockopt(attempts[i].fd, SOL_SOCKET, SO_ERROR, (char *)&so_error, &len) != 0) {
+                so_error = last_socket_error();
+            }
+
+            if (so_error == 0) {
+                *out = attempts[i].fd;
+                winner = attempts[i].index;
+            } else {
+                *error = so_error;
+                close_socket(attempts[i].fd);
+                next_start = now;  // Do not wait out the delay after a failure
+            }
+            attempts[i] = attempts[--active];
+        }
+    }
+
+    // Abandon the attempts that lost the race
+    for (int i = 0; i < active; i++) {
+        close_socket(attempts[i].fd);
+    }
+    return winner;
+}
+
+/**
+ * @brief Connect to a receiver by hostname or address
+ */
+SOCKET_T dial_receiver(const char *host, int port, int timeout_ms) {
+    if (timeout_ms <= 0) {
+        timeout_ms = DIALER_DEFAULT_TIMEOUT_MS;
+    }
+
+    char service[16];
+    snprintf(service, sizeof(service), "%d", port);
+
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;       // IPv4 and IPv6
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_protocol = IPPROTO_TCP;
+
+    struct addrinfo *list = NULL;
+    int rc = getaddrinfo(host, service, &hints, &list);
+    if (rc != 0) {
+        fprintf(stderr, "Cannot resolve %s: %s\n", host, gai_strerror(rc));
+        return INVALID_SOCKET_T;
+    }
+
+    struct addrinfo *addresses[DIALER_MAX_ADDRESSES];
+    int count = order_addresses(list, addresses);
+    if (count == 0) {
+        fprintf(stderr, "Cannot resolve %s: no IPv4 or IPv6 address\n", host);
+        freeaddrinfo(list);
+        return INVALID_SOCKET_T;
+    }
+
+    if (count > 1) {
+        printf("Connecting to %s:%d (%d addresses)...\n", host, port, count);
+    } else {
+        printf("Connecting to %s:%d...\n", host, port);
+    }
+
+    SOCKET_T s = INVALID_SOCKET_T;
+    int error = 0;
+    int winner = race_connects(addresses, count, timeout_ms, &s, &error);
+    if (winner < 0) {
+        if (error == ETIMEDOUT) {
+            fprintf(stderr, "Error: Could not connect to %s:%d within %d ms\n", host, port, timeout_ms);
+        } else {
+            fprintf(stderr, "connect: %s\n", strerror(error));
+        }
+        freeaddrinfo(list);
+        return INVALID_SOCKET_T;
+    }
+
+    // Transfers use blocking I/O
+    set_nonblocking(s, 0);
+
+    char address[INET6_ADDRSTRLEN];
+    if (getnameinfo(addresses[winner]->ai_addr, (socklen_t)addresses[winner]->ai_addrlen,
+                    address, sizeof(address), NULL, 0, NI_NUMERICHOST) != 0) {
+        snprintf(address, sizeof(address), "%s", host);
+    }
+    if (strcmp(address, host) != 0) {
+        printf("Connected to %s\n", address);
+    }
+
+    freeaddrinfo(list);
+    return s;
+}
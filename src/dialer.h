@@ -0,0 +1,38 @@
+/**
+ * @file dialer.h
+ * @brief Hostname resolution and racing connects for NETTF senders
+ *
+ * Resolves the target (a hostname or an IPv4/IPv6 literal) to all of its
+ * addresses and races connection attempts in the style of "Happy Eyeballs"
+ * (RFC 8305): addresses are interleaved by family, a new attempt starts every
+ * DIALER_ATTEMPT_DELAY_MS (or as soon as the previous one fails), the first
+ * attempt to complete wins and the rest are abandoned. The whole race is
+ * bounded by a deadline, so an unreachable target fails in seconds instead of
+ * waiting out the system's SYN retries.
+ */
+
+#ifndef DIALER_H
+#define DIALER_H
+
+#include "platform.h"  // Cross-platform socket types and functions
+
+// Delay before racing the next address (RFC 8305 recommends 250 ms)
+#define DIALER_ATTEMPT_DELAY_MS 250
+
+// Default deadline for resolving and connecting
+#define DIALER_DEFAULT_TIMEOUT_MS 10000
+
+// Most resolved addresses tried per target
+#define DIALER_MAX_ADDRESSES 16
+
+/**
+ * @brief Connect to a receiver by hostname or address
+ *
+ * @param host Hostname, IPv4 or IPv6 address of the receiver
+ * @param port Port number the receiver is listening on
+ * @param timeout_ms Deadline for the connection race (0 for DIALER_DEFAULT_TIMEOUT_MS)
+ * @return Connected blocking socket, INVALID_SOCKET_T on error (reported on stderr)
+ */
+SOCKET_T dial_receiver(const char *host, int port, int timeout_ms);
+
+#endif // DIALER_H
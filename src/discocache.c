@@ -0,0 +1,253 @@
+/**
+ * @file discocache.c
+ * @brief Discovery result cache implementation
+ *
+ * Cache file layout (host byte order, rejected on endianness mismatch):
+ *   "NTDC" magic, uint32 version, uint32 byte order marker, uint32 reserved,
+ *   uint64 entry count, then per entry an int64 last-seen time followed by
+ *   the NetworkDevice record.
+ *
+ * Background rescans hold an flock() on a lock file next to the cache, so
+ * back-to-back discover runs start at most one rescan.
+ */
+
+#define _GNU_SOURCE  // Enable fork(), setsid() and flock() on Linux systems
+#include "discocache.h"
+#include "platform.h"  // platform_cache_path()
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/file.h>
+
+#define DISCOCACHE_MAGIC "NTDC"
+#define DISCOCACHE_VERSION 2  // Bumped whenever NetworkDevice changes
+#define DISCOCACHE_BYTE_ORDER 0x01020304u
+
+// Most devices kept in the cache
+#define DISCOCACHE_MAX_ENTRIES 1024
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t reserved;
+    uint64_t count;
+} DiscoCacheFileHeader;
+
+/**
+ * @brief Load the cached devices
+ */
+int discocache_load(NetworkDevice *devices, int64_t *seen, int max_devices) {
+    char path[4096];
+    if (platform_cache_path(DISCOCACHE_FILE_NAME, path, sizeof(path)) != 0) {
+        return 0;
+    }
+
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        return 0;  // Nothing cached yet
+    }
+
+    DiscoCacheFileHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1 ||
+        memcmp(header.magic, DISCOCACHE_MAGIC, 4) != 0 ||
+        header.version != DISCOCACHE_VERSION ||
+        header.byte_order != DISCOCACHE_BYTE_ORDER) {
+        fclose(file);
+        return 0;  // Foreign or outdated cache: treat as empty
+    }
+
+    int count = 0;
+    for (uint64_t i = 0; i < header.count && count < max_devices; i++) {
+        if (fread(&seen[count], sizeof(int64_t), 1, file) != 1 ||
+            fread(&devices[count], sizeof(NetworkDevice), 1, file) != 1) {
+            break;  // Truncated cache: keep what was read
+        }
+
+        // Never trust strings read from disk to be terminated
+        devices[count].ip_address[sizeof(devices[count].ip_address) - 1] = '\0';
+        devices[count].mac_address[sizeof(devices[count].mac_address) - 1] = '\0';
+        devices[count].hostname[sizeof(devices[count].hostname) - 1] = '\0';
+        count++;
+    }
+
+    fclose(file);
+    return count;
+}
+
+/**
+ * @brief Store the result of a scan, keeping unexpired devices it missed
+ */
+int discocache_save(const NetworkDevice *devices, int num_devices, int ttl) {
+    char path[4096];
+    if (platform_cache_path(DISCOCACHE_FILE_NAME, path, sizeof(path)) != 0) {
+        return -1;
+    }
+
+    NetworkDevice *old_devices = malloc(DISCOCACHE_MAX_ENTRIES * sizeof(NetworkDevice));
+    int64_t *old_seen = malloc(DISCOCACHE_MAX_ENTRIES * sizeof(int64_t));
+    if (!old_devices || !old_seen) {
+        perror("malloc");
+        free(old_devices);
+        free(old_seen);
+        return -1;
+    }
+    int old_count = discocache_load(old_devices, old_seen, DISCOCACHE_MAX_ENTRIES);
+
+    int64_t now = (int64_t)time(NULL);
+    if (num_devices > DISCOCACHE_MAX_ENTRIES) {
+        num_devices = DISCOCACHE_MAX_ENTRIES;
+    }
+
+    // Devices the scan missed stay until their own TTL runs out
+    int keep[DISCOCACHE_MAX_ENTRIES];
+    int kept = 0;
+    for (int i = 0; i < old_count && num_devices + kept < DISCOCACHE_MAX_ENTRIES; i++) {
+        if (now - old_seen[i] >= ttl) {
+            continue;
+        }
+        int found = 0;
+        for (int j = 0; j < num_devices; j++) {
+            if (strcmp(old_devices[i].ip_address, devices[j].ip_address) == 0) {
+                found = 1;
+                break;
+            }
+        }
+        if (!found) {
+            keep[kept++] = i;
+        }
+    }
+
+    // Write to a private temporary file, then atomically replace the cache
+    char tmp_path[4200];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp.%ld", path, (long)getpid());
+    FILE *file = fopen(tmp_path, "wb");
+    if (!file) {
+        perror("fopen");
+        free(old_devices);
+        free(old_seen);
+        return -1;
+    }
+
+    DiscoCacheFileHeader header;
+    memcpy(header.magic, DISCOCACHE_MAGIC, 4);
+    header.version = DISCOCACHE_VERSION;
+    header.byte_order = DISCOCACHE_BYTE_ORDER;
+    header.reserved = 0;
+    header.count = (uint64_t)(num_devices + kept);
+
+    int ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    for (int i = 0; ok && i < num_devices; i++) {
+        ok = fwrite(&now, sizeof(int64_t), 1, file) == 1 &&
+             fwrite(&devices[i], sizeof(NetworkDevice), 1, file) == 1;
+    }
+    for (int i = 0; ok && i < kept; i++) {
+        ok = fwrite(&old_seen[keep[i]], sizeof(int64_t), 1, file) == 1 &&
+             fwrite(&old_devices[keep[i]], sizeof(NetworkDevice), 1, file) == 1;
+    }
+    free(old_devices);
+    free(old_seen);
+
+    if (fclose(file) != 0 || !ok) {
+        fprintf(stderr, "Error: Could not write discovery cache\n");
+        unlink(tmp_path);
+        return -1;
+    }
+    if (rename(tmp_path, path) != 0) {
+        perror("rename");
+        unlink(tmp_path);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Rescan in a detached child process
+ *
+ * The parent returns at once; the child scans with its output discarded,
+ * saves the result and exits. Nothing happens if a rescan is already running.
+ */
+static void start_background_refresh(int timeout_ms, const DiscoveryOptions *options) {
+    char lock_path[4096];
+    if (platform_cache_path(DISCOCACHE_FILE_NAME ".lock", lock_path, sizeof(lock_path)) != 0) {
+        return;
+    }
+
+    fflush(stdout);
+    fflush(stderr);
+    pid_t pid = fork();
+    if (pid != 0) {
+        if (pid < 0) {
+            perror("fork");
+        }
+        return;
+    }
+
+    // Child: detach from the terminal and the caller's output
+    setsid();
+    int null_fd = open("/dev/null", O_RDWR);
+    if (null_fd >= 0) {
+        dup2(null_fd, STDIN_FILENO);
+        dup2(null_fd, STDOUT_FILENO);
+        dup2(null_fd, STDERR_FILENO);
+        close(null_fd);
+    }
+
+    int lock_fd = open(lock_path, O_CREAT | O_RDWR, 0600);
+    if (lock_fd < 0 || flock(lock_fd, LOCK_EX | LOCK_NB) != 0) {
+        _exit(0);  // Another rescan is already running
+    }
+
+    NetworkDevice *devices = malloc(DISCOCACHE_MAX_ENTRIES * sizeof(NetworkDevice));
+    if (devices) {
+        int count = discover_network_devices(devices, DISCOCACHE_MAX_ENTRIES, 1, timeout_ms, options);
+        if (count >= 0) {
+            discocache_save(devices, count, options->cache_ttl);
+        }
+    }
+    _exit(0);
+}
+
+/**
+ * @brief Discover devices, answering from the cache when possible
+ */
+int discocache_discover(NetworkDevice *devices, int max_devices, int timeout_ms, const DiscoveryOptions *options) {
+    // An explicit full scan is a request for fresh results too
+    if (!options->refresh && !options->full_scan) {
+        int64_t *seen = malloc((size_t)(max_devices > 0 ? max_devices : 1) * sizeof(int64_t));
+        if (!seen) {
+            perror("malloc");
+            return -1;
+        }
+
+        int count = discocache_load(devices, seen, max_devices);
+        if (count > 0) {
+            int64_t now = (int64_t)time(NULL);
+            int stale = 0;
+            int64_t oldest = now;
+            for (int i = 0; i < count; i++) {
+                if (now - seen[i] >= options->cache_ttl) {
+                    stale++;
+                }
+                oldest = seen[i] < oldest ? seen[i] : oldest;
+            }
+            free(seen);
+
+            printf("Served %d device(s) from the discovery cache (oldest seen %lld s ago)\n",
+                   count, (long long)(now - oldest));
+            if (stale > 0) {
+                printf("%d cached device(s) older than %d s; refreshing in the background\n",
+                       stale, options->cache_ttl);
+                start_background_refresh(timeout_ms, options);
+            }
+            return count;
+        }
+        free(seen);
+    }
+
+    int count = discover_network_devices(devices, max_devices, 1, timeout_ms, options);
+    if (count >= 0) {
+        discocache_save(devices, count, options->cache_ttl);
+    }
+    return count;
+}
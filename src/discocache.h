@@ -0,0 +1,64 @@
+/**
+ * @file discocache.h
+ * @brief Discovery result cache for NETTF network discovery
+ *
+ * Keeps the devices found by the last discoveries (address, MAC, service
+ * status, response time and announced details) in the per-user cache
+ * directory, each with the time it was last seen. discover answers from the
+ * cache immediately; when entries are older than the TTL it still answers
+ * from the cache and rescans in a detached background process, so the next
+ * run sees fresh results. Devices missing from a rescan are kept until their
+ * own TTL runs out, which rides out a lost beacon or a dropped probe.
+ */
+
+#ifndef DISCOCACHE_H
+#define DISCOCACHE_H
+
+#include "discovery.h"  // NetworkDevice, DiscoveryOptions
+#include <stdint.h>
+
+// Name of the cache file inside the cache directory
+#define DISCOCACHE_FILE_NAME "discovery.cache"
+
+// Default time a cached device stays fresh (seconds)
+#define DISCOCACHE_DEFAULT_TTL 300
+
+// Longest time a cached device may be configured to stay fresh (seconds)
+#define DISCOCACHE_MAX_TTL (7 * 24 * 60 * 60)
+
+/**
+ * @brief Load the cached devices
+ *
+ * @param devices Array to store cached devices
+ * @param seen Array receiving the time each device was last seen (seconds since the epoch)
+ * @param max_devices Maximum number of devices to store
+ * @return Number of cached devices (0 if there is no usable cache)
+ */
+int discocache_load(NetworkDevice *devices, int64_t *seen, int max_devices);
+
+/**
+ * @brief Store the result of a scan, keeping unexpired devices it missed
+ *
+ * @param devices Devices found by the scan (seen now)
+ * @param num_devices Number of devices found
+ * @param ttl Seconds a device missing from the scan is kept
+ * @return 0 on success, -1 on error
+ */
+int discocache_save(const NetworkDevice *devices, int num_devices, int ttl);
+
+/**
+ * @brief Discover devices, answering from the cache when possible
+ *
+ * Scans in the foreground when there is no cache or options->refresh (or
+ * options->full_scan) is set; otherwise returns the cached devices and, if
+ * any of them is older than options->cache_ttl, starts a background rescan.
+ *
+ * @param devices Array to store discovered devices
+ * @param max_devices Maximum number of devices to store
+ * @param timeout_ms Timeout for network operations in milliseconds
+ * @param options Discovery settings
+ * @return Number of devices, -1 on error
+ */
+int discocache_discover(NetworkDevice *devices, int max_devices, int timeout_ms, const DiscoveryOptions *options);
+
+#endif // DISCOCACHE_H
@@ -5,11 +5,15 @@
  * This file implements cross-platform network discovery functionality including
  * ARP table scanning, ping sweeps, and service detection. The implementation
  * uses platform-specific system calls and commands to provide comprehensive
- * network scanning capabilities.
+ * network scanning capabilities. Hosts are probed concurrently in-process
+ * (see hostprobe.h) rather than with one ping command per address, and on
+ * Linux the neighbor table is read from /proc/net/arp instead of running arp.
  */
 
 #define _GNU_SOURCE
 #include "discovery.h"
+#include "hostprobe.h"  // Concurrent host probing
+#include "beacon.h"     // Receiver announcements
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -19,11 +23,8 @@
 #include <arpa/inet.h>
 #include <net/if.h>
 #include <ifaddrs.h>
-#include <sys/time.h>
 #include <unistd.h>
 #include <errno.h>
-#include <fcntl.h>
-#include <sys/select.h>
 
 #ifdef __APPLE__
 #include <net/route.h>
@@ -33,6 +34,7 @@
 #ifdef __linux__
 #include <sys/ioctl.h>
 #include <linux/if_link.h>
+#include <net/if_arp.h>     // ATF_COM
 #endif
 
 // Platform-specific includes
@@ -105,6 +107,58 @@ int get_network_interfaces(NetworkInterface *interfaces, int max_interfaces) {
     return count;
 }
 
+#ifdef __linux__
+/**
+ * @brief Read the kernel neighbor table from /proc/net/arp
+ *
+ * Only complete entries with a hardware address are returned; failed and
+ * incomplete resolutions (left behind by sweeps, among others) are skipped.
+ *
+ * @return Number of devices found, -1 if the table cannot be read
+ */
+static int read_proc_arp(NetworkDevice *devices, int max_devices) {
+    FILE *arp_file = fopen("/proc/net/arp", "r");
+    if (!arp_file) {
+        return -1;
+    }
+
+    char line[256];
+    int count = 0;
+
+    // Header: IP address  HW type  Flags  HW address  Mask  Device
+    if (!fgets(line, sizeof(line), arp_file)) {
+        fclose(arp_file);
+        return 0;
+    }
+
+    while (count < max_devices && fgets(line, sizeof(line), arp_file)) {
+        char ip[16], mac[18];
+        unsigned int hw_type, flags;
+        struct in_addr addr;
+
+        if (sscanf(line, "%15s %x %x %17s", ip, &hw_type, &flags, mac) != 4 ||
+            inet_pton(AF_INET, ip, &addr) != 1) {
+            continue;
+        }
+        if (!(flags & ATF_COM) || strcmp(mac, "00:00:00:00:00:00") == 0) {
+            continue;
+        }
+
+        memset(&devices[count], 0, sizeof(NetworkDevice));
+        snprintf(devices[count].ip_address, sizeof(devices[count].ip_address), "%s", ip);
+        snprintf(devices[count].mac_address, sizeof(devices[count].mac_address), "%s", mac);
+        devices[count].hostname[0] = '\0';
+        devices[count].is_active = 0;  // Will be determined by ping
+        devices[count].has_nettf_service = 0;
+        devices[count].response_time = 0;
+        count++;
+    }
+
+    fclose(arp_file);
+    return count;
+}
+#endif
+
 /**
  * @brief Scan ARP table for known devices
  */
@@ -113,6 +167,15 @@ int scan_arp_table(NetworkDevice *devices, int max_devices) {
     char line[256];
     int count = 0;
 
+#ifdef __linux__
+    // Read the kernel table directly; the arp command is only a fallback
+    count = read_proc_arp(devices, max_devices);
+    if (count >= 0) {
+        return count;
+    }
+    count = 0;
+#endif
+
 #if defined(__APPLE__)
     arp_file = popen("arp -an", "r");
 #elif defined(__linux__)
@@ -150,6 +213,7 @@ int scan_arp_table(NetworkDevice *devices, int max_devices) {
 #endif
 
             // Copy to device structure
+            memset(&devices[count], 0, sizeof(NetworkDevice));
             strncpy(devices[count].ip_address, ip, sizeof(devices[count].ip_address) - 1);
             strncpy(devices[count].mac_address, mac, sizeof(devices[count].mac_address) - 1);
             devices[count].hostname[0] = '\0';
@@ -205,23 +269,21 @@ int ping_device(const char *ip_address, int timeout_ms, double *response_time) {
     IcmpCloseHandle(hIcmpFile);
     return 0;
 #else
-    // Unix/Linux/macOS - use system ping command
-    char command[256];
-    snprintf(command, sizeof(command), "ping -c 1 -W %d %s >/dev/null 2>&1",
-             timeout_ms / 1000 + 1, ip_address);
-
-    struct timeval start_time, end_time;
-    gettimeofday(&start_time, NULL);
-
-    int result = system(command);
+    // Unix/Linux/macOS - in-process probe, no ping process
+    HostProbe host;
+    struct in_addr addr;
+    if (inet_pton(AF_INET, ip_address, &addr) != 1) {
+        return -1;
+    }
+    host.addr = ntohl(addr.s_addr);
 
-    gettimeofday(&end_time, NULL);
+    if (hostprobe_run(&host, 1, timeout_ms, 0, DEFAULT_NETTF_PORT) < 0) {
+        return -1;
+    }
     if (response_time) {
-        *response_time = (end_time.tv_sec - start_time.tv_sec) * 1000.0 +
-                        (end_time.tv_usec - start_time.tv_usec) / 1000.0;
+        *response_time = host.rtt_ms;
     }
-
-    return (result == 0) ? 1 : 0;
+    return host.alive;
 #endif
 }
 
@@ -229,52 +291,48 @@ int ping_device(const char *ip_address, int timeout_ms, double *response_time) {
  * @brief Check if a device has NETTF service running
  */
 int check_nettf_service(const char *ip_address, int port, int timeout_ms) {
-    int sock;
-    struct sockaddr_in addr;
-    fd_set fdset;
-    struct timeval tv;
-    int result = -1;
-
-    sock = socket(AF_INET, SOCK_STREAM, 0);
-    if (sock < 0) {
+    HostProbe host;
+    struct in_addr addr;
+    if (inet_pton(AF_INET, ip_address, &addr) != 1) {
         return -1;
     }
+    host.addr = ntohl(addr.s_addr);
 
-    // Set non-blocking
-    int flags = fcntl(sock, F_GETFL, 0);
-    fcntl(sock, F_SETFL, flags | O_NONBLOCK);
+    if (hostprobe_connect(&host, 1, port, timeout_ms, 0) < 0) {
+        return -1;
+    }
+    return host.alive;
+}
 
-    addr.sin_family = AF_INET;
-    addr.sin_port = htons(port);
-    inet_pton(AF_INET, ip_address, &addr.sin_addr);
+/**
+ * @brief Check all devices for a NETTF service at once
+ */
+int check_nettf_services(NetworkDevice *devices, int num_devices, int port, int timeout_ms, int rate) {
+    if (num_devices <= 0) {
+        return 0;
+    }
 
-    result = connect(sock, (struct sockaddr*)&addr, sizeof(addr));
+    HostProbe *hosts = malloc((size_t)num_devices * sizeof(HostProbe));
+    if (!hosts) {
+        perror("malloc");
+        return -1;
+    }
 
-    if (result == 0) {
-        // Connection succeeded immediately
-        close(sock);
-        return 1;
-    } else if (errno == EINPROGRESS) {
-        // Connection is in progress
-        FD_ZERO(&fdset);
-        FD_SET(sock, &fdset);
-        tv.tv_sec = timeout_ms / 1000;
-        tv.tv_usec = (timeout_ms % 1000) * 1000;
-
-        result = select(sock + 1, NULL, &fdset, NULL, &tv);
-
-        if (result > 0) {
-            int so_error;
-            socklen_t len = sizeof(so_error);
-            getsockopt(sock, SOL_SOCKET, SO_ERROR, &so_error, &len);
-
-            close(sock);
-            return (so_error == 0) ? 1 : 0;
+    // Devices without a usable address are checked against 0.0.0.0, which never answers
+    for (int i = 0; i < num_devices; i++) {
+        struct in_addr addr;
+        hosts[i].addr = inet_pton(AF_INET, devices[i].ip_address, &addr) == 1 ? ntohl(addr.s_addr) : 0;
+    }
+
+    int found = hostprobe_connect(hosts, num_devices, port, timeout_ms, rate);
+    if (found >= 0) {
+        for (int i = 0; i < num_devices; i++) {
+            devices[i].has_nettf_service = hosts[i].addr != 0 && hosts[i].alive;
         }
     }
 
-    close(sock);
-    return 0;
+    free(hosts);
+    return found;
 }
 
 /**
@@ -304,146 +362,100 @@ int calculate_network_range(const char *ip, const char *netmask, char *network,
 /**
  * @brief Perform ping sweep on network range
  */
-int ping_sweep(const char *network, const char *netmask, NetworkDevice *devices, int max_devices, int timeout_ms) {
-    char broadcast[16];
-    struct in_addr network_addr, mask_addr, base_addr, current_addr;
+int ping_sweep(const char *network, const char *netmask, NetworkDevice *devices, int max_devices, int timeout_ms,
+               int rate) {
+    struct in_addr network_addr, mask_addr, current_addr;
     int count = 0;
 
-    if (calculate_network_range(network, netmask, NULL, broadcast) != 0) {
-        return -1;
-    }
-
     if (inet_pton(AF_INET, network, &network_addr) != 1 || inet_pton(AF_INET, netmask, &mask_addr) != 1) {
         return -1;
     }
 
-    base_addr.s_addr = network_addr.s_addr;
-
     // Skip network address and broadcast address, limit to reasonable range
-    uint32_t start = ntohl(base_addr.s_addr) + 1;
-    uint32_t end = ntohl(inet_addr(broadcast)) - 1;
-
-    // Limit scanning to avoid excessive traffic
-    if (end - start > 254) {
-        end = start + 254;
+    uint32_t mask = ntohl(mask_addr.s_addr);
+    uint32_t base = ntohl(network_addr.s_addr) & mask;
+    uint32_t last = base | ~mask;
+    uint32_t start = base, end = last;
+    if (last - base >= 2) {
+        start = base + 1;
+        end = last - 1;
+    }
+    if (end - start >= PING_SWEEP_MAX_HOSTS) {
+        end = start + PING_SWEEP_MAX_HOSTS - 1;
     }
 
-    printf("Scanning network range: %s - ", inet_ntoa(base_addr));
+    int num_hosts = (int)(end - start + 1);
+    HostProbe *hosts = malloc((size_t)num_hosts * sizeof(HostProbe));
+    if (!hosts) {
+        perror("malloc");
+        return -1;
+    }
+    for (int i = 0; i < num_hosts; i++) {
+        hosts[i].addr = start + (uint32_t)i;
+    }
 
+    char first_ip[INET_ADDRSTRLEN], last_ip[INET_ADDRSTRLEN];
     current_addr.s_addr = htonl(start);
-    printf("%s\n", inet_ntoa(current_addr));
+    inet_ntop(AF_INET, &current_addr, first_ip, sizeof(first_ip));
     current_addr.s_addr = htonl(end);
-    printf("%s\n", inet_ntoa(current_addr));
-
-    for (uint32_t i = start; i <= end && count < max_devices; i++) {
-        current_addr.s_addr = htonl(i);
-        char *current_ip = inet_ntoa(current_addr);
+    inet_ntop(AF_INET, &current_addr, last_ip, sizeof(last_ip));
+    printf("Scanning network range: %s - %s (%d hosts, %s probes)\n",
+           first_ip, last_ip, num_hosts, hostprobe_method_name());
 
-        double response_time;
-        int is_active = ping_device(current_ip, timeout_ms, &response_time);
-
-        if (is_active) {
-            strncpy(devices[count].ip_address, current_ip, sizeof(devices[count].ip_address) - 1);
-            devices[count].mac_address[0] = '\0';
-            devices[count].hostname[0] = '\0';
-            devices[count].is_active = 1;
-            devices[count].has_nettf_service = 0;
-            devices[count].response_time = response_time;
-            count++;
-
-            printf("  Found: %s (%.2f ms)\n", current_ip, response_time);
-        }
+    // Probe every address at once; results come back in address order
+    if (hostprobe_run(hosts, num_hosts, timeout_ms, rate, DEFAULT_NETTF_PORT) < 0) {
+        free(hosts);
+        return -1;
     }
 
-    return count;
-}
+    for (int i = 0; i < num_hosts && count < max_devices; i++) {
+        if (!hosts[i].alive) {
+            continue;
+        }
 
-/**
- * @brief Test common IPs for NETTF service based on network type
- *
- * This function intelligently selects IP ranges to test based on the network class:
- * - Class A (10.0.0.0/8): Broader range for large networks
- * - Class B (172.16.0.0/12): Medium range for corporate networks
- * - Class C (192.168.0.0/16): Focused range for home networks
- * - Public networks: Conservative range to avoid network issues
- *
- * @param devices Array to store discovered devices
- * @param max_devices Maximum number of devices to store
- * @param base_network Base network address (e.g., "192.168.1", "10.0", "172.16")
- * @param timeout_ms Ping timeout in milliseconds
- * @return Number of devices found
- */
-int test_common_ips_for_nettf(NetworkDevice *devices, int max_devices, const char *base_network, int timeout_ms) {
-    int count = 0;
+        memset(&devices[count], 0, sizeof(NetworkDevice));
+        current_addr.s_addr = htonl(hosts[i].addr);
+        inet_ntop(AF_INET, &current_addr, devices[count].ip_address, sizeof(devices[count].ip_address));
+        devices[count].mac_address[0] = '\0';
+        devices[count].hostname[0] = '\0';
+        devices[count].is_active = 1;
+        devices[count].has_nettf_service = 0;
+        devices[count].response_time = hosts[i].rtt_ms;
+        count++;
 
-    // Determine network type and select appropriate IP ranges to test
-    const char **common_ips = NULL;
-    int num_common = 0;
-
-    // Define all possible IP arrays at function scope
-    static const char *class_a_ips[] = {
-        "1", "2", "5", "10", "20", "50", "100", "101", "105", "110", "200", "254"
-    };
-    static const char *class_b_ips[] = {
-        "16", "17", "18", "20", "30", "50", "100", "101", "105", "110", "200", "254"
-    };
-    static const char *class_c_ips[] = {
-        "1", "10", "50", "63", "100", "101", "105", "110", "150", "200", "254"
-    };
-    static const char *public_ips[] = {
-        "1", "10", "100", "254"
-    };
-
-    // Select IP test range based on network class
-    if (strncmp(base_network, "10.", 3) == 0) {
-        // Class A private network (10.0.0.0/8) - test broader range
-        common_ips = class_a_ips;
-        num_common = sizeof(class_a_ips) / sizeof(class_a_ips[0]);
-    } else if (strncmp(base_network, "172.", 4) == 0) {
-        // Class B private network (172.16.0.0/12) - test medium range
-        common_ips = class_b_ips;
-        num_common = sizeof(class_b_ips) / sizeof(class_b_ips[0]);
-    } else if (strncmp(base_network, "192.168.", 8) == 0) {
-        // Class C private network (192.168.0.0/16) - test focused range
-        common_ips = class_c_ips;
-        num_common = sizeof(class_c_ips) / sizeof(class_c_ips[0]);
-    } else {
-        // Public network or other - test conservative range to avoid issues
-        common_ips = public_ips;
-        num_common = sizeof(public_ips) / sizeof(public_ips[0]);
-    }
-
-    for (int i = 0; i < num_common && count < max_devices; i++) {
-        char test_ip[16];
-        snprintf(test_ip, sizeof(test_ip), "%s.%s", base_network, common_ips[i]);
-
-        // Quick ping test first
-        double response_time;
-        if (ping_device(test_ip, timeout_ms, &response_time)) {
-            strncpy(devices[count].ip_address, test_ip, sizeof(devices[count].ip_address) - 1);
-            devices[count].mac_address[0] = '\0';
-            devices[count].hostname[0] = '\0';
-            devices[count].is_active = 1;
-            devices[count].response_time = response_time;
-            devices[count].has_nettf_service = 0;  // Will be set later
-            count++;
-            printf("  Found active device: %s (%.2f ms)\n", test_ip, response_time);
-        }
+        printf("  Found: %s (%.2f ms)\n", devices[count - 1].ip_address, hosts[i].rtt_ms);
     }
 
+    free(hosts);
     return count;
 }
 
 /**
  * @brief Discover all available devices on local network
  */
-int discover_network_devices(NetworkDevice *devices, int max_devices, int check_services, int timeout_ms) {
+int discover_network_devices(NetworkDevice *devices, int max_devices, int check_services, int timeout_ms,
+                             const DiscoveryOptions *options) {
     (void)check_services; // Parameter kept for compatibility but always checks services now
+    int probe_rate = options ? options->probe_rate : HOSTPROBE_DEFAULT_RATE;
     int arp_count = 0;
     int total_count = 0;
     NetworkInterface interfaces[16];
     int interface_count;
 
+    // Step 0: Receivers that announce themselves make scanning unnecessary
+    if (!options || !options->full_scan) {
+        printf("Asking receivers to announce themselves...\n");
+        int announced = beacon_discover(devices, max_devices, BEACON_LISTEN_MS);
+        if (announced > 0) {
+            for (int i = 0; i < announced; i++) {
+                printf("  NETTF receiver %s (%s) announced on port %d\n",
+                       devices[i].ip_address, devices[i].hostname, devices[i].service_port);
+            }
+            return announced;
+        }
+        printf("No announcements received, scanning the network instead\n");
+    }
+
     printf("Discovering network devices from ARP table...\n");
 
     // Step 1: Get network interfaces to determine network range
@@ -466,7 +478,7 @@ int discover_network_devices(NetworkDevice *devices, int max_devices, int check_
         total_count = arp_count;
     }
 
-    // Step 4: Test common IPs for potential NETTF services on all active interfaces
+    // Step 4: Sweep the subnet of every active interface for further devices
     for (int i = 0; i < interface_count && total_count < max_devices; i++) {
         if (interfaces[i].is_active) {
             // Skip loopback and multicast addresses
@@ -475,21 +487,32 @@ int discover_network_devices(NetworkDevice *devices, int max_devices, int check_
                 continue;
             }
 
-            // Extract network part (e.g., "192.168.5" from "192.168.5.x")
-            char network_part[32];
-            strncpy(network_part, interfaces[i].ip_address, sizeof(network_part) - 1);
-            char *last_dot = strrchr(network_part, '.');
-            if (last_dot) {
-                *last_dot = '\0';  // Terminate at last dot
+            // Sweep at most the DISCOVERY_SWEEP_MASK-sized block around our own address
+            struct in_addr if_addr, if_mask, sweep_mask;
+            if (inet_pton(AF_INET, interfaces[i].ip_address, &if_addr) != 1 ||
+                inet_pton(AF_INET, interfaces[i].netmask, &if_mask) != 1 ||
+                inet_pton(AF_INET, DISCOVERY_SWEEP_MASK, &sweep_mask) != 1) {
+                continue;
+            }
+            if (ntohl(if_mask.s_addr) < ntohl(sweep_mask.s_addr)) {
+                if_mask = sweep_mask;
             }
 
-            printf("Scanning %s network for additional devices...\n", network_part);
+            char network_part[INET_ADDRSTRLEN], mask_part[INET_ADDRSTRLEN];
+            struct in_addr net_addr;
+            net_addr.s_addr = if_addr.s_addr & if_mask.s_addr;
+            inet_ntop(AF_INET, &net_addr, network_part, sizeof(network_part));
+            inet_ntop(AF_INET, &if_mask, mask_part, sizeof(mask_part));
+
+            printf("Scanning %s/%s network for additional devices...\n", network_part, mask_part);
 
-            int additional_count = test_common_ips_for_nettf(
+            int additional_count = ping_sweep(
+                network_part,
+                mask_part,
                 &devices[total_count],
                 max_devices - total_count,
-                network_part,
-                timeout_ms
+                timeout_ms,
+                probe_rate
             );
 
             if (additional_count > 0) {
@@ -499,18 +522,16 @@ int discover_network_devices(NetworkDevice *devices, int max_devices, int check_
                     int duplicate = 0;
                     for (int k = 0; k < total_count; k++) {
                         if (strcmp(devices[j].ip_address, devices[k].ip_address) == 0) {
+                            // ARP entries have no round-trip time; take the probe's
+                            devices[k].response_time = devices[j].response_time;
                             duplicate = 1;
                             break;
                         }
                     }
                     if (!duplicate) {
                         // Move unique device to correct position
-                        if (unique_count > 0) {
-                            strcpy(devices[total_count + unique_count].ip_address, devices[j].ip_address);
-                            devices[total_count + unique_count].is_active = devices[j].is_active;
-                            devices[total_count + unique_count].response_time = devices[j].response_time;
-                            devices[total_count + unique_count].mac_address[0] = '\0';
-                            devices[total_count + unique_count].hostname[0] = '\0';
+                        if (total_count + unique_count != j) {
+                            devices[total_count + unique_count] = devices[j];
                         }
                         unique_count++;
                     }
@@ -523,8 +544,8 @@ int discover_network_devices(NetworkDevice *devices, int max_devices, int check_
 
     // Step 5: Always check for NETTF service on port 9876
     printf("Checking for NETTF services on port %d...\n", DEFAULT_NETTF_PORT);
+    check_nettf_services(devices, total_count, DEFAULT_NETTF_PORT, timeout_ms, probe_rate);
     for (int i = 0; i < total_count; i++) {
-        devices[i].has_nettf_service = check_nettf_service(devices[i].ip_address, DEFAULT_NETTF_PORT, timeout_ms);
         if (devices[i].has_nettf_service) {
             printf("  NETTF service available on %s (ready to receive files)\n", devices[i].ip_address);
         }
@@ -580,4 +601,27 @@ void print_discovered_devices(const NetworkDevice *devices, int num_devices, int
 
         printf("\n");
     }
+
+    // Details that receivers announced about themselves
+    int header_printed = 0;
+    for (int i = 0; i < num_devices; i++) {
+        if (devices[i].service_port == 0) {
+            continue;
+        }
+        if (!header_printed) {
+            printf("\nAnnounced Receivers:\n");
+            printf("%-16s %-24s %-6s %-12s %s\n", "IP Address", "Hostname", "Port", "Free", "Capabilities");
+            printf("%-16s %-24s %-6s %-12s %s\n", "------------", "--------", "----", "----", "------------");
+            header_printed = 1;
+        }
+
+        char free_space[32];
+        snprintf(free_space, sizeof(free_space), "%.1f GB", devices[i].free_bytes / (1024.0 * 1024.0 * 1024.0));
+        printf("%-16s %-24s %-6d %-12s %s%s%s%s\n",
+               devices[i].ip_address, devices[i].hostname, devices[i].service_port, free_space,
+               (devices[i].capabilities & BEACON_CAP_VERIFY) ? "verify " : "",
+               (devices[i].capabilities & BEACON_CAP_EXT_DIR) ? "dedup " : "",
+               (devices[i].capabilities & BEACON_CAP_EXT_FILE) ? "sparse " : "",
+               (devices[i].capabilities & BEACON_CAP_LINK_DUPLICATES) ? "link-duplicates" : "");
+    }
 }
\ No newline at end of file
@@ -16,6 +16,12 @@
 // Default port configuration
 #define DEFAULT_NETTF_PORT 9876
 
+// Most addresses a single ping sweep probes (a /20 without network and broadcast)
+#define PING_SWEEP_MAX_HOSTS 4094
+
+// Interfaces on larger subnets only sweep the block of this size around their address
+#define DISCOVERY_SWEEP_MASK "255.255.240.0"
+
 // Device information structure
 typedef struct {
     char ip_address[16];        // IPv4 address string (xxx.xxx.xxx.xxx)
@@ -24,6 +30,11 @@ typedef struct {
     int is_active;             // 1 if device responded to ping, 0 otherwise
     int has_nettf_service;     // 1 if device has NETTF service running, 0 otherwise
     double response_time;      // Ping response time in milliseconds
+    int service_port;          // NETTF port announced by the receiver (0 if not announced)
+    unsigned int capabilities; // Announced BEACON_CAP_* bits (see beacon.h)
+    unsigned long long free_bytes; // Announced free space on the receiver
+    double throughput;         // Probed throughput in bytes per second (0 if not probed, see linkprobe.h)
+    double expected_ms;        // Expected time for the reference job (0 if not probed)
 } NetworkDevice;
 
 // Network interface information
@@ -35,6 +46,14 @@ typedef struct {
     int is_active;             // 1 if interface is up and has IP
 } NetworkInterface;
 
+// Discovery settings
+typedef struct {
+    int probe_rate;            // Most host probes sent per second (0 for no limit)
+    int full_scan;             // Scan the network even when receivers announce themselves
+    int cache_ttl;             // Seconds cached results stay fresh (see discocache.h)
+    int refresh;               // Ignore cached results and scan now
+} DiscoveryOptions;
+
 // Function declarations for network discovery
 
 /**
@@ -58,14 +77,20 @@ int scan_arp_table(NetworkDevice *devices, int max_devices);
 /**
  * @brief Perform ping sweep on network range
  *
+ * Probes every address of the range concurrently (see hostprobe.h), so the
+ * sweep takes about one timeout period; at most PING_SWEEP_MAX_HOSTS
+ * addresses are probed.
+ *
  * @param network Base network address (e.g., "192.168.1.0", "10.0.0.0", "172.16.1.0")
  * @param netmask Network mask (e.g., "255.255.255.0")
  * @param devices Array to store discovered devices
  * @param max_devices Maximum number of devices to store
  * @param timeout_ms Ping timeout in milliseconds
+ * @param rate Most probes sent per second (0 for no limit)
  * @return Number of active devices found, -1 on error
  */
-int ping_sweep(const char *network, const char *netmask, NetworkDevice *devices, int max_devices, int timeout_ms);
+int ping_sweep(const char *network, const char *netmask, NetworkDevice *devices, int max_devices, int timeout_ms,
+               int rate);
 
 /**
  * @brief Check if a device has NETTF service running on specified port
@@ -77,20 +102,39 @@ int ping_sweep(const char *network, const char *netmask, NetworkDevice *devices,
  */
 int check_nettf_service(const char *ip_address, int port, int timeout_ms);
 
+/**
+ * @brief Check all devices for a NETTF service at once
+ *
+ * Starts a non-blocking connect to every device and collects the results as
+ * they arrive, so the check takes about one timeout period in total.
+ *
+ * @param devices Devices to check; has_nettf_service is set on each
+ * @param num_devices Number of devices
+ * @param port Port number to check
+ * @param timeout_ms Connection timeout in milliseconds
+ * @param rate Most connects started per second (0 for no limit)
+ * @return Number of devices with the service, -1 on error
+ */
+int check_nettf_services(NetworkDevice *devices, int num_devices, int port, int timeout_ms, int rate);
+
 /**
  * @brief Discover all available devices on local network
  *
- * This is the main discovery function that combines ARP scanning,
- * ping sweep, and service detection to provide a comprehensive list
- * of available devices.
+ * This is the main discovery function. It first asks receivers to announce
+ * themselves (see beacon.h) and returns them right away if any answer;
+ * otherwise, or with options->full_scan, it combines ARP scanning, ping
+ * sweep, and service detection to provide a comprehensive list of
+ * available devices.
  *
  * @param devices Array to store discovered devices
  * @param max_devices Maximum number of devices to store
  * @param check_services Set to 1 to check for NETTF service, 0 to skip
  * @param timeout_ms Timeout for network operations in milliseconds
+ * @param options Discovery settings (NULL for defaults)
  * @return Number of devices discovered, -1 on error
  */
-int discover_network_devices(NetworkDevice *devices, int max_devices, int check_services, int timeout_ms);
+int discover_network_devices(NetworkDevice *devices, int max_devices, int check_services, int timeout_ms,
+                             const DiscoveryOptions *options);
 
 /**
  * @brief Print discovered devices in a formatted table
@@ -0,0 +1,545 @@
+/**
+ * @file extdir.c
+ * @brief Extended directory protocol implementation
+ *
+ * The sender lists the whole tree up front (one stat per file), so the
+ * duplicate map is known before the first byte is sent and every reference
+ * points backwards. The receiver remembers where it stored each entry and
+ * materializes references from its own disk.
+ */
+
+#define _GNU_SOURCE  // Enable strdup() on Linux systems
+#include "extdir.h"
+#include "filelist.h"   // Tree walking
+#include "dedup.h"      // Duplicate detection
+#include "hashcache.h"  // Persistent digest cache
+#include "sparse.h"     // Sparse segment streams
+#include "metrics.h"    // Receiver metrics
+#include "progress.h"   // JSON progress events
+#include "phases.h"     // Per-phase latency tracing
+#include "probes.h"     // USDT static tracepoints
+#include "feedback.h"   // Receiver feedback frames
+#include <errno.h>
+
+// Buffer size for local copies of duplicates
+#define EXT_COPY_BUFFER_SIZE (1024 * 1024)
+
+/**
+ * @brief Send one entry header and its relative path
+ */
+static int send_ext_entry_header(SOCKET_T s, uint32_t kind, uint32_t flags, uint64_t file_size,
+                                 uint64_t source_index, const char *relative_path) {
+    uint64_t path_len = relative_path ? strlen(relative_path) : 0;
+
+    ExtEntryHeader header;
+    header.file_size = htonll(file_size);
+    header.path_len = htonll(path_len);
+    header.source_index = htonll(source_index);
+    header.kind = htonl(kind);
+    header.flags = htonl(flags);
+
+    if (send_all(s, &header, EXT_ENTRY_HEADER_SIZE) != 0) {
+        return -1;
+    }
+    if (path_len > 0 && send_all(s, relative_path, path_len) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Send a directory using the extended directory protocol
+ */
+void send_ext_directory_protocol(SOCKET_T s, const char *dirpath, const char *target_dir,
+                                 const SendOptions *options) {
+    // Validate and sanitize target directory
+    char sanitized_target[4096] = {0};
+    if (target_dir && validate_target_directory(target_dir, sanitized_target, sizeof(sanitized_target)) != 0) {
+        exit(EXIT_FAILURE);
+    }
+
+    char base_name[1024];
+    path_base_name(dirpath, base_name, sizeof(base_name));
+
+    // List the tree once; every later stage reuses this stat data
+    FileList files;
+    filelist_init(&files);
+    if (filelist_add_directory(&files, dirpath, "") != 0) {
+        fprintf(stderr, "Error: Failed to analyze directory\n");
+        filelist_free(&files);
+        exit(EXIT_FAILURE);
+    }
+
+    DedupPlan plan;
+    memset(&plan, 0, sizeof(plan));
+    uint64_t flags = 0;
+    if (options && options->dedup) {
+        HashCache cache;
+        int cache_open = hashcache_open(&cache) == 0;
+        int plan_result = dedup_plan_build(&plan, &files, cache_open ? &cache : NULL);
+        if (cache_open) {
+            hashcache_save(&cache);
+            hashcache_close(&cache);
+        }
+        if (plan_result != 0) {
+            filelist_free(&files);
+            exit(EXIT_FAILURE);
+        }
+        flags |= EXT_DIR_FLAG_DEDUP;
+    }
+    if (options && options->sparse) {
+        flags |= EXT_DIR_FLAG_SPARSE;
+    }
+    if (options && options->feedback) {
+        flags |= EXT_DIR_FLAG_FEEDBACK;
+    }
+
+    // Send magic number and header
+    uint64_t base_path_len = strlen(base_name);
+    uint64_t target_dir_len = strlen(sanitized_target);
+    uint32_t magic = htonl(EXT_DIR_MAGIC);
+    ExtDirectoryHeader header;
+    header.total_files = htonll(files.count);
+    header.total_size = htonll(files.total_size);
+    progress_set_total(files.total_size, files.count);
+    header.base_path_len = htonll(base_path_len);
+    header.target_dir_len = htonll(target_dir_len);
+    header.flags = htonll(flags);
+
+    if (send_all(s, &magic, MAGIC_SIZE) != 0 ||
+        send_all(s, &header, EXT_DIR_HEADER_SIZE) != 0 ||
+        send_all(s, base_name, base_path_len) != 0 ||
+        (target_dir_len > 0 && send_all(s, sanitized_target, target_dir_len) != 0)) {
+        dedup_plan_free(&plan);
+        filelist_free(&files);
+        exit(EXIT_FAILURE);
+    }
+
+    char size_str[32];
+    format_bytes(files.total_size, size_str, sizeof(size_str));
+    printf("Sending directory: %s", base_name);
+    if (target_dir_len > 0) {
+        printf(" -> %s/", sanitized_target);
+    }
+    printf(" (%llu files, %s total)\n", (unsigned long long)files.count, size_str);
+
+    if (plan.duplicates > 0) {
+        char saved_str[32];
+        format_bytes(plan.saved_bytes, saved_str, sizeof(saved_str));
+        printf("Deduplicated %llu files (%llu hard links), %s will not be sent\n",
+               (unsigned long long)plan.duplicates, (unsigned long long)plan.hardlinks, saved_str);
+    }
+
+    time_t start_time = time(NULL);
+    uint64_t bytes_sent = 0;
+    uint64_t hole_bytes = 0;
+
+    // One adaptive session carries the chunk size from file to file
+    TransferSession session;
+    if (transfer_session_init(&session, files.total_size) != 0) {
+        dedup_plan_free(&plan);
+        filelist_free(&files);
+        exit(EXIT_FAILURE);
+    }
+    FeedbackChannel feedback;
+    if (flags & EXT_DIR_FLAG_FEEDBACK) {
+        feedback_init(&feedback, s);
+        session.feedback = &feedback;
+    }
+
+    for (size_t i = 0; i < files.count; i++) {
+        const FileEntry *entry = &files.entries[i];
+
+        // Duplicates only reference the entry that carries the data
+        if (plan.source && plan.source[i] != DEDUP_UNIQUE) {
+            uint32_t entry_flags = plan.hardlink[i] ? EXT_ENTRY_FLAG_HARDLINK : 0;
+            if (send_ext_entry_header(s, EXT_ENTRY_DUPLICATE, entry_flags, entry->size,
+                                      plan.source[i], entry->relative_path) != 0) {
+                dedup_plan_free(&plan);
+                filelist_free(&files);
+                exit(EXIT_FAILURE);
+            }
+            progress_file_done();
+            continue;
+        }
+
+        uint64_t probe_start = PROBE_START(file__end);
+        PROBE2(file__begin, entry->relative_path, entry->size);
+        FILE *file = phases_fopen(entry->full_path, "rb");
+        if (!file) {
+            perror("fopen");
+            dedup_plan_free(&plan);
+            filelist_free(&files);
+            exit(EXIT_FAILURE);
+        }
+
+        SparseStats stats = {entry->size, 0, 0};
+        int content_result;
+        transfer_session_next_file(&session, entry->size);
+        if (send_ext_entry_header(s, EXT_ENTRY_DATA, 0, entry->size, 0, entry->relative_path) != 0) {
+            content_result = -1;
+        } else if (flags & EXT_DIR_FLAG_SPARSE) {
+            content_result = send_sparse_content(s, file, entry->size, &stats, &session);
+        } else {
+            content_result = send_file_content(s, file, entry->size, &session);
+        }
+
+        fclose(file);
+        if (content_result != 0) {
+            dedup_plan_free(&plan);
+            filelist_free(&files);
+            exit(EXIT_FAILURE);
+        }
+        bytes_sent += stats.data_bytes;
+        hole_bytes += stats.hole_bytes;
+        progress_file_done();
+        PROBE3(file__end, entry->relative_path, entry->size, PROBE_ELAPSED(probe_start));
+    }
+
+    transfer_session_free(&session);
+
+    // Send end marker
+    if (send_ext_entry_header(s, EXT_ENTRY_END, 0, 0, 0, NULL) != 0) {
+        dedup_plan_free(&plan);
+        filelist_free(&files);
+        exit(EXIT_FAILURE);
+    }
+    if (flags & EXT_DIR_FLAG_FEEDBACK) {
+        feedback_sender_finish(&feedback);
+    }
+
+    // Display final statistics
+    double elapsed_seconds = difftime(time(NULL), start_time);
+    double speed = elapsed_seconds > 0 ? (double)bytes_sent / elapsed_seconds : 0;
+
+    char sent_str[32], speed_str[32], elapsed_str[32];
+    format_bytes(bytes_sent, sent_str, sizeof(sent_str));
+    format_speed(speed, speed_str, sizeof(speed_str));
+    format_time((int)elapsed_seconds, elapsed_str, sizeof(elapsed_str));
+
+    printf("\nDirectory sent successfully!\n");
+    printf("Total: %llu files, %s transferred\n", (unsigned long long)files.count, sent_str);
+    if (hole_bytes > 0) {
+        char hole_str[32];
+        format_bytes(hole_bytes, hole_str, sizeof(hole_str));
+        printf("Holes skipped: %s\n", hole_str);
+    }
+    printf("Average speed: %s | Total time: %s\n", speed_str, elapsed_str);
+
+    dedup_plan_free(&plan);
+    filelist_free(&files);
+}
+
+/**
+ * @brief Copy a file the receiver already wrote to a new path
+ */
+static int copy_local_file(const char *source_path, const char *dest_path) {
+    FILE *in = phases_fopen(source_path, "rb");
+    if (!in) {
+        perror("fopen");
+        return -1;
+    }
+
+    FILE *out = phases_fopen(dest_path, "wb");
+    if (!out) {
+        perror("fopen");
+        fclose(in);
+        return -1;
+    }
+
+    char *buffer = malloc(EXT_COPY_BUFFER_SIZE);
+    if (!buffer) {
+        perror("malloc");
+        fclose(in);
+        fclose(out);
+        return -1;
+    }
+
+    int result = 0;
+    size_t n;
+    uint64_t phase_start = phases_clock();
+    while ((n = fread(buffer, 1, EXT_COPY_BUFFER_SIZE, in)) > 0) {
+        phase_start = phases_record(PHASE_DISK_READ, phase_start);
+        if (fwrite(buffer, 1, n, out) != n) {
+            perror("fwrite");
+            result = -1;
+            break;
+        }
+        phase_start = phases_record(PHASE_DISK_WRITE, phase_start);
+    }
+    if (ferror(in)) {
+        perror("fread");
+        result = -1;
+    }
+
+    free(buffer);
+    fclose(in);
+    if (fclose(out) != 0) {
+        result = -1;
+    }
+    return result;
+}
+
+/**
+ * @brief Recreate a duplicate from the receiver's copy of its source
+ *
+ * Hard links fall back to a copy where linking is impossible (other
+ * filesystem, no link support).
+ */
+static int materialize_duplicate(const char *source_path, const char *dest_path, int link_duplicates) {
+    // Replace, never write through, whatever is at the destination
+    if (unlink(dest_path) != 0 && errno != ENOENT) {
+        perror("unlink");
+        return -1;
+    }
+
+#ifndef _WIN32
+    if (link_duplicates) {
+        if (link(source_path, dest_path) == 0) {
+            return 0;
+        }
+        perror("link");  // Fall back to a copy
+    }
+#else
+    (void)link_duplicates;
+#endif
+    return copy_local_file(source_path, dest_path);
+}
+
+/**
+ * @brief Create the parent directories of a file path
+ */
+static int create_parent_directories(const char *file_path) {
+    char dir_path[4096 + 2048];
+    strncpy(dir_path, file_path, sizeof(dir_path) - 1);
+    dir_path[sizeof(dir_path) - 1] = '\0';
+
+    char *last_slash = strrchr(dir_path, '/');
+    if (!last_slash) {
+        return 0;
+    }
+    *last_slash = '\0';
+    return create_directory_recursive(dir_path);
+}
+
+/**
+ * @brief Receive a directory sent with the extended directory protocol
+ */
+int recv_ext_directory_protocol(SOCKET_T s, const ReceiveOptions *options) {
+    ExtDirectoryHeader header;
+    if (recv_all(s, &header, EXT_DIR_HEADER_SIZE) != 0) {
+        return -1;
+    }
+
+    uint64_t total_files = ntohll(header.total_files);
+    uint64_t total_size = ntohll(header.total_size);
+    progress_set_total(total_size, total_files);
+    uint64_t base_path_len = ntohll(header.base_path_len);
+    uint64_t target_dir_len = ntohll(header.target_dir_len);
+    uint64_t flags = ntohll(header.flags);
+    int link_duplicates = options && options->link_duplicates;
+
+    if (base_path_len == 0 || base_path_len >= 1024 || target_dir_len >= 4096) {
+        fprintf(stderr, "Error: Invalid extended directory header\n");
+        return -1;
+    }
+
+    char base_dir[1024];
+    char target_dir[4096] = {0};
+    if (recv_all(s, base_dir, base_path_len) != 0) {
+        return -1;
+    }
+    base_dir[base_path_len] = '\0';
+
+    if (target_dir_len > 0) {
+        char received_target[4096];
+        if (recv_all(s, received_target, target_dir_len) != 0) {
+            return -1;
+        }
+        received_target[target_dir_len] = '\0';
+        if (validate_target_directory(received_target, target_dir, sizeof(target_dir)) != 0) {
+            return -1;
+        }
+    }
+
+    if (!is_safe_relative_path(base_dir) || strchr(base_dir, '/') != NULL) {
+        fprintf(stderr, "Error: Unsafe directory name '%s'\n", base_dir);
+        return -1;
+    }
+
+    // Create full target path
+    char root[4096];
+    if (target_dir[0] != '\0') {
+        snprintf(root, sizeof(root), "%s/%s", target_dir, base_dir);
+    } else {
+        snprintf(root, sizeof(root), "%s", base_dir);
+    }
+    if (create_directory_recursive(root) != 0) {
+        return -1;
+    }
+
+    char size_str[32];
+    format_bytes(total_size, size_str, sizeof(size_str));
+    printf("Receiving directory: %s", base_dir);
+    if (target_dir[0] != '\0') {
+        printf(" -> %s/", target_dir);
+    }
+    printf(" (%llu files, %s total)\n", (unsigned long long)total_files, size_str);
+
+    // Where each entry was stored, so later duplicates can reference it
+    char **stored_paths = NULL;
+    uint64_t *stored_sizes = NULL;
+    size_t stored_count = 0, stored_capacity = 0;
+
+    uint64_t duplicates = 0;
+    uint64_t bytes_received = 0;
+    time_t start_time = time(NULL);
+    int result = -1;
+
+    // One adaptive session carries the chunk size from file to file
+    TransferSession session;
+    if (transfer_session_init(&session, total_size) != 0) {
+        return -1;
+    }
+    FeedbackChannel feedback;
+    if (flags & EXT_DIR_FLAG_FEEDBACK) {
+        feedback_init(&feedback, s);
+        session.feedback = &feedback;
+    }
+
+    while (1) {
+        ExtEntryHeader entry;
+        if (recv_all(s, &entry, EXT_ENTRY_HEADER_SIZE) != 0) {
+            break;
+        }
+
+        uint64_t file_size = ntohll(entry.file_size);
+        uint64_t path_len = ntohll(entry.path_len);
+        uint64_t source_index = ntohll(entry.source_index);
+        uint32_t kind = ntohl(entry.kind);
+
+        if (kind == EXT_ENTRY_END) {
+            result = 0;
+            break;
+        }
+
+        if ((kind != EXT_ENTRY_DATA && kind != EXT_ENTRY_DUPLICATE) ||
+            path_len == 0 || path_len >= 2048 || stored_count >= total_files) {
+            fprintf(stderr, "Error: Invalid extended directory entry\n");
+            break;
+        }
+
+        char relative_path[2048];
+        if (recv_all(s, relative_path, path_len) != 0) {
+            break;
+        }
+        relative_path[path_len] = '\0';
+
+        if (!is_safe_relative_path(relative_path)) {
+            fprintf(stderr, "Error: Unsafe path '%s'\n", relative_path);
+            break;
+        }
+        uint64_t probe_start = PROBE_START(file__end);
+        PROBE2(file__begin, relative_path, file_size);
+
+        char full_path[4096 + 2048];
+        snprintf(full_path, sizeof(full_path), "%s/%s", root, relative_path);
+        if (create_parent_directories(full_path) != 0) {
+            break;
+        }
+
+        if (kind == EXT_ENTRY_DATA) {
+            printf("Receiving: %s\n", relative_path);
+
+            // Never write through a hard link left by an earlier linked transfer
+            unlink(full_path);
+
+            FILE *file = phases_fopen(full_path, "wb");
+            if (!file) {
+                perror("fopen");
+                metrics_error(METRICS_ERROR_DISK);
+                break;
+            }
+            int content_result;
+            transfer_session_next_file(&session, file_size);
+            if (flags & EXT_DIR_FLAG_SPARSE) {
+                content_result = recv_sparse_content(s, file, file_size, NULL, &session);
+            } else {
+                content_result = recv_file_content(s, file, file_size, &session);
+            }
+            if (fclose(file) != 0 || content_result != 0) {
+                break;
+            }
+            bytes_received += file_size;
+            metrics_file_received();
+            progress_file_done();
+            PROBE3(file__end, relative_path, file_size, PROBE_ELAPSED(probe_start));
+        } else {
+            // References must point at an earlier entry of the same size
+            if (source_index >= stored_count || stored_sizes[source_index] != file_size) {
+                fprintf(stderr, "Error: Invalid duplicate reference for '%s'\n", relative_path);
+                break;
+            }
+
+            printf("%s: %s\n", link_duplicates ? "Linking" : "Copying", relative_path);
+            if (materialize_duplicate(stored_paths[source_index], full_path, link_duplicates) != 0) {
+                metrics_error(METRICS_ERROR_DISK);
+                break;
+            }
+            duplicates++;
+            metrics_file_received();
+            progress_file_done();
+            PROBE3(file__end, relative_path, file_size, PROBE_ELAPSED(probe_start));
+        }
+
+        // Remember where this entry was stored
+        if (stored_count == stored_capacity) {
+            size_t new_capacity = stored_capacity ? stored_capacity * 2 : 256;
+            char **new_paths = realloc(stored_paths, new_capacity * sizeof(char *));
+            if (!new_paths) {
+                perror("realloc");
+                break;
+            }
+            stored_paths = new_paths;
+            uint64_t *new_sizes = realloc(stored_sizes, new_capacity * sizeof(uint64_t));
+            if (!new_sizes) {
+                perror("realloc");
+                break;
+            }
+            stored_sizes = new_sizes;
+            stored_capacity = new_capacity;
+        }
+        stored_paths[stored_count] = strdup(full_path);
+        if (!stored_paths[stored_count]) {
+            perror("strdup");
+            break;
+        }
+        stored_sizes[stored_count] = file_size;
+        stored_count++;
+    }
+
+    transfer_session_free(&session);
+    for (size_t i = 0; i < stored_count; i++) {
+        free(stored_paths[i]);
+    }
+    free(stored_paths);
+    free(stored_sizes);
+
+    if (result != 0) {
+        return -1;
+    }
+
+    // Display final statistics
+    double elapsed_seconds = difftime(time(NULL), start_time);
+    double speed = elapsed_seconds > 0 ? (double)bytes_received / elapsed_seconds : 0;
+
+    char speed_str[32], elapsed_str[32];
+    format_speed(speed, speed_str, sizeof(speed_str));
+    format_time((int)elapsed_seconds, elapsed_str, sizeof(elapsed_str));
+
+    printf("\nDirectory received successfully: %s\n", root);
+    printf("Total: %llu files received (%llu recreated from duplicates)\n",
+           (unsigned long long)stored_count, (unsigned long long)duplicates);
+    printf("Average speed: %s | Total time: %s\n", speed_str, elapsed_str);
+    return 0;
+}
@@ -0,0 +1,92 @@
+/**
+ * @file extdir.h
+ * @brief Extended directory protocol for NETTF file transfer tool
+ *
+ * A directory stream whose entries carry a kind, so an entry can reference
+ * the data of an earlier entry instead of repeating it. Used when the sender
+ * deduplicates a tree (see dedup.h); the receiver recreates every duplicate
+ * locally as a copy or a hard link, whichever it is configured for.
+ *
+ * Wire format (all integers in network byte order):
+ *   "XDIR" magic, ExtDirectoryHeader, base directory name, target directory
+ *   per file: ExtEntryHeader, relative path, file_size bytes (DATA only;
+ *             a sparse segment stream instead with EXT_DIR_FLAG_SPARSE)
+ *   end marker: ExtEntryHeader with kind EXT_ENTRY_END
+ * With EXT_DIR_FLAG_FEEDBACK, the receiver sends feedback frames back while
+ * data arrives (see feedback.h).
+ */
+
+#ifndef EXTDIR_H
+#define EXTDIR_H
+
+#include "platform.h"  // Cross-platform socket types and functions
+#include "protocol.h"  // SendOptions, ReceiveOptions
+#include <stdint.h>
+
+// Wire sizes of the extended directory frames
+#define EXT_DIR_HEADER_SIZE 40
+#define EXT_ENTRY_HEADER_SIZE 32
+
+// Directory flags
+#define EXT_DIR_FLAG_DEDUP  0x1  // Sender deduplicated the tree
+#define EXT_DIR_FLAG_SPARSE 0x2  // DATA entries carry sparse segment streams (see sparse.h)
+#define EXT_DIR_FLAG_FEEDBACK 0x4  // Receiver sends feedback frames (see feedback.h)
+
+// Entry kinds
+#define EXT_ENTRY_DATA      0  // File data follows
+#define EXT_ENTRY_DUPLICATE 1  // Same content as entry source_index, no data follows
+#define EXT_ENTRY_END       2  // End of the directory stream
+
+// Entry flags
+#define EXT_ENTRY_FLAG_HARDLINK 0x1  // Duplicate is a hard link of its source on the sender
+
+/**
+ * @brief Extended directory header
+ */
+typedef struct {
+    uint64_t total_files;     // Number of file entries (data and duplicates)
+    uint64_t total_size;      // Logical size of all files in bytes
+    uint64_t base_path_len;   // Length of base directory name
+    uint64_t target_dir_len;  // Length of target directory path (0 for current directory)
+    uint64_t flags;           // EXT_DIR_FLAG_* bits
+} ExtDirectoryHeader;
+
+/**
+ * @brief Per-file entry header
+ */
+typedef struct {
+    uint64_t file_size;     // Size of the file in bytes
+    uint64_t path_len;      // Length of the relative path
+    uint64_t source_index;  // Earlier entry with the same content (DUPLICATE only)
+    uint32_t kind;          // EXT_ENTRY_* kind
+    uint32_t flags;         // EXT_ENTRY_FLAG_* bits
+} ExtEntryHeader;
+
+/**
+ * @brief Send a directory using the extended directory protocol
+ *
+ * Walks the tree once; with options->dedup, hard links and files with
+ * identical content are sent as references to the first copy, and with
+ * options->sparse, file content is sent as data extents and holes.
+ *
+ * @param s Socket descriptor
+ * @param dirpath Path to directory to send
+ * @param target_dir Target directory on receiver (NULL for current directory)
+ * @param options Sender options
+ * @return Does not return on error (exits with EXIT_FAILURE)
+ */
+void send_ext_directory_protocol(SOCKET_T s, const char *dirpath, const char *target_dir,
+                                 const SendOptions *options);
+
+/**
+ * @brief Receive a directory sent with the extended directory protocol
+ *
+ * Called after detect_transfer_type() has consumed the "XDIR" magic.
+ *
+ * @param s Socket descriptor
+ * @param options Receiver options (duplicate handling)
+ * @return 0 on success, -1 on error
+ */
+int recv_ext_directory_protocol(SOCKET_T s, const ReceiveOptions *options);
+
+#endif // EXTDIR_H
@@ -0,0 +1,239 @@
+/**
+ * @file extfile.c
+ * @brief Extended single-file protocol implementation
+ */
+
+#define _GNU_SOURCE  // Enable GNU extensions on Linux systems
+#include "extfile.h"
+#include "sparse.h"  // Sparse segment streams
+#include "metrics.h" // Receiver metrics
+#include "progress.h" // JSON progress events
+#include "phases.h"   // Per-phase latency tracing
+#include "feedback.h" // Receiver feedback frames
+
+/**
+ * @brief Send a single file using the extended file protocol
+ */
+void send_ext_file_protocol(SOCKET_T s, const char *filepath, const char *target_dir,
+                            const SendOptions *options) {
+    // Validate and sanitize target directory
+    char sanitized_target[4096] = {0};
+    if (target_dir && validate_target_directory(target_dir, sanitized_target, sizeof(sanitized_target)) != 0) {
+        exit(EXIT_FAILURE);
+    }
+
+    FILE *file = phases_fopen(filepath, "rb");
+    if (!file) {
+        perror("fopen");
+        exit(EXIT_FAILURE);
+    }
+
+    struct stat st;
+    if (fstat(fileno(file), &st) != 0) {
+        perror("fstat");
+        fclose(file);
+        exit(EXIT_FAILURE);
+    }
+    uint64_t file_size = st.st_size;
+
+    char filename[1024];
+    path_base_name(filepath, filename, sizeof(filename));
+
+    uint64_t flags = 0;
+    if (options && options->sparse) {
+        flags |= EXT_FILE_FLAG_SPARSE;
+    }
+    if (options && options->feedback) {
+        flags |= EXT_FILE_FLAG_FEEDBACK;
+    }
+
+    // Send magic number, header, filename and target directory
+    uint64_t filename_len = strlen(filename);
+    uint64_t target_dir_len = strlen(sanitized_target);
+    uint32_t magic = htonl(EXT_FILE_MAGIC);
+    ExtFileHeader header;
+    header.file_size = htonll(file_size);
+    header.filename_len = htonll(filename_len);
+    header.target_dir_len = htonll(target_dir_len);
+    header.flags = htonll(flags);
+
+    if (send_all(s, &magic, MAGIC_SIZE) != 0 ||
+        send_all(s, &header, EXT_FILE_HEADER_SIZE) != 0 ||
+        send_all(s, filename, filename_len) != 0 ||
+        (target_dir_len > 0 && send_all(s, sanitized_target, target_dir_len) != 0)) {
+        fclose(file);
+        exit(EXIT_FAILURE);
+    }
+
+    char size_str[32];
+    format_bytes(file_size, size_str, sizeof(size_str));
+    printf("Sending file: %s", filename);
+    if (target_dir_len > 0) {
+        printf(" -> %s/", sanitized_target);
+    }
+    printf(" (%s)\n", size_str);
+    progress_set_total(file_size, 1);
+
+    TransferSession session;
+    if (transfer_session_init(&session, file_size) != 0) {
+        fclose(file);
+        exit(EXIT_FAILURE);
+    }
+    FeedbackChannel feedback;
+    if (flags & EXT_FILE_FLAG_FEEDBACK) {
+        feedback_init(&feedback, s);
+        session.feedback = &feedback;
+    }
+
+    time_t start_time = time(NULL);
+    SparseStats stats = {file_size, 0, 0};
+    int result;
+    if (flags & EXT_FILE_FLAG_SPARSE) {
+        result = send_sparse_content(s, file, file_size, &stats, &session);
+    } else {
+        result = send_file_content(s, file, file_size, &session);
+    }
+    transfer_session_free(&session);
+    fclose(file);
+    if (result != 0) {
+        exit(EXIT_FAILURE);
+    }
+    if (flags & EXT_FILE_FLAG_FEEDBACK) {
+        feedback_sender_finish(&feedback);
+    }
+    progress_file_done();
+
+    // Display final statistics
+    double elapsed_seconds = difftime(time(NULL), start_time);
+    double speed = elapsed_seconds > 0 ? (double)stats.data_bytes / elapsed_seconds : 0;
+
+    char data_str[32], speed_str[32], elapsed_str[32];
+    format_bytes(stats.data_bytes, data_str, sizeof(data_str));
+    format_speed(speed, speed_str, sizeof(speed_str));
+    format_time((int)elapsed_seconds, elapsed_str, sizeof(elapsed_str));
+
+    printf("\nFile sent successfully!\n");
+    printf("Data: %s", data_str);
+    if (stats.hole_bytes > 0) {
+        char hole_str[32];
+        format_bytes(stats.hole_bytes, hole_str, sizeof(hole_str));
+        printf(" | Holes skipped: %s", hole_str);
+        if (stats.zero_bytes > 0) {
+            char zero_str[32];
+            format_bytes(stats.zero_bytes, zero_str, sizeof(zero_str));
+            printf(" (%s as zero blocks)", zero_str);
+        }
+    }
+    printf(" | Average speed: %s | Total time: %s\n", speed_str, elapsed_str);
+}
+
+/**
+ * @brief Receive a file sent with the extended file protocol
+ */
+int recv_ext_file_protocol(SOCKET_T s, const ReceiveOptions *options) {
+    (void)options;
+
+    ExtFileHeader header;
+    if (recv_all(s, &header, EXT_FILE_HEADER_SIZE) != 0) {
+        return -1;
+    }
+
+    uint64_t file_size = ntohll(header.file_size);
+    uint64_t filename_len = ntohll(header.filename_len);
+    uint64_t target_dir_len = ntohll(header.target_dir_len);
+    uint64_t flags = ntohll(header.flags);
+
+    if (filename_len == 0 || filename_len >= 1024 || target_dir_len >= 4096) {
+        fprintf(stderr, "Error: Invalid extended file header\n");
+        return -1;
+    }
+
+    char filename[1024];
+    if (recv_all(s, filename, filename_len) != 0) {
+        return -1;
+    }
+    filename[filename_len] = '\0';
+
+    char target_dir[4096] = {0};
+    if (target_dir_len > 0) {
+        char received_target[4096];
+        if (recv_all(s, received_target, target_dir_len) != 0) {
+            return -1;
+        }
+        received_target[target_dir_len] = '\0';
+        if (validate_target_directory(received_target, target_dir, sizeof(target_dir)) != 0) {
+            return -1;
+        }
+    }
+
+    if (!is_safe_relative_path(filename) || strchr(filename, '/') != NULL) {
+        fprintf(stderr, "Error: Unsafe file name '%s'\n", filename);
+        return -1;
+    }
+
+    char full_path[4096 + 1024];
+    if (target_dir[0] != '\0') {
+        if (create_directory_recursive(target_dir) != 0) {
+            return -1;
+        }
+        snprintf(full_path, sizeof(full_path), "%s/%s", target_dir, filename);
+    } else {
+        snprintf(full_path, sizeof(full_path), "%s", filename);
+    }
+
+    char size_str[32];
+    format_bytes(file_size, size_str, sizeof(size_str));
+    printf("Receiving file: %s", filename);
+    if (target_dir[0] != '\0') {
+        printf(" -> %s/", target_dir);
+    }
+    printf(" (%s%s)\n", size_str, (flags & EXT_FILE_FLAG_SPARSE) ? ", sparse" : "");
+    progress_set_total(file_size, 1);
+
+    // Start from a new, empty file so skipped ranges stay holes
+    unlink(full_path);
+    FILE *file = phases_fopen(full_path, "wb");
+    if (!file) {
+        perror("fopen");
+        metrics_error(METRICS_ERROR_DISK);
+        return -1;
+    }
+
+    TransferSession session;
+    if (transfer_session_init(&session, file_size) != 0) {
+        fclose(file);
+        return -1;
+    }
+    FeedbackChannel feedback;
+    if (flags & EXT_FILE_FLAG_FEEDBACK) {
+        feedback_init(&feedback, s);
+        session.feedback = &feedback;
+    }
+
+    SparseStats stats = {file_size, 0, 0};
+    int result;
+    if (flags & EXT_FILE_FLAG_SPARSE) {
+        result = recv_sparse_content(s, file, file_size, &stats, &session);
+    } else {
+        result = recv_file_content(s, file, file_size, &session);
+    }
+    transfer_session_free(&session);
+    if (fclose(file) != 0) {
+        perror("fclose");
+        result = -1;
+    }
+    if (result != 0) {
+        return -1;
+    }
+
+    metrics_file_received();
+    progress_file_done();
+    printf("File received successfully: %s", full_path);
+    if (stats.hole_bytes > 0) {
+        char hole_str[32];
+        format_bytes(stats.hole_bytes, hole_str, sizeof(hole_str));
+        printf(" (%s left as holes)", hole_str);
+    }
+    printf("\n");
+    return 0;
+}
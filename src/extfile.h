@@ -0,0 +1,61 @@
+/**
+ * @file extfile.h
+ * @brief Extended single-file protocol for NETTF file transfer tool
+ *
+ * Like the target file protocol, but with a flags word that selects how the
+ * content is encoded, e.g. as a sparse segment stream (see sparse.h).
+ *
+ * Wire format (all integers in network byte order):
+ *   "XFIL" magic, ExtFileHeader, filename, target directory, content
+ * With EXT_FILE_FLAG_FEEDBACK, the receiver sends feedback frames back while
+ * the content arrives (see feedback.h).
+ */
+
+#ifndef EXTFILE_H
+#define EXTFILE_H
+
+#include "platform.h"  // Cross-platform socket types and functions
+#include "protocol.h"  // SendOptions, ReceiveOptions
+#include <stdint.h>
+
+// Wire size of the extended file header
+#define EXT_FILE_HEADER_SIZE 32
+
+// File flags
+#define EXT_FILE_FLAG_SPARSE 0x1  // Content is a sparse segment stream
+#define EXT_FILE_FLAG_FEEDBACK 0x2  // Receiver sends feedback frames (see feedback.h)
+
+/**
+ * @brief Extended file header
+ */
+typedef struct {
+    uint64_t file_size;       // Size of file in bytes
+    uint64_t filename_len;    // Length of filename in bytes
+    uint64_t target_dir_len;  // Length of target directory path (0 for current directory)
+    uint64_t flags;           // EXT_FILE_FLAG_* bits
+} ExtFileHeader;
+
+/**
+ * @brief Send a single file using the extended file protocol
+ *
+ * @param s Socket descriptor
+ * @param filepath Path to file to send
+ * @param target_dir Target directory on receiver (NULL for current directory)
+ * @param options Sender options (content encoding)
+ * @return Does not return on error (exits with EXIT_FAILURE)
+ */
+void send_ext_file_protocol(SOCKET_T s, const char *filepath, const char *target_dir,
+                            const SendOptions *options);
+
+/**
+ * @brief Receive a file sent with the extended file protocol
+ *
+ * Called after detect_transfer_type() has consumed the "XFIL" magic.
+ *
+ * @param s Socket descriptor
+ * @param options Receiver options
+ * @return 0 on success, -1 on error
+ */
+int recv_ext_file_protocol(SOCKET_T s, const ReceiveOptions *options);
+
+#endif // EXTFILE_H
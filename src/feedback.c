@@ -0,0 +1,205 @@
+/**
+ * @file feedback.c
+ * @brief Receiver-to-sender feedback frames implementation
+ *
+ * The sender asks the socket how many bytes are waiting (FIONREAD) and only
+ * reads what is there, so polling never blocks the data path; a frame split
+ * across polls is completed by a later one.
+ */
+
+#include "feedback.h"
+#include "platform.h"  // platform_monotonic_ns()
+#include "protocol.h"  // send_all(), htonll(), format_bytes(), format_speed()
+#include <errno.h>
+#ifdef _WIN32
+#define poll WSAPoll
+#define SHUT_WR SD_SEND
+#else
+#include <poll.h>
+#include <sys/ioctl.h>
+#endif
+
+/**
+ * @brief Bytes waiting to be read on a socket, 0 on error
+ */
+static uint64_t pending_bytes(SOCKET_T s) {
+#ifdef _WIN32
+    u_long pending = 0;
+    if (ioctlsocket(s, FIONREAD, &pending) != 0) {
+        return 0;
+    }
+#else
+    int pending = 0;
+    if (ioctl(s, FIONREAD, &pending) != 0 || pending < 0) {
+        return 0;
+    }
+#endif
+    return (uint64_t)pending;
+}
+
+/**
+ * @brief Start feedback on a connection
+ */
+void feedback_init(FeedbackChannel *channel, SOCKET_T s) {
+    memset(channel, 0, sizeof(*channel));
+    channel->socket = s;
+    channel->interval_start_ms = platform_monotonic_ns() / 1e6;
+    channel->last_poll_ms = channel->interval_start_ms;
+}
+
+/**
+ * @brief Receiver: account a disk write and send a frame when the interval is over
+ */
+int feedback_receiver_write(FeedbackChannel *channel, uint64_t bytes, uint64_t write_start, uint64_t write_end) {
+    double now = write_end / 1e6;
+    channel->write_ms += (write_end - write_start) / 1e6;
+    channel->write_bytes += bytes;
+
+    double interval = now - channel->interval_start_ms;
+    if (interval < FEEDBACK_INTERVAL_MS) {
+        return 0;
+    }
+
+    uint64_t queue = pending_bytes(channel->socket);
+    int buffer_size = 0;
+#ifdef _WIN32
+    int len = sizeof(buffer_size);
+    getsockopt(channel->socket, SOL_SOCKET, SO_RCVBUF, (char *)&buffer_size, &len);
+#else
+    socklen_t len = sizeof(buffer_size);
+    getsockopt(channel->socket, SOL_SOCKET, SO_RCVBUF, &buffer_size, &len);
+#endif
+    uint64_t busy = (uint64_t)(channel->write_ms * 1000.0 / interval);
+
+    FeedbackFrame frame;
+    frame.magic = htonl(FEEDBACK_MAGIC);
+    frame.busy_permille = htonl((uint32_t)(busy > 1000 ? 1000 : busy));
+    frame.write_rate = htonll(channel->write_ms > 0 ? (uint64_t)(channel->write_bytes * 1000.0 / channel->write_ms) : 0);
+    frame.queue_bytes = htonll(queue);
+    frame.free_bytes = htonll(buffer_size > 0 && (uint64_t)buffer_size > queue ? (uint64_t)buffer_size - queue : 0);
+
+    channel->interval_start_ms = now;
+    channel->write_ms = 0;
+    channel->write_bytes = 0;
+    return send_all(channel->socket, &frame, FEEDBACK_FRAME_SIZE);
+}
+
+/**
+ * @brief Take a complete frame into the sender's view of the receiver
+ */
+static void accept_frame(FeedbackChannel *channel, AdaptiveState *adaptive) {
+    FeedbackFrame frame;
+    memcpy(&frame, channel->partial, FEEDBACK_FRAME_SIZE);
+    channel->partial_len = 0;
+    if (channel->broken) {
+        return;
+    }
+    if (ntohl(frame.magic) != FEEDBACK_MAGIC) {
+        fprintf(stderr, "Warning: Malformed feedback from the receiver, ignoring it\n");
+        channel->broken = 1;
+        return;
+    }
+
+    FeedbackFrame *last = &channel->last;
+    last->magic = FEEDBACK_MAGIC;
+    last->busy_permille = ntohl(frame.busy_permille);
+    last->write_rate = ntohll(frame.write_rate);
+    last->queue_bytes = ntohll(frame.queue_bytes);
+    last->free_bytes = ntohll(frame.free_bytes);
+
+    // Busy writing, or not draining its socket: the receiver is the bottleneck
+    int bound = last->busy_permille >= FEEDBACK_BUSY_PERMILLE ||
+                last->queue_bytes > last->free_bytes;
+    channel->frames++;
+    channel->bound_frames += bound;
+    channel->busy_sum += last->busy_permille;
+    if (last->queue_bytes > channel->max_queue) {
+        channel->max_queue = last->queue_bytes;
+    }
+    if (adaptive) {
+        adaptive->receiver_bound = bound;
+    }
+}
+
+/**
+ * @brief Read the bytes that are waiting, frame by frame
+ *
+ * @return 0 if the connection is still open, -1 once the receiver closed it or on error
+ */
+static int read_waiting(FeedbackChannel *channel, AdaptiveState *adaptive, int block) {
+    uint64_t waiting = pending_bytes(channel->socket);
+    if (waiting == 0 && !block) {
+        return 0;
+    }
+    do {
+        size_t want = FEEDBACK_FRAME_SIZE - channel->partial_len;
+        if (!block && want > waiting) {
+            want = (size_t)waiting;
+        }
+        ssize_t n = recv(channel->socket, (char *)channel->partial + channel->partial_len, want, 0);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        channel->partial_len += (size_t)n;
+        waiting = waiting > (uint64_t)n ? waiting - (uint64_t)n : 0;
+        if (channel->partial_len == FEEDBACK_FRAME_SIZE) {
+            accept_frame(channel, adaptive);
+        }
+        block = 0;  // One blocking read per call, then only what is waiting
+    } while (waiting > 0);
+    return 0;
+}
+
+/**
+ * @brief Sender: read the frames that have arrived, without blocking
+ */
+void feedback_sender_poll(FeedbackChannel *channel, AdaptiveState *adaptive) {
+    double now = platform_monotonic_ns() / 1e6;
+    if (now - channel->last_poll_ms < FEEDBACK_INTERVAL_MS / 2) {
+        return;
+    }
+    channel->last_poll_ms = now;
+    read_waiting(channel, adaptive, 0);
+}
+
+/**
+ * @brief Sender: stop sending, read frames until the receiver closes, and print a summary
+ */
+void feedback_sender_finish(FeedbackChannel *channel) {
+    shutdown(channel->socket, SHUT_WR);
+
+    double deadline = platform_monotonic_ns() / 1e6 + FEEDBACK_DRAIN_TIMEOUT_MS;
+    while (1) {
+        double remaining = deadline - platform_monotonic_ns() / 1e6;
+        if (remaining <= 0) {
+            fprintf(stderr, "Warning: Receiver did not finish within %d s\n", FEEDBACK_DRAIN_TIMEOUT_MS / 1000);
+            break;
+        }
+        struct pollfd pfd;
+        pfd.fd = channel->socket;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        int ready = poll(&pfd, 1, (int)remaining);
+        if (ready < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ready <= 0 || read_waiting(channel, NULL, 1) != 0) {
+            break;  // Closed by the receiver (or the wait failed)
+        }
+    }
+
+    if (channel->frames == 0) {
+        printf("Receiver feedback: none received\n");
+        return;
+    }
+    char rate_str[32], queue_str[32];
+    format_speed((double)channel->last.write_rate, rate_str, sizeof(rate_str));
+    format_bytes(channel->max_queue, queue_str, sizeof(queue_str));
+    printf("Receiver feedback: %llu frames, receiver-bound %.0f%% of the time "
+           "(disk busy %.0f%%, last writes at %s, queue up to %s)\n",
+           (unsigned long long)channel->frames, 100.0 * channel->bound_frames / channel->frames,
+           channel->busy_sum / 10.0 / channel->frames, rate_str, queue_str);
+}
@@ -0,0 +1,121 @@
+/**
+ * @file feedback.h
+ * @brief Receiver-to-sender feedback frames for NETTF extended protocols
+ *
+ * When the receiver's disk is the bottleneck, the sender only sees its sends
+ * slow down, and adaptive sizing shrinks the chunks, which does not help.
+ * With feedback on (EXT_DIR_FLAG_FEEDBACK or EXT_FILE_FLAG_FEEDBACK, set by
+ * "send --feedback"), the receiver sends a small status frame back on the
+ * same connection every FEEDBACK_INTERVAL_MS while data arrives: how much of
+ * the interval it spent writing to disk, how fast the writes went, how much
+ * received data waits in its socket queue and how much buffer space is left.
+ *
+ * The sender reads the frames between chunks without blocking. A receiver
+ * that is busy writing most of the time, or whose socket queue fills more
+ * than half of its buffer, is not keeping up: the sender then holds its
+ * chunk size instead of shrinking it (see AdaptiveState.receiver_bound).
+ * Otherwise the network is the bottleneck and adaptive sizing works as
+ * usual. At the end, the sender stops sending and reads the remaining
+ * frames until the receiver closes the connection, so unread frames never
+ * turn its close into a reset.
+ *
+ * Wire format (all integers in network byte order), receiver to sender:
+ *   per frame: FeedbackFrame ("FDBK" magic first)
+ * Receivers that predate the flag ignore it and send nothing.
+ */
+
+#ifndef FEEDBACK_H
+#define FEEDBACK_H
+
+#include "platform.h"  // SOCKET_T
+#include "adaptive.h"  // AdaptiveState
+#include <stdint.h>
+
+#define FEEDBACK_MAGIC 0x4644424B  // "FDBK" in hex
+
+// Wire size of a feedback frame
+#define FEEDBACK_FRAME_SIZE 32
+
+// Time between frames while data arrives
+#define FEEDBACK_INTERVAL_MS 250
+
+// Receiver writing this share of the time (per mille) is disk-bound
+#define FEEDBACK_BUSY_PERMILLE 700
+
+// Longest wait for the receiver to finish after the last byte was sent
+#define FEEDBACK_DRAIN_TIMEOUT_MS 30000
+
+/**
+ * @brief Status frame sent by the receiver
+ */
+typedef struct {
+    uint32_t magic;          // FEEDBACK_MAGIC
+    uint32_t busy_permille;  // Share of the interval spent in disk writes
+    uint64_t write_rate;     // Bytes per second while writing
+    uint64_t queue_bytes;    // Received data not yet read by the receiver
+    uint64_t free_bytes;     // Receive buffer space left
+} FeedbackFrame;
+
+/**
+ * @brief Feedback state of one side of a connection
+ */
+typedef struct FeedbackChannel {
+    SOCKET_T socket;          // Connection the frames travel on
+
+    // Receiver side: the current interval
+    double interval_start_ms;
+    double write_ms;          // Time spent in disk writes
+    uint64_t write_bytes;     // Bytes written
+
+    // Sender side: frames read so far
+    unsigned char partial[FEEDBACK_FRAME_SIZE];  // Frame being read
+    size_t partial_len;
+    double last_poll_ms;
+    int broken;               // A malformed frame was read; later frames are discarded
+    FeedbackFrame last;       // Latest frame (host byte order)
+    uint64_t frames;          // Frames read
+    uint64_t bound_frames;    // Frames showing a receiver bottleneck
+    uint64_t busy_sum;        // Sum of busy_permille, for the average
+    uint64_t max_queue;       // Largest queue reported
+} FeedbackChannel;
+
+/**
+ * @brief Start feedback on a connection
+ *
+ * @param channel Channel to initialize
+ * @param s Connected socket
+ */
+void feedback_init(FeedbackChannel *channel, SOCKET_T s);
+
+/**
+ * @brief Receiver: account a disk write and send a frame when the interval is over
+ *
+ * @param channel Receiver channel
+ * @param bytes Bytes written
+ * @param write_start platform_monotonic_ns() before the write
+ * @param write_end platform_monotonic_ns() after the write (also ends the interval)
+ * @return 0 on success, -1 if the frame could not be sent
+ */
+int feedback_receiver_write(FeedbackChannel *channel, uint64_t bytes, uint64_t write_start, uint64_t write_end);
+
+/**
+ * @brief Sender: read the frames that have arrived, without blocking
+ *
+ * Polls the socket at most twice per FEEDBACK_INTERVAL_MS and sets
+ * adaptive->receiver_bound from the latest frame.
+ *
+ * @param channel Sender channel
+ * @param adaptive Adaptive state of the transfer
+ */
+void feedback_sender_poll(FeedbackChannel *channel, AdaptiveState *adaptive);
+
+/**
+ * @brief Sender: stop sending, read frames until the receiver closes, and print a summary
+ *
+ * Call after the last byte of the transfer has been sent.
+ *
+ * @param channel Sender channel
+ */
+void feedback_sender_finish(FeedbackChannel *channel);
+
+#endif // FEEDBACK_H
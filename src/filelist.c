@@ -0,0 +1,145 @@
+/**
+ * @file filelist.c
+ * @brief Flat file listing implementation
+ */
+
+#define _GNU_SOURCE  // Enable strdup() and st_mtim on Linux systems
+#include "filelist.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+
+/**
+ * @brief Modification time of a stat() result in nanoseconds
+ */
+int64_t stat_mtime_ns(const struct stat *st) {
+#if defined(__APPLE__)
+    return (int64_t)st->st_mtimespec.tv_sec * 1000000000LL + st->st_mtimespec.tv_nsec;
+#elif defined(_WIN32)
+    return (int64_t)st->st_mtime * 1000000000LL;
+#else
+    return (int64_t)st->st_mtim.tv_sec * 1000000000LL + st->st_mtim.tv_nsec;
+#endif
+}
+
+/**
+ * @brief Status change time of a stat() result in nanoseconds
+ */
+int64_t stat_ctime_ns(const struct stat *st) {
+#if defined(__APPLE__)
+    return (int64_t)st->st_ctimespec.tv_sec * 1000000000LL + st->st_ctimespec.tv_nsec;
+#elif defined(_WIN32)
+    return (int64_t)st->st_ctime * 1000000000LL;
+#else
+    return (int64_t)st->st_ctim.tv_sec * 1000000000LL + st->st_ctim.tv_nsec;
+#endif
+}
+
+/**
+ * @brief Initialize an empty file list
+ */
+void filelist_init(FileList *list) {
+    memset(list, 0, sizeof(FileList));
+}
+
+/**
+ * @brief Append a file to the list
+ */
+int filelist_add(FileList *list, const char *full_path, const char *relative_path, const struct stat *st) {
+    if (list->count == list->capacity) {
+        size_t new_capacity = list->capacity ? list->capacity * 2 : 64;
+        FileEntry *grown = realloc(list->entries, new_capacity * sizeof(FileEntry));
+        if (!grown) {
+            perror("realloc");
+            return -1;
+        }
+        list->entries = grown;
+        list->capacity = new_capacity;
+    }
+
+    FileEntry *entry = &list->entries[list->count];
+    entry->full_path = strdup(full_path);
+    entry->relative_path = strdup(relative_path);
+    if (!entry->full_path || !entry->relative_path) {
+        perror("strdup");
+        free(entry->full_path);
+        free(entry->relative_path);
+        return -1;
+    }
+
+    entry->size = (uint64_t)st->st_size;
+    entry->dev = (uint64_t)st->st_dev;
+    entry->ino = (uint64_t)st->st_ino;
+    entry->nlink = (uint64_t)st->st_nlink;
+    entry->mtime_ns = stat_mtime_ns(st);
+    entry->ctime_ns = stat_ctime_ns(st);
+
+    list->total_size += entry->size;
+    list->count++;
+    return 0;
+}
+
+/**
+ * @brief Recursively add every regular file below a directory
+ */
+int filelist_add_directory(FileList *list, const char *dirpath, const char *prefix) {
+    DIR *dir;
+    struct dirent *entry;
+    struct stat st;
+    char full_path[4096];
+    char relative_path[4096];
+
+    dir = opendir(dirpath);
+    if (!dir) {
+        perror("opendir");
+        return -1;
+    }
+
+    while ((entry = readdir(dir)) != NULL) {
+        // Skip . and .. entries
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+
+        snprintf(full_path, sizeof(full_path), "%s/%s", dirpath, entry->d_name);
+        if (prefix[0] == '\0') {
+            snprintf(relative_path, sizeof(relative_path), "%s", entry->d_name);
+        } else {
+            snprintf(relative_path, sizeof(relative_path), "%s/%s", prefix, entry->d_name);
+        }
+
+        if (stat(full_path, &st) != 0) {
+            perror("stat");
+            closedir(dir);
+            return -1;
+        }
+
+        if (S_ISDIR(st.st_mode)) {
+            if (filelist_add_directory(list, full_path, relative_path) != 0) {
+                closedir(dir);
+                return -1;
+            }
+        } else if (S_ISREG(st.st_mode)) {
+            if (filelist_add(list, full_path, relative_path, &st) != 0) {
+                closedir(dir);
+                return -1;
+            }
+        }
+    }
+
+    closedir(dir);
+    return 0;
+}
+
+/**
+ * @brief Release all memory owned by the list
+ */
+void filelist_free(FileList *list) {
+    for (size_t i = 0; i < list->count; i++) {
+        free(list->entries[i].full_path);
+        free(list->entries[i].relative_path);
+    }
+    free(list->entries);
+    memset(list, 0, sizeof(FileList));
+}
@@ -0,0 +1,95 @@
+/**
+ * @file filelist.h
+ * @brief Flat file listing of a transfer tree
+ *
+ * Walks a directory once and records every regular file together with the
+ * stat() metadata that later stages (hashing, verification) need, so those
+ * stages never have to stat the same file twice.
+ */
+
+#ifndef FILELIST_H
+#define FILELIST_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/stat.h>
+
+/**
+ * @brief One regular file of a transfer tree
+ */
+typedef struct {
+    char *full_path;      // Path on the local filesystem
+    char *relative_path;  // Path as sent on the wire
+    uint64_t size;        // File size in bytes
+    uint64_t dev;         // Device number
+    uint64_t ino;         // Inode number
+    uint64_t nlink;       // Hard link count
+    int64_t mtime_ns;     // Modification time in nanoseconds
+    int64_t ctime_ns;     // Status change time in nanoseconds
+} FileEntry;
+
+/**
+ * @brief Growable array of file entries
+ */
+typedef struct {
+    FileEntry *entries;
+    size_t count;
+    size_t capacity;
+    uint64_t total_size;  // Sum of all entry sizes
+} FileList;
+
+/**
+ * @brief Initialize an empty file list
+ *
+ * @param list Pointer to FileList to initialize
+ */
+void filelist_init(FileList *list);
+
+/**
+ * @brief Append a file to the list
+ *
+ * @param list Pointer to FileList
+ * @param full_path Local path of the file
+ * @param relative_path Path to use on the wire
+ * @param st stat() result for the file
+ * @return 0 on success, -1 on allocation failure
+ */
+int filelist_add(FileList *list, const char *full_path, const char *relative_path, const struct stat *st);
+
+/**
+ * @brief Recursively add every regular file below a directory
+ *
+ * Entries are added in readdir() order, the same order the directory
+ * protocols send files in.
+ *
+ * @param list Pointer to FileList
+ * @param dirpath Directory to walk
+ * @param prefix Prefix for relative paths ("" for paths relative to dirpath)
+ * @return 0 on success, -1 on error
+ */
+int filelist_add_directory(FileList *list, const char *dirpath, const char *prefix);
+
+/**
+ * @brief Release all memory owned by the list
+ *
+ * @param list Pointer to FileList
+ */
+void filelist_free(FileList *list);
+
+/**
+ * @brief Modification time of a stat() result in nanoseconds
+ *
+ * @param st stat() result
+ * @return Nanoseconds since the epoch
+ */
+int64_t stat_mtime_ns(const struct stat *st);
+
+/**
+ * @brief Status change time of a stat() result in nanoseconds
+ *
+ * @param st stat() result
+ * @return Nanoseconds since the epoch
+ */
+int64_t stat_ctime_ns(const struct stat *st);
+
+#endif // FILELIST_H
@@ -0,0 +1,336 @@
+/**
+ * @file hash.c
+ * @brief Fast content hashing implementation for NETTF file transfer tool
+ *
+ * Implements the xxHash64 construction and a pthread worker pool that hashes
+ * files in fixed-size ranges using pread(), one file descriptor per worker.
+ */
+
+#define _GNU_SOURCE  // Enable pread() and posix_fadvise() on Linux systems
+#include "hash.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+// xxHash64 primes
+#define PRIME64_1 0x9E3779B185EBCA87ULL
+#define PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define PRIME64_3 0x165667B19E3779F9ULL
+#define PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define PRIME64_5 0x27D4EB2F165667C5ULL
+
+static inline uint64_t rotl64(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+// Unaligned little-endian loads
+static inline uint64_t read64(const unsigned char *p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap64(v);
+#endif
+    return v;
+}
+
+static inline uint32_t read32(const unsigned char *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap32(v);
+#endif
+    return v;
+}
+
+static inline uint64_t hash_round(uint64_t acc, uint64_t input) {
+    acc += input * PRIME64_2;
+    acc = rotl64(acc, 31);
+    return acc * PRIME64_1;
+}
+
+static inline uint64_t hash_merge(uint64_t acc, uint64_t val) {
+    acc ^= hash_round(0, val);
+    return acc * PRIME64_1 + PRIME64_4;
+}
+
+/**
+ * @brief Hash a memory buffer
+ */
+uint64_t hash64(const void *data, size_t len, uint64_t seed) {
+    const unsigned char *p = (const unsigned char *)data;
+    const unsigned char *end = p + len;
+    uint64_t h;
+
+    if (len >= 32) {
+        const unsigned char *limit = end - 32;
+        uint64_t v1 = seed + PRIME64_1 + PRIME64_2;
+        uint64_t v2 = seed + PRIME64_2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - PRIME64_1;
+
+        // Main loop: four independent lanes per 32-byte stripe
+        do {
+            v1 = hash_round(v1, read64(p));
+            v2 = hash_round(v2, read64(p + 8));
+            v3 = hash_round(v3, read64(p + 16));
+            v4 = hash_round(v4, read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+
+        h = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+        h = hash_merge(h, v1);
+        h = hash_merge(h, v2);
+        h = hash_merge(h, v3);
+        h = hash_merge(h, v4);
+    } else {
+        h = seed + PRIME64_5;
+    }
+
+    h += (uint64_t)len;
+
+    // Tail: remaining 8-byte words, one 4-byte word, then single bytes
+    while (p + 8 <= end) {
+        h ^= hash_round(0, read64(p));
+        h = rotl64(h, 27) * PRIME64_1 + PRIME64_4;
+        p += 8;
+    }
+    if (p + 4 <= end) {
+        h ^= (uint64_t)read32(p) * PRIME64_1;
+        h = rotl64(h, 23) * PRIME64_2 + PRIME64_3;
+        p += 4;
+    }
+    while (p < end) {
+        h ^= (*p) * PRIME64_5;
+        h = rotl64(h, 11) * PRIME64_1;
+        p++;
+    }
+
+    // Final avalanche
+    h ^= h >> 33;
+    h *= PRIME64_2;
+    h ^= h >> 29;
+    h *= PRIME64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+/**
+ * @brief Number of ranges a file of the given size is split into
+ */
+uint64_t hash_range_count(uint64_t file_size, uint64_t range_size) {
+    if (range_size == 0) {
+        return 0;
+    }
+    return (file_size + range_size - 1) / range_size;
+}
+
+/**
+ * @brief Combine the range digests of a file into a whole-file digest
+ */
+uint64_t hash_combine_ranges(const uint64_t *digests, uint64_t range_count, uint64_t file_size) {
+    if (range_count == 0) {
+        return hash64(NULL, 0, file_size);
+    }
+    return hash64(digests, (size_t)range_count * sizeof(uint64_t), file_size);
+}
+
+/**
+ * @brief Default number of hashing threads for this machine
+ */
+int hash_default_threads(void) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus < 1) {
+        return 1;
+    }
+    if (cpus > HASH_MAX_THREADS) {
+        return HASH_MAX_THREADS;
+    }
+    return (int)cpus;
+}
+
+/**
+ * @brief Shared state of one hash_run_jobs() invocation
+ */
+typedef struct {
+    HashJob *jobs;
+    size_t job_count;
+    uint64_t range_size;
+    uint64_t *unit_offsets;        // Prefix sums of range counts (job_count + 1 entries)
+    uint64_t total_units;
+    atomic_uint_fast64_t next_unit;
+    pthread_mutex_t error_lock;    // Serializes status writes on the (rare) error path
+    int failed;
+} HashPool;
+
+/**
+ * @brief Map a work unit number to the job that owns it (binary search)
+ */
+static size_t find_job(const HashPool *pool, uint64_t unit) {
+    size_t lo = 0, hi = pool->job_count;
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (pool->unit_offsets[mid] <= unit) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+/**
+ * @brief Read exactly len bytes at offset, retrying on short reads
+ */
+static int pread_full(int fd, unsigned char *buf, size_t len, uint64_t offset) {
+    size_t done = 0;
+    while (done < len) {
+        ssize_t n = pread(fd, buf + done, len - done, (off_t)(offset + done));
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        if (n == 0) {
+            return -1;  // File shrank underneath us
+        }
+        done += (size_t)n;
+    }
+    return 0;
+}
+
+static void mark_failed(HashPool *pool, HashJob *job) {
+    pthread_mutex_lock(&pool->error_lock);
+    job->status = -1;
+    pool->failed = 1;
+    pthread_mutex_unlock(&pool->error_lock);
+}
+
+/**
+ * @brief Worker thread: claim (file, range) units until none are left
+ */
+static void *hash_worker(void *arg) {
+    HashPool *pool = (HashPool *)arg;
+    unsigned char *buffer = malloc(pool->range_size);
+    int fd = -1;
+    size_t open_job = (size_t)-1;
+
+    for (;;) {
+        uint64_t unit = atomic_fetch_add(&pool->next_unit, 1);
+        if (unit >= pool->total_units) {
+            break;
+        }
+
+        size_t j = find_job(pool, unit);
+        HashJob *job = &pool->jobs[j];
+        uint64_t range = unit - pool->unit_offsets[j];
+
+        if (!buffer) {
+            mark_failed(pool, job);
+            continue;
+        }
+
+        // Keep the descriptor open while consecutive units belong to the same file
+        if (j != open_job) {
+            if (fd >= 0) {
+                close(fd);
+            }
+            fd = open(job->path, O_RDONLY);
+            open_job = j;
+#if defined(POSIX_FADV_SEQUENTIAL)
+            if (fd >= 0) {
+                posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+            }
+#endif
+        }
+        if (fd < 0) {
+            mark_failed(pool, job);
+            continue;
+        }
+
+        uint64_t offset = range * pool->range_size;
+        uint64_t remaining = job->file_size - offset;
+        size_t len = remaining < pool->range_size ? (size_t)remaining : (size_t)pool->range_size;
+
+        if (pread_full(fd, buffer, len, offset) != 0) {
+            mark_failed(pool, job);
+            continue;
+        }
+
+        job->digests[range] = hash64(buffer, len, 0);
+    }
+
+    if (fd >= 0) {
+        close(fd);
+    }
+    free(buffer);
+    return NULL;
+}
+
+/**
+ * @brief Hash a batch of files range by range on a pool of threads
+ */
+int hash_run_jobs(HashJob *jobs, size_t job_count, uint64_t range_size, int threads) {
+    if (job_count == 0) {
+        return 0;
+    }
+    if (range_size == 0) {
+        return -1;
+    }
+
+    HashPool pool;
+    memset(&pool, 0, sizeof(pool));
+    pool.jobs = jobs;
+    pool.job_count = job_count;
+    pool.range_size = range_size;
+
+    pool.unit_offsets = malloc((job_count + 1) * sizeof(uint64_t));
+    if (!pool.unit_offsets) {
+        perror("malloc");
+        return -1;
+    }
+
+    for (size_t i = 0; i < job_count; i++) {
+        jobs[i].status = 0;
+        pool.unit_offsets[i] = pool.total_units;
+        pool.total_units += jobs[i].range_count;
+    }
+    pool.unit_offsets[job_count] = pool.total_units;
+    atomic_init(&pool.next_unit, 0);
+    pthread_mutex_init(&pool.error_lock, NULL);
+
+    if (threads <= 0) {
+        threads = hash_default_threads();
+    }
+    if ((uint64_t)threads > pool.total_units) {
+        threads = pool.total_units > 0 ? (int)pool.total_units : 1;
+    }
+
+    if (threads == 1) {
+        hash_worker(&pool);
+    } else {
+        pthread_t workers[HASH_MAX_THREADS];
+        int started = 0;
+        for (int i = 0; i < threads && i < HASH_MAX_THREADS; i++) {
+            if (pthread_create(&workers[i], NULL, hash_worker, &pool) != 0) {
+                break;
+            }
+            started++;
+        }
+        if (started == 0) {
+            hash_worker(&pool);  // Could not spawn threads: hash inline
+        }
+        for (int i = 0; i < started; i++) {
+            pthread_join(workers[i], NULL);
+        }
+    }
+
+    pthread_mutex_destroy(&pool.error_lock);
+    free(pool.unit_offsets);
+    return pool.failed ? -1 : 0;
+}
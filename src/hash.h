@@ -0,0 +1,97 @@
+/**
+ * @file hash.h
+ * @brief Fast content hashing for NETTF file transfer tool
+ *
+ * Provides a 64-bit non-cryptographic content hash (xxHash64 construction)
+ * and a multi-threaded file hasher that splits work across files and fixed
+ * size byte ranges. Used to compare replicas without moving file data.
+ */
+
+#ifndef HASH_H
+#define HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Default digest granularity (4 MB ranges)
+ *
+ * Features that share cached digests must hash with the same range size.
+ */
+#define HASH_RANGE_SIZE (4 * 1024 * 1024)
+
+/**
+ * @brief Upper bound on hashing worker threads
+ */
+#define HASH_MAX_THREADS 16
+
+/**
+ * @brief A file to hash as a sequence of fixed-size ranges
+ *
+ * The caller fills in path, file_size, range_count and digests; the hasher
+ * writes one digest per range and sets status to -1 if the file could not
+ * be read completely.
+ */
+typedef struct {
+    const char *path;      // Local path of the file
+    uint64_t file_size;    // Expected size in bytes
+    uint64_t range_count;  // Number of ranges (see hash_range_count)
+    uint64_t *digests;     // Output: range_count digests
+    int status;            // Output: 0 on success, -1 on read error
+} HashJob;
+
+/**
+ * @brief Hash a memory buffer
+ *
+ * Processes 32-byte stripes in four independent accumulator lanes so the
+ * multiplies of consecutive lanes overlap in the pipeline (and map onto
+ * vector registers where the target has 64-bit vector multiplies).
+ *
+ * @param data Pointer to data
+ * @param len Number of bytes to hash
+ * @param seed Seed value (0 for content addressing)
+ * @return 64-bit digest
+ */
+uint64_t hash64(const void *data, size_t len, uint64_t seed);
+
+/**
+ * @brief Number of ranges a file of the given size is split into
+ *
+ * @param file_size Size of the file in bytes
+ * @param range_size Size of each range in bytes
+ * @return Range count (0 for an empty file)
+ */
+uint64_t hash_range_count(uint64_t file_size, uint64_t range_size);
+
+/**
+ * @brief Combine the range digests of a file into a whole-file digest
+ *
+ * @param digests Range digests
+ * @param range_count Number of range digests
+ * @param file_size Size of the file in bytes
+ * @return 64-bit whole-file digest
+ */
+uint64_t hash_combine_ranges(const uint64_t *digests, uint64_t range_count, uint64_t file_size);
+
+/**
+ * @brief Default number of hashing threads for this machine
+ *
+ * @return Online CPU count, clamped to [1, HASH_MAX_THREADS]
+ */
+int hash_default_threads(void);
+
+/**
+ * @brief Hash a batch of files range by range on a pool of threads
+ *
+ * Every (file, range) pair is an independent work unit, so a few large
+ * files and many small files both keep all threads busy.
+ *
+ * @param jobs Array of jobs to process
+ * @param job_count Number of jobs
+ * @param range_size Size of each range in bytes
+ * @param threads Number of worker threads (0 for hash_default_threads())
+ * @return 0 if every job succeeded, -1 if any job failed
+ */
+int hash_run_jobs(HashJob *jobs, size_t job_count, uint64_t range_size, int threads);
+
+#endif // HASH_H
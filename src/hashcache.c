@@ -0,0 +1,375 @@
+/**
+ * @file hashcache.c
+ * @brief Persistent content-hash cache implementation
+ *
+ * Index file layout (host byte order, rejected on endianness mismatch):
+ *   "NTHC" magic, uint32 version, uint32 byte order marker, uint32 reserved,
+ *   uint64 entry count, then per entry eight 64-bit fields followed by
+ *   range_count 64-bit digests.
+ */
+
+#define _GNU_SOURCE  // Enable getpid() and snprintf() on older systems
+#include "hashcache.h"
+#include "platform.h"  // platform_cache_path()
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define HASHCACHE_MAGIC "NTHC"
+#define HASHCACHE_VERSION 1
+#define HASHCACHE_BYTE_ORDER 0x01020304u
+#define HASHCACHE_MIN_CAPACITY 1024
+
+/**
+ * @brief Fixed-size part of an entry as stored in the index file
+ */
+typedef struct {
+    uint64_t dev;
+    uint64_t ino;
+    uint64_t size;
+    int64_t mtime_ns;
+    int64_t ctime_ns;
+    uint64_t range_size;
+    uint64_t range_count;
+    int64_t last_used;
+} HashCacheRecord;
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t reserved;
+    uint64_t count;
+} HashCacheFileHeader;
+
+/**
+ * @brief Slot index for a (dev, inode) key (64-bit mix)
+ */
+static size_t slot_for(const HashCache *cache, uint64_t dev, uint64_t ino) {
+    uint64_t h = ino * 0x9E3779B97F4A7C15ULL ^ (dev + 0x632BE59BD9B4E019ULL);
+    h ^= h >> 31;
+    h *= 0xBF58476D1CE4E5B9ULL;
+    h ^= h >> 29;
+    return (size_t)h & (cache->capacity - 1);
+}
+
+/**
+ * @brief Find the slot holding a key, or the empty slot where it belongs
+ */
+static HashCacheEntry *find_slot(HashCache *cache, uint64_t dev, uint64_t ino) {
+    size_t i = slot_for(cache, dev, ino);
+    for (;;) {
+        HashCacheEntry *slot = &cache->slots[i];
+        if (slot->digests == NULL || (slot->dev == dev && slot->ino == ino)) {
+            return slot;
+        }
+        i = (i + 1) & (cache->capacity - 1);  // Linear probing
+    }
+}
+
+/**
+ * @brief Double the table when it is more than 70% full
+ */
+static int grow_if_needed(HashCache *cache) {
+    if (cache->capacity > 0 && (cache->count + 1) * 10 < cache->capacity * 7) {
+        return 0;
+    }
+
+    size_t new_capacity = cache->capacity ? cache->capacity * 2 : HASHCACHE_MIN_CAPACITY;
+    HashCacheEntry *new_slots = calloc(new_capacity, sizeof(HashCacheEntry));
+    if (!new_slots) {
+        perror("calloc");
+        return -1;
+    }
+
+    HashCacheEntry *old_slots = cache->slots;
+    size_t old_capacity = cache->capacity;
+    cache->slots = new_slots;
+    cache->capacity = new_capacity;
+
+    for (size_t i = 0; i < old_capacity; i++) {
+        if (old_slots[i].digests != NULL) {
+            *find_slot(cache, old_slots[i].dev, old_slots[i].ino) = old_slots[i];
+        }
+    }
+
+    free(old_slots);
+    return 0;
+}
+
+/**
+ * @brief Insert an entry, taking ownership of its digest buffer
+ */
+static int insert_entry(HashCache *cache, const HashCacheEntry *entry) {
+    if (grow_if_needed(cache) != 0) {
+        return -1;
+    }
+
+    HashCacheEntry *slot = find_slot(cache, entry->dev, entry->ino);
+    if (slot->digests != NULL) {
+        free(slot->digests);  // Replace a stale entry for the same inode
+    } else {
+        cache->count++;
+    }
+    *slot = *entry;
+    return 0;
+}
+
+/**
+ * @brief Load the cache from the per-user index file
+ */
+int hashcache_open(HashCache *cache) {
+    memset(cache, 0, sizeof(HashCache));
+
+    if (platform_cache_path(HASHCACHE_FILE_NAME, cache->path, sizeof(cache->path)) != 0) {
+        cache->path[0] = '\0';
+        return -1;
+    }
+
+    FILE *file = fopen(cache->path, "rb");
+    if (!file) {
+        return 0;  // No index yet: start empty
+    }
+
+    HashCacheFileHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1 ||
+        memcmp(header.magic, HASHCACHE_MAGIC, 4) != 0 ||
+        header.version != HASHCACHE_VERSION ||
+        header.byte_order != HASHCACHE_BYTE_ORDER) {
+        fclose(file);
+        return 0;  // Foreign or outdated index: start empty
+    }
+
+    for (uint64_t i = 0; i < header.count; i++) {
+        HashCacheRecord record;
+        if (fread(&record, sizeof(record), 1, file) != 1) {
+            break;  // Truncated index: keep what was read
+        }
+
+        // Reject records that cannot be right before allocating for them
+        if (record.range_size == 0 ||
+            record.range_count != hash_range_count(record.size, record.range_size)) {
+            break;
+        }
+
+        HashCacheEntry entry;
+        entry.dev = record.dev;
+        entry.ino = record.ino;
+        entry.size = record.size;
+        entry.mtime_ns = record.mtime_ns;
+        entry.ctime_ns = record.ctime_ns;
+        entry.range_size = record.range_size;
+        entry.range_count = record.range_count;
+        entry.last_used = record.last_used;
+        entry.digests = malloc((record.range_count ? record.range_count : 1) * sizeof(uint64_t));
+        if (!entry.digests) {
+            break;
+        }
+        if (record.range_count > 0 &&
+            fread(entry.digests, sizeof(uint64_t), record.range_count, file) != record.range_count) {
+            free(entry.digests);
+            break;
+        }
+        if (insert_entry(cache, &entry) != 0) {
+            free(entry.digests);
+            break;
+        }
+    }
+
+    fclose(file);
+    cache->dirty = 0;
+    return 0;
+}
+
+/**
+ * @brief Look up the digests of a file
+ */
+const uint64_t *hashcache_lookup(HashCache *cache, const FileEntry *entry, uint64_t range_size) {
+    if (cache == NULL || cache->capacity == 0) {
+        return NULL;
+    }
+
+    HashCacheEntry *slot = find_slot(cache, entry->dev, entry->ino);
+    if (slot->digests == NULL ||
+        slot->size != entry->size ||
+        slot->mtime_ns != entry->mtime_ns ||
+        slot->ctime_ns != entry->ctime_ns ||
+        slot->range_size != range_size) {
+        cache->misses++;
+        return NULL;
+    }
+
+    slot->last_used = (int64_t)time(NULL);
+    cache->dirty = 1;
+    cache->hits++;
+    return slot->digests;
+}
+
+/**
+ * @brief Remember the digests of a file
+ */
+int hashcache_store(HashCache *cache, const FileEntry *entry, uint64_t range_size,
+                    const uint64_t *digests, uint64_t range_count) {
+    if (cache == NULL || cache->path[0] == '\0') {
+        return 0;
+    }
+
+    // Do not trust files that may still be changing within timestamp granularity
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    int64_t now_ns = (int64_t)now.tv_sec * 1000000000LL + now.tv_nsec;
+    if (entry->mtime_ns > now_ns - HASHCACHE_RACY_WINDOW_NS ||
+        entry->ctime_ns > now_ns - HASHCACHE_RACY_WINDOW_NS) {
+        return 0;
+    }
+
+    HashCacheEntry cached;
+    cached.dev = entry->dev;
+    cached.ino = entry->ino;
+    cached.size = entry->size;
+    cached.mtime_ns = entry->mtime_ns;
+    cached.ctime_ns = entry->ctime_ns;
+    cached.range_size = range_size;
+    cached.range_count = range_count;
+    cached.last_used = (int64_t)now.tv_sec;
+    cached.digests = malloc((range_count ? range_count : 1) * sizeof(uint64_t));
+    if (!cached.digests) {
+        perror("malloc");
+        return -1;
+    }
+    if (range_count > 0) {
+        memcpy(cached.digests, digests, range_count * sizeof(uint64_t));
+    }
+
+    if (insert_entry(cache, &cached) != 0) {
+        free(cached.digests);
+        return -1;
+    }
+    cache->dirty = 1;
+    return 0;
+}
+
+/**
+ * @brief Hash files, serving unchanged ones from the cache
+ */
+int hashcache_hash_files(HashCache *cache, const FileEntry *const *entries, HashJob *jobs,
+                         size_t count, uint64_t range_size) {
+    HashJob *misses = malloc((count ? count : 1) * sizeof(HashJob));
+    size_t *miss_owner = malloc((count ? count : 1) * sizeof(size_t));
+    if (!misses || !miss_owner) {
+        perror("malloc");
+        free(misses);
+        free(miss_owner);
+        return -1;
+    }
+
+    size_t miss_count = 0;
+    for (size_t i = 0; i < count; i++) {
+        jobs[i].status = 0;
+        const uint64_t *cached = hashcache_lookup(cache, entries[i], range_size);
+        if (cached) {
+            if (jobs[i].range_count > 0) {
+                memcpy(jobs[i].digests, cached, jobs[i].range_count * sizeof(uint64_t));
+            }
+            continue;
+        }
+        misses[miss_count] = jobs[i];
+        miss_owner[miss_count] = i;
+        miss_count++;
+    }
+
+    int result = hash_run_jobs(misses, miss_count, range_size, 0);
+
+    for (size_t m = 0; m < miss_count; m++) {
+        size_t i = miss_owner[m];
+        jobs[i].status = misses[m].status;
+        if (misses[m].status == 0) {
+            hashcache_store(cache, entries[i], range_size, jobs[i].digests, jobs[i].range_count);
+        }
+    }
+
+    free(misses);
+    free(miss_owner);
+    return result;
+}
+
+/**
+ * @brief Write the cache back to the index file if it changed
+ */
+int hashcache_save(HashCache *cache) {
+    if (cache->path[0] == '\0' || !cache->dirty) {
+        return 0;
+    }
+
+    // Write to a private temporary file, then atomically replace the index
+    char tmp_path[4200];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp.%ld", cache->path, (long)getpid());
+
+    FILE *file = fopen(tmp_path, "wb");
+    if (!file) {
+        perror("fopen");
+        return -1;
+    }
+
+    int64_t oldest = (int64_t)time(NULL) - HASHCACHE_MAX_AGE;
+    uint64_t kept = 0;
+    for (size_t i = 0; i < cache->capacity; i++) {
+        if (cache->slots[i].digests != NULL && cache->slots[i].last_used >= oldest) {
+            kept++;
+        }
+    }
+
+    HashCacheFileHeader header;
+    memcpy(header.magic, HASHCACHE_MAGIC, 4);
+    header.version = HASHCACHE_VERSION;
+    header.byte_order = HASHCACHE_BYTE_ORDER;
+    header.reserved = 0;
+    header.count = kept;
+
+    int ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    for (size_t i = 0; ok && i < cache->capacity; i++) {
+        const HashCacheEntry *entry = &cache->slots[i];
+        if (entry->digests == NULL || entry->last_used < oldest) {
+            continue;
+        }
+
+        HashCacheRecord record;
+        record.dev = entry->dev;
+        record.ino = entry->ino;
+        record.size = entry->size;
+        record.mtime_ns = entry->mtime_ns;
+        record.ctime_ns = entry->ctime_ns;
+        record.range_size = entry->range_size;
+        record.range_count = entry->range_count;
+        record.last_used = entry->last_used;
+
+        ok = fwrite(&record, sizeof(record), 1, file) == 1 &&
+             (entry->range_count == 0 ||
+              fwrite(entry->digests, sizeof(uint64_t), entry->range_count, file) == entry->range_count);
+    }
+
+    if (fclose(file) != 0) {
+        ok = 0;
+    }
+    if (!ok || rename(tmp_path, cache->path) != 0) {
+        perror("hashcache");
+        remove(tmp_path);
+        return -1;
+    }
+
+    cache->dirty = 0;
+    return 0;
+}
+
+/**
+ * @brief Release all memory owned by the cache
+ */
+void hashcache_close(HashCache *cache) {
+    for (size_t i = 0; i < cache->capacity; i++) {
+        free(cache->slots[i].digests);
+    }
+    free(cache->slots);
+    memset(cache, 0, sizeof(HashCache));
+}
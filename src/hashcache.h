@@ -0,0 +1,137 @@
+/**
+ * @file hashcache.h
+ * @brief Persistent content-hash cache for NETTF file transfer tool
+ *
+ * Remembers the range digests of files on the sending side so unchanged
+ * files are never read twice. Entries are keyed by (dev, inode) and are only
+ * trusted while size, mtime and ctime (all in nanoseconds) still match the
+ * stat() data the walk already collected, so a lookup is an in-memory hash
+ * table probe with no extra system call.
+ *
+ * The cache lives in a single index file in the per-user cache directory
+ * (see platform_cache_path()) and is rewritten atomically on save.
+ */
+
+#ifndef HASHCACHE_H
+#define HASHCACHE_H
+
+#include "filelist.h"  // FileEntry (stat metadata)
+#include "hash.h"      // HashJob
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Name of the index file inside the cache directory
+ */
+#define HASHCACHE_FILE_NAME "hashcache.idx"
+
+/**
+ * @brief Files modified this recently are not cached (nanoseconds)
+ *
+ * A file written within the timestamp granularity of the filesystem could
+ * change again without its mtime moving; such "racy" files are rehashed on
+ * every run until they have been quiet for this long.
+ */
+#define HASHCACHE_RACY_WINDOW_NS (2LL * 1000000000LL)
+
+/**
+ * @brief Entries not used for this long are dropped on save (seconds)
+ */
+#define HASHCACHE_MAX_AGE (30L * 24 * 3600)
+
+/**
+ * @brief One cached file
+ */
+typedef struct {
+    uint64_t dev;          // Device number (key)
+    uint64_t ino;          // Inode number (key)
+    uint64_t size;         // File size when hashed
+    int64_t mtime_ns;      // Modification time when hashed
+    int64_t ctime_ns;      // Status change time when hashed
+    uint64_t range_size;   // Range size the digests were computed with
+    uint64_t range_count;  // Number of digests
+    int64_t last_used;     // Last lookup or store (seconds since the epoch)
+    uint64_t *digests;     // Range digests (NULL for an empty slot)
+} HashCacheEntry;
+
+/**
+ * @brief Open-addressing table of cached files
+ */
+typedef struct {
+    HashCacheEntry *slots;
+    size_t capacity;       // Number of slots (power of two)
+    size_t count;          // Number of used slots
+    int dirty;             // Set when the table differs from the index file
+    char path[4096];       // Index file path ("" if caching is unavailable)
+    uint64_t hits;         // Lookups served from the cache
+    uint64_t misses;       // Lookups that required hashing
+} HashCache;
+
+/**
+ * @brief Load the cache from the per-user index file
+ *
+ * A missing, unreadable or incompatible index file yields an empty cache.
+ *
+ * @param cache Pointer to HashCache to initialize
+ * @return 0 on success, -1 if the cache cannot be used at all
+ */
+int hashcache_open(HashCache *cache);
+
+/**
+ * @brief Look up the digests of a file
+ *
+ * @param cache Pointer to HashCache
+ * @param entry File to look up (stat metadata from the walk)
+ * @param range_size Range size the caller hashes with
+ * @return Cached digests (hash_range_count() entries), NULL on a miss
+ */
+const uint64_t *hashcache_lookup(HashCache *cache, const FileEntry *entry, uint64_t range_size);
+
+/**
+ * @brief Remember the digests of a file
+ *
+ * Files modified within HASHCACHE_RACY_WINDOW_NS are ignored.
+ *
+ * @param cache Pointer to HashCache
+ * @param entry File the digests belong to
+ * @param range_size Range size the digests were computed with
+ * @param digests Range digests
+ * @param range_count Number of digests
+ * @return 0 on success (or if ignored), -1 on allocation failure
+ */
+int hashcache_store(HashCache *cache, const FileEntry *entry, uint64_t range_size,
+                    const uint64_t *digests, uint64_t range_count);
+
+/**
+ * @brief Hash files, serving unchanged ones from the cache
+ *
+ * jobs[i] must describe entries[i] (path, size, range_count, digests buffer).
+ * Cache hits are copied into the job's digest buffer; misses are hashed on
+ * the thread pool and stored.
+ *
+ * @param cache Pointer to HashCache (NULL to always hash)
+ * @param entries Files to hash
+ * @param jobs Hash jobs, one per entry
+ * @param count Number of entries
+ * @param range_size Range size to hash with
+ * @return 0 if every file was hashed, -1 if any job failed
+ */
+int hashcache_hash_files(HashCache *cache, const FileEntry *const *entries, HashJob *jobs,
+                         size_t count, uint64_t range_size);
+
+/**
+ * @brief Write the cache back to the index file if it changed
+ *
+ * @param cache Pointer to HashCache
+ * @return 0 on success, -1 on error
+ */
+int hashcache_save(HashCache *cache);
+
+/**
+ * @brief Release all memory owned by the cache
+ *
+ * @param cache Pointer to HashCache
+ */
+void hashcache_close(HashCache *cache);
+
+#endif // HASHCACHE_H
@@ -0,0 +1,655 @@
+/**
+ * @file hostprobe.c
+ * @brief Concurrent host liveness probing implementation
+ *
+ * Both probers are single-threaded event loops: probe i is due at
+ * start + i / rate, everything that is due goes out, and poll() waits for
+ * answers until the next probe is due or the oldest outstanding probe times
+ * out. ICMP replies are matched to hosts by source address and sequence
+ * number. TCP connects (the liveness fallback and service checks) are
+ * watched with epoll on Linux and poll() elsewhere, with up to
+ * HOSTPROBE_MAX_CONNECTS in flight (fewer if the descriptor limit is lower).
+ */
+
+#define _GNU_SOURCE  // Enable IPPROTO_ICMP datagram sockets on Linux systems
+#include "hostprobe.h"
+#include "platform.h"  // platform_monotonic_ns()
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+// ICMP message types and header size
+#define ICMP_TYPE_ECHO_REPLY   0
+#define ICMP_TYPE_ECHO_REQUEST 8
+#define ICMP_HEADER_SIZE       8
+
+// Payload carried by every echo request
+#define PROBE_PAYLOAD "NETTF probe"
+
+/**
+ * @brief Time at which probe i may be sent
+ */
+static double probe_due(double start, int i, int rate) {
+    return rate > 0 ? start + (double)i * 1000.0 / rate : start;
+}
+
+/**
+ * @brief Milliseconds until a point in time, rounded up for poll()
+ */
+static int wait_until(double when, double now) {
+    if (when <= now) {
+        return 0;
+    }
+    return (int)(when - now) + 1;
+}
+
+/**
+ * @brief Put a descriptor in non-blocking mode
+ */
+static int set_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags < 0 ? -1 : fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+/**
+ * @brief Open a non-blocking ICMP socket
+ *
+ * Prefers an unprivileged datagram socket; a raw socket also works when the
+ * process is privileged.
+ */
+static int open_icmp_socket(int *raw) {
+    int fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_ICMP);
+    *raw = 0;
+    if (fd < 0) {
+        fd = socket(AF_INET, SOCK_RAW, IPPROTO_ICMP);
+        *raw = 1;
+    }
+    if (fd >= 0 && set_nonblocking(fd) != 0) {
+        close(fd);
+        fd = -1;
+    }
+    return fd;
+}
+
+/**
+ * @brief Internet checksum of an ICMP message
+ */
+static uint16_t icmp_checksum(const unsigned char *data, size_t len) {
+    uint32_t sum = 0;
+    for (size_t i = 0; i + 1 < len; i += 2) {
+        sum += (uint32_t)(data[i] << 8 | data[i + 1]);
+    }
+    if (len & 1) {
+        sum += (uint32_t)data[len - 1] << 8;
+    }
+    while (sum >> 16) {
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    }
+    return (uint16_t)~sum;
+}
+
+// Host table sorted by address, used to match replies
+static const HostProbe *sort_hosts;
+
+/**
+ * @brief Order host indices by address
+ */
+static int compare_host_index(const void *a, const void *b) {
+    uint32_t x = sort_hosts[*(const int *)a].addr;
+    uint32_t y = sort_hosts[*(const int *)b].addr;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Find the host with an address in the sorted index
+ */
+static int find_host(const HostProbe *hosts, const int *order, int count, uint32_t addr) {
+    int lo = 0, hi = count - 1;
+    while (lo <= hi) {
+        int mid = lo + (hi - lo) / 2;
+        uint32_t value = hosts[order[mid]].addr;
+        if (value == addr) {
+            return order[mid];
+        }
+        if (value < addr) {
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Send one echo request
+ *
+ * @return 0 if sent (or the host is unreachable), 1 if the socket buffer is full
+ */
+static int send_echo(int fd, uint32_t addr, uint16_t id, uint16_t seq) {
+    unsigned char packet[ICMP_HEADER_SIZE + sizeof(PROBE_PAYLOAD)];
+    memset(packet, 0, sizeof(packet));
+    packet[0] = ICMP_TYPE_ECHO_REQUEST;
+    packet[4] = (unsigned char)(id >> 8);
+    packet[5] = (unsigned char)id;
+    packet[6] = (unsigned char)(seq >> 8);
+    packet[7] = (unsigned char)seq;
+    memcpy(packet + ICMP_HEADER_SIZE, PROBE_PAYLOAD, sizeof(PROBE_PAYLOAD));
+
+    uint16_t sum = icmp_checksum(packet, sizeof(packet));
+    packet[2] = (unsigned char)(sum >> 8);
+    packet[3] = (unsigned char)sum;
+
+    struct sockaddr_in to;
+    memset(&to, 0, sizeof(to));
+    to.sin_family = AF_INET;
+    to.sin_addr.s_addr = htonl(addr);
+
+    if (sendto(fd, packet, sizeof(packet), 0, (struct sockaddr *)&to, sizeof(to)) < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS || errno == EINTR) {
+            return 1;
+        }
+        // Unreachable networks and the like: the host simply does not answer
+    }
+    return 0;
+}
+
+/**
+ * @brief Probe hosts with ICMP echo requests
+ */
+static int probe_icmp(int fd, int raw, HostProbe *hosts, int count, int timeout_ms, int rate) {
+    int *order = malloc((size_t)count * sizeof(int));
+    double *sent_at = malloc((size_t)count * sizeof(double));
+    if (!order || !sent_at) {
+        perror("malloc");
+        free(order);
+        free(sent_at);
+        return -1;
+    }
+
+    for (int i = 0; i < count; i++) {
+        order[i] = i;
+    }
+    sort_hosts = hosts;
+    qsort(order, (size_t)count, sizeof(int), compare_host_index);
+
+    // Datagram sockets get their identifier from the kernel; raw ones use ours
+    uint16_t id = (uint16_t)getpid();
+    int next = 0;
+    int answered = 0;
+    int blocked = 0;
+    double start = platform_monotonic_ns() / 1e6;
+
+    while (1) {
+        double now = platform_monotonic_ns() / 1e6;
+
+        while (!blocked && next < count && now >= probe_due(start, next, rate)) {
+            if (send_echo(fd, hosts[next].addr, id, (uint16_t)next) != 0) {
+                blocked = 1;
+                break;
+            }
+            sent_at[next++] = now;
+        }
+
+        if (next == count && (answered == count || now >= sent_at[count - 1] + timeout_ms)) {
+            break;
+        }
+
+        struct pollfd pfd;
+        pfd.fd = fd;
+        pfd.events = POLLIN | (blocked ? POLLOUT : 0);
+        pfd.revents = 0;
+        int wait = next < count ? wait_until(probe_due(start, next, rate), now)
+                                : wait_until(sent_at[count - 1] + timeout_ms, now);
+        if (blocked && wait < 10) {
+            wait = 10;  // Full send buffer: let POLLOUT end the wait
+        }
+        if (poll(&pfd, 1, wait) < 0 && errno != EINTR) {
+            perror("poll");
+            break;
+        }
+        if (pfd.revents & POLLOUT) {
+            blocked = 0;
+        }
+
+        // Drain every reply that has arrived
+        while (pfd.revents & POLLIN) {
+            unsigned char buf[1500];
+            struct sockaddr_in from;
+            socklen_t from_len = sizeof(from);
+            ssize_t n = recvfrom(fd, buf, sizeof(buf), 0, (struct sockaddr *)&from, &from_len);
+            if (n < 0) {
+                break;
+            }
+            double received = platform_monotonic_ns() / 1e6;
+
+            // Raw sockets (and datagram sockets on some systems) include the IP header
+            const unsigned char *icmp = buf;
+            if (n >= 20 && (buf[0] >> 4) == 4) {
+                size_t ihl = (size_t)(buf[0] & 0x0F) * 4;
+                if ((size_t)n < ihl) {
+                    continue;
+                }
+                icmp += ihl;
+                n -= (ssize_t)ihl;
+            }
+            if (n < ICMP_HEADER_SIZE || icmp[0] != ICMP_TYPE_ECHO_REPLY) {
+                continue;
+            }
+            if (raw && (uint16_t)(icmp[4] << 8 | icmp[5]) != id) {
+                continue;  // Another process's ping
+            }
+
+            int index = find_host(hosts, order, count, ntohl(from.sin_addr.s_addr));
+            uint16_t seq = (uint16_t)(icmp[6] << 8 | icmp[7]);
+            if (index < 0 || index >= next || (uint16_t)index != seq || hosts[index].alive) {
+                continue;
+            }
+            if (received - sent_at[index] > timeout_ms) {
+                continue;  // Too late to count
+            }
+            hosts[index].alive = 1;
+            hosts[index].rtt_ms = received - sent_at[index];
+            answered++;
+        }
+    }
+
+    free(order);
+    free(sent_at);
+    return answered;
+}
+
+/**
+ * @brief One TCP connect in flight
+ */
+typedef struct {
+    int fd;           // Connecting socket, -1 if the slot is free
+    int index;        // Host being probed
+    double started;   // When the connect was issued
+} ConnectSlot;
+
+/**
+ * @brief Connects in flight and the readiness backend watching them
+ *
+ * Slots keep their number while in use, so epoll can report them by number;
+ * the poll() fallback rebuilds its descriptor array before every wait.
+ */
+typedef struct {
+    ConnectSlot *slots;   // limit slots
+    int limit;            // Number of slots
+    int active;           // Slots in use
+    int *free_slots;      // Stack of unused slot numbers
+    int free_count;       // Entries on the stack
+    int epfd;             // epoll instance, -1 when using poll()
+#ifdef __linux__
+    struct epoll_event *events;  // epoll_wait() results
+#endif
+    struct pollfd *pfds;  // poll() fallback: descriptors of the slots in use
+    int *pfd_slot;        // poll() fallback: slot of each descriptor
+} ConnectSet;
+
+/**
+ * @brief Most descriptors the TCP prober may use at once
+ */
+static int connect_limit(void) {
+    int limit = HOSTPROBE_MAX_CONNECTS;
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur != RLIM_INFINITY) {
+        // Leave room for the descriptors the rest of the program holds
+        int available = (int)rl.rlim_cur - 32;
+        if (available < limit) {
+            limit = available > 1 ? available : 1;
+        }
+    }
+    return limit;
+}
+
+/**
+ * @brief Release a connect set (closes connects still in flight)
+ */
+static void connect_set_free(ConnectSet *set) {
+    if (set->slots) {
+        for (int i = 0; i < set->limit; i++) {
+            if (set->slots[i].fd >= 0) {
+                close(set->slots[i].fd);
+            }
+        }
+    }
+    if (set->epfd >= 0) {
+        close(set->epfd);
+    }
+#ifdef __linux__
+    free(set->events);
+#endif
+    free(set->slots);
+    free(set->free_slots);
+    free(set->pfds);
+    free(set->pfd_slot);
+}
+
+/**
+ * @brief Allocate a connect set, using epoll where available
+ */
+static int connect_set_init(ConnectSet *set, int limit) {
+    memset(set, 0, sizeof(ConnectSet));
+    set->limit = limit;
+    set->epfd = -1;
+    set->slots = malloc((size_t)limit * sizeof(ConnectSlot));
+    set->free_slots = malloc((size_t)limit * sizeof(int));
+    if (!set->slots || !set->free_slots) {
+        perror("malloc");
+        connect_set_free(set);
+        return -1;
+    }
+    for (int i = 0; i < limit; i++) {
+        set->slots[i].fd = -1;
+        set->free_slots[i] = limit - 1 - i;
+    }
+    set->free_count = limit;
+
+#ifdef __linux__
+    set->epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (set->epfd >= 0) {
+        set->events = malloc((size_t)limit * sizeof(struct epoll_event));
+        if (!set->events) {
+            perror("malloc");
+            connect_set_free(set);
+            return -1;
+        }
+        return 0;
+    }
+#endif
+
+    set->pfds = malloc((size_t)limit * sizeof(struct pollfd));
+    set->pfd_slot = malloc((size_t)limit * sizeof(int));
+    if (!set->pfds || !set->pfd_slot) {
+        perror("malloc");
+        connect_set_free(set);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Start watching a connecting socket
+ *
+ * @return Slot number, -1 on error
+ */
+static int connect_set_add(ConnectSet *set, int fd, int index, double started) {
+    int slot = set->free_slots[--set->free_count];
+
+#ifdef __linux__
+    if (set->epfd >= 0) {
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLOUT;
+        ev.data.u32 = (uint32_t)slot;
+        if (epoll_ctl(set->epfd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+            set->free_count++;
+            return -1;
+        }
+    }
+#endif
+
+    set->slots[slot].fd = fd;
+    set->slots[slot].index = index;
+    set->slots[slot].started = started;
+    set->active++;
+    return slot;
+}
+
+/**
+ * @brief Stop watching a slot and close its socket
+ */
+static void connect_set_remove(ConnectSet *set, int slot) {
+#ifdef __linux__
+    if (set->epfd >= 0) {
+        epoll_ctl(set->epfd, EPOLL_CTL_DEL, set->slots[slot].fd, NULL);
+    }
+#endif
+    close(set->slots[slot].fd);
+    set->slots[slot].fd = -1;
+    set->free_slots[set->free_count++] = slot;
+    set->active--;
+}
+
+/**
+ * @brief Wait until connects finish or the timeout passes
+ *
+ * @return Number of finished slots stored in ready, -1 on error
+ */
+static int connect_set_wait(ConnectSet *set, int timeout_ms, int *ready) {
+    int count = 0;
+
+#ifdef __linux__
+    if (set->epfd >= 0) {
+        int n = epoll_wait(set->epfd, set->events, set->limit, timeout_ms);
+        if (n < 0) {
+            return errno == EINTR ? 0 : -1;
+        }
+        for (int i = 0; i < n; i++) {
+            ready[count++] = (int)set->events[i].data.u32;
+        }
+        return count;
+    }
+#endif
+
+    int nfds = 0;
+    for (int i = 0; i < set->limit; i++) {
+        if (set->slots[i].fd >= 0) {
+            set->pfds[nfds].fd = set->slots[i].fd;
+            set->pfds[nfds].events = POLLOUT;
+            set->pfds[nfds].revents = 0;
+            set->pfd_slot[nfds++] = i;
+        }
+    }
+    int n = poll(set->pfds, (nfds_t)nfds, timeout_ms);
+    if (n < 0) {
+        return errno == EINTR ? 0 : -1;
+    }
+    for (int i = 0; i < nfds && count < n; i++) {
+        if (set->pfds[i].revents) {
+            ready[count++] = set->pfd_slot[i];
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief Record the outcome of a finished connect
+ */
+static int connect_answered(HostProbe *host, int error, int refused_answers, double elapsed) {
+    if (error == 0 || (refused_answers && error == ECONNREFUSED)) {
+        host->alive = 1;
+        host->rtt_ms = elapsed;
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Connect to a port on many hosts at once
+ *
+ * Connects are started in host order, so they also time out in host order:
+ * every host before oldest has finished, which is all the bookkeeping the
+ * timeouts need.
+ *
+ * @param refused_answers Count a refused connection as an answer
+ */
+static int connect_batch(HostProbe *hosts, int count, int port, int timeout_ms, int rate, int refused_answers) {
+    ConnectSet set;
+    int limit = connect_limit();
+    if (connect_set_init(&set, limit) != 0) {
+        return -1;
+    }
+
+    int *host_slot = malloc((size_t)count * sizeof(int));
+    int *ready = malloc((size_t)limit * sizeof(int));
+    if (!host_slot || !ready) {
+        perror("malloc");
+        free(host_slot);
+        free(ready);
+        connect_set_free(&set);
+        return -1;
+    }
+
+    int next = 0;
+    int oldest = 0;
+    int answered = 0;
+    double start = platform_monotonic_ns() / 1e6;
+
+    while (next < count || set.active > 0) {
+        double now = platform_monotonic_ns() / 1e6;
+
+        // Start every due connect there is room for
+        while (set.active < limit && next < count && now >= probe_due(start, next, rate)) {
+            int index = next;
+            host_slot[index] = -1;
+
+            int fd = socket(AF_INET, SOCK_STREAM, 0);
+            if (fd < 0) {
+                if ((errno == EMFILE || errno == ENFILE) && set.active > 0) {
+                    limit = set.active;  // Out of descriptors: retry once a slot frees up
+                    break;
+                }
+                next++;
+                continue;
+            }
+            next++;
+            set_nonblocking(fd);
+
+            struct sockaddr_in addr;
+            memset(&addr, 0, sizeof(addr));
+            addr.sin_family = AF_INET;
+            addr.sin_port = htons((uint16_t)port);
+            addr.sin_addr.s_addr = htonl(hosts[index].addr);
+
+            int rc = connect(fd, (struct sockaddr *)&addr, sizeof(addr));
+            if (rc == 0 || errno != EINPROGRESS) {
+                answered += connect_answered(&hosts[index], rc == 0 ? 0 : errno, refused_answers, platform_monotonic_ns() / 1e6 - now);
+                close(fd);
+                continue;
+            }
+
+            host_slot[index] = connect_set_add(&set, fd, index, now);
+            if (host_slot[index] < 0) {
+                close(fd);
+            }
+        }
+
+        // Skip hosts that have finished
+        while (oldest < next && host_slot[oldest] < 0) {
+            oldest++;
+        }
+        if (next == count && set.active == 0) {
+            break;
+        }
+
+        // Sleep until the next connect is due or the oldest one times out
+        double wake = now + timeout_ms;
+        if (oldest < next) {
+            wake = set.slots[host_slot[oldest]].started + timeout_ms;
+        }
+        if (next < count && set.active < limit) {
+            double due = probe_due(start, next, rate);
+            wake = due < wake ? due : wake;
+        }
+
+        int n = connect_set_wait(&set, wait_until(wake, now), ready);
+        if (n < 0) {
+            perror("connect wait");
+            break;
+        }
+
+        now = platform_monotonic_ns() / 1e6;
+        for (int i = 0; i < n; i++) {
+            ConnectSlot *slot = &set.slots[ready[i]];
+            int so_error = 0;
+            socklen_t len = sizeof(so_error);
+            getsockopt(slot->fd, SOL_SOCKET, SO_ERROR, &so_error, &len);
+            answered += connect_answered(&hosts[slot->index], so_error, refused_answers, now - slot->started);
+            host_slot[slot->index] = -1;
+            connect_set_remove(&set, ready[i]);
+        }
+
+        // Give up on connects that have run out of time
+        while (oldest < next) {
+            int slot = host_slot[oldest];
+            if (slot >= 0) {
+                if (now < set.slots[slot].started + timeout_ms) {
+                    break;
+                }
+                host_slot[oldest] = -1;
+                connect_set_remove(&set, slot);
+            }
+            oldest++;
+        }
+    }
+
+    free(host_slot);
+    free(ready);
+    connect_set_free(&set);
+    return answered;
+}
+
+/**
+ * @brief Probe a set of hosts concurrently
+ */
+int hostprobe_run(HostProbe *hosts, int count, int timeout_ms, int rate, int tcp_port) {
+    if (count <= 0) {
+        return 0;
+    }
+    for (int i = 0; i < count; i++) {
+        hosts[i].alive = 0;
+        hosts[i].rtt_ms = 0;
+    }
+
+    int raw;
+    int fd = open_icmp_socket(&raw);
+    if (fd >= 0) {
+        int answered = probe_icmp(fd, raw, hosts, count, timeout_ms, rate);
+        close(fd);
+        return answered;
+    }
+
+    // No ICMP access (see net.ipv4.ping_group_range): an accepted or refused
+    // connection both prove the host is up
+    return connect_batch(hosts, count, tcp_port, timeout_ms, rate, 1);
+}
+
+/**
+ * @brief Check which hosts accept connections on a port
+ */
+int hostprobe_connect(HostProbe *hosts, int count, int port, int timeout_ms, int rate) {
+    if (count <= 0) {
+        return 0;
+    }
+    for (int i = 0; i < count; i++) {
+        hosts[i].alive = 0;
+        hosts[i].rtt_ms = 0;
+    }
+    return connect_batch(hosts, count, port, timeout_ms, rate, 0);
+}
+
+/**
+ * @brief Name of the probe method available to this process
+ */
+const char *hostprobe_method_name(void) {
+    int raw;
+    int fd = open_icmp_socket(&raw);
+    if (fd < 0) {
+        return "tcp";
+    }
+    close(fd);
+    return raw ? "icmp-raw" : "icmp";
+}
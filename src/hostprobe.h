@@ -0,0 +1,68 @@
+/**
+ * @file hostprobe.h
+ * @brief Concurrent host liveness probing for NETTF network discovery
+ *
+ * Checks many IPv4 hosts at once from a single thread instead of running one
+ * ping process per address. Echo requests go out through an ICMP datagram
+ * socket where the system allows unprivileged ping (or a raw ICMP socket
+ * when running privileged); otherwise every host gets a non-blocking TCP
+ * connect, where both an accepted and a refused connection prove the host is
+ * up. Probes are paced by a rate limit and all of them share one timeout
+ * window, so a whole subnet takes about one timeout period.
+ */
+
+#ifndef HOSTPROBE_H
+#define HOSTPROBE_H
+
+#include <stdint.h>
+
+// Default pacing of outgoing probes (probes per second)
+#define HOSTPROBE_DEFAULT_RATE 4096
+
+// Most TCP connects kept in flight at once
+#define HOSTPROBE_MAX_CONNECTS 1024
+
+/**
+ * @brief One host to probe and its result
+ */
+typedef struct {
+    uint32_t addr;   // IPv4 address in host byte order (input)
+    int alive;       // 1 if the host answered, 0 otherwise
+    double rtt_ms;   // Round-trip time of the answer in milliseconds
+} HostProbe;
+
+/**
+ * @brief Probe a set of hosts concurrently
+ *
+ * @param hosts Hosts to probe; alive and rtt_ms are filled in
+ * @param count Number of hosts
+ * @param timeout_ms How long to wait for each host's answer
+ * @param rate Most probes sent per second (0 for no limit)
+ * @param tcp_port Port used by the TCP fallback
+ * @return Number of hosts that answered, -1 on error
+ */
+int hostprobe_run(HostProbe *hosts, int count, int timeout_ms, int rate, int tcp_port);
+
+/**
+ * @brief Check which hosts accept TCP connections on a port
+ *
+ * Starts non-blocking connects to every host at once and collects them as
+ * they complete, so the whole batch takes about one timeout period.
+ *
+ * @param hosts Hosts to check; alive is set for hosts that accepted
+ * @param count Number of hosts
+ * @param port Port to connect to
+ * @param timeout_ms How long to wait for each connection
+ * @param rate Most connects started per second (0 for no limit)
+ * @return Number of hosts that accepted, -1 on error
+ */
+int hostprobe_connect(HostProbe *hosts, int count, int port, int timeout_ms, int rate);
+
+/**
+ * @brief Name of the probe method available to this process
+ *
+ * @return "icmp", "icmp-raw" or "tcp"
+ */
+const char *hostprobe_method_name(void);
+
+#endif // HOSTPROBE_H
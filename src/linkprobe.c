@@ -0,0 +1,268 @@
+/**
+ * @file linkprobe.c
+ * @brief Link-quality probing and receiver ranking implementation
+ *
+ * Throughput is the payload size over the time from the first payload byte
+ * to the receiver's acknowledgement, less one round trip. The payload is
+ * small enough to keep a probe well under a second on a LAN, so on long fat
+ * links the figure leans low (TCP is still in slow start); it is meant for
+ * comparing receivers, not as an absolute measurement.
+ */
+
+#include "linkprobe.h"
+#include "platform.h"  // platform_monotonic_ns()
+#include "protocol.h"  // send_all/recv_all, byte order helpers, LINK_PROBE_MAGIC
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/time.h>
+
+// Buffer for sending and draining the payload
+#define LINKPROBE_BUFFER_SIZE (64 * 1024)
+
+/**
+ * @brief Connect with a timeout, leaving the socket blocking with I/O timeouts
+ */
+static SOCKET_T connect_with_timeout(const char *ip_address, int port, int timeout_ms) {
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    if (inet_pton(AF_INET, ip_address, &addr.sin_addr) != 1) {
+        return INVALID_SOCKET_T;
+    }
+
+    SOCKET_T s = socket(AF_INET, SOCK_STREAM, 0);
+    if (s == INVALID_SOCKET_T) {
+        return INVALID_SOCKET_T;
+    }
+
+    int flags = fcntl(s, F_GETFL, 0);
+    fcntl(s, F_SETFL, flags | O_NONBLOCK);
+    if (connect(s, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        struct pollfd pfd;
+        pfd.fd = s;
+        pfd.events = POLLOUT;
+        pfd.revents = 0;
+        int so_error = 0;
+        socklen_t len = sizeof(so_error);
+        if (errno != EINPROGRESS || poll(&pfd, 1, timeout_ms) <= 0 ||
+            getsockopt(s, SOL_SOCKET, SO_ERROR, &so_error, &len) != 0 || so_error != 0) {
+            close_socket(s);
+            return INVALID_SOCKET_T;
+        }
+    }
+    fcntl(s, F_SETFL, flags);
+
+    // Every later step is bounded by the same timeout
+    struct timeval tv;
+    tv.tv_sec = timeout_ms / 1000;
+    tv.tv_usec = (timeout_ms % 1000) * 1000;
+    setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(s, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    optimize_socket(s);
+    return s;
+}
+
+/**
+ * @brief Order round-trip times
+ */
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Run the probe exchange on a connected socket
+ */
+static int run_probe(SOCKET_T s, const char *buffer, double *rtt_ms, double *throughput) {
+    uint32_t magic = htonl(LINK_PROBE_MAGIC);
+    LinkProbeHeader header;
+    header.ping_count = htonll(LINKPROBE_PINGS);
+    header.payload_size = htonll(LINKPROBE_PAYLOAD);
+    if (send_all(s, &magic, MAGIC_SIZE) != 0 || send_all(s, &header, LINKPROBE_HEADER_SIZE) != 0) {
+        return -1;
+    }
+
+    // Latency: small echoes, one at a time
+    double rtts[LINKPROBE_PINGS];
+    for (int i = 0; i < LINKPROBE_PINGS; i++) {
+        uint64_t seq = htonll((uint64_t)i), echo;
+        double start = platform_monotonic_ns() / 1e6;
+        if (send_all(s, &seq, sizeof(seq)) != 0 || recv_all(s, &echo, sizeof(echo)) != 0 || echo != seq) {
+            return -1;
+        }
+        rtts[i] = platform_monotonic_ns() / 1e6 - start;
+    }
+    qsort(rtts, LINKPROBE_PINGS, sizeof(double), compare_double);
+    *rtt_ms = rtts[LINKPROBE_PINGS / 2];
+
+    // Throughput: a fixed payload, timed until the receiver acknowledges it
+    double start = platform_monotonic_ns() / 1e6;
+    for (size_t sent = 0; sent < LINKPROBE_PAYLOAD; sent += LINKPROBE_BUFFER_SIZE) {
+        size_t len = LINKPROBE_PAYLOAD - sent < LINKPROBE_BUFFER_SIZE ? LINKPROBE_PAYLOAD - sent
+                                                                       : LINKPROBE_BUFFER_SIZE;
+        if (send_all(s, buffer, len) != 0) {
+            return -1;
+        }
+    }
+    uint64_t received;
+    if (recv_all(s, &received, sizeof(received)) != 0 || ntohll(received) != LINKPROBE_PAYLOAD) {
+        return -1;
+    }
+
+    double elapsed = platform_monotonic_ns() / 1e6 - start - *rtt_ms;
+    if (elapsed < 0.001) {
+        elapsed = 0.001;  // Faster than the clock can tell
+    }
+    *throughput = LINKPROBE_PAYLOAD / (elapsed / 1000.0);
+    return 0;
+}
+
+/**
+ * @brief Measure the link to a receiver
+ */
+int linkprobe_measure(const char *ip_address, int port, int timeout_ms, double *rtt_ms, double *throughput) {
+    SOCKET_T s = connect_with_timeout(ip_address, port, timeout_ms);
+    if (s == INVALID_SOCKET_T) {
+        return -1;
+    }
+
+    char *buffer = calloc(1, LINKPROBE_BUFFER_SIZE);
+    if (!buffer) {
+        perror("calloc");
+        close_socket(s);
+        return -1;
+    }
+
+    int result = run_probe(s, buffer, rtt_ms, throughput);
+
+    free(buffer);
+    close_socket(s);
+    return result;
+}
+
+/**
+ * @brief Whether device a ranks before device b
+ */
+static int ranks_before(const NetworkDevice *a, const NetworkDevice *b) {
+    if (a->expected_ms <= 0) {
+        return 0;  // Unprobed devices never move ahead
+    }
+    return b->expected_ms <= 0 || a->expected_ms < b->expected_ms;
+}
+
+/**
+ * @brief Probe every NETTF receiver and sort the devices by expected transfer time
+ */
+int linkprobe_rank(NetworkDevice *devices, int num_devices, int timeout_ms) {
+    int probed = 0;
+
+    printf("Probing link quality of NETTF receivers...\n");
+    for (int i = 0; i < num_devices; i++) {
+        devices[i].throughput = 0;
+        devices[i].expected_ms = 0;
+        if (!devices[i].has_nettf_service) {
+            continue;
+        }
+
+        int port = devices[i].service_port ? devices[i].service_port : DEFAULT_NETTF_PORT;
+        double rtt, throughput;
+        if (linkprobe_measure(devices[i].ip_address, port, timeout_ms, &rtt, &throughput) != 0) {
+            printf("  %s: probe failed\n", devices[i].ip_address);
+            continue;
+        }
+
+        devices[i].response_time = rtt;
+        devices[i].throughput = throughput;
+        devices[i].expected_ms = rtt + LINKPROBE_REFERENCE_BYTES / throughput * 1000.0;
+        probed++;
+        printf("  %s: %.2f ms, %.1f MB/s\n", devices[i].ip_address, rtt, throughput / (1024.0 * 1024.0));
+    }
+
+    // Insertion sort: stable, and device lists are short
+    for (int i = 1; i < num_devices; i++) {
+        NetworkDevice device = devices[i];
+        int j = i;
+        while (j > 0 && ranks_before(&device, &devices[j - 1])) {
+            devices[j] = devices[j - 1];
+            j--;
+        }
+        devices[j] = device;
+    }
+    return probed;
+}
+
+/**
+ * @brief Print ranked receivers with their measurements
+ */
+void print_ranked_devices(const NetworkDevice *devices, int num_devices) {
+    printf("\nRanked NETTF Receivers (expected time for %.0f MB):\n",
+           LINKPROBE_REFERENCE_BYTES / (1024 * 1024));
+    printf("%-5s %-16s %-10s %-12s %-10s\n", "Rank", "IP Address", "RTT (ms)", "MB/s", "Expected");
+    printf("%-5s %-16s %-10s %-12s %-10s\n", "----", "------------", "--------", "----", "--------");
+
+    int rank = 0;
+    for (int i = 0; i < num_devices; i++) {
+        if (devices[i].expected_ms <= 0) {
+            continue;
+        }
+        char expected[32];
+        snprintf(expected, sizeof(expected), "%.2f s", devices[i].expected_ms / 1000.0);
+        printf("%-5d %-16s %-10.2f %-12.1f %-10s\n", ++rank, devices[i].ip_address,
+               devices[i].response_time, devices[i].throughput / (1024.0 * 1024.0), expected);
+    }
+    if (rank == 0) {
+        printf("No receiver could be probed.\n");
+    }
+}
+
+/**
+ * @brief Answer a link probe
+ */
+int recv_link_probe_protocol(SOCKET_T s) {
+    LinkProbeHeader header;
+    if (recv_all(s, &header, LINKPROBE_HEADER_SIZE) != 0) {
+        return -1;
+    }
+
+    uint64_t ping_count = ntohll(header.ping_count);
+    uint64_t payload_size = ntohll(header.payload_size);
+    if (ping_count > LINKPROBE_MAX_PINGS || payload_size > LINKPROBE_MAX_PAYLOAD) {
+        fprintf(stderr, "Error: Link probe exceeds limits\n");
+        return -1;
+    }
+
+    for (uint64_t i = 0; i < ping_count; i++) {
+        uint64_t echo;
+        if (recv_all(s, &echo, sizeof(echo)) != 0 || send_all(s, &echo, sizeof(echo)) != 0) {
+            return -1;
+        }
+    }
+
+    char *buffer = malloc(LINKPROBE_BUFFER_SIZE);
+    if (!buffer) {
+        perror("malloc");
+        return -1;
+    }
+    uint64_t received = 0;
+    while (received < payload_size) {
+        size_t len = payload_size - received < LINKPROBE_BUFFER_SIZE ? (size_t)(payload_size - received)
+                                                                      : LINKPROBE_BUFFER_SIZE;
+        if (recv_all(s, buffer, len) != 0) {
+            free(buffer);
+            return -1;
+        }
+        received += len;
+    }
+    free(buffer);
+
+    uint64_t ack = htonll(received);
+    if (send_all(s, &ack, sizeof(ack)) != 0) {
+        return -1;
+    }
+    printf("Answered link probe (%llu round trips, %llu bytes)\n",
+           (unsigned long long)ping_count, (unsigned long long)payload_size);
+    return 0;
+}
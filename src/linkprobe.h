@@ -0,0 +1,91 @@
+/**
+ * @file linkprobe.h
+ * @brief Link-quality probing and receiver ranking for NETTF discovery
+ *
+ * Measures each NETTF receiver with a short, bounded exchange on its service
+ * port: a few echo round trips for latency, then a fixed-size payload whose
+ * acknowledgement gives the throughput. Receivers are then ranked by the
+ * expected time to transfer a reference job.
+ *
+ * Wire format (all integers in network byte order):
+ *   "PROB" magic, LinkProbeHeader
+ *   ping_count times: 8 bytes to the receiver, the same 8 bytes back
+ *   payload_size bytes to the receiver, uint64 byte count back
+ */
+
+#ifndef LINKPROBE_H
+#define LINKPROBE_H
+
+#include "platform.h"   // Cross-platform socket types and functions
+#include "discovery.h"  // NetworkDevice
+#include <stdint.h>
+
+// Wire size of the probe header
+#define LINKPROBE_HEADER_SIZE 16
+
+// Round trips measured per probe
+#define LINKPROBE_PINGS 5
+
+// Payload sent to measure throughput
+#define LINKPROBE_PAYLOAD (4 * 1024 * 1024)
+
+// Largest probe a receiver accepts
+#define LINKPROBE_MAX_PINGS 64
+#define LINKPROBE_MAX_PAYLOAD (64 * 1024 * 1024)
+
+// Job size receivers are ranked for (expected transfer time)
+#define LINKPROBE_REFERENCE_BYTES (256.0 * 1024 * 1024)
+
+/**
+ * @brief Probe request header
+ */
+typedef struct {
+    uint64_t ping_count;    // Number of echo round trips
+    uint64_t payload_size;  // Bytes sent to measure throughput
+} LinkProbeHeader;
+
+/**
+ * @brief Measure the link to a receiver
+ *
+ * @param ip_address Receiver address
+ * @param port Receiver port
+ * @param timeout_ms Limit for connecting and for every step of the exchange
+ * @param rtt_ms Output: median round-trip time in milliseconds
+ * @param throughput Output: throughput in bytes per second
+ * @return 0 on success, -1 on error
+ */
+int linkprobe_measure(const char *ip_address, int port, int timeout_ms, double *rtt_ms, double *throughput);
+
+/**
+ * @brief Probe every NETTF receiver and sort the devices by expected transfer time
+ *
+ * Receivers are probed one after another so the measurements do not compete
+ * for bandwidth. Probed receivers come first, fastest first; the rest keep
+ * their order.
+ *
+ * @param devices Devices to rank (sorted in place)
+ * @param num_devices Number of devices
+ * @param timeout_ms Timeout for each probe step
+ * @return Number of receivers probed successfully
+ */
+int linkprobe_rank(NetworkDevice *devices, int num_devices, int timeout_ms);
+
+/**
+ * @brief Print ranked receivers with their measurements
+ *
+ * @param devices Devices sorted by linkprobe_rank()
+ * @param num_devices Number of devices
+ */
+void print_ranked_devices(const NetworkDevice *devices, int num_devices);
+
+/**
+ * @brief Answer a link probe
+ *
+ * Called after detect_transfer_type() has consumed the "PROB" magic.
+ *
+ * @param s Socket descriptor
+ * @return 0 on success, -1 on error
+ */
+int recv_link_probe_protocol(SOCKET_T s);
+
+#endif // LINKPROBE_H
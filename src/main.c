@@ -10,13 +10,23 @@
 
 #include "platform.h"  // Cross-platform socket abstraction
 #include "discovery.h"  // Network discovery functionality
+#include "hostprobe.h"  // Default probe rate
+#include "discocache.h" // Cached discovery results
+#include "linkprobe.h"  // Receiver ranking
+#include "dialer.h"     // Default connect deadline
+#include "bench.h"      // Loopback throughput benchmark
+#include "netem.h"      // Network impairment proxy
+#include "progress.h"   // JSON progress events
 #include "protocol.h"   // Protocol definitions (includes DEFAULT_NETTF_PORT)
 #include "signals.h"    // Signal handling
 #include <getopt.h>     // Not used but included for potential future CLI options
+#include <errno.h>      // strtol() range errors
 
 // Forward declarations for functions implemented in other modules
-void send_file(const char *target_ip, int port, const char *filepath, const char *target_dir);
-void receive_file(int port);
+void send_file(const char *target, int port, const char *filepath, const char *target_dir,
+               const SendOptions *options);
+void receive_file(int port, const ReceiveOptions *options);
+int verify_remote(const char *target, int port, const char *path, const char *target_dir, int use_cache);
 
 /**
  * @brief Display usage information for the program
@@ -28,19 +38,143 @@ void receive_file(int port);
  */
 void print_usage(const char *program_name) {
     printf("Usage:\n");
-    printf("  %s discover [--timeout <ms>]\n", program_name);                     // Discovery mode
-    printf("  %s receive\n", program_name);                                         // Receiver mode
-    printf("  %s send <TARGET_IP> <FILE_OR_DIR_PATH> [TARGET_DIR]\n", program_name); // Sender mode
+    printf("  %s discover [--timeout <ms>] [--rate <probes/s>] [--scan] [--refresh] [--ttl <s>]\n"
+           "           [--rank | --best]\n", program_name);                         // Discovery mode
+    printf("  %s receive [--port <port>] [--link-duplicates] [--no-announce] [--metrics-port <port>]\n"
+           "           [--no-profile] [PROGRESS]\n", program_name);                    // Receiver mode
+    printf("  %s send [--port <port>] [--dedup] [--sparse] [--feedback] [--connect-timeout <ms>] [--no-profile]\n"
+           "           [PROGRESS] <TARGET> <FILE_OR_DIR_PATH> [TARGET_DIR]\n", program_name); // Sender mode
+    printf("  %s verify [--rehash] <TARGET> <FILE_OR_DIR_PATH> [TARGET_DIR]\n", program_name); // Verify mode
+    printf("  %s bench [--transport tcp|socketpair] [--data zeros|random|text] [--null-sink]\n"
+           "           [--sizes <list>] [--shapes <list>] [--engine standard|ext|all] [--dir <path>]\n"
+           "           [--tree-files <n> [--tree-depth <d>] [--tree-fanout <f>] [--tree-sizes <range>] [--seed <n>]]\n"
+           "           [--netem <profile>] [--results <file>]\n",
+           program_name);                                                          // Benchmark mode
+    printf("  %s netem-proxy [--listen <port>] [--profile <name>] [--latency <ms>] [--jitter <ms>]\n"
+           "           [--rate <mbit>] [--stall <every_ms>:<ms>] [--queue <KB>] [--seed <n>] <TARGET> [PORT]\n",
+           program_name);                                                          // Impairment proxy
     printf("\nOptions:\n");
     printf("  --timeout <ms> Set timeout for network operations (default: 1000ms)\n");
+    printf("  --rate <n>     Send at most n host probes per second, 0 for no limit (default: %d)\n",
+           HOSTPROBE_DEFAULT_RATE);
+    printf("  --scan         Scan the network even when receivers announce themselves\n");
+    printf("  --refresh      Ignore cached discovery results and discover now\n");
+    printf("  --ttl <s>      Refresh cached discovery results older than s seconds (default: %d)\n",
+           DISCOCACHE_DEFAULT_TTL);
+    printf("  --rank         Probe receivers and rank them by expected transfer time\n");
+    printf("  --best         Print only the address of the fastest receiver (for scripts)\n");
+    printf("  --rehash       Ignore the local hash cache and read every file\n");
+    printf("  --dedup        Send identical files and hard links of a directory only once\n");
+    printf("  --sparse       Send only the data extents of sparse files (receiver keeps holes)\n");
+    printf("  --feedback     Have the receiver report disk load, so a slow disk does not shrink chunks\n");
+    printf("  --connect-timeout <ms> Give up connecting to the receiver after ms (default: %d)\n",
+           DIALER_DEFAULT_TIMEOUT_MS);
+    printf("  --link-duplicates Recreate deduplicated files as hard links instead of copies\n");
+    printf("  --no-announce  Do not announce the receiver on the local network\n");
+    printf("  --metrics-port <port> Serve Prometheus metrics at http://<host>:<port>/metrics\n");
+    printf("  --no-profile   Start from default chunk and buffer sizes and do not update the peer's profile\n");
+    printf("  --port <port>  Listen or connect on port instead of %d\n", DEFAULT_NETTF_PORT);
+    printf("\nBench options:\n");
+    printf("  --transport <t> Connect sender and receiver over loopback TCP or a socket pair (default: tcp)\n");
+    printf("  --data <kind>  Source content: zeros, random or compressible text (default: random)\n");
+    printf("  --null-sink    Discard received data instead of writing files\n");
+    printf("  --sizes <list> File sizes for the FILE and TARG runs, e.g. 4K,1M,1G (default: %s)\n",
+           BENCH_DEFAULT_SIZES);
+    printf("  --shapes <list> Directory shapes small, mixed, deep, all or none (default: all)\n");
+    printf("  --engine <e>   Standard protocols, extended ones (--sparse, --dedup) or all (default: all)\n");
+    printf("  --sizes none   Skip the single-file runs (likewise --shapes none for the built-in trees)\n");
+    printf("  --tree-files <n> Also send a generated tree of n files\n");
+    printf("  --tree-depth <d> Directory levels of the generated tree (default: %d)\n", TREEGEN_DEFAULT_DEPTH);
+    printf("  --tree-fanout <f> Subdirectories per directory of the generated tree (default: %d)\n",
+           TREEGEN_DEFAULT_FANOUT);
+    printf("  --tree-sizes <range> Fixed file size or log-uniform range, e.g. 4K or 512-16K (default: %s)\n",
+           TREEGEN_DEFAULT_SIZES);
+    printf("  --seed <n>     Seed of the generated tree (same seed, same tree; default: 1)\n");
+    printf("  --netem <profile> Send every run through an impairment relay (profiles as for netem-proxy)\n");
+    printf("  --results <file> Append results to file as JSON lines for regression tracking\n");
+    printf("  --dir <path>   Create the scratch directory under path (default: $TMPDIR or /tmp)\n");
+    printf("\nNetem-proxy options (relays <listen port> to TARGET:PORT, default PORT %d):\n",
+           NETEM_DEFAULT_TARGET_PORT);
+    printf("  --listen <port> Accept senders on port (default: %d)\n", DEFAULT_NETTF_PORT);
+    printf("  --profile <name> Start from none, lan, wan, transatlantic, lte, satellite or flaky (default: none)\n");
+    printf("  --latency <ms> One-way delay added in each direction\n");
+    printf("  --jitter <ms>  Vary the delay uniformly by up to ms (data is never reordered)\n");
+    printf("  --rate <mbit>  Cap each direction at mbit Mbit/s, 0 for no cap\n");
+    printf("  --stall <every_ms>:<ms> Forward nothing for ms once every every_ms\n");
+    printf("  --queue <KB>   Data held per direction before the sender is pushed back (default: %d)\n",
+           NETEM_DEFAULT_QUEUE_BYTES / 1024);
+    printf("  --seed <n>     Seed of the jitter (same seed, same delays)\n");
+    printf("\nPROGRESS options (send and receive):\n");
+    printf("  --json         Print newline-delimited JSON progress events on stdout (messages go to stderr)\n");
+    printf("  --json-fd <fd> Write the JSON events to descriptor fd instead (implies --json)\n");
+    printf("  --progress-interval <ms> Time between progress lines or events (default: %d)\n",
+           PROGRESS_DEFAULT_INTERVAL_MS);
+    printf("  --phases       Time disk, network and metadata operations and report where the time went\n");
+    printf("  --trace-file <file> Record every chunk (size, duration, TCP_INFO) for adaptive-sim\n");
     printf("\nExamples:\n");
     printf("  %s discover\n", program_name);                                       // Discovery with port 9876 check
+    printf("  %s send $(%s discover --best) /path/to/file.txt\n", program_name, program_name); // Fastest receiver
     printf("  %s receive\n", program_name);                                        // Receiver example
     printf("  %s send <TARGET_IP> /path/to/file.txt\n", program_name);            // File transfer example
     printf("  %s send <TARGET_IP> /path/to/file.txt downloads/\n", program_name);  // File with target dir
     printf("  %s send <TARGET_IP> /path/to/directory/\n", program_name);          // Directory transfer example
     printf("  %s send <TARGET_IP> /path/to/directory/ backups/\n", program_name);  // Directory with target dir
-    printf("\nNote: All transfers use port %d by default.\n", DEFAULT_NETTF_PORT);
+    printf("  %s send --dedup <TARGET_IP> build/\n", program_name);               // Send duplicates once
+    printf("  %s verify <TARGET_IP> /path/to/directory/ backups/\n", program_name); // Compare replica digests
+    printf("  %s send nas.local /path/to/file.txt\n", program_name);               // Send by hostname
+    printf("  %s send --json <TARGET_IP> disk.img | jq .\n", program_name);       // Machine-readable progress
+    printf("  %s bench --null-sink --sizes 1G --shapes none\n", program_name);      // Raw protocol throughput
+    printf("  %s bench --sizes none --shapes none --tree-files 1000000 --results bench.jsonl\n",
+           program_name);                                                          // Many small files
+    printf("  %s receive --port %d & %s netem-proxy --profile wan 127.0.0.1\n", program_name,
+           NETEM_DEFAULT_TARGET_PORT, program_name);                               // WAN on localhost
+    printf("\nTARGET is a hostname or an IPv4/IPv6 address; every resolved address is tried.\n");
+    printf("Note: All transfers use port %d by default.\n", DEFAULT_NETTF_PORT);
+}
+
+/**
+ * @brief Parse a progress option shared by send and receive
+ *
+ * @param argc Number of command-line arguments
+ * @param argv Array of command-line argument strings
+ * @param i Index of the option; advanced past its value
+ * @param progress Progress options to update
+ * @return 1 if the option was a progress option, 0 if not, -1 on an invalid value
+ */
+static int parse_progress_option(int argc, char *argv[], int *i, ProgressOptions *progress) {
+    if (strcmp(argv[*i], "--phases") == 0) {
+        progress->phases = 1;
+        return 1;
+    }
+    if (strcmp(argv[*i], "--json") == 0) {
+        progress->json = 1;
+        return 1;
+    }
+    if (strcmp(argv[*i], "--json-fd") == 0 && *i + 1 < argc) {
+        progress->json = 1;
+        progress->fd = atoi(argv[*i + 1]);
+        if (progress->fd < 0 || (progress->fd == 0 && strcmp(argv[*i + 1], "0") != 0)) {
+            fprintf(stderr, "Error: JSON descriptor must be a non-negative number\n");
+            return -1;
+        }
+        (*i)++;  // Skip the descriptor
+        return 1;
+    }
+    if (strcmp(argv[*i], "--progress-interval") == 0 && *i + 1 < argc) {
+        progress->interval_ms = atoi(argv[*i + 1]);
+        if (progress->interval_ms <= 0) {
+            fprintf(stderr, "Error: Progress interval must be a positive number\n");
+            return -1;
+        }
+        (*i)++;  // Skip the interval
+        return 1;
+    }
+    if (strcmp(argv[*i], "--trace-file") == 0 && *i + 1 < argc) {
+        progress->trace_path = argv[*i + 1];
+        (*i)++;  // Skip the path
+        return 1;
+    }
+    return 0;
 }
 
 /**
@@ -50,17 +184,57 @@ void print_usage(const char *program_name) {
  * appropriate functionality based on the provided arguments. The program
  * supports three main operational modes:
  *
- * 1. Discovery mode: ./nettf discover [--services] [--timeout <ms>]
- *    - Scans local network for available devices
+ * 1. Discovery mode: ./nettf discover [--timeout <ms>] [--rate <probes/s>] [--scan] [--refresh] [--ttl <s>]
+ *                                     [--rank | --best]
+ *    - Answers from the discovery cache, refreshing stale results in the background
+ *    - Collects receiver announcements, or scans the local network for
+ *      available devices, probing hosts concurrently
+ *    - Optionally probes link quality and ranks receivers (--best prints the fastest)
  *    - Optionally checks for NETTF service on discovered devices
  *
- * 2. Receiver mode: ./nettf receive <PORT>
+ * 2. Receiver mode: ./nettf receive [--port <port>] [--link-duplicates] [--no-announce] [--metrics-port <port>]
+ *                                  [--no-profile] [PROGRESS]
  *    - Starts a server that listens on the specified port
  *    - Waits for an incoming connection and receives a file/directory
+ *    - Recreates deduplicated files as copies, or hard links if requested
+ *    - Announces itself on the local network unless told not to
+ *    - Optionally serves transfer metrics over HTTP
+ *    - Starts each connection from the sender's tuning profile (--no-profile to skip)
+ *    - Optionally reports progress as JSON events (--json, --json-fd, --progress-interval)
+ *    - Optionally traces per-phase latencies (--phases)
+ *    - Optionally records a per-chunk trace for adaptive-sim (--trace-file)
  *
- * 3. Sender mode: ./nettf send <TARGET_IP> <PORT> <FILE_OR_DIR_PATH>
- *    - Connects to a receiver at the specified IP and port
+ * 3. Sender mode: ./nettf send [--port <port>] [--dedup] [--sparse] [--feedback] [--connect-timeout <ms>]
+ *                               [--no-profile] [PROGRESS] <TARGET> <FILE_OR_DIR_PATH> [TARGET_DIR]
+ *    - Resolves the target and races connections to all of its addresses,
+ *      giving up at the connect deadline
+ *    - Starts from the receiver's tuning profile and updates it afterwards
  *    - Sends the specified file or directory
+ *    - With --dedup, sends each unique payload of a directory once
+ *    - With --sparse, sends data extents only and describes holes
+ *    - With --feedback, reads receiver status frames and holds the chunk size
+ *      while the receiver is the bottleneck
+ *    - Optionally reports progress as JSON events
+ *
+ * 4. Verify mode: ./nettf verify [--rehash] <TARGET> <FILE_OR_DIR_PATH> [TARGET_DIR]
+ *    - Compares the local copy with the receiver's copy by range digests
+ *    - Reuses digests of unchanged files from the local hash cache
+ *    - Exits with failure if any file differs or is missing
+ *
+ * 5. Benchmark mode: ./nettf bench [--transport tcp|socketpair] [--data zeros|random|text] [--null-sink]
+ *                                  [--sizes <list>] [--shapes <list>] [--engine standard|ext|all] [--dir <path>]
+ *                                  [--tree-files <n> ...] [--netem <profile>] [--results <file>]
+ *    - Runs sender and receiver in one process over loopback on synthetic data
+ *    - Covers each transfer type, file size, directory shape and engine
+ *    - Optionally adds a reproducible generated tree of many small files
+ *    - Optionally impairs the link with a WAN-like profile
+ *    - Prints MB/s, files/s, metadata ops/s, CPU time per GB, syscalls per MB
+ *      and peak RSS for each run, optionally appending them as JSON lines
+ *
+ * 6. Impairment proxy mode: ./nettf netem-proxy [--listen <port>] [--profile <name>] [--latency <ms>] ...
+ *                                              <TARGET> [PORT]
+ *    - Relays connections on the listen port to the receiver at TARGET:PORT
+ *    - Adds latency, jitter, a bandwidth cap and stalls without root or tc
  *
  * @param argc Number of command-line arguments
  * @param argv Array of command-line argument strings
@@ -80,6 +254,9 @@ int main(int argc, char *argv[]) {
     // Parse command: "discover" mode
     if (strcmp(argv[1], "discover") == 0) {
         int timeout_ms = 1000;
+        DiscoveryOptions discovery_options = {HOSTPROBE_DEFAULT_RATE, 0, DISCOCACHE_DEFAULT_TTL, 0};
+        int rank = 0;       // Probe receivers and rank them by expected transfer time
+        int best_only = 0;  // Print only the address of the best receiver
 
         // Parse optional arguments
         for (int i = 2; i < argc; i++) {
@@ -91,6 +268,35 @@ int main(int argc, char *argv[]) {
                     return EXIT_FAILURE;
                 }
                 i++;  // Skip the timeout value
+            } else if (strcmp(argv[i], "--rate") == 0 && i + 1 < argc) {
+                discovery_options.probe_rate = atoi(argv[i + 1]);
+                if (discovery_options.probe_rate < 0) {
+                    fprintf(stderr, "Error: Rate must not be negative\n");
+                    signals_cleanup();
+                    return EXIT_FAILURE;
+                }
+                i++;  // Skip the rate value
+            } else if (strcmp(argv[i], "--scan") == 0) {
+                discovery_options.full_scan = 1;
+            } else if (strcmp(argv[i], "--refresh") == 0) {
+                discovery_options.refresh = 1;
+            } else if (strcmp(argv[i], "--ttl") == 0 && i + 1 < argc) {
+                char *end;
+                errno = 0;
+                long ttl = strtol(argv[i + 1], &end, 10);
+                if (end == argv[i + 1] || *end != '\0' || errno == ERANGE || ttl < 0 || ttl > DISCOCACHE_MAX_TTL) {
+                    fprintf(stderr, "Error: TTL must be a number of seconds from 0 to %d, got '%s'\n",
+                            DISCOCACHE_MAX_TTL, argv[i + 1]);
+                    signals_cleanup();
+                    return EXIT_FAILURE;
+                }
+                discovery_options.cache_ttl = (int)ttl;
+                i++;  // Skip the TTL value
+            } else if (strcmp(argv[i], "--rank") == 0) {
+                rank = 1;
+            } else if (strcmp(argv[i], "--best") == 0) {
+                rank = 1;
+                best_only = 1;
             } else {
                 fprintf(stderr, "Error: Unknown option '%s'\n", argv[i]);
                 print_usage(argv[0]);
@@ -102,9 +308,28 @@ int main(int argc, char *argv[]) {
         // Initialize network subsystem
         net_init();
 
+        // With --best, progress goes to stderr so stdout carries only the address
+        int saved_stdout = -1;
+        if (best_only) {
+            fflush(stdout);
+            saved_stdout = dup(STDOUT_FILENO);
+            dup2(STDERR_FILENO, STDOUT_FILENO);
+        }
+
         // Perform network discovery
         NetworkDevice devices[256];
-        int device_count = discover_network_devices(devices, 256, 1, timeout_ms);
+        int device_count = discocache_discover(devices, 256, timeout_ms, &discovery_options);
+
+        if (device_count >= 0 && rank) {
+            linkprobe_rank(devices, device_count, timeout_ms);
+        }
+
+        // Restore stdout before any exit from here on
+        if (saved_stdout >= 0) {
+            fflush(stdout);
+            dup2(saved_stdout, STDOUT_FILENO);
+            close(saved_stdout);
+        }
 
         if (device_count < 0) {
             fprintf(stderr, "Error: Network discovery failed\n");
@@ -113,6 +338,18 @@ int main(int argc, char *argv[]) {
             return EXIT_FAILURE;
         }
 
+        if (best_only) {
+            int found = device_count > 0 && devices[0].expected_ms > 0;
+            if (found) {
+                printf("%s\n", devices[0].ip_address);
+            } else {
+                fprintf(stderr, "Error: No NETTF receiver could be probed\n");
+            }
+            net_cleanup();
+            signals_cleanup();
+            return found ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+
         // Print results
         print_discovered_devices(devices, device_count, 0);  // show_services parameter no longer used
 
@@ -128,6 +365,10 @@ int main(int argc, char *argv[]) {
         }
         printf("%d device(s) have NETTF service running on port %d.\n", nettfservices_count, DEFAULT_NETTF_PORT);
 
+        if (rank) {
+            print_ranked_devices(devices, device_count);
+        }
+
         net_cleanup();
         signals_cleanup();
         return EXIT_SUCCESS;
@@ -142,39 +383,377 @@ int main(int argc, char *argv[]) {
 
     // Parse command: "receive" mode
     if (strcmp(argv[1], "receive") == 0) {
-        // Receive mode requires exactly 2 arguments: program receive
-        if (argc != 2) {
-            print_usage(argv[0]);  // Show correct usage
+        ReceiveOptions options;
+        memset(&options, 0, sizeof(options));
+        ProgressOptions progress = {0, -1, PROGRESS_DEFAULT_INTERVAL_MS, 0, NULL};
+        int port = DEFAULT_NETTF_PORT;
+
+        // Receive mode takes options only
+        for (int i = 2; i < argc; i++) {
+            int parsed = parse_progress_option(argc, argv, &i, &progress);
+            if (parsed < 0) {
+                signals_cleanup();
+                return EXIT_FAILURE;
+            } else if (parsed > 0) {
+                continue;
+            } else if (strcmp(argv[i], "--link-duplicates") == 0) {
+                options.link_duplicates = 1;
+            } else if (strcmp(argv[i], "--no-announce") == 0) {
+                options.no_announce = 1;
+            } else if (strcmp(argv[i], "--no-profile") == 0) {
+                options.no_profile = 1;
+            } else if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) {
+                port = atoi(argv[i + 1]);
+                if (port <= 0 || port > 65535) {
+                    fprintf(stderr, "Error: Port must be between 1 and 65535\n");
+                    signals_cleanup();
+                    return EXIT_FAILURE;
+                }
+                i++;  // Skip the port value
+            } else if (strcmp(argv[i], "--metrics-port") == 0 && i + 1 < argc) {
+                options.metrics_port = atoi(argv[i + 1]);
+                if (options.metrics_port <= 0 || options.metrics_port > 65535) {
+                    fprintf(stderr, "Error: Metrics port must be between 1 and 65535\n");
+                    signals_cleanup();
+                    return EXIT_FAILURE;
+                }
+                i++;  // Skip the port value
+            } else {
+                fprintf(stderr, "Error: Unknown option '%s'\n", argv[i]);
+                print_usage(argv[0]);  // Show correct usage
+                signals_cleanup();
+                return EXIT_FAILURE;
+            }
+        }
+
+        if (progress_init(&progress) != 0) {
             signals_cleanup();
             return EXIT_FAILURE;
         }
 
-        // Start the receiver (server) functionality with default port
-        receive_file(DEFAULT_NETTF_PORT);
+        // Start the receiver (server) functionality
+        receive_file(port, &options);
         signals_cleanup();
     }
     // Parse command: "send" mode
     else if (strcmp(argv[1], "send") == 0) {
-        // Send mode requires 4 or 5 arguments: program send ip filepath [target_dir]
-        if (argc < 4 || argc > 5) {
+        // Send mode takes 2 or 3 positional arguments: target filepath [target_dir]
+        const char *positional[3] = {NULL, NULL, NULL};
+        int positional_count = 0;
+        SendOptions options;
+        memset(&options, 0, sizeof(options));
+        options.connect_timeout_ms = DIALER_DEFAULT_TIMEOUT_MS;
+        ProgressOptions progress = {0, -1, PROGRESS_DEFAULT_INTERVAL_MS, 0, NULL};
+        int port = DEFAULT_NETTF_PORT;
+
+        for (int i = 2; i < argc; i++) {
+            int parsed = parse_progress_option(argc, argv, &i, &progress);
+            if (parsed < 0) {
+                signals_cleanup();
+                return EXIT_FAILURE;
+            } else if (parsed > 0) {
+                continue;
+            } else if (strcmp(argv[i], "--dedup") == 0) {
+                options.dedup = 1;
+            } else if (strcmp(argv[i], "--sparse") == 0) {
+                options.sparse = 1;
+            } else if (strcmp(argv[i], "--no-profile") == 0) {
+                options.no_profile = 1;
+            } else if (strcmp(argv[i], "--feedback") == 0) {
+                options.feedback = 1;
+            } else if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) {
+                port = atoi(argv[i + 1]);
+                if (port <= 0 || port > 65535) {
+                    fprintf(stderr, "Error: Port must be between 1 and 65535\n");
+                    signals_cleanup();
+                    return EXIT_FAILURE;
+                }
+                i++;  // Skip the port value
+            } else if (strcmp(argv[i], "--connect-timeout") == 0 && i + 1 < argc) {
+                options.connect_timeout_ms = atoi(argv[i + 1]);
+                if (options.connect_timeout_ms <= 0) {
+                    fprintf(stderr, "Error: Connect timeout must be a positive number\n");
+                    signals_cleanup();
+                    return EXIT_FAILURE;
+                }
+                i++;  // Skip the timeout value
+            } else if (argv[i][0] == '-' && argv[i][1] == '-') {
+                fprintf(stderr, "Error: Unknown option '%s'\n", argv[i]);
+                print_usage(argv[0]);
+                signals_cleanup();
+                return EXIT_FAILURE;
+            } else if (positional_count < 3) {
+                positional[positional_count++] = argv[i];
+            } else {
+                positional_count++;  // Too many arguments
+            }
+        }
+
+        if (positional_count < 2 || positional_count > 3) {
             print_usage(argv[0]);  // Show correct usage
             signals_cleanup();
             return EXIT_FAILURE;
         }
 
         // Extract command-line arguments
-        const char *target_ip = argv[2];   // IP address of receiver
-        const char *filepath = argv[3];    // Path to file to send
-        const char *target_dir = NULL;     // Target directory (optional)
+        const char *target = positional[0];      // Hostname or IP address of receiver
+        const char *filepath = positional[1];    // Path to file to send
+        const char *target_dir = positional[2];  // Target directory (optional)
+
+        if (progress_init(&progress) != 0) {
+            signals_cleanup();
+            return EXIT_FAILURE;
+        }
+
+        // Start the sender (client) functionality
+        send_file(target, port, filepath, target_dir, &options);
+        signals_cleanup();
+    }
+    // Parse command: "verify" mode
+    else if (strcmp(argv[1], "verify") == 0) {
+        // Verify mode takes the same positional arguments as send mode
+        const char *positional[3] = {NULL, NULL, NULL};
+        int positional_count = 0;
+        int use_cache = 1;
 
-        // Check if target directory is provided
-        if (argc == 5) {
-            target_dir = argv[4];
+        for (int i = 2; i < argc; i++) {
+            if (strcmp(argv[i], "--rehash") == 0) {
+                use_cache = 0;
+            } else if (argv[i][0] == '-' && argv[i][1] == '-') {
+                fprintf(stderr, "Error: Unknown option '%s'\n", argv[i]);
+                print_usage(argv[0]);
+                signals_cleanup();
+                return EXIT_FAILURE;
+            } else if (positional_count < 3) {
+                positional[positional_count++] = argv[i];
+            } else {
+                positional_count++;  // Too many arguments
+            }
+        }
+
+        if (positional_count < 2 || positional_count > 3) {
+            print_usage(argv[0]);
+            signals_cleanup();
+            return EXIT_FAILURE;
         }
 
-        // Start the sender (client) functionality with default port
-        send_file(target_ip, DEFAULT_NETTF_PORT, filepath, target_dir);
+        // Compare digests with the receiver on the default port
+        int mismatches = verify_remote(positional[0], DEFAULT_NETTF_PORT, positional[1], positional[2], use_cache);
         signals_cleanup();
+        if (mismatches != 0) {
+            return EXIT_FAILURE;  // Errors or differing/missing files
+        }
+    }
+    // Parse command: "bench" mode
+    else if (strcmp(argv[1], "bench") == 0) {
+        BenchOptions bench_options;
+        bench_default_options(&bench_options);
+
+        for (int i = 2; i < argc; i++) {
+            if (strcmp(argv[i], "--transport") == 0 && i + 1 < argc) {
+                if (bench_parse_transport(argv[i + 1], &bench_options) != 0) {
+                    fprintf(stderr, "Error: Transport must be tcp or socketpair\n");
+                    signals_cleanup();
+                    return EXIT_FAILURE;
+                }
+                i++;  // Skip the transport name
+            } else if (strcmp(argv[i], "--data") == 0 && i + 1 < argc) {
+                if (bench_parse_data(argv[i + 1], &bench_options) != 0) {
+                    fprintf(stderr, "Error: Data must be zeros, random or text\n");
+                    signals_cleanup();
+                    return EXIT_FAILURE;
+                }
+                i++;  // Skip the data kind
+            } else if (strcmp(argv[i], "--null-sink") == 0) {
+                bench_options.null_sink = 1;
+            } else if (strcmp(argv[i], "--sizes") == 0 && i + 1 < argc) {
+                if (bench_parse_sizes(argv[i + 1], &bench_options) != 0) {
+                    fprintf(stderr, "Error: Sizes must be a list of at most %d sizes such as 4K,1M,1G\n",
+                            BENCH_MAX_SIZES);
+                    signals_cleanup();
+                    return EXIT_FAILURE;
+                }
+                i++;  // Skip the size list
+            } else if (strcmp(argv[i], "--shapes") == 0 && i + 1 < argc) {
+                if (bench_parse_shapes(argv[i + 1], &bench_options) != 0) {
+                    fprintf(stderr, "Error: Shapes must be a list of small, mixed, deep, all or none\n");
+                    signals_cleanup();
+                    return EXIT_FAILURE;
+                }
+                i++;  // Skip the shape list
+            } else if (strcmp(argv[i], "--engine") == 0 && i + 1 < argc) {
+                if (bench_parse_engine(argv[i + 1], &bench_options) != 0) {
+                    fprintf(stderr, "Error: Engine must be standard, ext or all\n");
+                    signals_cleanup();
+                    return EXIT_FAILURE;
+                }
+                i++;  // Skip the engine name
+            } else if (strcmp(argv[i], "--tree-files") == 0 && i + 1 < argc) {
+                long long files = atoll(argv[i + 1]);
+                if (files <= 0) {
+                    fprintf(stderr, "Error: Tree files must be a positive number\n");
+                    signals_cleanup();
+                    return EXIT_FAILURE;
+                }
+                bench_options.tree.files = (uint64_t)files;
+                i++;  // Skip the file count
+            } else if (strcmp(argv[i], "--tree-depth") == 0 && i + 1 < argc) {
+                bench_options.tree.depth = atoi(argv[i + 1]);
+                if (bench_options.tree.depth < 0) {
+                    fprintf(stderr, "Error: Tree depth must not be negative\n");
+                    signals_cleanup();
+                    return EXIT_FAILURE;
+                }
+                i++;  // Skip the depth
+            } else if (strcmp(argv[i], "--tree-fanout") == 0 && i + 1 < argc) {
+                bench_options.tree.fanout = atoi(argv[i + 1]);
+                if (bench_options.tree.fanout <= 0) {
+                    fprintf(stderr, "Error: Tree fanout must be a positive number\n");
+                    signals_cleanup();
+                    return EXIT_FAILURE;
+                }
+                i++;  // Skip the fanout
+            } else if (strcmp(argv[i], "--tree-sizes") == 0 && i + 1 < argc) {
+                if (treegen_parse_sizes(argv[i + 1], &bench_options.tree) != 0) {
+                    fprintf(stderr, "Error: Tree sizes must be a size such as 4K or a range such as 512-16K\n");
+                    signals_cleanup();
+                    return EXIT_FAILURE;
+                }
+                i++;  // Skip the size distribution
+            } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+                bench_options.tree.seed = strtoull(argv[i + 1], NULL, 10);
+                i++;  // Skip the seed
+            } else if (strcmp(argv[i], "--netem") == 0 && i + 1 < argc) {
+                if (netem_profile(argv[i + 1], &bench_options.netem_profile) != 0) {
+                    fprintf(stderr, "Error: Profile must be none, lan, wan, transatlantic, lte, satellite or flaky\n");
+                    signals_cleanup();
+                    return EXIT_FAILURE;
+                }
+                bench_options.netem = 1;
+                i++;  // Skip the profile name
+            } else if (strcmp(argv[i], "--results") == 0 && i + 1 < argc) {
+                bench_options.results_path = argv[i + 1];
+                i++;  // Skip the results file
+            } else if (strcmp(argv[i], "--dir") == 0 && i + 1 < argc) {
+                bench_options.scratch_dir = argv[i + 1];
+                i++;  // Skip the directory
+            } else {
+                fprintf(stderr, "Error: Unknown option '%s'\n", argv[i]);
+                print_usage(argv[0]);
+                signals_cleanup();
+                return EXIT_FAILURE;
+            }
+        }
+
+        // Run sender and receiver in this process over loopback
+        net_init();
+        int result = bench_run(&bench_options);
+        net_cleanup();
+        signals_cleanup();
+        if (result != 0) {
+            return EXIT_FAILURE;
+        }
+    }
+    // Parse command: "netem-proxy" mode
+    else if (strcmp(argv[1], "netem-proxy") == 0) {
+        const char *positional[2] = {NULL, NULL};
+        int positional_count = 0;
+        int listen_port = DEFAULT_NETTF_PORT;
+        NetemProfile profile;
+        memset(&profile, 0, sizeof(profile));
+        netem_profile("none", &profile);
+
+        for (int i = 2; i < argc; i++) {
+            if (strcmp(argv[i], "--listen") == 0 && i + 1 < argc) {
+                listen_port = atoi(argv[i + 1]);
+                if (listen_port <= 0 || listen_port > 65535) {
+                    fprintf(stderr, "Error: Listen port must be between 1 and 65535\n");
+                    signals_cleanup();
+                    return EXIT_FAILURE;
+                }
+                i++;  // Skip the port value
+            } else if (strcmp(argv[i], "--profile") == 0 && i + 1 < argc) {
+                if (netem_profile(argv[i + 1], &profile) != 0) {
+                    fprintf(stderr, "Error: Profile must be none, lan, wan, transatlantic, lte, satellite or flaky\n");
+                    signals_cleanup();
+                    return EXIT_FAILURE;
+                }
+                i++;  // Skip the profile name
+            } else if (strcmp(argv[i], "--latency") == 0 && i + 1 < argc) {
+                profile.latency_ms = atof(argv[i + 1]);
+                if (profile.latency_ms < 0) {
+                    fprintf(stderr, "Error: Latency must not be negative\n");
+                    signals_cleanup();
+                    return EXIT_FAILURE;
+                }
+                i++;  // Skip the latency value
+            } else if (strcmp(argv[i], "--jitter") == 0 && i + 1 < argc) {
+                profile.jitter_ms = atof(argv[i + 1]);
+                if (profile.jitter_ms < 0) {
+                    fprintf(stderr, "Error: Jitter must not be negative\n");
+                    signals_cleanup();
+                    return EXIT_FAILURE;
+                }
+                i++;  // Skip the jitter value
+            } else if (strcmp(argv[i], "--rate") == 0 && i + 1 < argc) {
+                profile.rate_mbit = atof(argv[i + 1]);
+                if (profile.rate_mbit < 0) {
+                    fprintf(stderr, "Error: Rate must not be negative\n");
+                    signals_cleanup();
+                    return EXIT_FAILURE;
+                }
+                i++;  // Skip the rate value
+            } else if (strcmp(argv[i], "--stall") == 0 && i + 1 < argc) {
+                if (netem_parse_stall(argv[i + 1], &profile) != 0) {
+                    fprintf(stderr, "Error: Stall must be <every_ms>:<ms> with ms shorter than every_ms\n");
+                    signals_cleanup();
+                    return EXIT_FAILURE;
+                }
+                i++;  // Skip the stall specification
+            } else if (strcmp(argv[i], "--queue") == 0 && i + 1 < argc) {
+                int queue_kb = atoi(argv[i + 1]);
+                if (queue_kb <= 0) {
+                    fprintf(stderr, "Error: Queue must be a positive number of KB\n");
+                    signals_cleanup();
+                    return EXIT_FAILURE;
+                }
+                profile.queue_bytes = (size_t)queue_kb * 1024;
+                i++;  // Skip the queue size
+            } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+                profile.seed = strtoull(argv[i + 1], NULL, 10);
+                i++;  // Skip the seed
+            } else if (argv[i][0] == '-' && argv[i][1] == '-') {
+                fprintf(stderr, "Error: Unknown option '%s'\n", argv[i]);
+                print_usage(argv[0]);
+                signals_cleanup();
+                return EXIT_FAILURE;
+            } else if (positional_count < 2) {
+                positional[positional_count++] = argv[i];
+            } else {
+                positional_count++;  // Too many arguments
+            }
+        }
+
+        if (positional_count < 1 || positional_count > 2) {
+            print_usage(argv[0]);
+            signals_cleanup();
+            return EXIT_FAILURE;
+        }
+        int target_port = positional[1] ? atoi(positional[1]) : NETEM_DEFAULT_TARGET_PORT;
+        if (target_port <= 0 || target_port > 65535) {
+            fprintf(stderr, "Error: Port must be between 1 and 65535\n");
+            signals_cleanup();
+            return EXIT_FAILURE;
+        }
+
+        // Relay senders to the receiver until Ctrl+C
+        net_init();
+        int result = netem_proxy_run(listen_port, positional[0], target_port, &profile);
+        net_cleanup();
+        signals_cleanup();
+        if (result != 0) {
+            return EXIT_FAILURE;
+        }
     }
     // Handle invalid commands
     else {
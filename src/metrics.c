@@ -0,0 +1,379 @@
+/**
+ * @file metrics.c
+ * @brief Receiver metrics implementation
+ *
+ * Counters and histogram buckets are plain uint64_t variables updated with
+ * relaxed atomic adds; the endpoint thread reads them with relaxed loads, so
+ * a scrape taken mid-chunk may be off by that chunk but never blocks the
+ * receiver. Histograms keep per-bucket counts and accumulate into the
+ * cumulative Prometheus buckets only when rendered.
+ */
+
+#define _GNU_SOURCE  // Enable nanosleep() on Linux systems
+#include "metrics.h"
+#include "platform.h"  // Cross-platform socket types and functions
+#include "protocol.h"  // send_all()
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/time.h>
+
+// Relaxed atomics: counters need no ordering with respect to each other
+#define METRICS_ADD(var, value) __atomic_fetch_add(&(var), (value), __ATOMIC_RELAXED)
+#define METRICS_SUB(var, value) __atomic_fetch_sub(&(var), (value), __ATOMIC_RELAXED)
+#define METRICS_LOAD(var) __atomic_load_n(&(var), __ATOMIC_RELAXED)
+
+// Most finite buckets in a histogram
+#define METRICS_MAX_BUCKETS 16
+
+// Largest rendered /metrics response
+#define METRICS_RESPONSE_SIZE (16 * 1024)
+
+// Pause before accepting again when out of descriptors or memory
+#define METRICS_ACCEPT_BACKOFF_MS 100
+
+/**
+ * @brief Fixed-bucket histogram of unsigned integer observations
+ */
+typedef struct {
+    const char *name;          // Metric name
+    const char *help;          // HELP text
+    double scale;              // Exposed unit per stored unit (e.g. 1e-9 for ns to s)
+    const uint64_t *bounds;    // Bucket upper bounds in stored units, ascending
+    int bound_count;           // Number of finite buckets
+    uint64_t buckets[METRICS_MAX_BUCKETS + 1];  // Observations per bucket, the last one is +Inf
+    uint64_t sum;              // Sum of observations in stored units
+} Histogram;
+
+// Chunk latency bounds: 50 us to 1 s, in nanoseconds
+static const uint64_t chunk_latency_bounds[] = {
+    50000, 100000, 250000, 500000, 1000000, 2500000, 5000000, 10000000,
+    25000000, 50000000, 100000000, 250000000, 500000000, 1000000000
+};
+
+// Transfer throughput bounds: 1 MB/s to 10 GB/s, in bytes per second
+static const uint64_t throughput_bounds[] = {
+    1000000, 5000000, 10000000, 25000000, 50000000, 100000000,
+    250000000, 500000000, 1000000000, 2500000000ULL, 5000000000ULL, 10000000000ULL
+};
+
+static Histogram chunk_latency = {
+    "nettf_chunk_latency_seconds", "Time to receive and write one chunk.", 1e-9,
+    chunk_latency_bounds, sizeof(chunk_latency_bounds) / sizeof(chunk_latency_bounds[0]), {0}, 0
+};
+
+static Histogram transfer_throughput = {
+    "nettf_transfer_throughput_bytes_per_second", "Average throughput of transfers that carried file data.", 1.0,
+    throughput_bounds, sizeof(throughput_bounds) / sizeof(throughput_bounds[0]), {0}, 0
+};
+
+static int enabled;                     // Set once by metrics_start()
+static uint64_t bytes_received;         // File data bytes received
+static uint64_t files_received;         // Files received completely
+static uint64_t recv_nanoseconds;       // Time spent receiving chunk data
+static uint64_t write_nanoseconds;      // Time spent writing chunk data
+static uint64_t active_transfers;       // Connections being handled
+static uint64_t transfers_ok;           // Transfers that succeeded
+static uint64_t transfers_failed;       // Transfers that failed
+static uint64_t errors[METRICS_ERROR_TYPES];
+
+static const char *error_names[METRICS_ERROR_TYPES] = {"network", "disk", "protocol"};
+
+// Start of the current transfer (touched only by the receiving thread)
+static uint64_t transfer_start_ns;
+static uint64_t transfer_start_bytes;
+static uint64_t transfer_start_errors;
+
+/**
+ * @brief Errors of all types counted so far
+ */
+static uint64_t total_errors(void) {
+    uint64_t total = 0;
+    for (int i = 0; i < METRICS_ERROR_TYPES; i++) {
+        total += METRICS_LOAD(errors[i]);
+    }
+    return total;
+}
+
+/**
+ * @brief Add an observation to a histogram
+ */
+static void histogram_observe(Histogram *h, uint64_t value) {
+    int bucket = 0;
+    while (bucket < h->bound_count && value > h->bounds[bucket]) {
+        bucket++;
+    }
+    METRICS_ADD(h->buckets[bucket], 1);
+    METRICS_ADD(h->sum, value);
+}
+
+/**
+ * @brief Whether metrics are collected
+ */
+int metrics_enabled(void) {
+    return METRICS_LOAD(enabled);
+}
+
+/**
+ * @brief Record one received chunk
+ */
+void metrics_chunk(uint64_t bytes, uint64_t recv_start, uint64_t write_start, uint64_t write_end) {
+    if (!METRICS_LOAD(enabled)) {
+        return;
+    }
+    METRICS_ADD(bytes_received, bytes);
+    METRICS_ADD(recv_nanoseconds, write_start - recv_start);
+    METRICS_ADD(write_nanoseconds, write_end - write_start);
+    histogram_observe(&chunk_latency, write_end - recv_start);
+}
+
+/**
+ * @brief Count a file received completely
+ */
+void metrics_file_received(void) {
+    if (METRICS_LOAD(enabled)) {
+        METRICS_ADD(files_received, 1);
+    }
+}
+
+/**
+ * @brief Count an error
+ */
+void metrics_error(MetricsError type) {
+    if (METRICS_LOAD(enabled) && type >= 0 && type < METRICS_ERROR_TYPES) {
+        METRICS_ADD(errors[type], 1);
+    }
+}
+
+/**
+ * @brief Mark the start of a transfer (one accepted connection)
+ */
+void metrics_transfer_begin(void) {
+    if (!METRICS_LOAD(enabled)) {
+        return;
+    }
+    METRICS_ADD(active_transfers, 1);
+    transfer_start_ns = platform_monotonic_ns();
+    transfer_start_bytes = METRICS_LOAD(bytes_received);
+    transfer_start_errors = total_errors();
+}
+
+/**
+ * @brief Mark the end of the transfer started last
+ */
+void metrics_transfer_end(int ok) {
+    if (!METRICS_LOAD(enabled)) {
+        return;
+    }
+    METRICS_SUB(active_transfers, 1);
+    if (ok) {
+        METRICS_ADD(transfers_ok, 1);
+    } else {
+        METRICS_ADD(transfers_failed, 1);
+
+        // A failure with no network or disk error behind it broke the protocol
+        if (total_errors() == transfer_start_errors) {
+            METRICS_ADD(errors[METRICS_ERROR_PROTOCOL], 1);
+        }
+    }
+
+    uint64_t bytes = METRICS_LOAD(bytes_received) - transfer_start_bytes;
+    uint64_t elapsed_ns = platform_monotonic_ns() - transfer_start_ns;
+    if (bytes > 0 && elapsed_ns > 0) {
+        histogram_observe(&transfer_throughput, (uint64_t)((double)bytes * 1e9 / (double)elapsed_ns));
+    }
+}
+
+/**
+ * @brief Append a single-valued metric with its HELP and TYPE lines
+ */
+static void append_metric(char *buf, size_t size, size_t *len, const char *name, const char *type,
+                          const char *help, double value) {
+    platform_append(buf, size, len, "# HELP %s %s\n# TYPE %s %s\n%s %.15g\n", name, help, name, type, name, value);
+}
+
+/**
+ * @brief Append a histogram in the Prometheus text format
+ */
+static void append_histogram(char *buf, size_t size, size_t *len, Histogram *h) {
+    platform_append(buf, size, len, "# HELP %s %s\n# TYPE %s histogram\n", h->name, h->help, h->name);
+    uint64_t cumulative = 0;
+    for (int i = 0; i < h->bound_count; i++) {
+        cumulative += METRICS_LOAD(h->buckets[i]);
+        platform_append(buf, size, len, "%s_bucket{le=\"%g\"} %llu\n", h->name, (double)h->bounds[i] * h->scale,
+                        (unsigned long long)cumulative);
+    }
+    cumulative += METRICS_LOAD(h->buckets[h->bound_count]);
+    platform_append(buf, size, len, "%s_bucket{le=\"+Inf\"} %llu\n", h->name, (unsigned long long)cumulative);
+    platform_append(buf, size, len, "%s_sum %.15g\n", h->name, (double)METRICS_LOAD(h->sum) * h->scale);
+    platform_append(buf, size, len, "%s_count %llu\n", h->name, (unsigned long long)cumulative);
+}
+
+/**
+ * @brief Render all metrics
+ *
+ * @return Length of the rendered text
+ */
+static size_t render_metrics(char *buf, size_t size) {
+    size_t len = 0;
+    buf[0] = '\0';
+
+    append_metric(buf, size, &len, "nettf_received_bytes_total", "counter",
+                  "File data bytes received.", (double)METRICS_LOAD(bytes_received));
+    append_metric(buf, size, &len, "nettf_received_files_total", "counter",
+                  "Files received completely.", (double)METRICS_LOAD(files_received));
+    append_metric(buf, size, &len, "nettf_active_transfers", "gauge",
+                  "Transfers in progress.", (double)METRICS_LOAD(active_transfers));
+
+    platform_append(buf, size, &len, "# HELP nettf_transfers_total Transfers handled, by result.\n"
+                                     "# TYPE nettf_transfers_total counter\n");
+    platform_append(buf, size, &len, "nettf_transfers_total{result=\"ok\"} %llu\n",
+                    (unsigned long long)METRICS_LOAD(transfers_ok));
+    platform_append(buf, size, &len, "nettf_transfers_total{result=\"failed\"} %llu\n",
+                    (unsigned long long)METRICS_LOAD(transfers_failed));
+
+    platform_append(buf, size, &len, "# HELP nettf_chunk_phase_seconds_total Time spent receiving and writing chunks.\n"
+                                     "# TYPE nettf_chunk_phase_seconds_total counter\n");
+    platform_append(buf, size, &len, "nettf_chunk_phase_seconds_total{phase=\"recv\"} %.9f\n",
+                    (double)METRICS_LOAD(recv_nanoseconds) * 1e-9);
+    platform_append(buf, size, &len, "nettf_chunk_phase_seconds_total{phase=\"write\"} %.9f\n",
+                    (double)METRICS_LOAD(write_nanoseconds) * 1e-9);
+
+    platform_append(buf, size, &len, "# HELP nettf_errors_total Errors, by type.\n# TYPE nettf_errors_total counter\n");
+    for (int i = 0; i < METRICS_ERROR_TYPES; i++) {
+        platform_append(buf, size, &len, "nettf_errors_total{type=\"%s\"} %llu\n", error_names[i],
+                        (unsigned long long)METRICS_LOAD(errors[i]));
+    }
+
+    append_histogram(buf, size, &len, &chunk_latency);
+    append_histogram(buf, size, &len, &transfer_throughput);
+    return len;
+}
+
+/**
+ * @brief Answer one HTTP request
+ */
+static void serve_request(SOCKET_T s, char *response) {
+    // A scraper that never sends its request must not stall the endpoint
+    struct timeval tv;
+    tv.tv_sec = 1;
+    tv.tv_usec = 0;
+    setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(s, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+    char request[1024];
+    ssize_t n = recv(s, request, sizeof(request) - 1, 0);
+    if (n <= 0) {
+        return;
+    }
+    request[n] = '\0';
+
+    char header[256];
+    if (strncmp(request, "GET /metrics", 12) == 0 && (request[12] == ' ' || request[12] == '?')) {
+        size_t body_len = render_metrics(response, METRICS_RESPONSE_SIZE);
+        snprintf(header, sizeof(header),
+                 "HTTP/1.0 200 OK\r\n"
+                 "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+                 "Content-Length: %lu\r\n"
+                 "Connection: close\r\n\r\n", (unsigned long)body_len);
+        if (send_all(s, header, strlen(header)) == 0) {
+            send_all(s, response, body_len);
+        }
+    } else {
+        const char *not_found = "HTTP/1.0 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+        send_all(s, not_found, strlen(not_found));
+    }
+}
+
+/**
+ * @brief Endpoint thread: accept scrapes one at a time
+ */
+static void *metrics_thread(void *arg) {
+    SOCKET_T listen_socket = *(SOCKET_T *)arg;
+    char *response = malloc(METRICS_RESPONSE_SIZE);
+    if (!response) {
+        perror("malloc");
+        return NULL;
+    }
+
+    int exhausted = 0;  // Out of resources, and already reported
+    while (1) {
+        SOCKET_T s = accept(listen_socket, NULL, NULL);
+        if (s == INVALID_SOCKET_T) {
+#ifdef _WIN32
+            int error = WSAGetLastError();
+            int transient = error == WSAECONNRESET || error == WSAEINTR;
+            int resources = error == WSAEMFILE || error == WSAENOBUFS;
+#else
+            int error = errno;
+            int transient = error == EINTR || error == ECONNABORTED || error == EPROTO;
+            int resources = error == EMFILE || error == ENFILE || error == ENOBUFS || error == ENOMEM;
+#endif
+            if (transient) {
+                continue;
+            }
+            if (!resources) {
+                perror("metrics accept");
+                break;
+            }
+            // The pending scrape stays queued: wait for descriptors to free up
+            // instead of spinning on the same error
+            if (!exhausted) {
+                perror("metrics accept");
+                exhausted = 1;
+            }
+#ifdef _WIN32
+            Sleep(METRICS_ACCEPT_BACKOFF_MS);
+#else
+            struct timespec pause = {0, METRICS_ACCEPT_BACKOFF_MS * 1000000L};
+            nanosleep(&pause, NULL);
+#endif
+            continue;
+        }
+        exhausted = 0;
+        serve_request(s, response);
+        close_socket(s);
+    }
+
+    free(response);
+    return NULL;
+}
+
+/**
+ * @brief Start serving metrics over HTTP in a background thread
+ */
+int metrics_start(int port) {
+    static SOCKET_T listen_socket;
+
+    listen_socket = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_socket == INVALID_SOCKET_T) {
+        perror("metrics socket");
+        return -1;
+    }
+
+    int opt = 1;
+    setsockopt(listen_socket, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+    SOCKADDR_IN_T addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = INADDR_ANY;
+    addr.sin_port = htons((uint16_t)port);
+    if (bind(listen_socket, (struct sockaddr *)&addr, sizeof(addr)) == SOCKET_ERROR ||
+        listen(listen_socket, 8) == SOCKET_ERROR) {
+        perror("metrics bind");
+        close_socket(listen_socket);
+        return -1;
+    }
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, metrics_thread, &listen_socket) != 0) {
+        fprintf(stderr, "Error: Could not start metrics thread\n");
+        close_socket(listen_socket);
+        return -1;
+    }
+    pthread_detach(thread);
+
+    __atomic_store_n(&enabled, 1, __ATOMIC_RELAXED);
+    return 0;
+}
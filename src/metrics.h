@@ -0,0 +1,89 @@
+/**
+ * @file metrics.h
+ * @brief Receiver metrics with a Prometheus text endpoint
+ *
+ * Counts what a long-running receiver does (bytes and files received,
+ * transfers in progress, per-transfer throughput, chunk latency, time spent
+ * receiving versus writing, errors by type) and serves the values over HTTP
+ * in the Prometheus text exposition format at /metrics.
+ *
+ * Every update is a relaxed atomic add on a fixed counter or histogram
+ * bucket: no locks and no allocation on the data path. Until metrics_start()
+ * is called, the recording functions return at once and the receive loops
+ * do not read the clock for them (see metrics_enabled()), so receivers
+ * without an endpoint pay nothing.
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+
+/**
+ * @brief Error types counted by metrics_error()
+ */
+typedef enum {
+    METRICS_ERROR_NETWORK = 0,  // Receive failed or the peer closed the connection
+    METRICS_ERROR_DISK,         // A received file could not be created or written
+    METRICS_ERROR_PROTOCOL,     // Transfer failed for any other reason (unknown type, bad header)
+    METRICS_ERROR_TYPES         // Number of error types
+} MetricsError;
+
+/**
+ * @brief Start serving metrics over HTTP in a background thread
+ *
+ * Enables metric collection and answers GET /metrics on the given port.
+ * When the process runs out of descriptors, the endpoint reports it once
+ * and retries after a short pause; on any other accept error
+ * it stops serving, and the transfers carry on without it.
+ *
+ * @param port TCP port for the metrics endpoint
+ * @return 0 on success, -1 on error
+ */
+int metrics_start(int port);
+
+/**
+ * @brief Whether metrics are collected
+ *
+ * @return Nonzero once metrics_start() has succeeded
+ */
+int metrics_enabled(void);
+
+/**
+ * @brief Record one received chunk
+ *
+ * @param bytes Chunk size
+ * @param recv_start platform_monotonic_ns() before receiving the chunk
+ * @param write_start platform_monotonic_ns() after receiving, before writing it out
+ * @param write_end platform_monotonic_ns() after writing it out
+ */
+void metrics_chunk(uint64_t bytes, uint64_t recv_start, uint64_t write_start, uint64_t write_end);
+
+/**
+ * @brief Count a file received completely
+ */
+void metrics_file_received(void);
+
+/**
+ * @brief Count an error
+ *
+ * @param type Error type
+ */
+void metrics_error(MetricsError type);
+
+/**
+ * @brief Mark the start of a transfer (one accepted connection)
+ */
+void metrics_transfer_begin(void);
+
+/**
+ * @brief Mark the end of the transfer started last
+ *
+ * Records its throughput when it carried file data. A failed transfer that
+ * counted no network or disk error is counted as a protocol error.
+ *
+ * @param ok Nonzero if the transfer succeeded
+ */
+void metrics_transfer_end(int ok);
+
+#endif // METRICS_H
@@ -0,0 +1,506 @@
+/**
+ * @file netem.c
+ * @brief User-space network impairment relay implementation
+ *
+ * Both sockets are non-blocking and watched by one poll() loop per
+ * connection. Each direction keeps a queue of segments stamped with the
+ * time they may leave; the loop sleeps until a segment is due, a stall
+ * ends, or a socket becomes ready.
+ */
+
+#define _GNU_SOURCE  // Enable getaddrinfo() on Linux systems
+#include "netem.h"
+#include "platform.h"  // platform_monotonic_ns()
+#include "dialer.h"   // Connecting to the receiver
+#include "signals.h"  // Stop the proxy on Ctrl+C
+#include "treegen.h"  // treegen_random(), treegen_seed_state()
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#ifdef _WIN32
+#define poll WSAPoll
+#else
+#include <fcntl.h>
+#include <poll.h>
+#endif
+
+// Largest piece of data read or held at once
+#define NETEM_SEGMENT_SIZE 16384
+
+// Receive buffer of the relay's sockets, small so the queue is the bottleneck
+#define NETEM_SOCKET_BUFFER (64 * 1024)
+
+/**
+ * @brief Data waiting to leave in one direction
+ */
+typedef struct {
+    unsigned char *data;   // NETEM_SEGMENT_SIZE bytes
+    size_t length;         // Bytes held
+    size_t offset;         // Bytes already delivered
+    uint64_t release_ns;   // Earliest time the data may leave
+} NetemSegment;
+
+/**
+ * @brief State of one direction of a relayed connection
+ */
+typedef struct {
+    SOCKET_T from;             // Source socket
+    SOCKET_T to;               // Destination socket
+    NetemSegment *segments;    // Ring of segments
+    int capacity;              // Segments in the ring
+    int head;                  // Oldest segment
+    int count;                 // Segments held
+    uint64_t link_free_ns;     // When the capped link finishes serializing
+    uint64_t last_release_ns;  // Release time of the newest segment
+    int eof;                   // Source closed
+    int closed;                // End passed on to the destination
+    uint64_t bytes;            // Bytes delivered
+} NetemDirection;
+
+/**
+ * @brief A connection served by the proxy
+ */
+typedef struct {
+    SOCKET_T client;           // Sender side
+    SOCKET_T upstream;         // Receiver side
+    NetemProfile profile;      // Impairments (seed varied per connection)
+    int id;                    // Connection number
+} NetemConnection;
+
+/**
+ * @brief Switch a socket to non-blocking mode
+ */
+static void set_nonblocking(SOCKET_T s) {
+#ifdef _WIN32
+    u_long mode = 1;
+    ioctlsocket(s, FIONBIO, &mode);
+#else
+    fcntl(s, F_SETFL, fcntl(s, F_GETFL, 0) | O_NONBLOCK);
+#endif
+}
+
+/**
+ * @brief Whether the last socket call failed only because it would block
+ */
+static int would_block(void) {
+#ifdef _WIN32
+    return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+#endif
+}
+
+/**
+ * @brief End of the stall in progress at a time, 0 if none
+ */
+static uint64_t stall_end(const NetemProfile *profile, uint64_t start_ns, uint64_t now) {
+    if (profile->stall_every_ms <= 0 || profile->stall_ms <= 0) {
+        return 0;
+    }
+    uint64_t every = (uint64_t)profile->stall_every_ms * 1000000ULL;
+    uint64_t length = (uint64_t)profile->stall_ms * 1000000ULL;
+    uint64_t elapsed = now - start_ns;
+    if (elapsed < every) {
+        return 0;  // The first stall comes after one period
+    }
+    uint64_t into = elapsed % every;
+    return into < length ? start_ns + (elapsed - into) + length : 0;
+}
+
+/**
+ * @brief Read from the source of a direction into a new segment
+ *
+ * @return 0 on success or nothing to read, -1 on a socket error
+ */
+static int read_segment(NetemDirection *dir, const NetemProfile *profile, uint64_t *rng, uint64_t now) {
+    NetemSegment *segment = &dir->segments[(dir->head + dir->count) % dir->capacity];
+    ssize_t received = recv(dir->from, (char *)segment->data, NETEM_SEGMENT_SIZE, 0);
+    if (received == 0) {
+        dir->eof = 1;
+        return 0;
+    }
+    if (received < 0) {
+        return would_block() ? 0 : -1;
+    }
+
+    // Serialize at the capped rate, then add latency and jitter
+    uint64_t leave = now;
+    if (profile->rate_mbit > 0) {
+        uint64_t start = dir->link_free_ns > now ? dir->link_free_ns : now;
+        leave = start + (uint64_t)(received * 8.0 * 1000.0 / profile->rate_mbit);
+        dir->link_free_ns = leave;
+    }
+    double delay_ms = profile->latency_ms;
+    if (profile->jitter_ms > 0) {
+        double unit = (treegen_random(rng) >> 11) * (1.0 / 9007199254740992.0);  // [0, 1)
+        delay_ms += (unit * 2.0 - 1.0) * profile->jitter_ms;
+    }
+    uint64_t release = leave + (delay_ms > 0 ? (uint64_t)(delay_ms * 1e6) : 0);
+    if (release < dir->last_release_ns) {
+        release = dir->last_release_ns;  // Never overtake earlier data
+    }
+    dir->last_release_ns = release;
+
+    segment->length = (size_t)received;
+    segment->offset = 0;
+    segment->release_ns = release;
+    dir->count++;
+    return 0;
+}
+
+/**
+ * @brief Deliver the segments of a direction that are due
+ *
+ * @return 0 on success (possibly blocked), -1 on a socket error
+ */
+static int flush_direction(NetemDirection *dir, uint64_t now) {
+    while (dir->count > 0) {
+        NetemSegment *segment = &dir->segments[dir->head];
+        if (segment->release_ns > now) {
+            return 0;
+        }
+        ssize_t sent = send(dir->to, (const char *)segment->data + segment->offset,
+                            segment->length - segment->offset, 0);
+        if (sent < 0) {
+            return would_block() ? 0 : -1;
+        }
+        segment->offset += (size_t)sent;
+        dir->bytes += (uint64_t)sent;
+        if (segment->offset < segment->length) {
+            return 0;  // Socket buffer full
+        }
+        dir->head = (dir->head + 1) % dir->capacity;
+        dir->count--;
+    }
+    return 0;
+}
+
+/**
+ * @brief Relay between two connected sockets until both directions end
+ */
+int netem_relay(SOCKET_T a, SOCKET_T b, const NetemProfile *profile, NetemStats *stats) {
+    NetemDirection dirs[2];
+    int capacity = (int)(profile->queue_bytes / NETEM_SEGMENT_SIZE);
+    if (capacity < 2) {
+        capacity = 2;
+    }
+    memset(dirs, 0, sizeof(dirs));
+    dirs[0].from = a;
+    dirs[0].to = b;
+    dirs[1].from = b;
+    dirs[1].to = a;
+
+    int result = 0;
+    for (int d = 0; d < 2; d++) {
+        dirs[d].capacity = capacity;
+        dirs[d].segments = calloc((size_t)capacity, sizeof(NetemSegment));
+        if (!dirs[d].segments) {
+            result = -1;
+            continue;
+        }
+        for (int i = 0; i < capacity; i++) {
+            dirs[d].segments[i].data = malloc(NETEM_SEGMENT_SIZE);
+            if (!dirs[d].segments[i].data) {
+                result = -1;
+            }
+        }
+    }
+    if (result != 0) {
+        fprintf(stderr, "Error: Out of memory for the relay queues\n");
+    }
+
+    set_nonblocking(a);
+    set_nonblocking(b);
+
+    uint64_t rng = treegen_seed_state(profile->seed);
+    uint64_t start = platform_monotonic_ns();
+    uint64_t stalls = 0;
+    uint64_t last_stall_end = 0;
+
+    while (result == 0 && !(dirs[0].closed && dirs[1].closed)) {
+        uint64_t now = platform_monotonic_ns();
+        uint64_t stalled_until = stall_end(profile, start, now);
+        if (stalled_until && stalled_until != last_stall_end) {
+            stalls++;
+            last_stall_end = stalled_until;
+        }
+
+        struct pollfd pfds[2];
+        pfds[0].fd = a;
+        pfds[1].fd = b;
+        pfds[0].events = pfds[1].events = 0;
+        pfds[0].revents = pfds[1].revents = 0;
+        uint64_t wake = 0;  // Earliest time something becomes due, 0 for none
+
+        for (int d = 0; d < 2 && result == 0; d++) {
+            NetemDirection *dir = &dirs[d];
+            if (!stalled_until && flush_direction(dir, now) != 0) {
+                result = -1;
+                break;
+            }
+            if (dir->count == 0 && dir->eof && !dir->closed) {
+                shutdown(dir->to, SHUT_WR);  // Pass the end on
+                dir->closed = 1;
+            }
+
+            if (dir->count > 0) {
+                uint64_t due = stalled_until ? stalled_until : dir->segments[dir->head].release_ns;
+                if (due > now) {
+                    wake = wake == 0 || due < wake ? due : wake;
+                } else {
+                    pfds[1 - d].events |= POLLOUT;  // Due but the destination is full
+                }
+            }
+            if (!dir->eof && dir->count < dir->capacity) {
+                pfds[d].events |= POLLIN;
+            }
+        }
+        if (result != 0 || (dirs[0].closed && dirs[1].closed)) {
+            break;
+        }
+
+        int timeout = -1;
+        if (wake) {
+            uint64_t wait_ns = wake - now;
+            timeout = (int)((wait_ns + 999999) / 1000000);  // Round up to whole milliseconds
+        }
+        int ready = poll(pfds, 2, timeout);
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("poll");
+            result = -1;
+            break;
+        }
+
+        now = platform_monotonic_ns();
+        for (int d = 0; d < 2 && result == 0; d++) {
+            if (pfds[d].revents & (POLLIN | POLLHUP | POLLERR)) {
+                if (!dirs[d].eof && dirs[d].count < dirs[d].capacity &&
+                    read_segment(&dirs[d], profile, &rng, now) != 0) {
+                    result = -1;
+                }
+            }
+        }
+    }
+
+    if (stats) {
+        stats->bytes[0] = dirs[0].bytes;
+        stats->bytes[1] = dirs[1].bytes;
+        stats->seconds = (platform_monotonic_ns() - start) / 1e9;
+        stats->stalls = stalls;
+    }
+    for (int d = 0; d < 2; d++) {
+        for (int i = 0; dirs[d].segments && i < dirs[d].capacity; i++) {
+            free(dirs[d].segments[i].data);
+        }
+        free(dirs[d].segments);
+    }
+    return result;
+}
+
+/**
+ * @brief Load a named profile
+ */
+int netem_profile(const char *name, NetemProfile *profile) {
+    // name, one-way latency, jitter, rate, stall period, stall length
+    static const struct {
+        const char *name;
+        double latency_ms;
+        double jitter_ms;
+        double rate_mbit;
+        int stall_every_ms;
+        int stall_ms;
+    } profiles[] = {
+        {"none", 0, 0, 0, 0, 0},
+        {"lan", 0.25, 0.05, 1000, 0, 0},
+        {"wan", 20, 2, 100, 0, 0},
+        {"transatlantic", 40, 4, 200, 0, 0},
+        {"lte", 30, 15, 30, 8000, 250},
+        {"satellite", 300, 20, 20, 0, 0},
+        {"flaky", 15, 10, 50, 2000, 500},
+    };
+
+    for (size_t i = 0; i < sizeof(profiles) / sizeof(profiles[0]); i++) {
+        if (strcmp(name, profiles[i].name) == 0) {
+            profile->latency_ms = profiles[i].latency_ms;
+            profile->jitter_ms = profiles[i].jitter_ms;
+            profile->rate_mbit = profiles[i].rate_mbit;
+            profile->stall_every_ms = profiles[i].stall_every_ms;
+            profile->stall_ms = profiles[i].stall_ms;
+            profile->queue_bytes = NETEM_DEFAULT_QUEUE_BYTES;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Parse a stall specification "<every_ms>:<ms>"
+ */
+int netem_parse_stall(const char *text, NetemProfile *profile) {
+    int every = 0, length = 0;
+    char extra;
+    if (sscanf(text, "%d:%d%c", &every, &length, &extra) != 2 || every <= 0 || length <= 0 ||
+        length >= every) {
+        return -1;
+    }
+    profile->stall_every_ms = every;
+    profile->stall_ms = length;
+    return 0;
+}
+
+/**
+ * @brief Describe a profile in one line
+ */
+void netem_describe(const NetemProfile *profile, char *buf, size_t size) {
+    char rate[32] = "unlimited";
+    char stall[48] = "no stalls";
+    if (profile->rate_mbit > 0) {
+        snprintf(rate, sizeof(rate), "%.1f Mbit/s", profile->rate_mbit);
+    }
+    if (profile->stall_every_ms > 0) {
+        snprintf(stall, sizeof(stall), "%d ms stall every %d ms", profile->stall_ms, profile->stall_every_ms);
+    }
+    snprintf(buf, size, "%.2f ms +/- %.2f ms one way, %s, %s, %zu KB queue", profile->latency_ms,
+             profile->jitter_ms, rate, stall, profile->queue_bytes / 1024);
+}
+
+// Target of the proxy, shared by the connection threads
+static const char *proxy_target;
+static int proxy_target_port;
+
+/**
+ * @brief Connection thread: connect to the receiver and relay
+ */
+static void *proxy_connection(void *arg) {
+    NetemConnection *connection = (NetemConnection *)arg;
+
+    connection->upstream = dial_receiver(proxy_target, proxy_target_port, 0);
+    if (connection->upstream == INVALID_SOCKET_T) {
+        fprintf(stderr, "[%d] Cannot reach %s:%d, dropping the connection\n", connection->id, proxy_target,
+                proxy_target_port);
+        close_socket(connection->client);
+        free(connection);
+        return NULL;
+    }
+    int buffer = NETEM_SOCKET_BUFFER;
+    setsockopt(connection->upstream, SOL_SOCKET, SO_RCVBUF, (char *)&buffer, sizeof(buffer));
+
+    NetemStats stats;
+    int result = netem_relay(connection->client, connection->upstream, &connection->profile, &stats);
+    printf("[%d] %s: %llu bytes forward, %llu back in %.2f s (%.2f MB/s), %llu stalls\n", connection->id,
+           result == 0 ? "Closed" : "Aborted", (unsigned long long)stats.bytes[0],
+           (unsigned long long)stats.bytes[1], stats.seconds,
+           stats.seconds > 0 ? stats.bytes[0] / stats.seconds / (1024.0 * 1024.0) : 0.0,
+           (unsigned long long)stats.stalls);
+    fflush(stdout);
+
+    close_socket(connection->client);
+    close_socket(connection->upstream);
+    free(connection);
+    return NULL;
+}
+
+/**
+ * @brief Accept connections and relay each to the target with impairments
+ */
+int netem_proxy_run(int listen_port, const char *target, int target_port, const NetemProfile *profile) {
+#ifndef _WIN32
+    signal(SIGPIPE, SIG_IGN);  // A closed peer is reported by send() instead
+#endif
+    proxy_target = target;
+    proxy_target_port = target_port;
+
+    // Dual-stack listener, falling back to IPv4
+    int family = AF_INET6;
+    SOCKET_T listener = socket(AF_INET6, SOCK_STREAM, 0);
+    if (listener == INVALID_SOCKET_T) {
+        family = AF_INET;
+        listener = socket(AF_INET, SOCK_STREAM, 0);
+    }
+    if (listener == INVALID_SOCKET_T) {
+        perror("socket");
+        return -1;
+    }
+    int opt = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, (char *)&opt, sizeof(opt));
+    int buffer = NETEM_SOCKET_BUFFER;  // Inherited by accepted sockets
+    setsockopt(listener, SOL_SOCKET, SO_RCVBUF, (char *)&buffer, sizeof(buffer));
+
+    struct sockaddr_storage address;
+    socklen_t address_len;
+    memset(&address, 0, sizeof(address));
+    if (family == AF_INET6) {
+        int v6only = 0;
+        setsockopt(listener, IPPROTO_IPV6, IPV6_V6ONLY, (char *)&v6only, sizeof(v6only));
+        struct sockaddr_in6 *addr6 = (struct sockaddr_in6 *)&address;
+        addr6->sin6_family = AF_INET6;
+        addr6->sin6_addr = in6addr_any;
+        addr6->sin6_port = htons(listen_port);
+        address_len = sizeof(*addr6);
+    } else {
+        SOCKADDR_IN_T *addr4 = (SOCKADDR_IN_T *)&address;
+        addr4->sin_family = AF_INET;
+        addr4->sin_addr.s_addr = INADDR_ANY;
+        addr4->sin_port = htons(listen_port);
+        address_len = sizeof(*addr4);
+    }
+    if (bind(listener, (struct sockaddr *)&address, address_len) == SOCKET_ERROR ||
+        listen(listener, 8) == SOCKET_ERROR) {
+        perror("bind");
+        close_socket(listener);
+        return -1;
+    }
+
+    char description[160];
+    netem_describe(profile, description, sizeof(description));
+    printf("Relaying port %d to %s:%d\n", listen_port, target, target_port);
+    printf("Impairment: %s\n", description);
+    printf("Press Ctrl+C to stop the proxy\n\n");
+    fflush(stdout);
+
+    int next_id = 1;
+    while (!signals_should_shutdown()) {
+        // Wake regularly to notice Ctrl+C
+        struct pollfd pfd;
+        pfd.fd = listener;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        if (poll(&pfd, 1, 200) <= 0) {
+            continue;
+        }
+
+        SOCKET_T client = accept(listener, NULL, NULL);
+        if (client == INVALID_SOCKET_T) {
+            perror("accept");
+            continue;
+        }
+        NetemConnection *connection = malloc(sizeof(NetemConnection));
+        if (!connection) {
+            close_socket(client);
+            continue;
+        }
+        connection->client = client;
+        connection->upstream = INVALID_SOCKET_T;
+        connection->profile = *profile;
+        connection->profile.seed = profile->seed + (uint64_t)next_id;  // Distinct, reproducible jitter
+        connection->id = next_id++;
+        printf("[%d] Connection accepted\n", connection->id);
+        fflush(stdout);
+
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, proxy_connection, connection) != 0) {
+            fprintf(stderr, "Error: Cannot start a relay thread\n");
+            close_socket(client);
+            free(connection);
+            continue;
+        }
+        pthread_detach(thread);
+    }
+
+    printf("\nShutting down the proxy.\n");
+    close_socket(listener);
+    return 0;
+}
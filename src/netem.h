@@ -0,0 +1,115 @@
+/**
+ * @file netem.h
+ * @brief User-space network impairment relay for NETTF
+ *
+ * Relays a TCP stream between two sockets while adding one-way latency,
+ * jitter, a bandwidth cap and periodic stalls in each direction, similar to
+ * what the Linux netem queueing discipline does but without root or tc.
+ * Run as "nettf netem-proxy" between a sender and a receiver on localhost,
+ * it reproduces WAN-like conditions for tuning adaptive chunk sizing and
+ * socket options.
+ *
+ * Model, per direction: data read from the source is serialized at the
+ * capped rate, then held for the latency plus a jitter drawn uniformly from
+ * [-jitter, +jitter]. Data never overtakes earlier data, as on a TCP path,
+ * so jitter only stretches gaps. During a stall nothing is forwarded; data
+ * waiting behind it leaves as a burst when the stall ends. At most
+ * queue_bytes wait in the relay; beyond that it stops reading, so the
+ * sender feels the bottleneck through TCP flow control. Jitter is drawn
+ * from a seeded generator, so a profile and seed always give the same delays.
+ */
+
+#ifndef NETEM_H
+#define NETEM_H
+
+#include "platform.h"  // SOCKET_T
+#include <stddef.h>
+#include <stdint.h>
+
+// Default port the proxy forwards to (the receiver runs with --port)
+#define NETEM_DEFAULT_TARGET_PORT 9877
+
+// Default bytes held per direction (the bottleneck queue)
+#define NETEM_DEFAULT_QUEUE_BYTES (1024 * 1024)
+
+/**
+ * @brief Impairments applied to each direction of a relayed connection
+ */
+typedef struct {
+    double latency_ms;    // One-way delay added in each direction
+    double jitter_ms;     // Delay varies uniformly by up to this much
+    double rate_mbit;     // Bandwidth cap per direction in Mbit/s, 0 for none
+    int stall_every_ms;   // Start a stall this often, 0 for never
+    int stall_ms;         // Length of each stall
+    size_t queue_bytes;   // Bytes held per direction before reading stops
+    uint64_t seed;        // Seed for the jitter
+} NetemProfile;
+
+/**
+ * @brief What a relayed connection carried
+ */
+typedef struct {
+    uint64_t bytes[2];    // Bytes forwarded from the first and from the second socket
+    double seconds;       // Duration of the relay
+    uint64_t stalls;      // Stalls that began during the relay
+} NetemStats;
+
+/**
+ * @brief Load a named profile
+ *
+ * Profiles: "none" (no impairment), "lan", "wan", "transatlantic",
+ * "lte", "satellite" and "flaky" (see README for their values).
+ *
+ * @param name Profile name
+ * @param profile Output: the profile's impairments
+ * @return 0 on success, -1 if the name is unknown
+ */
+int netem_profile(const char *name, NetemProfile *profile);
+
+/**
+ * @brief Parse a stall specification "<every_ms>:<ms>"
+ *
+ * @param text Stall specification, e.g. "5000:300"
+ * @param profile Profile to update
+ * @return 0 on success, -1 on an invalid specification
+ */
+int netem_parse_stall(const char *text, NetemProfile *profile);
+
+/**
+ * @brief Describe a profile in one line
+ *
+ * @param profile Profile to describe
+ * @param buf Output buffer
+ * @param size Size of the output buffer
+ */
+void netem_describe(const NetemProfile *profile, char *buf, size_t size);
+
+/**
+ * @brief Relay between two connected sockets until both directions end
+ *
+ * Each direction ends when its source closes and everything held has been
+ * delivered; the end is passed on with a half-close. The sockets are left
+ * open (non-blocking) for the caller to close.
+ *
+ * @param a First socket
+ * @param b Second socket
+ * @param profile Impairments to apply
+ * @param stats Output: what was relayed, may be NULL
+ * @return 0 when both directions ended, -1 on a socket error
+ */
+int netem_relay(SOCKET_T a, SOCKET_T b, const NetemProfile *profile, NetemStats *stats);
+
+/**
+ * @brief Accept connections and relay each to the target with impairments
+ *
+ * Serves connections concurrently, one thread each, until Ctrl+C.
+ *
+ * @param listen_port Port to accept senders on
+ * @param target Hostname or address of the receiver
+ * @param target_port Port of the receiver
+ * @param profile Impairments to apply
+ * @return 0 on shutdown, -1 if the proxy could not start
+ */
+int netem_proxy_run(int listen_port, const char *target, int target_port, const NetemProfile *profile);
+
+#endif // NETEM_H
@@ -0,0 +1,396 @@
+/**
+ * @file peerprofile.c
+ * @brief Per-peer tuning profiles implementation
+ *
+ * Profile file layout (host byte order, rejected on endianness mismatch):
+ *   "NTPP" magic, uint32 version, uint32 byte order marker, uint32 reserved,
+ *   uint64 entry count, then the PeerProfile records.
+ *
+ * Concurrent writers (a sender and a receiver on one host) each replace the
+ * whole file atomically, so one of two simultaneous updates may be lost but
+ * the file is never torn.
+ */
+
+#define _GNU_SOURCE  // Enable getnameinfo() on Linux systems
+#include "peerprofile.h"
+#include "platform.h"  // platform_monotonic_ns()
+#include "adaptive.h"  // adaptive_set_initial_chunk_size(), adaptive_policy_threshold()
+#include "protocol.h"  // format_bytes()
+#include <time.h>
+#ifdef __linux__
+#include <linux/sockios.h>  // SIOCOUTQ
+#include <sys/ioctl.h>
+#endif
+
+#define PEERPROFILE_MAGIC "NTPP"
+#define PEERPROFILE_VERSION 1  // Bumped whenever PeerProfile changes
+#define PEERPROFILE_BYTE_ORDER 0x01020304u
+
+// Most peers kept; the least recently updated one makes room for a new peer
+#define PEERPROFILE_MAX_ENTRIES 256
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t reserved;
+    uint64_t count;
+} PeerProfileFileHeader;
+
+/**
+ * @brief Numeric address of the peer of a socket, IPv4-mapped addresses in dotted form
+ */
+static int peer_address(SOCKET_T s, char *out, size_t out_size) {
+    struct sockaddr_storage addr;
+#ifdef _WIN32
+    int addr_len = sizeof(addr);
+#else
+    socklen_t addr_len = sizeof(addr);
+#endif
+    char host[INET6_ADDRSTRLEN];
+    if (getpeername(s, (struct sockaddr *)&addr, &addr_len) != 0 ||
+        getnameinfo((struct sockaddr *)&addr, addr_len, host, sizeof(host), NULL, 0, NI_NUMERICHOST) != 0) {
+        return -1;
+    }
+    const char *shown = strncmp(host, "::ffff:", 7) == 0 && strchr(host, '.') ? host + 7 : host;
+    snprintf(out, out_size, "%s", shown);
+    return 0;
+}
+
+/**
+ * @brief Smoothed round-trip time of a connection in microseconds, -1 if unknown
+ */
+static double connection_rtt_us(SOCKET_T s) {
+#ifdef __linux__
+    struct tcp_info info;
+    socklen_t len = sizeof(info);
+    if (getsockopt(s, IPPROTO_TCP, TCP_INFO, &info, &len) == 0 && info.tcpi_rtt > 0) {
+        return (double)info.tcpi_rtt;
+    }
+#else
+    (void)s;
+#endif
+    return -1;
+}
+
+/**
+ * @brief Size of a socket's send buffer in bytes, 0 if unknown
+ */
+static uint64_t send_buffer_size(SOCKET_T s) {
+    int size = 0;
+#ifdef _WIN32
+    int len = sizeof(size);
+    if (getsockopt(s, SOL_SOCKET, SO_SNDBUF, (char *)&size, &len) != 0) {
+#else
+    socklen_t len = sizeof(size);
+    if (getsockopt(s, SOL_SOCKET, SO_SNDBUF, &size, &len) != 0) {
+#endif
+        return 0;
+    }
+    return size > 0 ? (uint64_t)size : 0;
+}
+
+/**
+ * @brief Wait until everything written to a socket has been acknowledged
+ *
+ * @return 0 once the send queue is empty, -1 if it cannot be observed or did not drain in time
+ */
+static int wait_for_send_queue(SOCKET_T s) {
+#ifdef __linux__
+    double deadline = platform_monotonic_ns() / 1e6 + PEERPROFILE_DRAIN_TIMEOUT_MS;
+    while (1) {
+        int queued = 0;
+        if (ioctl(s, SIOCOUTQ, &queued) != 0) {
+            return -1;
+        }
+        if (queued == 0) {
+            return 0;
+        }
+        if (platform_monotonic_ns() / 1e6 >= deadline) {
+            return -1;
+        }
+        struct timespec pause = {0, 1000000};  // 1 ms
+        nanosleep(&pause, NULL);
+    }
+#else
+    (void)s;
+    return -1;
+#endif
+}
+
+/**
+ * @brief Load every profile
+ *
+ * @return Number of profiles (0 if there is no usable file)
+ */
+static int load_all(PeerProfile *profiles, int max_profiles) {
+    char path[4096];
+    if (platform_cache_path(PEERPROFILE_FILE_NAME, path, sizeof(path)) != 0) {
+        return 0;
+    }
+
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        return 0;  // No profiles yet
+    }
+
+    PeerProfileFileHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1 ||
+        memcmp(header.magic, PEERPROFILE_MAGIC, 4) != 0 ||
+        header.version != PEERPROFILE_VERSION ||
+        header.byte_order != PEERPROFILE_BYTE_ORDER) {
+        fclose(file);
+        return 0;  // Foreign or outdated file: treat as empty
+    }
+
+    int count = 0;
+    for (uint64_t i = 0; i < header.count && count < max_profiles; i++) {
+        if (fread(&profiles[count], sizeof(PeerProfile), 1, file) != 1) {
+            break;  // Truncated file: keep what was read
+        }
+        // Never trust strings read from disk to be terminated
+        profiles[count].peer[sizeof(profiles[count].peer) - 1] = '\0';
+        count++;
+    }
+
+    fclose(file);
+    return count;
+}
+
+/**
+ * @brief Weight of a profile of the given age
+ *
+ * Halves every half-life, linearly in between, so no math library is needed.
+ */
+double peerprofile_weight(int64_t age) {
+    if (age < 0) {
+        age = 0;  // Clock went back: treat as fresh
+    }
+    if (age >= PEERPROFILE_MAX_AGE) {
+        return 0.0;
+    }
+    double weight = 1.0;
+    while (age >= PEERPROFILE_HALF_LIFE) {
+        weight /= 2;
+        age -= PEERPROFILE_HALF_LIFE;
+    }
+    return weight * (1.0 - 0.5 * (double)age / PEERPROFILE_HALF_LIFE);
+}
+
+/**
+ * @brief Look up the profile of a peer
+ */
+int peerprofile_load(const char *peer, PeerProfile *profile) {
+    PeerProfile *profiles = malloc(PEERPROFILE_MAX_ENTRIES * sizeof(PeerProfile));
+    if (!profiles) {
+        perror("malloc");
+        return 0;
+    }
+
+    int found = 0;
+    int count = load_all(profiles, PEERPROFILE_MAX_ENTRIES);
+    for (int i = 0; i < count; i++) {
+        if (strcmp(profiles[i].peer, peer) == 0) {
+            *profile = profiles[i];
+            found = 1;
+            break;
+        }
+    }
+    free(profiles);
+    return found;
+}
+
+/**
+ * @brief Store the profile of a peer, replacing its old one
+ */
+int peerprofile_save(const PeerProfile *profile) {
+    char path[4096];
+    if (platform_cache_path(PEERPROFILE_FILE_NAME, path, sizeof(path)) != 0) {
+        return -1;
+    }
+
+    PeerProfile *profiles = malloc(PEERPROFILE_MAX_ENTRIES * sizeof(PeerProfile));
+    if (!profiles) {
+        perror("malloc");
+        return -1;
+    }
+    int count = load_all(profiles, PEERPROFILE_MAX_ENTRIES);
+
+    // Replace the peer's entry, or append, or evict the least recently updated peer
+    int slot = -1;
+    for (int i = 0; i < count; i++) {
+        if (strcmp(profiles[i].peer, profile->peer) == 0) {
+            slot = i;
+            break;
+        }
+    }
+    if (slot < 0 && count < PEERPROFILE_MAX_ENTRIES) {
+        slot = count++;
+    } else if (slot < 0) {
+        slot = 0;
+        for (int i = 1; i < count; i++) {
+            if (profiles[i].updated < profiles[slot].updated) {
+                slot = i;
+            }
+        }
+    }
+    profiles[slot] = *profile;
+
+    // Write to a private temporary file, then atomically replace the profiles
+    char tmp_path[4200];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp.%ld", path, (long)getpid());
+    FILE *file = fopen(tmp_path, "wb");
+    if (!file) {
+        perror("fopen");
+        free(profiles);
+        return -1;
+    }
+
+    PeerProfileFileHeader header;
+    memcpy(header.magic, PEERPROFILE_MAGIC, 4);
+    header.version = PEERPROFILE_VERSION;
+    header.byte_order = PEERPROFILE_BYTE_ORDER;
+    header.reserved = 0;
+    header.count = (uint64_t)count;
+
+    int ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+             fwrite(profiles, sizeof(PeerProfile), (size_t)count, file) == (size_t)count;
+    free(profiles);
+
+    if (fclose(file) != 0 || !ok) {
+        fprintf(stderr, "Error: Could not write peer profiles\n");
+        unlink(tmp_path);
+        return -1;
+    }
+    if (rename(tmp_path, path) != 0) {
+        perror("rename");
+        unlink(tmp_path);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Base-2 logarithm of a power of two
+ */
+static int log2_size(size_t size) {
+    int shift = 0;
+    while (((size_t)1 << (shift + 1)) <= size) {
+        shift++;
+    }
+    return shift;
+}
+
+/**
+ * @brief Start a transfer with a connected peer from its profile
+ */
+void peerprofile_begin(PeerTuning *tuning, SOCKET_T s) {
+    memset(tuning, 0, sizeof(*tuning));
+    if (peer_address(s, tuning->peer, sizeof(tuning->peer)) != 0) {
+        return;  // No address to key the profile on
+    }
+    tuning->active = 1;
+    tuning->start_ms = platform_monotonic_ns() / 1e6;
+
+    PeerProfile profile;
+    if (!peerprofile_load(tuning->peer, &profile)) {
+        return;
+    }
+    int64_t age = (int64_t)time(NULL) - profile.updated;
+    double weight = peerprofile_weight(age);
+    if (weight <= 0.0) {
+        return;
+    }
+
+    // Blend from the defaults towards the profile: chunk sizes by their
+    // logarithm, so the result stays a power of two
+    int from = log2_size(INITIAL_CHUNK_SIZE);
+    int to = log2_size(profile.chunk_size > 0 ? profile.chunk_size : INITIAL_CHUNK_SIZE);
+    int shift = from + (int)((to - from) * weight + (to > from ? 0.5 : -0.5));
+    size_t chunk_size = (size_t)1 << shift;
+    adaptive_set_initial_chunk_size(chunk_size);
+
+    // Buffers only grow: optimize_socket() has already set the minimum
+    int buffer = (int)(PEERPROFILE_MIN_BUFFER + (profile.socket_buffer - (double)PEERPROFILE_MIN_BUFFER) * weight);
+    if (buffer > PEERPROFILE_MIN_BUFFER) {
+#ifdef _WIN32
+        setsockopt(s, SOL_SOCKET, SO_SNDBUF, (char *)&buffer, sizeof(buffer));
+        setsockopt(s, SOL_SOCKET, SO_RCVBUF, (char *)&buffer, sizeof(buffer));
+#else
+        setsockopt(s, SOL_SOCKET, SO_SNDBUF, &buffer, sizeof(buffer));
+        setsockopt(s, SOL_SOCKET, SO_RCVBUF, &buffer, sizeof(buffer));
+#endif
+    } else {
+        buffer = PEERPROFILE_MIN_BUFFER;
+    }
+
+    char chunk_str[32], buffer_str[32];
+    adaptive_format_chunk_size(chunk_size, chunk_str, sizeof(chunk_str));
+    format_bytes((uint64_t)buffer, buffer_str, sizeof(buffer_str));
+    printf("Using tuning profile of %s from %lld s ago: %s chunks, %s socket buffers\n", tuning->peer,
+           (long long)(age > 0 ? age : 0), chunk_str, buffer_str);
+}
+
+/**
+ * @brief Finish a transfer and merge its measurements into the peer's profile
+ */
+void peerprofile_end(PeerTuning *tuning, SOCKET_T s, uint64_t bytes, int ok) {
+    adaptive_set_initial_chunk_size(0);
+    if (!tuning->active) {
+        return;
+    }
+    tuning->active = 0;
+
+    if (!ok || bytes < PEERPROFILE_MIN_BYTES) {
+        return;
+    }
+
+    // The protocols have no end-of-transfer acknowledgement: a sender is done
+    // once its last bytes are queued, possibly a whole socket buffer before
+    // the peer has them. Time the transfer when the queue has drained, and
+    // without that, never trust a transfer that fits in the buffer.
+    int drained = wait_for_send_queue(s) == 0;
+    double seconds = (platform_monotonic_ns() / 1e6 - tuning->start_ms) / 1000.0;
+    if (seconds <= 0 || (!drained && bytes <= send_buffer_size(s))) {
+        return;
+    }
+    double bandwidth = (double)bytes / seconds;
+    double rtt_us = connection_rtt_us(s);
+
+    // Merge into the old profile, which counts for at most half and less as it ages
+    PeerProfile profile;
+    int64_t now = (int64_t)time(NULL);
+    if (peerprofile_load(tuning->peer, &profile)) {
+        double keep = 0.5 * peerprofile_weight(now - profile.updated);
+        bandwidth = keep * profile.bandwidth + (1.0 - keep) * bandwidth;
+        if (rtt_us < 0) {
+            rtt_us = profile.rtt_us;
+        } else if (profile.rtt_us > 0) {
+            rtt_us = keep * profile.rtt_us + (1.0 - keep) * rtt_us;
+        }
+        profile.transfers++;
+    } else {
+        memset(&profile, 0, sizeof(profile));
+        snprintf(profile.peer, sizeof(profile.peer), "%s", tuning->peer);
+        profile.transfers = 1;
+    }
+    if (rtt_us < 0) {
+        rtt_us = 0;
+    }
+
+    profile.updated = now;
+    profile.bandwidth = bandwidth;
+    profile.rtt_us = rtt_us;
+    profile.chunk_size = (uint32_t)adaptive_policy_threshold(NULL, bandwidth);
+
+    // Twice the bandwidth-delay product keeps the pipe full through a loss
+    double buffer = 2.0 * bandwidth * rtt_us / 1e6;
+    if (buffer < PEERPROFILE_MIN_BUFFER) {
+        buffer = PEERPROFILE_MIN_BUFFER;
+    } else if (buffer > PEERPROFILE_MAX_BUFFER) {
+        buffer = PEERPROFILE_MAX_BUFFER;
+    }
+    profile.socket_buffer = (uint32_t)buffer;
+
+    peerprofile_save(&profile);
+}
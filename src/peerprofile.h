@@ -0,0 +1,123 @@
+/**
+ * @file peerprofile.h
+ * @brief Per-peer tuning profiles kept across runs
+ *
+ * Remembers, per peer address, what the last transfers learned about the
+ * link: the average bandwidth and round-trip time, the chunk size adaptive
+ * sizing settles on at that bandwidth and socket buffers sized to twice the
+ * bandwidth-delay product. The next transfer with that peer starts from
+ * these values instead of the defaults, so a fast or long link does not
+ * have to be relearned from 64 KB chunks and 1 MB buffers every run.
+ *
+ * Profiles decay: a profile's weight halves every PEERPROFILE_HALF_LIFE
+ * seconds, and the starting values are blended from the defaults towards
+ * the profile by that weight. Profiles older than PEERPROFILE_MAX_AGE are
+ * ignored. New measurements are merged into an old profile the same way,
+ * so one unusual transfer moves the profile only part of the way.
+ *
+ * Profiles live in the per-user cache directory (see platform_cache_path())
+ * and are rewritten atomically after each transfer long enough to measure.
+ */
+
+#ifndef PEERPROFILE_H
+#define PEERPROFILE_H
+
+#include "platform.h"  // SOCKET_T
+#include <stdint.h>
+
+// Name of the profile file inside the cache directory
+#define PEERPROFILE_FILE_NAME "peers.cache"
+
+// Seconds after which a profile counts half as much
+#define PEERPROFILE_HALF_LIFE (24 * 60 * 60)
+
+// Seconds after which a profile is ignored
+#define PEERPROFILE_MAX_AGE (7 * 24 * 60 * 60)
+
+// Smallest transfer measured into a profile (shorter ones are mostly setup)
+#define PEERPROFILE_MIN_BYTES (1024 * 1024)
+
+// Longest wait for the send queue to drain before a transfer is timed
+#define PEERPROFILE_DRAIN_TIMEOUT_MS 30000
+
+// Socket buffer bounds (the lower one is what optimize_socket() sets)
+#define PEERPROFILE_MIN_BUFFER (1024 * 1024)
+#define PEERPROFILE_MAX_BUFFER (16 * 1024 * 1024)
+
+/**
+ * @brief What the transfers with one peer have learned
+ */
+typedef struct {
+    char peer[64];            // Numeric peer address
+    int64_t updated;          // Time of the last merged transfer (seconds since the epoch)
+    uint32_t transfers;       // Transfers merged into the profile
+    uint32_t chunk_size;      // Chunk size adaptive sizing settles on at the bandwidth
+    uint32_t socket_buffer;   // Send and receive buffer size for the link
+    uint32_t reserved;
+    double bandwidth;         // Average throughput in bytes per second
+    double rtt_us;            // Smoothed round-trip time in microseconds, 0 if unknown
+} PeerProfile;
+
+/**
+ * @brief Profile use of one connection
+ */
+typedef struct {
+    int active;               // Started, and the transfer is measured at the end
+    char peer[64];            // Numeric peer address
+    double start_ms;          // Start of the transfer (monotonic)
+} PeerTuning;
+
+/**
+ * @brief Start a transfer with a connected peer from its profile
+ *
+ * Looks up the peer's profile and, if it is recent enough, raises the
+ * socket buffers and sets the initial chunk size of adaptive sizing (see
+ * adaptive_set_initial_chunk_size()) to the decayed profile values.
+ *
+ * @param tuning Profile use to start
+ * @param s Connected socket of the peer
+ */
+void peerprofile_begin(PeerTuning *tuning, SOCKET_T s);
+
+/**
+ * @brief Finish a transfer and merge its measurements into the peer's profile
+ *
+ * Restores the default initial chunk size. Failed transfers and transfers
+ * of fewer than PEERPROFILE_MIN_BYTES are not measured. The transfer is
+ * timed once everything sent on the socket has been acknowledged (waiting
+ * up to PEERPROFILE_DRAIN_TIMEOUT_MS); where that cannot be observed,
+ * transfers no larger than the send buffer are not measured either.
+ *
+ * @param tuning Profile use started by peerprofile_begin()
+ * @param s Socket of the transfer (for its round-trip time)
+ * @param bytes Bytes of file content transferred
+ * @param ok Nonzero if the transfer succeeded
+ */
+void peerprofile_end(PeerTuning *tuning, SOCKET_T s, uint64_t bytes, int ok);
+
+/**
+ * @brief Look up the profile of a peer
+ *
+ * @param peer Numeric peer address
+ * @param profile Output: the profile
+ * @return 1 if the peer has a profile, 0 otherwise
+ */
+int peerprofile_load(const char *peer, PeerProfile *profile);
+
+/**
+ * @brief Store the profile of a peer, replacing its old one
+ *
+ * @param profile Profile to store
+ * @return 0 on success, -1 on error
+ */
+int peerprofile_save(const PeerProfile *profile);
+
+/**
+ * @brief Weight of a profile of the given age
+ *
+ * @param age Seconds since the profile was updated
+ * @return 1 for a fresh profile, halving every PEERPROFILE_HALF_LIFE, 0 past PEERPROFILE_MAX_AGE
+ */
+double peerprofile_weight(int64_t age);
+
+#endif // PEERPROFILE_H
@@ -0,0 +1,177 @@
+/**
+ * @file perfcount.c
+ * @brief Hardware and kernel performance counters implementation
+ *
+ * Each counter is its own event rather than a group, so one missing
+ * hardware event does not take the others down, and so counts of threads
+ * inherited from the calling thread are folded in when they exit. Values
+ * are scaled by enabled over running time in case the kernel multiplexed a
+ * counter with other users of the PMU.
+ *
+ * Counts of exited threads are kept apart from the event's own count and
+ * survive PERF_EVENT_IOC_RESET, so a sample is the difference between a
+ * read at the start and one at the stop rather than a reset.
+ */
+
+#define _GNU_SOURCE  // Enable syscall() on Linux systems
+#include "perfcount.h"
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+static const char *counter_names[PERFCOUNT_COUNT] = {
+    "cycles", "instructions", "cache_misses", "context_switches", "page_faults"
+};
+
+#ifdef __linux__
+// Event type and configuration of each counter
+static const struct {
+    uint32_t type;
+    uint64_t config;
+} counter_events[PERFCOUNT_COUNT] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES},
+    {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS}
+};
+
+/**
+ * @brief Open one disabled counter of the calling process and its future threads
+ */
+static int open_counter(PerfCounter counter, int user_only) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = counter_events[counter].type;
+    attr.config = counter_events[counter].config;
+    attr.disabled = 1;
+    attr.inherit = 1;
+    attr.exclude_kernel = user_only;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC);
+}
+
+/**
+ * @brief Read value, time enabled and time running of a counter
+ */
+static int read_counter(int fd, uint64_t data[3]) {
+    return read(fd, data, 3 * sizeof(uint64_t)) == (ssize_t)(3 * sizeof(uint64_t)) ? 0 : -1;
+}
+#endif
+
+/**
+ * @brief Open the counters, disabled
+ */
+int perfcount_open(PerfCounters *counters) {
+    int available = 0;
+    counters->user_only = 0;
+    for (int c = 0; c < PERFCOUNT_COUNT; c++) {
+        counters->fds[c] = -1;
+    }
+#ifdef __linux__
+    for (int c = 0; c < PERFCOUNT_COUNT; c++) {
+        int fd = open_counter((PerfCounter)c, counters->user_only);
+        if (fd < 0 && (errno == EACCES || errno == EPERM) && !counters->user_only) {
+            // perf_event_paranoid forbids kernel events: count user space only, for all counters
+            for (int d = 0; d < c; d++) {
+                if (counters->fds[d] >= 0) {
+                    close(counters->fds[d]);
+                }
+                counters->fds[d] = -1;
+            }
+            counters->user_only = 1;
+            available = 0;
+            c = -1;
+            continue;
+        }
+        counters->fds[c] = fd;
+        if (fd >= 0) {
+            available++;
+        }
+    }
+#endif
+    return available;
+}
+
+/**
+ * @brief Start counting from the current values
+ */
+void perfcount_start(PerfCounters *counters) {
+#ifdef __linux__
+    for (int c = 0; c < PERFCOUNT_COUNT; c++) {
+        if (counters->fds[c] >= 0 && read_counter(counters->fds[c], counters->base[c]) != 0) {
+            memset(counters->base[c], 0, sizeof(counters->base[c]));
+        }
+    }
+    for (int c = 0; c < PERFCOUNT_COUNT; c++) {
+        if (counters->fds[c] >= 0) {
+            ioctl(counters->fds[c], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+#else
+    (void)counters;
+#endif
+}
+
+/**
+ * @brief Stop counting and read the counters
+ */
+void perfcount_stop(PerfCounters *counters, PerfSample *sample) {
+    memset(sample, 0, sizeof(*sample));
+#ifdef __linux__
+    for (int c = 0; c < PERFCOUNT_COUNT; c++) {
+        if (counters->fds[c] >= 0) {
+            ioctl(counters->fds[c], PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+    for (int c = 0; c < PERFCOUNT_COUNT; c++) {
+        uint64_t data[3];  // Value, time enabled, time running
+        if (counters->fds[c] < 0 || read_counter(counters->fds[c], data) != 0) {
+            continue;
+        }
+        for (int i = 0; i < 3; i++) {
+            data[i] -= counters->base[c][i];
+        }
+        if (data[2] == 0) {
+            // Never scheduled on the PMU: no measurement
+            if (data[1] > 0) {
+                continue;
+            }
+            sample->values[c] = 0;
+        } else if (data[2] < data[1]) {
+            sample->values[c] = (uint64_t)((double)data[0] * data[1] / data[2]);
+        } else {
+            sample->values[c] = data[0];
+        }
+        sample->valid[c] = 1;
+    }
+#else
+    (void)counters;
+#endif
+}
+
+/**
+ * @brief Close the counters
+ */
+void perfcount_close(PerfCounters *counters) {
+    for (int c = 0; c < PERFCOUNT_COUNT; c++) {
+        if (counters->fds[c] >= 0) {
+            close(counters->fds[c]);
+        }
+        counters->fds[c] = -1;
+    }
+}
+
+/**
+ * @brief Short name of a counter
+ */
+const char *perfcount_name(PerfCounter counter) {
+    return counter >= 0 && counter < PERFCOUNT_COUNT ? counter_names[counter] : "unknown";
+}
@@ -0,0 +1,94 @@
+/**
+ * @file perfcount.h
+ * @brief Hardware and kernel performance counters for NETTF benchmarks
+ *
+ * Samples cycles, instructions, cache misses, context switches and page
+ * faults of the whole process (every thread, including threads started
+ * while counting) through perf_event_open(), so the benchmark can show
+ * whether a change really removed copies or system calls.
+ *
+ * Counters the kernel refuses are left out rather than failing: virtual
+ * machines often expose no hardware counters, and with
+ * kernel.perf_event_paranoid at 2 or above only user-space events are
+ * counted (the counters are then marked user-only). On systems other than
+ * Linux no counter is available.
+ */
+
+#ifndef PERFCOUNT_H
+#define PERFCOUNT_H
+
+#include <stdint.h>
+
+/**
+ * @brief Counters sampled during a run
+ */
+typedef enum {
+    PERFCOUNT_CYCLES = 0,        // CPU cycles
+    PERFCOUNT_INSTRUCTIONS,      // Instructions retired
+    PERFCOUNT_CACHE_MISSES,      // Last-level cache misses
+    PERFCOUNT_CONTEXT_SWITCHES,  // Context switches
+    PERFCOUNT_PAGE_FAULTS,       // Page faults (minor and major)
+    PERFCOUNT_COUNT              // Number of counters
+} PerfCounter;
+
+/**
+ * @brief Open counters of the calling process
+ */
+typedef struct {
+    int fds[PERFCOUNT_COUNT];           // Counter descriptors, -1 if unavailable
+    uint64_t base[PERFCOUNT_COUNT][3];  // Value, time enabled and time running at the start
+    int user_only;                      // Kernel activity is excluded (paranoid setting)
+} PerfCounters;
+
+/**
+ * @brief Counter values of one sample
+ */
+typedef struct {
+    int valid[PERFCOUNT_COUNT];        // Nonzero if the counter was measured
+    uint64_t values[PERFCOUNT_COUNT];  // Counts, scaled if the counter was multiplexed
+} PerfSample;
+
+/**
+ * @brief Open the counters, disabled
+ *
+ * Call before starting the threads to be measured.
+ *
+ * @param counters Counters to open
+ * @return Number of counters available (0 if none)
+ */
+int perfcount_open(PerfCounters *counters);
+
+/**
+ * @brief Start counting from the current values
+ *
+ * @param counters Open counters
+ */
+void perfcount_start(PerfCounters *counters);
+
+/**
+ * @brief Stop counting and read the counters
+ *
+ * Threads started after perfcount_start() are included once they have been
+ * joined.
+ *
+ * @param counters Open counters
+ * @param sample Output: counter values
+ */
+void perfcount_stop(PerfCounters *counters, PerfSample *sample);
+
+/**
+ * @brief Close the counters
+ *
+ * @param counters Counters to close
+ */
+void perfcount_close(PerfCounters *counters);
+
+/**
+ * @brief Short name of a counter, e.g. "cycles"
+ *
+ * @param counter Counter
+ * @return Static name (also the JSON key of the counter)
+ */
+const char *perfcount_name(PerfCounter counter);
+
+#endif // PERFCOUNT_H
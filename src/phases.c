@@ -0,0 +1,305 @@
+/**
+ * @file phases.c
+ * @brief Per-phase latency tracing implementation
+ *
+ * Each histogram bucket covers 1/PHASES_SUB_BUCKETS of a power of two, so a
+ * recorded latency is known to within about 6% from 1 ns up to the largest
+ * 64-bit value, with a fixed number of counters and no allocation.
+ */
+
+#include "phases.h"
+#include "platform.h"  // platform_append()
+#include <string.h>
+
+// log2(PHASES_SUB_BUCKETS)
+#define PHASES_SUB_BUCKET_BITS 4
+
+// Buckets needed to cover every 64-bit value
+#define PHASES_BUCKETS ((64 - PHASES_SUB_BUCKET_BITS + 1) * PHASES_SUB_BUCKETS)
+
+// Sender and receiver may record from different threads of one process
+#define PHASES_ADD(var, value) __atomic_fetch_add(&(var), (value), __ATOMIC_RELAXED)
+
+/**
+ * @brief Latency record of one phase
+ */
+typedef struct {
+    uint64_t calls;                     // Operations recorded
+    uint64_t total_ns;                  // Time spent in them
+    uint64_t max_ns;                    // Slowest operation
+    uint64_t stalls;                    // Operations of at least PHASES_STALL_NS
+    uint64_t buckets[PHASES_BUCKETS];   // Log-linear latency histogram
+} PhaseRecord;
+
+/**
+ * @brief Kinds of work a transfer can be bound by
+ */
+typedef enum {
+    BOUND_DISK = 0,
+    BOUND_NETWORK,
+    BOUND_METADATA,
+    BOUND_COUNT
+} Bound;
+
+static const char *phase_names[PHASE_COUNT] = {
+    "disk_read", "disk_write", "net_send", "net_recv", "open", "mkdir"
+};
+static const char *phase_labels[PHASE_COUNT] = {
+    "disk read", "disk write", "net send", "net recv", "open", "mkdir"
+};
+static const Bound phase_bounds[PHASE_COUNT] = {
+    BOUND_DISK, BOUND_DISK, BOUND_NETWORK, BOUND_NETWORK, BOUND_METADATA, BOUND_METADATA
+};
+static const char *bound_names[BOUND_COUNT] = {"disk", "network", "metadata"};
+
+static int enabled;
+static PhaseRecord records[PHASE_COUNT];
+
+/**
+ * @brief Histogram bucket of a latency
+ */
+static int bucket_index(uint64_t ns) {
+    if (ns < PHASES_SUB_BUCKETS) {
+        return (int)ns;
+    }
+    int msb = 63 - __builtin_clzll(ns);
+    int shift = msb - PHASES_SUB_BUCKET_BITS;
+    return (shift + 1) * PHASES_SUB_BUCKETS + (int)((ns >> shift) - PHASES_SUB_BUCKETS);
+}
+
+/**
+ * @brief Representative latency of a bucket (its midpoint)
+ */
+static uint64_t bucket_value(int index) {
+    if (index < PHASES_SUB_BUCKETS) {
+        return (uint64_t)index;
+    }
+    int shift = index / PHASES_SUB_BUCKETS - 1;
+    uint64_t low = (uint64_t)(index % PHASES_SUB_BUCKETS + PHASES_SUB_BUCKETS) << shift;
+    return low + ((1ULL << shift) >> 1);
+}
+
+/**
+ * @brief Latency at a quantile of a phase
+ */
+static uint64_t percentile(const PhaseRecord *record, double quantile) {
+    if (record->calls == 0) {
+        return 0;
+    }
+    // Smallest count covering the quantile (rounded up)
+    uint64_t target = (uint64_t)(quantile * (double)record->calls);
+    if ((double)target < quantile * (double)record->calls || target < 1) {
+        target++;
+    }
+    uint64_t seen = 0;
+    for (int i = 0; i < PHASES_BUCKETS; i++) {
+        seen += record->buckets[i];
+        if (seen >= target) {
+            uint64_t value = bucket_value(i);
+            return value < record->max_ns ? value : record->max_ns;
+        }
+    }
+    return record->max_ns;
+}
+
+/**
+ * @brief Time spent in each kind of work, returning the largest
+ */
+static Bound bound_totals(uint64_t totals[BOUND_COUNT], uint64_t *traced) {
+    memset(totals, 0, sizeof(uint64_t) * BOUND_COUNT);
+    *traced = 0;
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        totals[phase_bounds[p]] += records[p].total_ns;
+        *traced += records[p].total_ns;
+    }
+    Bound largest = BOUND_DISK;
+    for (int b = 1; b < BOUND_COUNT; b++) {
+        if (totals[b] > totals[largest]) {
+            largest = (Bound)b;
+        }
+    }
+    return largest;
+}
+
+/**
+ * @brief Format a latency for display
+ */
+static void format_ns(uint64_t ns, char *buffer, size_t buffer_size) {
+    if (ns < 1000) {
+        snprintf(buffer, buffer_size, "%llu ns", (unsigned long long)ns);
+    } else if (ns < 1000000) {
+        snprintf(buffer, buffer_size, "%.1f us", ns / 1e3);
+    } else if (ns < 1000000000) {
+        snprintf(buffer, buffer_size, "%.1f ms", ns / 1e6);
+    } else {
+        snprintf(buffer, buffer_size, "%.2f s", ns / 1e9);
+    }
+}
+
+/**
+ * @brief Enable phase tracing for this process
+ */
+void phases_enable(void) {
+    enabled = 1;
+}
+
+/**
+ * @brief Whether phase tracing is enabled
+ */
+int phases_enabled(void) {
+    return enabled;
+}
+
+/**
+ * @brief Clear all phases for a new transfer
+ */
+void phases_reset(void) {
+    if (enabled) {
+        memset(records, 0, sizeof(records));
+    }
+}
+
+/**
+ * @brief Timestamp for phase timing
+ */
+uint64_t phases_clock(void) {
+    if (!enabled) {
+        return 0;
+    }
+    return platform_monotonic_ns();
+}
+
+/**
+ * @brief Record an operation that started at start and ends now
+ */
+uint64_t phases_record(Phase phase, uint64_t start) {
+    if (!enabled) {
+        return 0;
+    }
+    uint64_t end = phases_clock();
+    phases_record_span(phase, start, end);
+    return end;
+}
+
+/**
+ * @brief Record an operation timed by the caller
+ */
+void phases_record_span(Phase phase, uint64_t start, uint64_t end) {
+    if (!enabled) {
+        return;
+    }
+    uint64_t ns = end > start ? end - start : 0;
+
+    PhaseRecord *record = &records[phase];
+    PHASES_ADD(record->calls, 1);
+    PHASES_ADD(record->total_ns, ns);
+    uint64_t max = __atomic_load_n(&record->max_ns, __ATOMIC_RELAXED);
+    while (ns > max && !__atomic_compare_exchange_n(&record->max_ns, &max, ns, 1,
+                                                    __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        // max now holds the latest value; retry while ns is still larger
+    }
+    if (ns >= PHASES_STALL_NS) {
+        PHASES_ADD(record->stalls, 1);
+    }
+    PHASES_ADD(record->buckets[bucket_index(ns)], 1);
+}
+
+/**
+ * @brief Operations recorded in a phase since the last reset
+ */
+uint64_t phases_calls(Phase phase) {
+    return __atomic_load_n(&records[phase].calls, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief fopen() timed as PHASE_OPEN
+ */
+FILE *phases_fopen(const char *path, const char *mode) {
+    uint64_t start = phases_clock();
+    FILE *file = fopen(path, mode);
+    if (file) {
+        phases_record(PHASE_OPEN, start);
+    }
+    return file;
+}
+
+/**
+ * @brief Print the phase breakdown of the transfer
+ */
+void phases_print(double duration) {
+    if (!enabled) {
+        return;
+    }
+
+    printf("\nPhase breakdown (%.2f s):\n", duration);
+    printf("  %-10s %10s %10s %6s %9s %9s %9s %6s\n",
+           "Phase", "Calls", "Total", "Share", "p50", "p99", "Max", "Stalls");
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        const PhaseRecord *record = &records[p];
+        if (record->calls == 0) {
+            continue;
+        }
+        char total_str[16], p50_str[16], p99_str[16], max_str[16];
+        format_ns(record->total_ns, total_str, sizeof(total_str));
+        format_ns(percentile(record, 0.50), p50_str, sizeof(p50_str));
+        format_ns(percentile(record, 0.99), p99_str, sizeof(p99_str));
+        format_ns(record->max_ns, max_str, sizeof(max_str));
+        double share = duration > 0 ? record->total_ns / 1e9 / duration * 100.0 : 0;
+        printf("  %-10s %10llu %10s %5.1f%% %9s %9s %9s %6llu\n", phase_labels[p],
+               (unsigned long long)record->calls, total_str, share, p50_str, p99_str, max_str,
+               (unsigned long long)record->stalls);
+    }
+
+    uint64_t totals[BOUND_COUNT], traced;
+    Bound bound = bound_totals(totals, &traced);
+    if (traced == 0) {
+        return;
+    }
+    printf("Transfer was %s-bound (", bound_names[bound]);
+    for (int b = 0; b < BOUND_COUNT; b++) {
+        printf("%s%s %.0f%%", b > 0 ? ", " : "", bound_names[b], (double)totals[b] / traced * 100.0);
+    }
+    printf(" of traced time)\n");
+}
+
+/**
+ * @brief Format the phase breakdown as JSON object members
+ */
+size_t phases_format_json(char *buf, size_t size, double duration) {
+    size_t len = 0;
+    if (size == 0) {
+        return 0;
+    }
+    buf[0] = '\0';
+
+    platform_append(buf, size, &len, "\"phases\":{");
+    int first = 1;
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        const PhaseRecord *record = &records[p];
+        if (record->calls == 0) {
+            continue;
+        }
+        platform_append(buf, size, &len,
+                        "%s\"%s\":{\"calls\":%llu,\"total\":%.6f,\"share\":%.4f,\"p50_us\":%.3f,\"p90_us\":%.3f,"
+                        "\"p99_us\":%.3f,\"max_us\":%.3f,\"stalls\":%llu}",
+                        first ? "" : ",", phase_names[p], (unsigned long long)record->calls, record->total_ns / 1e9,
+                        duration > 0 ? record->total_ns / 1e9 / duration : 0.0, percentile(record, 0.50) / 1e3,
+                        percentile(record, 0.90) / 1e3, percentile(record, 0.99) / 1e3, record->max_ns / 1e3,
+                        (unsigned long long)record->stalls);
+        first = 0;
+    }
+    platform_append(buf, size, &len, "}");
+
+    uint64_t totals[BOUND_COUNT], traced;
+    Bound bound = bound_totals(totals, &traced);
+    if (traced == 0) {
+        platform_append(buf, size, &len, ",\"bound\":null");
+        return len;
+    }
+    platform_append(buf, size, &len, ",\"bound\":\"%s-bound\",\"bound_shares\":{", bound_names[bound]);
+    for (int b = 0; b < BOUND_COUNT; b++) {
+        platform_append(buf, size, &len, "%s\"%s\":%.4f", b > 0 ? "," : "", bound_names[b], (double)totals[b] / traced);
+    }
+    platform_append(buf, size, &len, "}");
+    return len;
+}
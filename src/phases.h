@@ -0,0 +1,134 @@
+/**
+ * @file phases.h
+ * @brief Per-phase latency tracing for NETTF transfers
+ *
+ * Times the operations a transfer is made of (disk reads and writes, network
+ * sends and receives, file opens, directory creation) and keeps an HDR-style
+ * log-linear latency histogram per phase. At the end of a transfer the
+ * phases are reported with call counts, total time, percentiles and stalls,
+ * and the transfer is attributed to the kind of work that took the most
+ * time: disk-bound, network-bound or metadata-bound.
+ *
+ * Tracing is off until phases_enable() is called; until then phases_clock()
+ * returns 0 without reading the clock and phases_record() returns at once.
+ * Recording is lock-free and safe from several threads at once (the
+ * benchmark runs sender and receiver in one process); reset and report only
+ * while no transfer is running.
+ */
+
+#ifndef PHASES_H
+#define PHASES_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Sub-buckets per power of two in the histograms (about 6% precision)
+#define PHASES_SUB_BUCKETS 16
+
+// An operation at least this slow counts as a stall
+#define PHASES_STALL_NS (50ULL * 1000 * 1000)
+
+/**
+ * @brief Phases of a transfer
+ */
+typedef enum {
+    PHASE_DISK_READ = 0,  // Reading file content (fread, pread)
+    PHASE_DISK_WRITE,     // Writing file content (fwrite)
+    PHASE_NET_SEND,       // Sending to the peer (send_all)
+    PHASE_NET_RECV,       // Waiting for data from the peer (recv_all, recv)
+    PHASE_OPEN,           // Opening or creating files (fopen)
+    PHASE_MKDIR,          // Creating directories (create_directory_recursive)
+    PHASE_COUNT           // Number of phases
+} Phase;
+
+/**
+ * @brief Enable phase tracing for this process
+ */
+void phases_enable(void);
+
+/**
+ * @brief Whether phase tracing is enabled
+ *
+ * @return Nonzero if phases are traced
+ */
+int phases_enabled(void);
+
+/**
+ * @brief Clear all phases for a new transfer
+ */
+void phases_reset(void);
+
+/**
+ * @brief Timestamp for phase timing
+ *
+ * @return Nanoseconds since an arbitrary point, 0 when tracing is disabled
+ */
+uint64_t phases_clock(void);
+
+/**
+ * @brief Record an operation that started at start and ends now
+ *
+ * Returns the end time so consecutive phases can be chained without
+ * reading the clock twice:
+ *   uint64_t t = phases_clock();
+ *   recv_all(...);
+ *   t = phases_record(PHASE_NET_RECV, t);
+ *   fwrite(...);
+ *   phases_record(PHASE_DISK_WRITE, t);
+ *
+ * @param phase Phase the operation belongs to
+ * @param start phases_clock() before the operation
+ * @return phases_clock() after the operation, 0 when tracing is disabled
+ */
+uint64_t phases_record(Phase phase, uint64_t start);
+
+/**
+ * @brief Record an operation timed by the caller
+ *
+ * For loops that read the clock once for several consumers (metrics,
+ * feedback) instead of once each.
+ *
+ * @param phase Phase the operation belongs to
+ * @param start Monotonic time before the operation (platform_monotonic_ns())
+ * @param end Monotonic time after the operation
+ */
+void phases_record_span(Phase phase, uint64_t start, uint64_t end);
+
+/**
+ * @brief Operations recorded in a phase since the last reset
+ *
+ * @param phase Phase to query
+ * @return Number of operations recorded
+ */
+uint64_t phases_calls(Phase phase);
+
+/**
+ * @brief fopen() timed as PHASE_OPEN
+ *
+ * @param path File to open
+ * @param mode fopen() mode
+ * @return Open file, NULL on error (errno set by fopen)
+ */
+FILE *phases_fopen(const char *path, const char *mode);
+
+/**
+ * @brief Print the phase breakdown of the transfer
+ *
+ * @param duration Wall-clock duration of the transfer in seconds
+ */
+void phases_print(double duration);
+
+/**
+ * @brief Format the phase breakdown as JSON object members
+ *
+ * Writes "phases":{...},"bound":"..." (without surrounding braces).
+ *
+ * @param buf Output buffer
+ * @param size Size of the output buffer
+ * @param duration Wall-clock duration of the transfer in seconds
+ * @return Length written (truncated to fit)
+ */
+size_t phases_format_json(char *buf, size_t size, double duration);
+
+#endif // PHASES_H
@@ -7,7 +7,15 @@
  * operating systems.
  */
 
+#define _GNU_SOURCE  // Enable clock_gettime() on Linux systems
 #include "platform.h"
+#include <errno.h>
+#include <stdarg.h>
+#include <time.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>  // _mkdir()
+#endif
 
 // Platform-specific implementations for htonll/ntohll
 // Only needed on Windows and systems that don't provide them
@@ -154,4 +162,99 @@ void optimize_socket(SOCKET_T s) {
     setsockopt(s, SOL_SOCKET, SO_RCVBUF, &sock_buf_size, sizeof(sock_buf_size));
     setsockopt(s, SOL_SOCKET, SO_SNDBUF, &sock_buf_size, sizeof(sock_buf_size));
 #endif
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Monotonic clock in nanoseconds
+ *
+ * The one clock every duration, deadline and rate in nettf is measured
+ * with. It never jumps with wall-clock adjustments; only differences
+ * between two readings are meaningful.
+ *
+ * @return Nanoseconds since an arbitrary point
+ */
+uint64_t platform_monotonic_ns(void) {
+#ifdef _WIN32
+    return (uint64_t)GetTickCount64() * 1000000ULL;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+/**
+ * @brief Append formatted text to a buffer, truncating at its end
+ *
+ * Used to build JSON events, metrics responses and reports piece by piece
+ * without checking every call: once the buffer is full, further text is
+ * dropped and *len stays below size, so buf remains terminated.
+ *
+ * @param buf Buffer being built
+ * @param size Size of buf
+ * @param len Input/output: length of the text in buf
+ * @param format printf-style format
+ */
+void platform_append(char *buf, size_t size, size_t *len, const char *format, ...) {
+    if (*len >= size) {
+        return;
+    }
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(buf + *len, size - *len, format, args);
+    va_end(args);
+    if (n > 0) {
+        *len += (size_t)n < size - *len ? (size_t)n : size - *len - 1;
+    }
+}
+
+/**
+ * @brief Build the path of a file in the per-user nettf cache directory
+ *
+ * Uses $XDG_CACHE_HOME/nettf, falling back to $HOME/.cache/nettf
+ * (%LOCALAPPDATA%\\nettf on Windows). The directory is created if needed.
+ *
+ * @param name File name inside the cache directory
+ * @param out Output buffer for the full path
+ * @param out_size Size of output buffer
+ * @return 0 on success, -1 if no cache directory is available
+ */
+int platform_cache_path(const char *name, char *out, size_t out_size) {
+    char dir[4096];
+
+#ifdef _WIN32
+    const char *base = getenv("LOCALAPPDATA");
+    if (!base || base[0] == '\0') {
+        return -1;
+    }
+    snprintf(dir, sizeof(dir), "%s\\nettf", base);
+    if (_mkdir(dir) != 0 && errno != EEXIST) {
+        return -1;
+    }
+    snprintf(out, out_size, "%s\\%s", dir, name);
+#else
+    const char *xdg = getenv("XDG_CACHE_HOME");
+    if (xdg && xdg[0] == '/') {
+        snprintf(dir, sizeof(dir), "%s", xdg);
+    } else {
+        const char *home = getenv("HOME");
+        if (!home || home[0] == '\0') {
+            return -1;
+        }
+        snprintf(dir, sizeof(dir), "%s/.cache", home);
+    }
+
+    // Create <base> and <base>/nettf (like mkdir -p for the last two levels)
+    if (mkdir(dir, 0700) != 0 && errno != EEXIST) {
+        return -1;
+    }
+    size_t len = strlen(dir);
+    snprintf(dir + len, sizeof(dir) - len, "/nettf");
+    if (mkdir(dir, 0700) != 0 && errno != EEXIST) {
+        return -1;
+    }
+    snprintf(out, out_size, "%s/%s", dir, name);
+#endif
+
+    return 0;
+}
@@ -28,6 +28,7 @@
     #include <netinet/in.h>   // Internet address structures
     #include <netinet/tcp.h>  // TCP-specific options (TCP_NODELAY)
     #include <arpa/inet.h>    // IP address manipulation functions
+    #include <netdb.h>        // Name resolution (getaddrinfo, getnameinfo)
     #include <unistd.h>       // Unix standard functions (close)
 
     // Type aliases to normalize POSIX socket types
@@ -38,6 +39,7 @@
 #endif
 
 // Standard C library headers needed by all platforms
+#include <stdint.h>     // Fixed-width integer types (uint64_t)
 #include <stdio.h>      // Input/output functions (printf, perror, etc.)
 #include <stdlib.h>     // Memory allocation, exit, etc.
 #include <string.h>     // String manipulation functions
@@ -61,4 +63,13 @@ void net_cleanup(void);   // Clean up network subsystem (WSACleanup on Windows)
 void close_socket(SOCKET_T s);  // Close socket platform-independently
 void optimize_socket(SOCKET_T s);  // Optimize socket for high-speed transfers
 
+// Monotonic clock in nanoseconds (only differences between readings are meaningful)
+uint64_t platform_monotonic_ns(void);
+
+// Append printf-style text at buf + *len, advancing *len and truncating at the end of buf
+void platform_append(char *buf, size_t size, size_t *len, const char *format, ...);
+
+// Per-user cache directory ($XDG_CACHE_HOME/nettf or ~/.cache/nettf), created on demand
+int platform_cache_path(const char *name, char *out, size_t out_size);
+
 #endif // PLATFORM_H
\ No newline at end of file
@@ -0,0 +1,31 @@
+/**
+ * @file probes.c
+ * @brief USDT probe semaphores and clock
+ *
+ * Tracers find each semaphore through the probe's ELF note and increment it
+ * while attached; the .probes section is where sys/sdt.h expects them.
+ */
+
+#include "probes.h"
+#include "platform.h"  // platform_monotonic_ns()
+
+#ifdef NETTF_HAVE_PROBES
+
+#define PROBE_DEFINE_SEMAPHORE(name) \
+    unsigned short PROBE_SEMAPHORE(name) __attribute__((section(".probes"), used)) = 0
+
+PROBE_DEFINE_SEMAPHORE(send);
+PROBE_DEFINE_SEMAPHORE(recv);
+PROBE_DEFINE_SEMAPHORE(adaptive);
+PROBE_DEFINE_SEMAPHORE(file__begin);
+PROBE_DEFINE_SEMAPHORE(file__end);
+PROBE_DEFINE_SEMAPHORE(accept);
+
+/**
+ * @brief Monotonic clock for probe durations
+ */
+uint64_t probes_clock(void) {
+    return platform_monotonic_ns();
+}
+
+#endif // NETTF_HAVE_PROBES
@@ -0,0 +1,91 @@
+/**
+ * @file probes.h
+ * @brief USDT static tracepoints for NETTF
+ *
+ * Static probes in the protocol hot paths for bpftrace, perf and SystemTap.
+ * When <sys/sdt.h> is available (systemtap-sdt-dev / systemtap-sdt-devel on
+ * Linux), each probe compiles to a single nop plus an ELF note; a tracer
+ * attaching to it patches the nop and sets the probe's semaphore. Durations
+ * are only measured while the semaphore is set, so a probe nobody traces
+ * costs one predictable branch; an operation already running when the
+ * tracer attaches reports a duration of 0. Without <sys/sdt.h>, or when built with
+ * -DNETTF_NO_PROBES, every macro compiles to nothing.
+ *
+ * Probes (provider "nettf"):
+ *   send(fd, bytes, ns)                       send_all() finished
+ *   recv(fd, bytes, ns)                       recv_all() finished
+ *   adaptive(bytes, elapsed_us, old, new)     adaptive_update() ran (chunk sizes)
+ *   file__begin(path, size)                   A directory entry starts
+ *   file__end(path, size, ns)                 A directory entry finished
+ *   accept(fd, peer, wait_ns)                 receive_file() accepted a connection
+ *
+ * Example:
+ *   bpftrace -e 'usdt:./nettf:nettf:recv { @us = hist(arg2 / 1000); }'
+ *   perf probe -x ./nettf sdt_nettf:send && perf record -e sdt_nettf:send -ag
+ */
+
+#ifndef PROBES_H
+#define PROBES_H
+
+#include <stdint.h>
+
+#if defined(__linux__) && !defined(NETTF_NO_PROBES) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#define NETTF_HAVE_PROBES 1
+#endif
+#endif
+
+#ifdef NETTF_HAVE_PROBES
+
+// Semaphores let the code ask whether a tracer is attached
+#define _SDT_HAS_SEMAPHORES 1
+#include <sys/sdt.h>
+
+#define PROBE_SEMAPHORE(name) nettf_##name##_semaphore
+
+extern unsigned short PROBE_SEMAPHORE(send);
+extern unsigned short PROBE_SEMAPHORE(recv);
+extern unsigned short PROBE_SEMAPHORE(adaptive);
+extern unsigned short PROBE_SEMAPHORE(file__begin);
+extern unsigned short PROBE_SEMAPHORE(file__end);
+extern unsigned short PROBE_SEMAPHORE(accept);
+
+// Nonzero while a tracer is attached to the probe
+#define PROBE_ACTIVE(name) __builtin_expect(PROBE_SEMAPHORE(name) != 0, 0)
+
+// Start time for a probe's duration argument (0 while nobody traces it)
+#define PROBE_START(name) (PROBE_ACTIVE(name) ? probes_clock() : 0)
+
+// Nanoseconds since a PROBE_START() time, 0 if the tracer attached after it
+// (a 0 start would report the raw clock as the duration)
+#define PROBE_ELAPSED(start) ((start) ? probes_clock() - (start) : 0)
+
+// Fire a probe; the arguments are only evaluated while it is traced
+#define PROBE2(name, a, b) \
+    do { if (PROBE_ACTIVE(name)) STAP_PROBE2(nettf, name, a, b); } while (0)
+#define PROBE3(name, a, b, c) \
+    do { if (PROBE_ACTIVE(name)) STAP_PROBE3(nettf, name, a, b, c); } while (0)
+#define PROBE4(name, a, b, c, d) \
+    do { if (PROBE_ACTIVE(name)) STAP_PROBE4(nettf, name, a, b, c, d); } while (0)
+
+/**
+ * @brief Monotonic clock for probe durations
+ *
+ * @return Nanoseconds since an arbitrary point
+ */
+uint64_t probes_clock(void);
+
+#else
+
+// Arguments only appear under sizeof: never evaluated, but not unused either
+#define PROBE_ACTIVE(name) 0
+#define PROBE_START(name) ((uint64_t)0)
+#define PROBE_ELAPSED(start) (start)
+#define PROBE2(name, a, b) do { (void)sizeof(a); (void)sizeof(b); } while (0)
+#define PROBE3(name, a, b, c) do { (void)sizeof(a); (void)sizeof(b); (void)sizeof(c); } while (0)
+#define PROBE4(name, a, b, c, d) \
+    do { (void)sizeof(a); (void)sizeof(b); (void)sizeof(c); (void)sizeof(d); } while (0)
+
+#endif // NETTF_HAVE_PROBES
+
+#endif // PROBES_H
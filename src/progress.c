@@ -0,0 +1,477 @@
+/**
+ * @file progress.c
+ * @brief Transfer progress reporting implementation
+ *
+ * A process runs one transfer at a time (the sender sends one tree, the
+ * receiver handles one connection after another), so the state of the
+ * current transfer is kept in a single static structure. The data path
+ * updates its counters with relaxed atomic adds; the ticker thread reads
+ * them every PROGRESS_TICK_MS and does all clock reads and output. Each JSON
+ * event is formatted into a buffer and written with one write() call, so a
+ * reader never sees half a line.
+ */
+
+#define _GNU_SOURCE  // Enable clock_gettime(), dup() and struct tcp_info on Linux systems
+#include "progress.h"
+#include "protocol.h"  // format_bytes(), format_speed(), format_time()
+#include "platform.h"  // platform_append()
+#include "adaptive.h"  // adaptive_format_chunk_size()
+#include "signals.h"   // Ctrl+C handling during transfers
+#include "phases.h"    // Per-phase latency tracing
+#include "chunktrace.h" // Per-chunk traces (--trace-file)
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <time.h>
+
+// Relaxed atomics: counters shared between the data path and the ticker
+#define PROGRESS_ADD(var, value) __atomic_fetch_add(&(var), (value), __ATOMIC_RELAXED)
+#define PROGRESS_LOAD(var) __atomic_load_n(&(var), __ATOMIC_RELAXED)
+#define PROGRESS_STORE(var, value) __atomic_store_n(&(var), (value), __ATOMIC_RELAXED)
+
+// Largest event line (the summary carries the chunk size history)
+#define PROGRESS_EVENT_SIZE (16 * 1024)
+
+/**
+ * @brief A change of chunk size during the transfer
+ */
+typedef struct {
+    double at;        // Seconds since the start of the transfer
+    uint64_t offset;  // Bytes transferred before the change
+    size_t size;      // New chunk size
+} ChunkChange;
+
+/**
+ * @brief State of the current transfer
+ */
+typedef struct {
+    // Updated by the data path, read by the ticker (atomic)
+    uint64_t bytes;              // Bytes of file content transferred
+    uint64_t total_bytes;        // Expected bytes (0 if unknown)
+    uint64_t files;              // Files transferred completely
+    uint64_t total_files;        // Expected files (0 if unknown)
+    uint64_t chunk_size;         // Chunk size in effect
+    int show_line;               // Draw the terminal progress line
+
+    // Owned by the data path
+    int active;                  // A transfer is being tracked
+    const char *direction;       // "send" or "receive"
+    char name[1024];             // What is being transferred, or the peer
+    size_t last_chunk_size;      // Chunk size of the previous chunk
+    ChunkChange history[PROGRESS_MAX_CHUNK_HISTORY];
+    int history_count;
+
+    // Owned by the ticker while it runs
+    double start_ms;             // Start time (monotonic)
+    double last_event_ms;        // Time of the last progress line or event
+    uint64_t last_event_bytes;   // Bytes at the last progress line or event
+    double peak_speed;           // Fastest interval so far (bytes per second)
+    int prompted;                // Shutdown prompt already shown
+} ProgressState;
+
+static ProgressOptions progress_options = {0, -1, PROGRESS_DEFAULT_INTERVAL_MS, 0, NULL};
+static int json_fd = -1;
+static ProgressState transfer;
+
+// Ticker thread and the clock it samples for the data path
+static pthread_t ticker;
+static pthread_mutex_t ticker_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t ticker_wake = PTHREAD_COND_INITIALIZER;
+static int ticker_stop;
+static int ticker_running;        // Atomic: clock_seconds and clock_ms are current
+static int64_t clock_seconds;     // Atomic: time(NULL) at the last tick
+static int64_t clock_ms;          // Atomic: monotonic milliseconds at the last tick
+
+// Serializes the terminal line between the ticker and progress_file_done()
+static pthread_mutex_t line_lock = PTHREAD_MUTEX_INITIALIZER;
+static int line_drawn;
+
+/**
+ * @brief Append a string as a JSON string literal
+ */
+static void append_json_string(char *buf, size_t size, size_t *len, const char *text) {
+    platform_append(buf, size, len, "\"");
+    for (const unsigned char *p = (const unsigned char *)text; *p; p++) {
+        if (*p == '"' || *p == '\\') {
+            platform_append(buf, size, len, "\\%c", *p);
+        } else if (*p < 0x20) {
+            platform_append(buf, size, len, "\\u%04x", *p);
+        } else {
+            platform_append(buf, size, len, "%c", *p);
+        }
+    }
+    platform_append(buf, size, len, "\"");
+}
+
+/**
+ * @brief Write a finished event line to the JSON descriptor
+ */
+static void emit(char *buf, size_t len) {
+    buf[len++] = '\n';  // Callers leave room for the newline
+    size_t written = 0;
+    while (written < len) {
+        ssize_t n = write(json_fd, buf + written, len - written);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return;  // Reader went away: progress is best effort
+        }
+        written += (size_t)n;
+    }
+}
+
+/**
+ * @brief Total retransmitted segments of a TCP connection
+ *
+ * @return Retransmit count, -1 if the system does not report it
+ */
+static long long tcp_retransmits(SOCKET_T s) {
+#ifdef __linux__
+    struct tcp_info info;
+    socklen_t len = sizeof(info);
+    if (getsockopt(s, IPPROTO_TCP, TCP_INFO, &info, &len) == 0) {
+        return (long long)info.tcpi_total_retrans;
+    }
+#else
+    (void)s;
+#endif
+    return -1;
+}
+
+/**
+ * @brief Configure progress output for this process
+ */
+int progress_init(const ProgressOptions *options) {
+    progress_options = *options;
+    if (progress_options.interval_ms <= 0) {
+        progress_options.interval_ms = PROGRESS_DEFAULT_INTERVAL_MS;
+    }
+    if (progress_options.phases) {
+        phases_enable();
+    }
+    if (progress_options.trace_path && chunktrace_open(progress_options.trace_path) != 0) {
+        return -1;
+    }
+    if (!progress_options.json) {
+        return 0;
+    }
+
+    if (progress_options.fd >= 0) {
+        if (fcntl(progress_options.fd, F_GETFD) < 0) {
+            fprintf(stderr, "Error: Progress descriptor %d is not open\n", progress_options.fd);
+            return -1;
+        }
+        json_fd = progress_options.fd;
+        return 0;
+    }
+
+    // Keep the real stdout for events and send everything else to stderr
+    fflush(stdout);
+    json_fd = dup(STDOUT_FILENO);
+    if (json_fd < 0 || dup2(STDERR_FILENO, STDOUT_FILENO) < 0) {
+        perror("dup");
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Current time as sampled by the ticker
+ */
+time_t progress_time(void) {
+    if (PROGRESS_LOAD(ticker_running)) {
+        return (time_t)PROGRESS_LOAD(clock_seconds);
+    }
+    return time(NULL);
+}
+
+/**
+ * @brief Sample the clocks for the data path
+ */
+static void sample_clock(double now) {
+    PROGRESS_STORE(clock_ms, (int64_t)now);
+    PROGRESS_STORE(clock_seconds, (int64_t)time(NULL));
+}
+
+/**
+ * @brief Speed since the last progress line or event, tracking the peak
+ */
+static double interval_speed(double now, uint64_t bytes) {
+    double interval = (now - transfer.last_event_ms) / 1000.0;
+    double speed = interval > 0 ? (double)(bytes - transfer.last_event_bytes) / interval : 0;
+    if (speed > transfer.peak_speed) {
+        transfer.peak_speed = speed;
+    }
+    return speed;
+}
+
+/**
+ * @brief Draw the terminal progress line
+ */
+static void draw_line(double now) {
+    uint64_t bytes = PROGRESS_LOAD(transfer.bytes);
+    uint64_t total = PROGRESS_LOAD(transfer.total_bytes);
+    double elapsed_seconds = (now - transfer.start_ms) / 1000.0;
+    double speed = elapsed_seconds > 0 ? (double)bytes / elapsed_seconds : 0;
+
+    // Calculate estimated time remaining
+    int eta_seconds = 0;
+    if (speed > 0 && bytes < total) {
+        eta_seconds = (int)((double)(total - bytes) / speed);
+    }
+
+    // Format all display components
+    char total_str[32], done_str[32], speed_str[32], chunk_str[32], eta_str[32], elapsed_str[32];
+    format_bytes(total, total_str, sizeof(total_str));
+    format_bytes(bytes, done_str, sizeof(done_str));
+    format_speed(speed, speed_str, sizeof(speed_str));
+    adaptive_format_chunk_size((size_t)PROGRESS_LOAD(transfer.chunk_size), chunk_str, sizeof(chunk_str));
+    format_time(eta_seconds, eta_str, sizeof(eta_str));
+    format_time((int)elapsed_seconds, elapsed_str, sizeof(elapsed_str));
+
+    pthread_mutex_lock(&line_lock);
+    printf("\r\033[K");  // Clear current line
+    printf("Progress: %.2f%% | %s/%s | Speed: %s | Chunk: %s | Elapsed: %s | ETA: %s",
+           total > 0 ? (double)bytes / total * 100 : 100.0,
+           done_str, total_str, speed_str, chunk_str, elapsed_str, eta_str);
+    fflush(stdout);
+    line_drawn = 1;
+    pthread_mutex_unlock(&line_lock);
+}
+
+/**
+ * @brief Emit a progress event
+ */
+static void emit_progress(double now, uint64_t bytes, double speed) {
+    char buf[PROGRESS_EVENT_SIZE];
+    size_t len = 0;
+    platform_append(buf, sizeof(buf) - 1, &len,
+                    "{\"event\":\"progress\",\"direction\":\"%s\",\"bytes\":%llu,\"total_bytes\":%llu,"
+                    "\"files\":%llu,\"total_files\":%llu,\"elapsed\":%.3f,\"speed\":%.0f,\"chunk_size\":%lu}",
+                    transfer.direction, (unsigned long long)bytes,
+                    (unsigned long long)PROGRESS_LOAD(transfer.total_bytes),
+                    (unsigned long long)PROGRESS_LOAD(transfer.files),
+                    (unsigned long long)PROGRESS_LOAD(transfer.total_files),
+                    (now - transfer.start_ms) / 1000.0, speed, (unsigned long)PROGRESS_LOAD(transfer.chunk_size));
+    emit(buf, len);
+}
+
+/**
+ * @brief Answer Ctrl+C while a transfer runs
+ */
+static void check_shutdown(void) {
+    int shutdown = signals_should_shutdown();
+    if (shutdown == 1 && !transfer.prompted) {
+        printf("\nShutdown requested. Press Ctrl+C again to force exit...\n");
+        fflush(stdout);
+        signals_acknowledge_shutdown();
+        transfer.prompted = 1;
+    } else if (shutdown == 2) {
+        printf("\nForced exit! Transfer may be incomplete.\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+/**
+ * @brief Ticker thread: sample the clock, report progress, answer Ctrl+C
+ */
+static void *ticker_thread(void *arg) {
+    (void)arg;
+    int tick_ms = progress_options.interval_ms < PROGRESS_TICK_MS ? progress_options.interval_ms
+                                                                  : PROGRESS_TICK_MS;
+
+    pthread_mutex_lock(&ticker_lock);
+    while (!ticker_stop) {
+        // Sleep one tick, waking early when the transfer ends
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += (long)tick_ms * 1000000L;
+        deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+        deadline.tv_nsec %= 1000000000L;
+        pthread_cond_timedwait(&ticker_wake, &ticker_lock, &deadline);
+        if (ticker_stop) {
+            break;
+        }
+        pthread_mutex_unlock(&ticker_lock);
+
+        double now = platform_monotonic_ns() / 1e6;
+        sample_clock(now);
+        check_shutdown();
+
+        if (now - transfer.last_event_ms >= progress_options.interval_ms) {
+            uint64_t bytes = PROGRESS_LOAD(transfer.bytes);
+            double speed = interval_speed(now, bytes);
+            if (progress_options.json) {
+                emit_progress(now, bytes, speed);
+            } else if (PROGRESS_LOAD(transfer.show_line)) {
+                draw_line(now);
+            }
+            transfer.last_event_ms = now;
+            transfer.last_event_bytes = bytes;
+        }
+
+        pthread_mutex_lock(&ticker_lock);
+    }
+    pthread_mutex_unlock(&ticker_lock);
+    return NULL;
+}
+
+/**
+ * @brief Start tracking a transfer, start the ticker and emit the start event
+ */
+void progress_begin(const char *direction, const char *name) {
+    memset(&transfer, 0, sizeof(transfer));
+    transfer.active = 1;
+    transfer.direction = direction;
+    snprintf(transfer.name, sizeof(transfer.name), "%s", name);
+    transfer.start_ms = platform_monotonic_ns() / 1e6;
+    transfer.last_event_ms = transfer.start_ms;
+    line_drawn = 0;
+    phases_reset();
+
+    if (progress_options.json) {
+        struct timespec wall;
+        clock_gettime(CLOCK_REALTIME, &wall);
+
+        char buf[PROGRESS_EVENT_SIZE];
+        size_t len = 0;
+        platform_append(buf, sizeof(buf) - 1, &len, "{\"event\":\"start\",\"direction\":\"%s\",\"name\":", direction);
+        append_json_string(buf, sizeof(buf) - 1, &len, transfer.name);
+        platform_append(buf, sizeof(buf) - 1, &len, ",\"time\":%.3f}", wall.tv_sec + wall.tv_nsec / 1e9);
+        emit(buf, len);
+    }
+
+    // The loops read the sampled clock from now on
+    sample_clock(transfer.start_ms);
+    ticker_stop = 0;
+    if (pthread_create(&ticker, NULL, ticker_thread, NULL) != 0) {
+        fprintf(stderr, "Warning: Cannot start progress thread, progress is not shown\n");
+        return;
+    }
+    PROGRESS_STORE(ticker_running, 1);
+}
+
+/**
+ * @brief Draw the terminal progress line for the current transfer
+ */
+void progress_show_line(void) {
+    if (!progress_options.json) {
+        PROGRESS_STORE(transfer.show_line, 1);
+    }
+}
+
+/**
+ * @brief Set the expected size of the transfer once it is known
+ */
+void progress_set_total(uint64_t total_bytes, uint64_t total_files) {
+    PROGRESS_STORE(transfer.total_bytes, total_bytes);
+    PROGRESS_STORE(transfer.total_files, total_files);
+}
+
+/**
+ * @brief Bytes of file content transferred so far in the current or last transfer
+ */
+uint64_t progress_bytes(void) {
+    return PROGRESS_LOAD(transfer.bytes);
+}
+
+/**
+ * @brief Account one chunk
+ */
+void progress_chunk(uint64_t bytes, size_t chunk_size) {
+    if (!transfer.active) {
+        return;
+    }
+
+    // Chunk size changes are rare; record them with the ticker's clock
+    if (chunk_size != transfer.last_chunk_size) {
+        transfer.last_chunk_size = chunk_size;
+        PROGRESS_STORE(transfer.chunk_size, (uint64_t)chunk_size);
+        if (transfer.history_count < PROGRESS_MAX_CHUNK_HISTORY) {
+            ChunkChange *change = &transfer.history[transfer.history_count++];
+            change->at = ((double)PROGRESS_LOAD(clock_ms) - transfer.start_ms) / 1000.0;
+            if (change->at < 0) {
+                change->at = 0;
+            }
+            change->offset = PROGRESS_LOAD(transfer.bytes);
+            change->size = chunk_size;
+        }
+    }
+    PROGRESS_ADD(transfer.bytes, bytes);
+}
+
+/**
+ * @brief Count a file transferred completely
+ */
+void progress_file_done(void) {
+    PROGRESS_ADD(transfer.files, 1);
+    if (PROGRESS_LOAD(transfer.show_line)) {
+        draw_line(platform_monotonic_ns() / 1e6);  // Show the final state before the completion message
+    }
+}
+
+/**
+ * @brief Finish the transfer, stop the ticker and emit the summary event
+ */
+void progress_end(SOCKET_T s, int ok) {
+    if (!transfer.active) {
+        return;
+    }
+    transfer.active = 0;
+
+    if (PROGRESS_LOAD(ticker_running)) {
+        pthread_mutex_lock(&ticker_lock);
+        ticker_stop = 1;
+        pthread_cond_signal(&ticker_wake);
+        pthread_mutex_unlock(&ticker_lock);
+        pthread_join(ticker, NULL);
+        PROGRESS_STORE(ticker_running, 0);
+    }
+
+    double now = platform_monotonic_ns() / 1e6;
+    double duration = (now - transfer.start_ms) / 1000.0;
+    if (!progress_options.json) {
+        phases_print(duration);
+        return;
+    }
+
+    uint64_t bytes = PROGRESS_LOAD(transfer.bytes);
+    double avg_speed = duration > 0 ? (double)bytes / duration : 0;
+    interval_speed(now, bytes);  // A transfer shorter than one interval still has a peak
+
+    char buf[PROGRESS_EVENT_SIZE];
+    size_t len = 0;
+    platform_append(buf, sizeof(buf) - 1, &len, "{\"event\":\"summary\",\"direction\":\"%s\",\"name\":",
+                    transfer.direction);
+    append_json_string(buf, sizeof(buf) - 1, &len, transfer.name);
+    platform_append(buf, sizeof(buf) - 1, &len,
+                    ",\"ok\":%s,\"bytes\":%llu,\"total_bytes\":%llu,\"files\":%llu,\"total_files\":%llu,"
+                    "\"duration\":%.3f,\"avg_speed\":%.0f,\"peak_speed\":%.0f,",
+                    ok ? "true" : "false", (unsigned long long)bytes, (unsigned long long)transfer.total_bytes,
+                    (unsigned long long)transfer.files, (unsigned long long)transfer.total_files,
+                    duration, avg_speed, transfer.peak_speed);
+
+    long long retransmits = tcp_retransmits(s);
+    if (retransmits >= 0) {
+        platform_append(buf, sizeof(buf) - 1, &len, "\"retransmits\":%lld,", retransmits);
+    } else {
+        platform_append(buf, sizeof(buf) - 1, &len, "\"retransmits\":null,");
+    }
+
+    platform_append(buf, sizeof(buf) - 1, &len, "\"chunk_sizes\":[");
+    for (int i = 0; i < transfer.history_count; i++) {
+        platform_append(buf, sizeof(buf) - 1, &len, "%s{\"at\":%.3f,\"offset\":%llu,\"size\":%lu}", i > 0 ? "," : "",
+                        transfer.history[i].at, (unsigned long long)transfer.history[i].offset,
+                        (unsigned long)transfer.history[i].size);
+    }
+    platform_append(buf, sizeof(buf) - 1, &len, "]");
+
+    if (phases_enabled()) {
+        char phases_json[4096];
+        phases_format_json(phases_json, sizeof(phases_json), duration);
+        platform_append(buf, sizeof(buf) - 1, &len, ",%s", phases_json);
+    }
+    platform_append(buf, sizeof(buf) - 1, &len, "}");
+    emit(buf, len);
+}
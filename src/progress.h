@@ -0,0 +1,136 @@
+/**
+ * @file progress.h
+ * @brief Transfer progress reporting for NETTF
+ *
+ * The transfer loops only add to counters; a ticker thread started by
+ * progress_begin() samples them, draws the terminal progress line or emits
+ * JSON events, and answers Ctrl+C. It also samples the clock, so the loops
+ * read the time with progress_time() instead of calling into the system.
+ *
+ * With JSON progress enabled, a transfer emits newline-delimited JSON events
+ * instead of the terminal progress line: a "start" event, "progress" events
+ * at most every interval, and a final "summary" event with bytes, files,
+ * duration, average and peak speed, the history of chunk sizes chosen by
+ * adaptive sizing and the TCP retransmit count.
+ *
+ * Events go to standard output (the human-readable messages then move to
+ * standard error, so stdout carries only JSON) or to a given descriptor.
+ *
+ * Event examples (one object per line):
+ *   {"event":"start","direction":"send","name":"disk.img","time":1700000000.123}
+ *   {"event":"progress","direction":"send","bytes":1048576,"total_bytes":4194304,
+ *    "files":0,"total_files":1,"elapsed":0.5,"speed":2097152,"chunk_size":65536}
+ *   {"event":"summary","direction":"send","name":"disk.img","ok":true,"bytes":4194304,
+ *    "total_bytes":4194304,"files":1,"total_files":1,"duration":2.01,"avg_speed":2086718,
+ *    "peak_speed":2500000,"retransmits":0,"chunk_sizes":[{"at":0,"offset":0,"size":65536}]}
+ *
+ * With phase tracing enabled, the summary (terminal or JSON) also carries
+ * the per-phase latency breakdown described in phases.h.
+ */
+
+#ifndef PROGRESS_H
+#define PROGRESS_H
+
+#include "platform.h"  // SOCKET_T
+#include <stdint.h>
+#include <time.h>
+
+// Default time between progress events
+#define PROGRESS_DEFAULT_INTERVAL_MS 1000
+
+// Resolution of the ticker clock (and its longest sleep)
+#define PROGRESS_TICK_MS 100
+
+// Chunk size changes kept for the summary
+#define PROGRESS_MAX_CHUNK_HISTORY 64
+
+/**
+ * @brief Progress output selected on the command line
+ */
+typedef struct {
+    int json;         // Emit JSON events instead of the terminal progress line
+    int fd;           // Descriptor for JSON events, -1 for standard output
+    int interval_ms;  // Time between progress lines or events
+    int phases;       // Trace per-phase latencies and report them in the summary
+    const char *trace_path;  // Record a per-chunk trace to this file (see chunktrace.h), NULL for none
+} ProgressOptions;
+
+/**
+ * @brief Configure progress output for this process
+ *
+ * When JSON events go to standard output, the original stdout is kept for
+ * them and stdout is pointed at stderr for everything else. With a trace
+ * path, the chunk trace is created here.
+ *
+ * @param options Progress options
+ * @return 0 on success, -1 on error
+ */
+int progress_init(const ProgressOptions *options);
+
+/**
+ * @brief Start tracking a transfer, start the ticker and emit the start event
+ *
+ * @param direction "send" or "receive"
+ * @param name File, directory or peer the transfer is about
+ */
+void progress_begin(const char *direction, const char *name);
+
+/**
+ * @brief Draw the terminal progress line for the current transfer
+ *
+ * Single-file protocols call this; directory protocols print a line per
+ * file instead. Has no effect with JSON progress.
+ */
+void progress_show_line(void);
+
+/**
+ * @brief Current time as sampled by the ticker
+ *
+ * Lags the system clock by at most PROGRESS_TICK_MS. Outside a transfer
+ * (no ticker running) the system clock is read.
+ *
+ * @return Seconds since the epoch, like time(NULL)
+ */
+time_t progress_time(void);
+
+/**
+ * @brief Set the expected size of the transfer once it is known
+ *
+ * @param total_bytes Bytes the transfer covers
+ * @param total_files Files the transfer covers
+ */
+void progress_set_total(uint64_t total_bytes, uint64_t total_files);
+
+/**
+ * @brief Account one chunk
+ *
+ * Called on the data path: only counter updates, no clock reads or output.
+ *
+ * @param bytes Bytes of file content covered by the chunk
+ * @param chunk_size Chunk size adaptive sizing chose for the next chunk
+ */
+void progress_chunk(uint64_t bytes, size_t chunk_size);
+
+/**
+ * @brief Bytes of file content transferred so far in the current or last transfer
+ *
+ * @return Bytes accounted by progress_chunk()
+ */
+uint64_t progress_bytes(void);
+
+/**
+ * @brief Count a file transferred completely
+ *
+ * Draws the final state of the terminal progress line if it is shown.
+ */
+void progress_file_done(void);
+
+/**
+ * @brief Finish the transfer, stop the ticker and emit the summary event
+ *
+ * @param s Socket of the transfer (for the retransmit count)
+ * @param ok Nonzero if the transfer succeeded
+ */
+void progress_end(SOCKET_T s, int ok);
+
+#endif // PROGRESS_H
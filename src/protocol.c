@@ -11,7 +11,11 @@
 #define _GNU_SOURCE  // Enable strdup() on Linux systems
 #include "protocol.h"
 #include "adaptive.h"    // Adaptive chunk sizing
-#include "signals.h"     // Signal handling
+#include "metrics.h"     // Receiver metrics
+#include "progress.h"    // JSON progress events
+#include "phases.h"      // Per-phase latency tracing
+#include "probes.h"      // USDT static tracepoints
+#include "feedback.h"    // Receiver feedback frames
 #include <errno.h>  // For error codes (perror functionality)
 #include <dirent.h> // For directory operations
 #include <string.h> // For string manipulation functions
@@ -19,27 +23,6 @@
 // Maximum chunk size for buffer allocation (from adaptive.h)
 #define MAX_CHUNK_BUFFER_SIZE (2 * 1024 * 1024)  // 2 MB
 
-// Define htonll/ntohll for systems that don't have them (like Linux)
-#ifndef htonll
-static inline uint64_t htonll(uint64_t value) {
-    #if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
-        return ((uint64_t)htonl(value & 0xFFFFFFFF) << 32) | htonl(value >> 32);
-    #else
-        return value;
-    #endif
-}
-#endif
-
-#ifndef ntohll
-static inline uint64_t ntohll(uint64_t value) {
-    #if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
-        return ((uint64_t)ntohl(value & 0xFFFFFFFF) << 32) | ntohl(value >> 32);
-    #else
-        return value;
-    #endif
-}
-#endif
-
 /**
  * @brief Send all bytes from a buffer, handling partial sends
  *
@@ -55,6 +38,8 @@ static inline uint64_t ntohll(uint64_t value) {
 int send_all(SOCKET_T s, const void *data, size_t len) {
     const char *ptr = (const char *)data;  // Cast to char pointer for byte-level operations
     size_t total_sent = 0;                 // Track total bytes sent so far
+    uint64_t phase_start = phases_clock();
+    uint64_t probe_start = PROBE_START(send);
 
     // Keep sending until all bytes have been transmitted
     while (total_sent < len) {
@@ -73,6 +58,8 @@ int send_all(SOCKET_T s, const void *data, size_t len) {
 
         total_sent += sent;  // Update progress counter
     }
+    phases_record(PHASE_NET_SEND, phase_start);
+    PROBE3(send, (int)s, len, PROBE_ELAPSED(probe_start));
     return 0;  // Success: all bytes sent
 }
 
@@ -91,6 +78,8 @@ int send_all(SOCKET_T s, const void *data, size_t len) {
 int recv_all(SOCKET_T s, void *buf, size_t len) {
     char *ptr = (char *)buf;           // Cast to char pointer for byte-level operations
     size_t total_received = 0;         // Track total bytes received so far
+    uint64_t phase_start = phases_clock();
+    uint64_t probe_start = PROBE_START(recv);
 
     // Keep receiving until all expected bytes have arrived
     while (total_received < len) {
@@ -99,16 +88,20 @@ int recv_all(SOCKET_T s, void *buf, size_t len) {
 
         if (received == SOCKET_ERROR) {
             perror("recv");  // Print system error message
+            metrics_error(METRICS_ERROR_NETWORK);
             return -1;       // Return error indicator
         }
 
         if (received == 0) {
             fprintf(stderr, "Connection closed by peer\n");
+            metrics_error(METRICS_ERROR_NETWORK);
             return -1;       // Return error if connection closed unexpectedly
         }
 
         total_received += received;  // Update progress counter
     }
+    phases_record(PHASE_NET_RECV, phase_start);
+    PROBE3(recv, (int)s, len, PROBE_ELAPSED(probe_start));
     return 0;  // Success: all bytes received
 }
 
@@ -131,7 +124,7 @@ int recv_all(SOCKET_T s, void *buf, size_t len) {
 void send_file_protocol(SOCKET_T s, const char *filepath) {
 
     // Open file in binary read mode - "rb" is critical for preserving file integrity
-    FILE *file = fopen(filepath, "rb");
+    FILE *file = phases_fopen(filepath, "rb");
     if (!file) {
         perror("fopen");      // Print system error for file open failure
         exit(EXIT_FAILURE);   // Terminate program on critical error
@@ -167,6 +160,7 @@ void send_file_protocol(SOCKET_T s, const char *filepath) {
     // Initialize adaptive chunk sizing
     AdaptiveState adaptive;
     adaptive_init(&adaptive, file_size);
+    progress_set_total(file_size, 1);
 
     // Prepare protocol header with network byte order conversion
     FileHeader header;
@@ -202,17 +196,17 @@ void send_file_protocol(SOCKET_T s, const char *filepath) {
     }
 
     size_t bytes_read;              // Number of bytes read from file
-    uint64_t total_sent = 0;        // Track total progress
 
-    // Time tracking for transfer speed calculation
-    time_t start_time = time(NULL);
-    time_t last_update = start_time;
-    time_t chunk_start = start_time;
+    // The progress ticker draws the progress line and samples the clock
+    progress_show_line();
+    time_t chunk_start = progress_time();
 
     // Read and send file in chunks until EOF
     size_t chunk_size = adaptive_get_chunk_size(&adaptive);
+    uint64_t read_start = phases_clock();
     while ((bytes_read = fread(buffer, 1, chunk_size, file)) > 0) {
-        time_t chunk_end = time(NULL);
+        phases_record(PHASE_DISK_READ, read_start);
+        time_t chunk_end = progress_time();
         double chunk_elapsed = difftime(chunk_end, chunk_start);
         chunk_start = chunk_end;
 
@@ -222,60 +216,13 @@ void send_file_protocol(SOCKET_T s, const char *filepath) {
             exit(EXIT_FAILURE);
         }
 
-        // Update adaptive state
+        // Update progress counters and adaptive state
+        progress_chunk(bytes_read, chunk_size);
         adaptive_update(&adaptive, bytes_read, chunk_elapsed);
 
-        total_sent += bytes_read;   // Update progress counter
-
-        // Check for shutdown signal
-        int shutdown = signals_should_shutdown();
-        if (shutdown == 1) {
-            printf("\nShutdown requested. Press Ctrl+C again to force exit...\n");
-            signals_acknowledge_shutdown();
-        } else if (shutdown == 2) {
-            printf("\nForced exit! File may be incomplete.\n");
-            free(buffer);
-            fclose(file);
-            exit(EXIT_FAILURE);
-        }
-
-        // Update progress display every second
-        time_t current_time = time(NULL);
-        if (current_time != last_update || total_sent == file_size) {
-            double elapsed_seconds = difftime(current_time, start_time);
-            double speed = elapsed_seconds > 0 ? (double)total_sent / elapsed_seconds : 0;
-
-            // Get current chunk size for display
-            chunk_size = adaptive_get_chunk_size(&adaptive);
-            char chunk_str[32];
-            adaptive_format_chunk_size(chunk_size, chunk_str, sizeof(chunk_str));
-
-            // Calculate estimated time remaining
-            int eta_seconds = 0;
-            if (speed > 0 && total_sent < file_size) {
-                eta_seconds = (int)((double)(file_size - total_sent) / speed);
-            }
-
-            // Format all display components
-            char total_str[32], sent_str[32], speed_str[32], eta_str[32], elapsed_str[32];
-            format_bytes(file_size, total_str, sizeof(total_str));
-            format_bytes(total_sent, sent_str, sizeof(sent_str));
-            format_speed(speed, speed_str, sizeof(speed_str));
-            format_time(eta_seconds, eta_str, sizeof(eta_str));
-            format_time((int)elapsed_seconds, elapsed_str, sizeof(elapsed_str));
-
-            // Display comprehensive progress information
-            printf("\r\033[K");  // Clear current line
-            printf("Progress: %.2f%% | %s/%s | Speed: %s | Chunk: %s | Elapsed: %s | ETA: %s",
-                   (double)total_sent / file_size * 100,
-                   sent_str, total_str, speed_str, chunk_str, elapsed_str, eta_str);
-            fflush(stdout);
-
-            last_update = current_time;
-        }
-
         // Get next chunk size (may have changed)
         chunk_size = adaptive_get_chunk_size(&adaptive);
+        read_start = phases_clock();
     }
 
     // Check for file read errors (distinguish from EOF)
@@ -288,6 +235,7 @@ void send_file_protocol(SOCKET_T s, const char *filepath) {
 
     free(buffer);
     fclose(file);  // Clean up file handle
+    progress_file_done();
     printf("\nFile sent successfully!\n");  // Success message on new line
 }
 
@@ -334,6 +282,7 @@ int recv_file_protocol(SOCKET_T s) {
 
     // Display file information
     printf("Receiving file: %s (%llu bytes)\n", filename, (unsigned long long)file_size);
+    progress_set_total(file_size, 1);
 
     // Initialize adaptive chunk sizing
     AdaptiveState adaptive;
@@ -341,9 +290,10 @@ int recv_file_protocol(SOCKET_T s) {
 
     // Step 4: Create file locally in binary write mode
     // File will be created in current working directory
-    FILE *file = fopen(filename, "wb");
+    FILE *file = phases_fopen(filename, "wb");
     if (!file) {
         perror("fopen");     // Print file creation error
+        metrics_error(METRICS_ERROR_DISK);
         free(filename);      // Clean up memory on error
         return -1;
     }
@@ -359,10 +309,12 @@ int recv_file_protocol(SOCKET_T s) {
 
     uint64_t total_received = 0;  // Track progress
 
-    // Time tracking for transfer speed calculation
-    time_t start_time = time(NULL);
-    time_t last_update = start_time;
-    time_t chunk_start = start_time;
+    // The progress ticker draws the progress line and samples the clock
+    progress_show_line();
+    time_t chunk_start = progress_time();
+
+    // One clock read on each side of a write serves metrics and phase tracing
+    int timed = metrics_enabled() || phases_enabled();
 
     // Keep receiving until all file bytes have been received
     while (total_received < file_size) {
@@ -374,6 +326,7 @@ int recv_file_protocol(SOCKET_T s) {
         }
 
         // Receive chunk data from network
+        uint64_t recv_start = timed ? platform_monotonic_ns() : 0;
         if (recv_all(s, buffer, to_receive) != 0) {
             fclose(file);      // Clean up file handle
             free(buffer);
@@ -381,77 +334,37 @@ int recv_file_protocol(SOCKET_T s) {
             return -1;
         }
 
-        time_t chunk_end = time(NULL);
+        time_t chunk_end = progress_time();
         double chunk_elapsed = difftime(chunk_end, chunk_start);
         chunk_start = chunk_end;
 
         // Write received data to file
+        uint64_t write_start = timed ? platform_monotonic_ns() : 0;
         if (fwrite(buffer, 1, to_receive, file) != to_receive) {
             perror("fwrite");  // Print file write error
+            metrics_error(METRICS_ERROR_DISK);
             fclose(file);      // Clean up file handle
             free(buffer);
             free(filename);    // Clean up memory
             return -1;
         }
+        uint64_t write_end = timed ? platform_monotonic_ns() : 0;
+        phases_record_span(PHASE_DISK_WRITE, write_start, write_end);
+        metrics_chunk(to_receive, recv_start, write_start, write_end);
 
-        // Update adaptive state
+        // Update progress counters and adaptive state
+        progress_chunk(to_receive, chunk_size);
         adaptive_update(&adaptive, to_receive, chunk_elapsed);
 
         total_received += to_receive;  // Update progress counter
-
-        // Check for shutdown signal
-        int shutdown = signals_should_shutdown();
-        if (shutdown == 1) {
-            printf("\nShutdown requested. Press Ctrl+C again to force exit...\n");
-            signals_acknowledge_shutdown();
-        } else if (shutdown == 2) {
-            printf("\nForced exit! File may be incomplete.\n");
-            fclose(file);
-            free(buffer);
-            free(filename);
-            exit(EXIT_FAILURE);
-        }
-
-        // Update progress display every second
-        time_t current_time = time(NULL);
-        if (current_time != last_update || total_received == file_size) {
-            double elapsed_seconds = difftime(current_time, start_time);
-            double speed = elapsed_seconds > 0 ? (double)total_received / elapsed_seconds : 0;
-
-            // Get current chunk size for display
-            chunk_size = adaptive_get_chunk_size(&adaptive);
-            char chunk_str[32];
-            adaptive_format_chunk_size(chunk_size, chunk_str, sizeof(chunk_str));
-
-            // Calculate estimated time remaining
-            int eta_seconds = 0;
-            if (speed > 0 && total_received < file_size) {
-                eta_seconds = (int)((double)(file_size - total_received) / speed);
-            }
-
-            // Format all display components
-            char total_str[32], received_str[32], speed_str[32], eta_str[32], elapsed_str[32];
-            format_bytes(file_size, total_str, sizeof(total_str));
-            format_bytes(total_received, received_str, sizeof(received_str));
-            format_speed(speed, speed_str, sizeof(speed_str));
-            format_time(eta_seconds, eta_str, sizeof(eta_str));
-            format_time((int)elapsed_seconds, elapsed_str, sizeof(elapsed_str));
-
-            // Display comprehensive progress information
-            printf("\r\033[K");  // Clear current line
-            printf("Progress: %.2f%% | %s/%s | Speed: %s | Chunk: %s | Elapsed: %s | ETA: %s",
-                   (double)total_received / file_size * 100,
-                   received_str, total_str, speed_str, chunk_str, elapsed_str, eta_str);
-            fflush(stdout);
-
-            last_update = current_time;
-        }
     }
 
     // Step 6: Clean up resources
     fclose(file);       // Close file handle
     free(buffer);
     free(filename);     // Free allocated memory
+    metrics_file_received();
+    progress_file_done();
     printf("\nFile received successfully!\n");  // Success message on new line
 
     return 0;  // Success
@@ -516,19 +429,183 @@ void format_time(int seconds, char *buffer, size_t buffer_size) {
     }
 }
 
+/**
+ * @brief Start a session for a transfer
+ */
+int transfer_session_init(TransferSession *session, uint64_t total_bytes) {
+    adaptive_init(&session->adaptive, total_bytes);
+    session->files = 0;
+    session->feedback = NULL;
+    session->buffer = malloc(MAX_CHUNK_BUFFER_SIZE);
+    if (!session->buffer) {
+        perror("malloc");
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Release the buffer of a session
+ */
+void transfer_session_free(TransferSession *session) {
+    free(session->buffer);
+    session->buffer = NULL;
+}
+
+/**
+ * @brief Mark the start of the next file's content in a session
+ */
+void transfer_session_next_file(TransferSession *session, uint64_t file_bytes) {
+    if (session->files++ > 0) {
+        adaptive_next_file(&session->adaptive, file_bytes);
+    }
+}
+
+/**
+ * @brief Send exactly file_size bytes of an open file
+ */
+int send_file_content(SOCKET_T s, FILE *file, uint64_t file_size, TransferSession *session) {
+    // Without a transfer session, this file gets one of its own
+    TransferSession own_session;
+    if (!session) {
+        if (transfer_session_init(&own_session, file_size) != 0) {
+            return -1;
+        }
+    }
+    TransferSession *active = session ? session : &own_session;
+    AdaptiveState *adaptive = &active->adaptive;
+    char *buffer = active->buffer;
+    int result = 0;
+
+    uint64_t total_sent = 0;
+    size_t chunk_size = adaptive_get_chunk_size(adaptive);
+    time_t chunk_start = progress_time();
+
+    while (total_sent < file_size) {
+        size_t to_read = file_size - total_sent;
+        if (to_read > chunk_size) {
+            to_read = chunk_size;
+        }
+
+        uint64_t read_start = phases_clock();
+        size_t bytes_read = fread(buffer, 1, to_read, file);
+        if (bytes_read == 0) {
+            if (ferror(file)) {
+                perror("fread");
+            } else {
+                fprintf(stderr, "Error: File shrank while it was being sent\n");
+            }
+            result = -1;
+            break;
+        }
+        phases_record(PHASE_DISK_READ, read_start);
+
+        time_t chunk_end = progress_time();
+        double chunk_elapsed = difftime(chunk_end, chunk_start);
+        chunk_start = chunk_end;
+
+        if (send_all(s, buffer, bytes_read) != 0) {
+            result = -1;
+            break;
+        }
+
+        progress_chunk(bytes_read, chunk_size);
+        if (active->feedback) {
+            feedback_sender_poll(active->feedback, adaptive);
+        }
+        adaptive_update(adaptive, bytes_read, chunk_elapsed);
+        chunk_size = adaptive_get_chunk_size(adaptive);
+        total_sent += bytes_read;
+    }
+
+    if (!session) {
+        transfer_session_free(&own_session);
+    }
+    return result;
+}
+
+/**
+ * @brief Receive exactly file_size bytes into an open file
+ */
+int recv_file_content(SOCKET_T s, FILE *file, uint64_t file_size, TransferSession *session) {
+    // Without a transfer session, this file gets one of its own
+    TransferSession own_session;
+    if (!session) {
+        if (transfer_session_init(&own_session, file_size) != 0) {
+            return -1;
+        }
+    }
+    TransferSession *active = session ? session : &own_session;
+    AdaptiveState *adaptive = &active->adaptive;
+    char *buffer = active->buffer;
+    int result = 0;
+
+    uint64_t total_received = 0;
+    size_t chunk_size = adaptive_get_chunk_size(adaptive);
+    time_t chunk_start = progress_time();
+
+    // One clock read on each side of a write serves metrics, phase tracing and feedback
+    int timed = metrics_enabled() || phases_enabled() || active->feedback;
+
+    while (total_received < file_size) {
+        size_t to_receive = file_size - total_received;
+        if (to_receive > chunk_size) {
+            to_receive = chunk_size;
+        }
+
+        uint64_t recv_start = timed ? platform_monotonic_ns() : 0;
+        if (recv_all(s, buffer, to_receive) != 0) {
+            result = -1;
+            break;
+        }
+
+        uint64_t write_start = timed ? platform_monotonic_ns() : 0;
+        if (fwrite(buffer, 1, to_receive, file) != to_receive) {
+            perror("fwrite");
+            metrics_error(METRICS_ERROR_DISK);
+            result = -1;
+            break;
+        }
+        uint64_t write_end = timed ? platform_monotonic_ns() : 0;
+        phases_record_span(PHASE_DISK_WRITE, write_start, write_end);
+        metrics_chunk(to_receive, recv_start, write_start, write_end);
+        if (active->feedback && feedback_receiver_write(active->feedback, to_receive, write_start, write_end) != 0) {
+            result = -1;
+            break;
+        }
+
+        time_t chunk_end = progress_time();
+        double chunk_elapsed = difftime(chunk_end, chunk_start);
+        chunk_start = chunk_end;
+
+        progress_chunk(to_receive, chunk_size);
+        adaptive_update(adaptive, to_receive, chunk_elapsed);
+        chunk_size = adaptive_get_chunk_size(adaptive);
+
+        total_received += to_receive;
+    }
+
+    if (!session) {
+        transfer_session_free(&own_session);
+    }
+    return result;
+}
+
 /**
  * @brief Send a single file within a directory with relative path
  *
  * @param s Socket descriptor
  * @param base_path Base directory path
  * @param relative_path Relative path from base
+ * @param session Session of the directory transfer
  */
-void send_single_file_in_dir(SOCKET_T s, const char *base_path, const char *relative_path) {
+void send_single_file_in_dir(SOCKET_T s, const char *base_path, const char *relative_path,
+                             TransferSession *session) {
     char full_path[4096];
     snprintf(full_path, sizeof(full_path), "%s/%s", base_path, relative_path);
 
     // Open file in binary read mode
-    FILE *file = fopen(full_path, "rb");
+    FILE *file = phases_fopen(full_path, "rb");
     if (!file) {
         perror("fopen");
         exit(EXIT_FAILURE);
@@ -544,10 +621,8 @@ void send_single_file_in_dir(SOCKET_T s, const char *base_path, const char *rela
 
     uint64_t file_size = st.st_size;
     uint64_t rel_path_len = strlen(relative_path);
-
-    // Initialize adaptive chunk sizing
-    AdaptiveState adaptive;
-    adaptive_init(&adaptive, file_size);
+    uint64_t probe_start = PROBE_START(file__end);
+    PROBE2(file__begin, relative_path, file_size);
 
     // Send file header with relative path
     FileHeader header;
@@ -566,53 +641,15 @@ void send_single_file_in_dir(SOCKET_T s, const char *base_path, const char *rela
     }
 
     // Send file content in chunks
-    char *buffer = malloc(MAX_CHUNK_BUFFER_SIZE);
-    if (!buffer) {
-        perror("malloc");
+    transfer_session_next_file(session, file_size);
+    if (send_file_content(s, file, file_size, session) != 0) {
         fclose(file);
         exit(EXIT_FAILURE);
     }
 
-    size_t bytes_read;
-    size_t chunk_size = adaptive_get_chunk_size(&adaptive);
-    time_t chunk_start = time(NULL);
-
-    while ((bytes_read = fread(buffer, 1, chunk_size, file)) > 0) {
-        time_t chunk_end = time(NULL);
-        double chunk_elapsed = difftime(chunk_end, chunk_start);
-        chunk_start = chunk_end;
-
-        if (send_all(s, buffer, bytes_read) != 0) {
-            free(buffer);
-            fclose(file);
-            exit(EXIT_FAILURE);
-        }
-
-        adaptive_update(&adaptive, bytes_read, chunk_elapsed);
-        chunk_size = adaptive_get_chunk_size(&adaptive);
-
-        // Check for shutdown signal
-        int shutdown = signals_should_shutdown();
-        if (shutdown == 1) {
-            printf("\nShutdown requested. Press Ctrl+C again to force exit...\n");
-            signals_acknowledge_shutdown();
-        } else if (shutdown == 2) {
-            printf("\nForced exit!\n");
-            free(buffer);
-            fclose(file);
-            exit(EXIT_FAILURE);
-        }
-    }
-
-    if (ferror(file)) {
-        perror("fread");
-        free(buffer);
-        fclose(file);
-        exit(EXIT_FAILURE);
-    }
-
-    free(buffer);
     fclose(file);
+    progress_file_done();
+    PROBE3(file__end, relative_path, file_size, PROBE_ELAPSED(probe_start));
 }
 
 /**
@@ -621,8 +658,10 @@ void send_single_file_in_dir(SOCKET_T s, const char *base_path, const char *rela
  * @param s Socket descriptor
  * @param base_path Base directory path
  * @param current_path Current directory path (relative to base)
+ * @param session Session of the directory transfer
  */
-void send_directory_recursive(SOCKET_T s, const char *base_path, const char *current_path) {
+void send_directory_recursive(SOCKET_T s, const char *base_path, const char *current_path,
+                              TransferSession *session) {
     DIR *dir;
     struct dirent *entry;
     struct stat st;
@@ -667,10 +706,10 @@ void send_directory_recursive(SOCKET_T s, const char *base_path, const char *cur
 
         if (S_ISDIR(st.st_mode)) {
             // Recursively process subdirectory
-            send_directory_recursive(s, base_path, relative_path);
+            send_directory_recursive(s, base_path, relative_path, session);
         } else if (S_ISREG(st.st_mode)) {
             // Send regular file
-            send_single_file_in_dir(s, base_path, relative_path);
+            send_single_file_in_dir(s, base_path, relative_path, session);
         }
     }
 
@@ -688,6 +727,7 @@ void send_directory_protocol(SOCKET_T s, const char *dirpath) {
     if (count_directory_files(dirpath, &total_files, &total_size) != 0) {
         exit(EXIT_FAILURE);
     }
+    progress_set_total(total_size, total_files);
 
     // Extract base directory name
     const char *base_name = strrchr(dirpath, '/');
@@ -731,10 +771,15 @@ void send_directory_protocol(SOCKET_T s, const char *dirpath) {
     format_bytes(total_size, size_str, sizeof(size_str));
     printf("%s total)\n", size_str);
 
-    // Send all files recursively
+    // Send all files recursively, with one adaptive session for the whole tree
     time_t start_time = time(NULL);
 
-    send_directory_recursive(s, dirpath, "");
+    TransferSession session;
+    if (transfer_session_init(&session, total_size) != 0) {
+        exit(EXIT_FAILURE);
+    }
+    send_directory_recursive(s, dirpath, "", &session);
+    transfer_session_free(&session);
 
     // Send end marker (file_size = 0, filename_len = 0)
     FileHeader end_header;
@@ -764,9 +809,10 @@ void send_directory_protocol(SOCKET_T s, const char *dirpath) {
  *
  * @param s Socket descriptor
  * @param base_dir Base directory path
- * @return 0 on success, -1 on error
+ * @param session Session of the directory transfer
+ * @return 0 on success, 1 at the end marker, -1 on error
  */
-int receive_single_file_in_dir(SOCKET_T s, const char *base_dir) {
+int receive_single_file_in_dir(SOCKET_T s, const char *base_dir, TransferSession *session) {
     FileHeader header;
 
     // Receive file header
@@ -795,6 +841,8 @@ int receive_single_file_in_dir(SOCKET_T s, const char *base_dir) {
         return -1;
     }
     relative_path[filename_len] = '\0';
+    uint64_t probe_start = PROBE_START(file__end);
+    PROBE2(file__begin, relative_path, file_size);
 
     // Construct full file path
     char full_path[4096];
@@ -815,78 +863,28 @@ int receive_single_file_in_dir(SOCKET_T s, const char *base_dir) {
 
     printf("Receiving: %s\n", relative_path);
 
-    // Initialize adaptive chunk sizing
-    AdaptiveState adaptive;
-    adaptive_init(&adaptive, file_size);
-
     // Create and write file
-    FILE *file = fopen(full_path, "wb");
+    FILE *file = phases_fopen(full_path, "wb");
     if (!file) {
         perror("fopen");
+        metrics_error(METRICS_ERROR_DISK);
         free(relative_path);
         return -1;
     }
 
     // Receive file content
-    char *buffer = malloc(MAX_CHUNK_BUFFER_SIZE);
-    if (!buffer) {
-        perror("malloc");
+    transfer_session_next_file(session, file_size);
+    if (recv_file_content(s, file, file_size, session) != 0) {
         fclose(file);
         free(relative_path);
         return -1;
     }
 
-    uint64_t total_received = 0;
-    size_t chunk_size = adaptive_get_chunk_size(&adaptive);
-    time_t chunk_start = time(NULL);
-
-    while (total_received < file_size) {
-        size_t to_receive = file_size - total_received;
-        if (to_receive > chunk_size) {
-            to_receive = chunk_size;
-        }
-
-        if (recv_all(s, buffer, to_receive) != 0) {
-            free(buffer);
-            fclose(file);
-            free(relative_path);
-            return -1;
-        }
-
-        if (fwrite(buffer, 1, to_receive, file) != to_receive) {
-            perror("fwrite");
-            free(buffer);
-            fclose(file);
-            free(relative_path);
-            return -1;
-        }
-
-        time_t chunk_end = time(NULL);
-        double chunk_elapsed = difftime(chunk_end, chunk_start);
-        chunk_start = chunk_end;
-
-        adaptive_update(&adaptive, to_receive, chunk_elapsed);
-        chunk_size = adaptive_get_chunk_size(&adaptive);
-
-        total_received += to_receive;
-
-        // Check for shutdown signal
-        int shutdown = signals_should_shutdown();
-        if (shutdown == 1) {
-            printf("\nShutdown requested. Press Ctrl+C again to force exit...\n");
-            signals_acknowledge_shutdown();
-        } else if (shutdown == 2) {
-            printf("\nForced exit!\n");
-            free(buffer);
-            fclose(file);
-            free(relative_path);
-            exit(EXIT_FAILURE);
-        }
-    }
-
-    free(buffer);
     fclose(file);
+    PROBE3(file__end, relative_path, file_size, PROBE_ELAPSED(probe_start));
     free(relative_path);
+    metrics_file_received();
+    progress_file_done();
     return 0;
 }
 
@@ -908,6 +906,7 @@ int recv_directory_protocol(SOCKET_T s) {
     uint64_t total_files = ntohll(dir_header.total_files);
     uint64_t total_size = ntohll(dir_header.total_size);
     uint64_t base_name_len = ntohll(dir_header.base_path_len);
+    progress_set_total(total_size, total_files);
 
     // Receive base directory name
     char *base_name = malloc(base_name_len + 1);
@@ -934,21 +933,28 @@ int recv_directory_protocol(SOCKET_T s) {
         return -1;
     }
 
-    // Receive all files
+    // Receive all files, with one adaptive session for the whole tree
     time_t start_time = time(NULL);
     uint64_t files_received = 0;
+    TransferSession session;
+    if (transfer_session_init(&session, total_size) != 0) {
+        free(base_name);
+        return -1;
+    }
 
     while (1) {
-        int result = receive_single_file_in_dir(s, base_name);
+        int result = receive_single_file_in_dir(s, base_name, &session);
         if (result == 1) {
             break;  // End of transfer
         } else if (result != 0) {
+            transfer_session_free(&session);
             free(base_name);
             return -1;  // Error
         }
 
         files_received++;
     }
+    transfer_session_free(&session);
 
     // Display final statistics
     time_t end_time = time(NULL);
@@ -972,7 +978,9 @@ int recv_directory_protocol(SOCKET_T s) {
  * @brief Detect transfer type by reading magic number
  *
  * @param s Socket descriptor
- * @return 0 for file transfer, 1 for directory transfer, -1 on error
+ * @return 0 for file transfer, 1 for directory transfer, 2 for target file,
+ *         3 for target dir, 4 for remote verification, 5 for extended directory,
+ *         6 for extended file, -1 on error
  */
 int detect_transfer_type(SOCKET_T s) {
     uint32_t magic;
@@ -992,6 +1000,14 @@ int detect_transfer_type(SOCKET_T s) {
         return 2;  // File transfer with target directory
     } else if (magic_host == TARGET_DIR_MAGIC) {
         return 3;  // Directory transfer with target directory
+    } else if (magic_host == VERIFY_MAGIC) {
+        return 4;  // Remote verification
+    } else if (magic_host == EXT_DIR_MAGIC) {
+        return 5;  // Extended directory transfer
+    } else if (magic_host == EXT_FILE_MAGIC) {
+        return 6;  // Extended file transfer
+    } else if (magic_host == LINK_PROBE_MAGIC) {
+        return 7;  // Link-quality probe
     } else {
         fprintf(stderr, "Error: Unknown transfer type magic number: 0x%08X\n", magic_host);
         return -1;
@@ -1012,6 +1028,41 @@ int is_directory(const char *path) {
     return S_ISDIR(st.st_mode) ? 1 : 0;
 }
 
+/**
+ * @brief Check that a received relative path stays below the receiver root
+ */
+int is_safe_relative_path(const char *path) {
+    if (path[0] == '\0' || path[0] == '/') {
+        return 0;
+    }
+    if (strstr(path, "..") != NULL) {
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief Extract the last path component, ignoring trailing slashes
+ */
+void path_base_name(const char *path, char *out, size_t out_size) {
+    size_t len = strlen(path);
+    while (len > 1 && path[len - 1] == '/') {
+        len--;
+    }
+
+    size_t start = len;
+    while (start > 0 && path[start - 1] != '/') {
+        start--;
+    }
+
+    size_t n = len - start;
+    if (n >= out_size) {
+        n = out_size - 1;
+    }
+    memcpy(out, path + start, n);
+    out[n] = '\0';
+}
+
 /**
  * @brief Recursively count files and calculate total size in a directory
  *
@@ -1080,6 +1131,7 @@ int count_directory_files(const char *dirpath, uint64_t *total_files, uint64_t *
 int create_directory_recursive(const char *dirpath) {
     char path[4096];
     char *p;
+    uint64_t phase_start = phases_clock();
 
     // Make a copy of the path to modify
     strncpy(path, dirpath, sizeof(path) - 1);
@@ -1113,6 +1165,7 @@ int create_directory_recursive(const char *dirpath) {
         return -1;
     }
 
+    phases_record(PHASE_MKDIR, phase_start);
     return 0;
 }
 
@@ -1169,7 +1222,7 @@ int validate_target_directory(const char *target_dir, char *sanitized_dir, size_
  */
 void send_file_with_target_protocol(SOCKET_T s, const char *filepath, const char *target_dir) {
 
-    FILE *file = fopen(filepath, "rb");
+    FILE *file = phases_fopen(filepath, "rb");
     if (!file) {
         perror("fopen");
         exit(EXIT_FAILURE);
@@ -1206,6 +1259,7 @@ void send_file_with_target_protocol(SOCKET_T s, const char *filepath, const char
     // Initialize adaptive chunk sizing
     AdaptiveState adaptive;
     adaptive_init(&adaptive, file_size);
+    progress_set_total(file_size, 1);
 
     // Prepare enhanced header
     uint64_t filename_len = strlen(filename);
@@ -1251,10 +1305,7 @@ void send_file_with_target_protocol(SOCKET_T s, const char *filepath, const char
     }
 
     size_t bytes_read;
-    uint64_t total_sent = 0;
-    time_t start_time = time(NULL);
     size_t chunk_size = adaptive_get_chunk_size(&adaptive);
-    time_t chunk_start = start_time;
 
     printf("Sending file: %s", filename);
     if (target_dir_len > 0) {
@@ -1262,8 +1313,14 @@ void send_file_with_target_protocol(SOCKET_T s, const char *filepath, const char
     }
     printf(" (%s)\n", file_size > 1024*1024 ? "large file" : "small file");
 
+    // The progress ticker draws the progress line and samples the clock
+    progress_show_line();
+    time_t chunk_start = progress_time();
+
+    uint64_t read_start = phases_clock();
     while ((bytes_read = fread(buffer, 1, chunk_size, file)) > 0) {
-        time_t chunk_end = time(NULL);
+        phases_record(PHASE_DISK_READ, read_start);
+        time_t chunk_end = progress_time();
         double chunk_elapsed = difftime(chunk_end, chunk_start);
         chunk_start = chunk_end;
 
@@ -1273,34 +1330,10 @@ void send_file_with_target_protocol(SOCKET_T s, const char *filepath, const char
             exit(EXIT_FAILURE);
         }
 
+        progress_chunk(bytes_read, chunk_size);
         adaptive_update(&adaptive, bytes_read, chunk_elapsed);
         chunk_size = adaptive_get_chunk_size(&adaptive);
-        total_sent += bytes_read;
-
-        // Check for shutdown signal
-        int shutdown = signals_should_shutdown();
-        if (shutdown == 1) {
-            printf("\nShutdown requested. Press Ctrl+C again to force exit...\n");
-            signals_acknowledge_shutdown();
-        } else if (shutdown == 2) {
-            printf("\nForced exit!\n");
-            free(buffer);
-            fclose(file);
-            exit(EXIT_FAILURE);
-        }
-
-        // Progress display
-        if (file_size > 1024*1024) { // Only show progress for large files
-            double percent = (double)total_sent / file_size * 100.0;
-            time_t elapsed = time(NULL) - start_time;
-            double speed = elapsed > 0 ? (double)total_sent / (1024.0 * 1024.0) / elapsed : 0;
-
-            printf("\rProgress: %.1f%%", percent);
-            if (speed > 0) {
-                printf(" (%.1f MB/s)", speed);
-            }
-            fflush(stdout);
-        }
+        read_start = phases_clock();
     }
 
     if (ferror(file)) {
@@ -1312,6 +1345,7 @@ void send_file_with_target_protocol(SOCKET_T s, const char *filepath, const char
 
     free(buffer);
     fclose(file);
+    progress_file_done();
     printf("\nFile sent successfully!\n");
 }
 
@@ -1343,6 +1377,7 @@ void send_directory_with_target_protocol(SOCKET_T s, const char *dirpath, const
         fprintf(stderr, "Error: Failed to analyze directory\n");
         exit(EXIT_FAILURE);
     }
+    progress_set_total(total_size, total_files);
 
     // Extract directory name
     const char *dir_name = strrchr(dirpath, '/');
@@ -1394,8 +1429,13 @@ void send_directory_with_target_protocol(SOCKET_T s, const char *dirpath, const
     }
     printf(" (%lu files, %s)\n", (unsigned long)total_files, total_size > 1024*1024 ? "large" : "small");
 
-    // Send all files recursively
-    send_directory_recursive(s, dirpath, "");
+    // Send all files recursively, with one adaptive session for the whole tree
+    TransferSession session;
+    if (transfer_session_init(&session, total_size) != 0) {
+        exit(EXIT_FAILURE);
+    }
+    send_directory_recursive(s, dirpath, "", &session);
+    transfer_session_free(&session);
 
     printf("Directory sent successfully!\n");
 }
@@ -1465,15 +1505,17 @@ int recv_file_with_target_protocol(SOCKET_T s) {
         printf(" -> %s/", target_dir);
     }
     printf(" (%s)\n", file_size > 1024*1024 ? "large file" : "small file");
+    progress_set_total(file_size, 1);
 
     // Initialize adaptive chunk sizing
     AdaptiveState adaptive;
     adaptive_init(&adaptive, file_size);
 
     // Create and write file
-    FILE *file = fopen(full_path, "wb");
+    FILE *file = phases_fopen(full_path, "wb");
     if (!file) {
         perror("fopen");
+        metrics_error(METRICS_ERROR_DISK);
         free(filename);
         if (target_dir) free(target_dir);
         return -1;
@@ -1490,9 +1532,14 @@ int recv_file_with_target_protocol(SOCKET_T s) {
     }
 
     uint64_t total_received = 0;
-    time_t start_time = time(NULL);
     size_t chunk_size = adaptive_get_chunk_size(&adaptive);
-    time_t chunk_start = start_time;
+
+    // The progress ticker draws the progress line and samples the clock
+    progress_show_line();
+    time_t chunk_start = progress_time();
+
+    // One clock read on each side of a receive or write serves metrics and phase tracing
+    int timed = metrics_enabled() || phases_enabled();
 
     while (total_received < file_size) {
         size_t to_receive = file_size - total_received;
@@ -1500,63 +1547,47 @@ int recv_file_with_target_protocol(SOCKET_T s) {
             to_receive = chunk_size;
         }
 
+        uint64_t recv_start = timed ? platform_monotonic_ns() : 0;
         ssize_t received = recv(s, buffer, to_receive, 0);
         if (received <= 0) {
             fprintf(stderr, "Error: Connection closed while receiving file\n");
+            metrics_error(METRICS_ERROR_NETWORK);
             free(buffer);
             fclose(file);
             free(filename);
             if (target_dir) free(target_dir);
             return -1;
         }
+        uint64_t write_start = timed ? platform_monotonic_ns() : 0;
+        phases_record_span(PHASE_NET_RECV, recv_start, write_start);
 
-        time_t chunk_end = time(NULL);
+        time_t chunk_end = progress_time();
         double chunk_elapsed = difftime(chunk_end, chunk_start);
         chunk_start = chunk_end;
 
         if (fwrite(buffer, 1, received, file) != received) {
             perror("fwrite");
+            metrics_error(METRICS_ERROR_DISK);
             free(buffer);
             fclose(file);
             free(filename);
             if (target_dir) free(target_dir);
             return -1;
         }
+        uint64_t write_end = timed ? platform_monotonic_ns() : 0;
+        phases_record_span(PHASE_DISK_WRITE, write_start, write_end);
+        metrics_chunk((uint64_t)received, recv_start, write_start, write_end);
 
+        progress_chunk((uint64_t)received, chunk_size);
         adaptive_update(&adaptive, received, chunk_elapsed);
         chunk_size = adaptive_get_chunk_size(&adaptive);
         total_received += received;
-
-        // Check for shutdown signal
-        int shutdown = signals_should_shutdown();
-        if (shutdown == 1) {
-            printf("\nShutdown requested. Press Ctrl+C again to force exit...\n");
-            signals_acknowledge_shutdown();
-        } else if (shutdown == 2) {
-            printf("\nForced exit!\n");
-            free(buffer);
-            fclose(file);
-            free(filename);
-            if (target_dir) free(target_dir);
-            exit(EXIT_FAILURE);
-        }
-
-        // Progress display for large files
-        if (file_size > 1024*1024) {
-            double percent = (double)total_received / file_size * 100.0;
-            time_t elapsed = time(NULL) - start_time;
-            double speed = elapsed > 0 ? (double)total_received / (1024.0 * 1024.0) / elapsed : 0;
-
-            printf("\rProgress: %.1f%%", percent);
-            if (speed > 0) {
-                printf(" (%.1f MB/s)", speed);
-            }
-            fflush(stdout);
-        }
     }
 
     free(buffer);
     fclose(file);
+    metrics_file_received();
+    progress_file_done();
     printf("\nFile received successfully: %s\n", full_path);
 
     free(filename);
@@ -1579,6 +1610,7 @@ int recv_directory_with_target_protocol(SOCKET_T s) {
     uint64_t total_size = ntohll(header.total_size);
     uint64_t base_path_len = ntohll(header.base_path_len);
     uint64_t target_dir_len = ntohll(header.target_dir_len);
+    progress_set_total(total_size, total_files);
 
     // Receive base directory name
     char *base_dir = malloc(base_path_len + 1);
@@ -1638,17 +1670,25 @@ int recv_directory_with_target_protocol(SOCKET_T s) {
         return -1;
     }
 
-    // Receive all files
+    // Receive all files, with one adaptive session for the whole tree
     uint64_t files_received = 0;
+    TransferSession session;
+    if (transfer_session_init(&session, total_size) != 0) {
+        free(base_dir);
+        if (target_dir) free(target_dir);
+        return -1;
+    }
     while (files_received < total_files) {
-        int result = receive_single_file_in_dir(s, full_target_path);
+        int result = receive_single_file_in_dir(s, full_target_path, &session);
         if (result != 0) {
+            transfer_session_free(&session);
             free(base_dir);
             if (target_dir) free(target_dir);
             return -1;
         }
         files_received++;
     }
+    transfer_session_free(&session);
 
     printf("Directory received successfully: %s\n", full_target_path);
 
@@ -12,9 +12,31 @@
 #define PROTOCOL_H
 
 #include "platform.h"  // Cross-platform socket types and functions
+#include "adaptive.h"  // AdaptiveState for transfer sessions
 #include <sys/stat.h>   // File status operations (stat() for file size)
 #include <time.h>       // Time functions for transfer speed calculation
 
+// Define htonll/ntohll for systems that don't have them (like Linux)
+#ifndef htonll
+static inline uint64_t htonll(uint64_t value) {
+    #if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        return ((uint64_t)htonl(value & 0xFFFFFFFF) << 32) | htonl(value >> 32);
+    #else
+        return value;
+    #endif
+}
+#endif
+
+#ifndef ntohll
+static inline uint64_t ntohll(uint64_t value) {
+    #if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        return ((uint64_t)ntohl(value & 0xFFFFFFFF) << 32) | ntohl(value >> 32);
+    #else
+        return value;
+    #endif
+}
+#endif
+
 // Default port configuration
 #define DEFAULT_NETTF_PORT 9876
 
@@ -29,6 +51,31 @@
 #define DIR_MAGIC  0x44495220  // "DIR " in hex
 #define TARGET_FILE_MAGIC 0x54415247  // "TARG" in hex - File with target directory
 #define TARGET_DIR_MAGIC  0x54444952  // "TDIR" in hex - Directory with target directory
+#define VERIFY_MAGIC      0x56524659  // "VRFY" in hex - Remote verification (digests only)
+#define EXT_DIR_MAGIC     0x58444952  // "XDIR" in hex - Extended directory (see extdir.h)
+#define EXT_FILE_MAGIC    0x5846494C  // "XFIL" in hex - Extended file (see extfile.h)
+#define LINK_PROBE_MAGIC  0x50524F42  // "PROB" in hex - Link-quality probe (see linkprobe.h)
+
+/**
+ * @brief Sender options selected on the command line
+ */
+typedef struct {
+    int dedup;   // Send each unique payload of a directory once (extended directory protocol)
+    int sparse;  // Send data extents only, describing holes (extended protocols)
+    int connect_timeout_ms;  // Deadline for connecting to the receiver (0 for the default)
+    int no_profile;  // Start from defaults and do not update the peer's tuning profile (see peerprofile.h)
+    int feedback;    // Ask the receiver for status frames (extended protocols, see feedback.h)
+} SendOptions;
+
+/**
+ * @brief Receiver options selected on the command line
+ */
+typedef struct {
+    int link_duplicates;  // Recreate duplicate files as hard links instead of copies
+    int no_announce;      // Do not announce the receiver on the local network (see beacon.h)
+    int metrics_port;     // Serve metrics over HTTP on this port, 0 for none (see metrics.h)
+    int no_profile;       // Start from defaults and do not update peers' tuning profiles (see peerprofile.h)
+} ReceiveOptions;
 
 /**
  * @brief Protocol header structure for file transfer metadata
@@ -179,12 +226,82 @@ void format_bytes(uint64_t bytes, char *buffer, size_t buffer_size);
 void format_speed(double bytes_per_sec, char *buffer, size_t buffer_size);
 void format_time(int seconds, char *buffer, size_t buffer_size);
 
+/**
+ * @brief Adaptive controller and chunk buffer shared by the files of one transfer
+ *
+ * A directory transfer keeps one session for all of its files, so the chunk
+ * size and speed estimates carry over from file to file instead of restarting
+ * at INITIAL_CHUNK_SIZE, and the chunk buffer is allocated once. Most files
+ * of a tree end long before ADJUSTMENT_INTERVAL; only a session lets the
+ * controller converge on them.
+ */
+typedef struct {
+    AdaptiveState adaptive;  // Chunk size controller, carried across files
+    char *buffer;            // Buffer for the largest chunk (MAX_CHUNK_SIZE)
+    uint64_t files;          // Files whose content went through the session
+    struct FeedbackChannel *feedback;  // Receiver feedback of the connection (see feedback.h), NULL if off
+} TransferSession;
+
+/**
+ * @brief Start a session for a transfer
+ *
+ * @param session Session to initialize
+ * @param total_bytes Content bytes of the whole transfer (0 if unknown)
+ * @return 0 on success, -1 if the buffer cannot be allocated
+ */
+int transfer_session_init(TransferSession *session, uint64_t total_bytes);
+
+/**
+ * @brief Release the buffer of a session
+ *
+ * @param session Session to release
+ */
+void transfer_session_free(TransferSession *session);
+
+/**
+ * @brief Mark the start of the next file's content in a session
+ *
+ * Keeps the controller's state and records the file boundary in the chunk
+ * trace. Call before each file's content; send_file_content() and
+ * recv_file_content() may be called several times per file (sparse
+ * extents).
+ *
+ * @param session Session of the transfer
+ * @param file_bytes Size of the file
+ */
+void transfer_session_next_file(TransferSession *session, uint64_t file_bytes);
+
+/**
+ * @brief Send exactly file_size bytes of an open file using adaptive chunks
+ *
+ * @param s Socket descriptor
+ * @param file File opened for reading, positioned at the first byte to send
+ * @param file_size Number of bytes to send
+ * @param session Session of the transfer, NULL for a session of this file only
+ * @return 0 on success, -1 on error (including a file that shrank)
+ */
+int send_file_content(SOCKET_T s, FILE *file, uint64_t file_size, TransferSession *session);
+
+/**
+ * @brief Receive exactly file_size bytes into an open file using adaptive chunks
+ *
+ * @param s Socket descriptor
+ * @param file File opened for writing
+ * @param file_size Number of bytes to receive
+ * @param session Session of the transfer, NULL for a session of this file only
+ * @return 0 on success, -1 on error
+ */
+int recv_file_content(SOCKET_T s, FILE *file, uint64_t file_size, TransferSession *session);
+
 // Helper functions for directory operations
 int is_directory(const char *path);
+int is_safe_relative_path(const char *path);
+void path_base_name(const char *path, char *out, size_t out_size);
 int count_directory_files(const char *dirpath, uint64_t *total_files, uint64_t *total_size);
 int create_directory_recursive(const char *dirpath);
-void send_single_file_in_dir(SOCKET_T s, const char *base_path, const char *relative_path);
-int receive_single_file_in_dir(SOCKET_T s, const char *base_dir);
+void send_single_file_in_dir(SOCKET_T s, const char *base_path, const char *relative_path,
+                             TransferSession *session);
+int receive_single_file_in_dir(SOCKET_T s, const char *base_dir, TransferSession *session);
 
 /**
  * @brief Send a file with target directory support
@@ -238,7 +355,9 @@ int recv_directory_with_target_protocol(SOCKET_T s);
  * @brief Detect transfer type by examining first bytes
  *
  * @param s Socket descriptor
- * @return 0 for file transfer, 1 for directory transfer, 2 for target file, 3 for target dir, -1 on error
+ * @return 0 for file transfer, 1 for directory transfer, 2 for target file, 3 for target dir,
+ *         4 for remote verification, 5 for extended directory, 6 for extended file,
+ *         7 for link probe, -1 on error
  */
 int detect_transfer_type(SOCKET_T s);
 
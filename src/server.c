@@ -8,16 +8,96 @@
  * error handling and proper resource management.
  */
 
+#define _GNU_SOURCE  // Enable getnameinfo() on Linux systems
 #include "platform.h"  // Cross-platform socket abstraction
 #include "protocol.h"  // File transfer protocol definitions
 #include "signals.h"   // Signal handling
+#include "verify.h"    // Remote verification protocol
+#include "extdir.h"    // Extended directory protocol
+#include "extfile.h"   // Extended file protocol
+#include "beacon.h"    // Receiver announcements
+#include "linkprobe.h" // Link-quality probes
+#include "metrics.h"   // Receiver metrics
+#include "progress.h"  // JSON progress events
+#include "chunktrace.h" // Per-chunk traces
+#include "peerprofile.h" // Per-peer tuning profiles
+#include "probes.h"    // USDT static tracepoints
+
+/**
+ * @brief Detect the transfer type of a connection and receive it
+ *
+ * Reads the magic number sent first on the connection and runs the matching
+ * receive protocol, reporting failures on stderr.
+ *
+ * @param client_socket Connected socket of the sender
+ * @param options Receiver options (duplicate handling)
+ * @return 0 on success, -1 on error
+ */
+int receive_transfer(SOCKET_T client_socket, const ReceiveOptions *options) {
+    int result = -1;
+    int transfer_type = detect_transfer_type(client_socket);
+    if (transfer_type == -1) {
+        fprintf(stderr, "Error detecting transfer type\n");
+    } else if (transfer_type == 0) {
+        // Standard file transfer
+        result = recv_file_protocol(client_socket);
+        if (result != 0) {
+            fprintf(stderr, "Error receiving file\n");
+        }
+    } else if (transfer_type == 1) {
+        // Standard directory transfer
+        result = recv_directory_protocol(client_socket);
+        if (result != 0) {
+            fprintf(stderr, "Error receiving directory\n");
+        }
+    } else if (transfer_type == 2) {
+        // File transfer with target directory
+        result = recv_file_with_target_protocol(client_socket);
+        if (result != 0) {
+            fprintf(stderr, "Error receiving file with target directory\n");
+        }
+    } else if (transfer_type == 3) {
+        // Directory transfer with target directory
+        result = recv_directory_with_target_protocol(client_socket);
+        if (result != 0) {
+            fprintf(stderr, "Error receiving directory with target directory\n");
+        }
+    } else if (transfer_type == 4) {
+        // Remote verification: compare digests, no file data
+        result = recv_verify_protocol(client_socket);
+        if (result != 0) {
+            fprintf(stderr, "Error answering verification request\n");
+        }
+    } else if (transfer_type == 5) {
+        // Extended directory transfer (deduplicated entries)
+        result = recv_ext_directory_protocol(client_socket, options);
+        if (result != 0) {
+            fprintf(stderr, "Error receiving extended directory\n");
+        }
+    } else if (transfer_type == 6) {
+        // Extended file transfer (sparse content)
+        result = recv_ext_file_protocol(client_socket, options);
+        if (result != 0) {
+            fprintf(stderr, "Error receiving extended file\n");
+        }
+    } else if (transfer_type == 7) {
+        // Link-quality probe from a discovering sender
+        result = recv_link_probe_protocol(client_socket);
+        if (result != 0) {
+            fprintf(stderr, "Error answering link probe\n");
+        }
+    } else {
+        fprintf(stderr, "Error: Unknown transfer type %d\n", transfer_type);
+    }
+    return result;
+}
 
 /**
  * @brief Start a server to receive files on a specific port
  *
  * This function implements the complete server-side file receiving workflow:
  * 1. Initialize network subsystem
- * 2. Create TCP socket
+ * 2. Create a dual-stack (IPv6 and IPv4) TCP socket
  * 3. Set socket options for address reuse
  * 4. Bind socket to local port
  * 5. Start listening for connections
@@ -29,18 +109,24 @@
  * All steps include comprehensive error handling with proper resource cleanup.
  *
  * @param port Port number to listen on (e.g., 8080)
+ * @param options Receiver options (duplicate handling)
  * @return Does not return on error (exits with EXIT_FAILURE)
  */
-void receive_file(int port) {
+void receive_file(int port, const ReceiveOptions *options) {
     // Step 1: Initialize network subsystem
     // On Windows, this calls WSAStartup(); on POSIX systems, this does nothing
     net_init();
 
-    // Step 2: Create TCP socket for IPv4 communication
-    // AF_INET: IPv4 address family
-    // SOCK_STREAM: TCP (reliable, connection-oriented)
-    // 0: Let system choose protocol (TCP for SOCK_STREAM)
-    SOCKET_T server_socket = socket(AF_INET, SOCK_STREAM, 0);
+    // Step 2: Create a dual-stack TCP socket
+    // AF_INET6 with IPV6_V6ONLY off accepts IPv6 clients and IPv4 clients
+    // (as IPv4-mapped addresses) on one socket; fall back to plain IPv4
+    // where the system has no IPv6 support
+    int family = AF_INET6;
+    SOCKET_T server_socket = socket(AF_INET6, SOCK_STREAM, 0);
+    if (server_socket == INVALID_SOCKET_T) {
+        family = AF_INET;
+        server_socket = socket(AF_INET, SOCK_STREAM, 0);
+    }
     if (server_socket == INVALID_SOCKET_T) {
         perror("socket");              // Print system error for socket creation failure
         net_cleanup();                 // Clean up network subsystem before exit
@@ -61,14 +147,29 @@ void receive_file(int port) {
     }
 
     // Step 4: Setup server address structure and bind to port
-    SOCKADDR_IN_T server_addr;         // IPv4 address structure
+    // Accept connections on any interface
+    struct sockaddr_storage server_addr;
+    socklen_t server_addr_len;
     memset(&server_addr, 0, sizeof(server_addr));  // Zero-initialize structure
-    server_addr.sin_family = AF_INET;              // IPv4 address family
-    server_addr.sin_addr.s_addr = INADDR_ANY;       // Accept connections on any interface
-    server_addr.sin_port = htons(port);            // Port in network byte order
+    if (family == AF_INET6) {
+        int v6only = 0;                // Also accept IPv4 clients
+        setsockopt(server_socket, IPPROTO_IPV6, IPV6_V6ONLY, (char *)&v6only, sizeof(v6only));
+
+        struct sockaddr_in6 *addr6 = (struct sockaddr_in6 *)&server_addr;
+        addr6->sin6_family = AF_INET6;
+        addr6->sin6_addr = in6addr_any;
+        addr6->sin6_port = htons(port);           // Port in network byte order
+        server_addr_len = sizeof(*addr6);
+    } else {
+        SOCKADDR_IN_T *addr4 = (SOCKADDR_IN_T *)&server_addr;
+        addr4->sin_family = AF_INET;
+        addr4->sin_addr.s_addr = INADDR_ANY;
+        addr4->sin_port = htons(port);            // Port in network byte order
+        server_addr_len = sizeof(*addr4);
+    }
 
     // Bind socket to local address and port
-    if (bind(server_socket, (struct sockaddr *)&server_addr, sizeof(server_addr)) == SOCKET_ERROR) {
+    if (bind(server_socket, (struct sockaddr *)&server_addr, server_addr_len) == SOCKET_ERROR) {
         perror("bind");                // Print system error for bind failure
         close_socket(server_socket);   // Clean up socket before exit
         net_cleanup();                 // Clean up network subsystem
@@ -84,6 +185,16 @@ void receive_file(int port) {
         exit(EXIT_FAILURE);            // Cannot continue if listen fails
     }
 
+    // Serve metrics for monitoring a long-running receiver
+    if (options->metrics_port > 0 && metrics_start(options->metrics_port) == 0) {
+        printf("Serving metrics on http://0.0.0.0:%d/metrics\n", options->metrics_port);
+    }
+
+    // Announce the receiver so discovery can find it without scanning
+    if (!options->no_announce && beacon_start(port, options) == 0) {
+        printf("Announcing on UDP port %d\n", BEACON_PORT);
+    }
+
     // Display server status
     printf("Listening on port %d...\n", port);
     printf("Server started. Waiting for connections...\n");
@@ -107,7 +218,7 @@ void receive_file(int port) {
         printf("Waiting for incoming connection...\n");
 
         // Accept incoming connection
-        SOCKADDR_IN_T client_addr;         // Structure to hold client address information
+        struct sockaddr_storage client_addr;  // Large enough for IPv4 and IPv6 clients
 
         // Platform-specific address length type
 #ifdef _WIN32
@@ -116,6 +227,7 @@ void receive_file(int port) {
         socklen_t client_addr_len = sizeof(client_addr); // POSIX uses socklen_t
 #endif
 
+        uint64_t probe_start = PROBE_START(accept);
         SOCKET_T client_socket = accept(server_socket, (struct sockaddr *)&client_addr, &client_addr_len);
         if (client_socket == INVALID_SOCKET_T) {
             perror("accept");              // Print system error for accept failure
@@ -125,38 +237,34 @@ void receive_file(int port) {
         // Optimize client socket for high-speed transfers
         optimize_socket(client_socket);
 
-        // Convert client IP address to string for display
-        char client_ip[INET_ADDRSTRLEN];   // Buffer for IP address string (IPv4 max 15 chars + null)
-        inet_ntop(AF_INET, &client_addr.sin_addr, client_ip, INET_ADDRSTRLEN);
-        printf("Connection established from %s:%d\n", client_ip, ntohs(client_addr.sin_port));
+        // Convert client address to strings for display
+        char client_ip[INET6_ADDRSTRLEN];  // Buffer for IP address string (IPv6 max 45 chars + null)
+        char client_port[8];
+        if (getnameinfo((struct sockaddr *)&client_addr, client_addr_len, client_ip, sizeof(client_ip),
+                        client_port, sizeof(client_port), NI_NUMERICHOST | NI_NUMERICSERV) != 0) {
+            snprintf(client_ip, sizeof(client_ip), "unknown");
+            snprintf(client_port, sizeof(client_port), "0");
+        }
+        // Show IPv4 clients of the dual-stack socket in dotted form
+        const char *display_ip = strncmp(client_ip, "::ffff:", 7) == 0 && strchr(client_ip, '.') ? client_ip + 7
+                                                                                                  : client_ip;
+        printf("Connection established from %s:%s\n", display_ip, client_port);
+        PROBE3(accept, (int)client_socket, display_ip, PROBE_ELAPSED(probe_start));
 
         // Detect transfer type and receive using appropriate protocol
-        int transfer_type = detect_transfer_type(client_socket);
-        if (transfer_type == -1) {
-            fprintf(stderr, "Error detecting transfer type\n");
-        } else if (transfer_type == 0) {
-            // Standard file transfer
-            if (recv_file_protocol(client_socket) != 0) {
-                fprintf(stderr, "Error receiving file\n");
-            }
-        } else if (transfer_type == 1) {
-            // Standard directory transfer
-            if (recv_directory_protocol(client_socket) != 0) {
-                fprintf(stderr, "Error receiving directory\n");
-            }
-        } else if (transfer_type == 2) {
-            // File transfer with target directory
-            if (recv_file_with_target_protocol(client_socket) != 0) {
-                fprintf(stderr, "Error receiving file with target directory\n");
-            }
-        } else if (transfer_type == 3) {
-            // Directory transfer with target directory
-            if (recv_directory_with_target_protocol(client_socket) != 0) {
-                fprintf(stderr, "Error receiving directory with target directory\n");
-            }
-        } else {
-            fprintf(stderr, "Error: Unknown transfer type %d\n", transfer_type);
+        PeerTuning tuning;
+        memset(&tuning, 0, sizeof(tuning));
+        if (!options->no_profile) {
+            peerprofile_begin(&tuning, client_socket);
         }
+        metrics_transfer_begin();
+        progress_begin("receive", display_ip);
+        chunktrace_begin(client_socket);
+        int result = receive_transfer(client_socket, options);
+        chunktrace_end();
+        peerprofile_end(&tuning, client_socket, progress_bytes(), result == 0);
+        metrics_transfer_end(result == 0);
+        progress_end(client_socket, result == 0);
 
         // Close client connection but keep server running
         close_socket(client_socket);
@@ -0,0 +1,315 @@
+/**
+ * @file sparse.c
+ * @brief Sparse file content stream implementation
+ *
+ * The sender reads data extents with pread() in adaptive chunks and splits
+ * every chunk into SPARSE_ZERO_BLOCK blocks: runs of non-zero blocks become
+ * DATA segments, all-zero blocks are added to the pending hole. Adjacent
+ * hole bytes (filesystem holes and zero blocks alike) are merged into a
+ * single HOLE segment before the next DATA segment goes out.
+ */
+
+#define _GNU_SOURCE  // Enable SEEK_DATA/SEEK_HOLE, pread() and fseeko() on Linux systems
+#include "sparse.h"
+#include "protocol.h"   // send_all/recv_all, recv_file_content, byte order helpers
+#include "adaptive.h"   // Adaptive chunk sizing
+#include "zeroscan.h"   // All-zero block detection
+#include "progress.h"   // JSON progress events
+#include "phases.h"     // Per-phase latency tracing
+#include "feedback.h"   // Receiver feedback frames
+#include <errno.h>
+#include <sys/types.h>
+#ifndef _WIN32
+#include <unistd.h>
+#else
+#include <io.h>         // _chsize_s()
+#endif
+
+/**
+ * @brief Find the next data extent of a file
+ */
+int sparse_next_extent(int fd, uint64_t offset, uint64_t file_size, uint64_t *data_start, uint64_t *data_end) {
+    if (offset >= file_size) {
+        return 1;
+    }
+
+    *data_start = offset;
+    *data_end = file_size;
+
+#if defined(SEEK_DATA) && defined(SEEK_HOLE)
+    off_t start = lseek(fd, (off_t)offset, SEEK_DATA);
+    if (start < 0) {
+        if (errno == ENXIO) {
+            return 1;  // Only a hole remains
+        }
+        return 0;  // Holes not supported here: everything is data
+    }
+    if ((uint64_t)start >= file_size) {
+        return 1;
+    }
+
+    off_t end = lseek(fd, start, SEEK_HOLE);
+    *data_start = (uint64_t)start;
+    if (end > start && (uint64_t)end < file_size) {
+        *data_end = (uint64_t)end;
+    }
+#else
+    (void)fd;
+#endif
+    return 0;
+}
+
+/**
+ * @brief Length of the block starting at pos, and whether it is all zeros
+ *
+ * Only full blocks count as zero blocks, so short tails are always data.
+ */
+static size_t next_block(const char *buffer, size_t pos, size_t len, int *is_zero) {
+    size_t block = len - pos < SPARSE_ZERO_BLOCK ? len - pos : SPARSE_ZERO_BLOCK;
+    *is_zero = block == SPARSE_ZERO_BLOCK && buffer_is_zero(buffer + pos, block);
+    return block;
+}
+
+/**
+ * @brief Send one segment header
+ */
+static int send_segment_header(SOCKET_T s, uint32_t type, uint64_t length) {
+    SparseSegmentHeader header;
+    header.type = htonl(type);
+    header.reserved = 0;
+    header.length = htonll(length);
+    return send_all(s, &header, SPARSE_SEGMENT_HEADER_SIZE);
+}
+
+/**
+ * @brief Send a pending hole, if any, as one HOLE segment
+ */
+static int flush_hole(SOCKET_T s, uint64_t *pending_hole, SparseStats *stats) {
+    if (*pending_hole == 0) {
+        return 0;
+    }
+    if (send_segment_header(s, SPARSE_SEGMENT_HOLE, *pending_hole) != 0) {
+        return -1;
+    }
+    stats->hole_bytes += *pending_hole;
+    *pending_hole = 0;
+    return 0;
+}
+
+/**
+ * @brief Read exactly len bytes at offset
+ */
+static int pread_full(int fd, char *buf, size_t len, uint64_t offset) {
+    size_t done = 0;
+    uint64_t phase_start = phases_clock();
+    while (done < len) {
+        ssize_t n = pread(fd, buf + done, len - done, (off_t)(offset + done));
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("pread");
+            return -1;
+        }
+        if (n == 0) {
+            fprintf(stderr, "Error: File shrank while it was being sent\n");
+            return -1;
+        }
+        done += (size_t)n;
+    }
+    phases_record(PHASE_DISK_READ, phase_start);
+    return 0;
+}
+
+/**
+ * @brief Send the first file_size bytes of a file as a segment stream
+ */
+int send_sparse_content(SOCKET_T s, FILE *file, uint64_t file_size, SparseStats *stats,
+                        TransferSession *session) {
+    SparseStats local_stats = {0, 0, 0};
+    if (!stats) {
+        stats = &local_stats;
+    }
+    memset(stats, 0, sizeof(SparseStats));
+
+    int fd = fileno(file);
+
+    // Without a transfer session, this file gets one of its own
+    TransferSession own_session;
+    if (!session) {
+        if (transfer_session_init(&own_session, file_size) != 0) {
+            return -1;
+        }
+    }
+    TransferSession *active = session ? session : &own_session;
+    AdaptiveState *adaptive = &active->adaptive;
+    char *buffer = active->buffer;
+    int result = 0;
+
+    uint64_t offset = 0;
+    uint64_t pending_hole = 0;
+    size_t chunk_size = adaptive_get_chunk_size(adaptive);
+    time_t chunk_start = progress_time();
+
+    while (offset < file_size && result == 0) {
+        uint64_t data_start, data_end;
+        if (sparse_next_extent(fd, offset, file_size, &data_start, &data_end) != 0) {
+            pending_hole += file_size - offset;  // Trailing hole
+            break;
+        }
+        pending_hole += data_start - offset;
+        offset = data_start;
+
+        while (offset < data_end && result == 0) {
+            size_t len = data_end - offset < chunk_size ? (size_t)(data_end - offset) : chunk_size;
+            if (pread_full(fd, buffer, len, offset) != 0) {
+                result = -1;
+                break;
+            }
+
+            // Split the chunk into runs of data blocks and zero blocks
+            size_t pos = 0;
+            while (pos < len && result == 0) {
+                int is_zero;
+                size_t run_end = pos + next_block(buffer, pos, len, &is_zero);
+                if (is_zero) {
+                    pending_hole += run_end - pos;
+                    stats->zero_bytes += run_end - pos;
+                    pos = run_end;
+                    continue;
+                }
+
+                while (run_end < len) {
+                    size_t block = next_block(buffer, run_end, len, &is_zero);
+                    if (is_zero) {
+                        break;
+                    }
+                    run_end += block;
+                }
+
+                if (flush_hole(s, &pending_hole, stats) != 0 ||
+                    send_segment_header(s, SPARSE_SEGMENT_DATA, run_end - pos) != 0 ||
+                    send_all(s, buffer + pos, run_end - pos) != 0) {
+                    result = -1;
+                    break;
+                }
+                stats->data_bytes += run_end - pos;
+                pos = run_end;
+            }
+            if (result != 0) {
+                break;
+            }
+            offset += len;
+
+            time_t chunk_end = progress_time();
+            double chunk_elapsed = difftime(chunk_end, chunk_start);
+            chunk_start = chunk_end;
+
+            progress_chunk(len, chunk_size);
+            if (active->feedback) {
+                feedback_sender_poll(active->feedback, adaptive);
+            }
+            adaptive_update(adaptive, len, chunk_elapsed);
+            chunk_size = adaptive_get_chunk_size(adaptive);
+        }
+    }
+
+    if (!session) {
+        transfer_session_free(&own_session);
+    }
+    if (result != 0) {
+        return -1;
+    }
+
+    if (flush_hole(s, &pending_hole, stats) != 0 ||
+        send_segment_header(s, SPARSE_SEGMENT_END, 0) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Receive the segments of a stream with a session's adaptive state
+ */
+static int recv_segments(SOCKET_T s, FILE *file, uint64_t file_size, SparseStats *stats,
+                         TransferSession *session) {
+    uint64_t offset = 0;
+    while (1) {
+        SparseSegmentHeader header;
+        if (recv_all(s, &header, SPARSE_SEGMENT_HEADER_SIZE) != 0) {
+            return -1;
+        }
+
+        uint32_t type = ntohl(header.type);
+        uint64_t length = ntohll(header.length);
+
+        if (type == SPARSE_SEGMENT_END) {
+            break;
+        }
+        if ((type != SPARSE_SEGMENT_DATA && type != SPARSE_SEGMENT_HOLE) ||
+            length > file_size - offset) {
+            fprintf(stderr, "Error: Invalid sparse segment\n");
+            return -1;
+        }
+
+        if (type == SPARSE_SEGMENT_DATA) {
+            // Seeking past the end leaves the skipped range unallocated
+            if (fseeko(file, (off_t)offset, SEEK_SET) != 0) {
+                perror("fseeko");
+                return -1;
+            }
+            if (recv_file_content(s, file, length, session) != 0) {
+                return -1;
+            }
+            stats->data_bytes += length;
+        } else {
+            stats->hole_bytes += length;
+        }
+        offset += length;
+    }
+
+    if (offset != file_size) {
+        fprintf(stderr, "Error: Sparse stream ended at %llu of %llu bytes\n",
+                (unsigned long long)offset, (unsigned long long)file_size);
+        return -1;
+    }
+
+    // A trailing hole only exists once the size is set
+    if (fflush(file) != 0) {
+        perror("fflush");
+        return -1;
+    }
+#ifdef _WIN32
+    if (_chsize_s(_fileno(file), (long long)file_size) != 0) {
+#else
+    if (ftruncate(fileno(file), (off_t)file_size) != 0) {
+#endif
+        perror("ftruncate");
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Receive a segment stream into a file, leaving holes unwritten
+ */
+int recv_sparse_content(SOCKET_T s, FILE *file, uint64_t file_size, SparseStats *stats,
+                        TransferSession *session) {
+    SparseStats local_stats = {0, 0, 0};
+    if (!stats) {
+        stats = &local_stats;
+    }
+    memset(stats, 0, sizeof(SparseStats));
+
+    // Without a transfer session, the data segments of this file share one
+    if (session) {
+        return recv_segments(s, file, file_size, stats, session);
+    }
+    TransferSession own_session;
+    if (transfer_session_init(&own_session, file_size) != 0) {
+        return -1;
+    }
+    int result = recv_segments(s, file, file_size, stats, &own_session);
+    transfer_session_free(&own_session);
+    return result;
+}
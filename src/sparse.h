@@ -0,0 +1,93 @@
+/**
+ * @file sparse.h
+ * @brief Sparse file content streams for NETTF file transfer tool
+ *
+ * Sends file content as a sequence of segments so holes never cross the
+ * network: the sender enumerates data extents with SEEK_DATA/SEEK_HOLE,
+ * describes everything else as a hole, and also turns all-zero blocks
+ * inside data extents into holes (see zeroscan.h); the receiver seeks over
+ * holes and sets the final size, so its copy stays sparse.
+ *
+ * Segment stream (all integers in network byte order):
+ *   SparseSegmentHeader, then length bytes for DATA segments only,
+ *   repeated until a SPARSE_SEGMENT_END segment
+ */
+
+#ifndef SPARSE_H
+#define SPARSE_H
+
+#include "platform.h"  // Cross-platform socket types and functions
+#include "protocol.h"  // TransferSession
+#include <stdint.h>
+
+// Wire size of a segment header
+#define SPARSE_SEGMENT_HEADER_SIZE 16
+
+// Granularity of zero-block detection inside data extents (filesystem block size)
+#define SPARSE_ZERO_BLOCK 4096
+
+// Segment types
+#define SPARSE_SEGMENT_DATA 0  // length bytes of file data follow
+#define SPARSE_SEGMENT_HOLE 1  // length bytes of zeros, nothing follows
+#define SPARSE_SEGMENT_END  2  // End of the file content
+
+/**
+ * @brief Segment header
+ */
+typedef struct {
+    uint32_t type;      // SPARSE_SEGMENT_* type
+    uint32_t reserved;  // Must be 0
+    uint64_t length;    // Number of file bytes the segment covers
+} SparseSegmentHeader;
+
+/**
+ * @brief Byte counts of a sparse transfer
+ */
+typedef struct {
+    uint64_t data_bytes;  // Bytes sent or received as data
+    uint64_t hole_bytes;  // Bytes described as holes
+    uint64_t zero_bytes;  // Of those, all-zero blocks found inside data extents (sender only)
+} SparseStats;
+
+/**
+ * @brief Find the next data extent of a file
+ *
+ * Falls back to treating the rest of the file as data where the platform
+ * or filesystem cannot report holes.
+ *
+ * @param fd File descriptor
+ * @param offset Offset to search from
+ * @param file_size Size of the file (extents are clipped to it)
+ * @param data_start Output: first byte of the extent
+ * @param data_end Output: end of the extent (exclusive)
+ * @return 0 if an extent was found, 1 if there is no data after offset
+ */
+int sparse_next_extent(int fd, uint64_t offset, uint64_t file_size, uint64_t *data_start, uint64_t *data_end);
+
+/**
+ * @brief Send the first file_size bytes of a file as a segment stream
+ *
+ * @param s Socket descriptor
+ * @param file File opened for reading
+ * @param file_size Number of bytes to send
+ * @param stats Output: data and hole byte counts (may be NULL)
+ * @param session Session of the transfer, NULL for a session of this file only
+ * @return 0 on success, -1 on error (including a file that shrank)
+ */
+int send_sparse_content(SOCKET_T s, FILE *file, uint64_t file_size, SparseStats *stats,
+                        TransferSession *session);
+
+/**
+ * @brief Receive a segment stream into a file, leaving holes unwritten
+ *
+ * @param s Socket descriptor
+ * @param file Newly created (empty) file opened for writing
+ * @param file_size Size the file must have when the stream ends
+ * @param stats Output: data and hole byte counts (may be NULL)
+ * @param session Session of the transfer, NULL for a session of this file only
+ * @return 0 on success, -1 on error
+ */
+int recv_sparse_content(SOCKET_T s, FILE *file, uint64_t file_size, SparseStats *stats,
+                        TransferSession *session);
+
+#endif // SPARSE_H
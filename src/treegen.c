@@ -0,0 +1,267 @@
+/**
+ * @file treegen.c
+ * @brief Reproducible synthetic files and directory trees implementation
+ *
+ * One xorshift64* generator seeded from the specification decides file
+ * placement and sizes in order; file content is generated from a second
+ * seed derived from the file index, so changing the content kind does not
+ * move files around.
+ */
+
+#define _GNU_SOURCE  // Enable strtoull() and mkdir() on Linux systems
+#include "treegen.h"
+#include "protocol.h"  // create_directory_recursive()
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+// Block size for writing generated content
+#define TREEGEN_BLOCK_SIZE (1024 * 1024)
+
+// Longest path of a generated file
+#define TREEGEN_MAX_PATH 4096
+
+// Words of the compressible text data
+static const char *text_words[] = {
+    "the", "of", "and", "to", "in", "a", "is", "that", "for", "it", "as", "was", "with", "be",
+    "by", "on", "not", "he", "this", "are", "or", "his", "from", "at", "which", "but", "have",
+    "an", "had", "they", "you", "were", "their", "one", "all", "we", "can", "her", "has",
+    "there", "been", "if", "more", "when", "will", "would", "who", "so", "no", "transfer"
+};
+
+/**
+ * @brief Next value of a xorshift64* generator
+ */
+uint64_t treegen_random(uint64_t *state) {
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545F4914F6CDD1DULL;
+}
+
+/**
+ * @brief Non-zero generator state for a seed
+ */
+uint64_t treegen_seed_state(uint64_t seed) {
+    return seed * 0x9E3779B97F4A7C15ULL + 1;
+}
+
+/**
+ * @brief Fill a block with generated content
+ */
+static void fill_block(unsigned char *block, size_t size, TreegenData data, uint64_t *state) {
+    if (data == TREEGEN_DATA_ZEROS) {
+        memset(block, 0, size);
+    } else if (data == TREEGEN_DATA_RANDOM) {
+        size_t i = 0;
+        for (; i + 8 <= size; i += 8) {
+            uint64_t value = treegen_random(state);
+            memcpy(block + i, &value, 8);
+        }
+        for (; i < size; i++) {
+            block[i] = (unsigned char)treegen_random(state);
+        }
+    } else {
+        size_t words = sizeof(text_words) / sizeof(text_words[0]);
+        size_t i = 0;
+        while (i < size) {
+            uint64_t value = treegen_random(state);
+            const char *word = text_words[value % words];
+            while (*word && i < size) {
+                block[i++] = (unsigned char)*word++;
+            }
+            if (i < size) {
+                block[i++] = (value >> 32) % 12 == 0 ? '\n' : ' ';
+            }
+        }
+    }
+}
+
+/**
+ * @brief Draw a file size from the log-uniform distribution of a spec
+ */
+static uint64_t draw_size(const TreegenSpec *spec, uint64_t *state) {
+    if (spec->max_size <= spec->min_size) {
+        return spec->min_size;
+    }
+
+    // Pick a power of two uniformly, then a size within it
+    uint64_t low = spec->min_size > 0 ? spec->min_size : 1;
+    int low_bit = 63 - __builtin_clzll(low);
+    int high_bit = 63 - __builtin_clzll(spec->max_size);
+    int bit = low_bit + (int)(treegen_random(state) % (uint64_t)(high_bit - low_bit + 1));
+    uint64_t from = 1ULL << bit;
+    uint64_t to = bit == 63 ? UINT64_MAX : (1ULL << (bit + 1)) - 1;
+    if (from < spec->min_size) {
+        from = spec->min_size;
+    }
+    if (to > spec->max_size) {
+        to = spec->max_size;
+    }
+    return from + treegen_random(state) % (to - from + 1);
+}
+
+/**
+ * @brief Parse a file size such as "4K"
+ */
+int treegen_parse_size(const char *text, const char **end, uint64_t *size) {
+    char *p;
+    if (*text < '0' || *text > '9') {
+        return -1;
+    }
+    errno = 0;
+    unsigned long long value = strtoull(text, &p, 10);
+    if (errno != 0) {
+        return -1;
+    }
+    if (*p == 'K' || *p == 'k') {
+        value *= 1024ULL;
+        p++;
+    } else if (*p == 'M' || *p == 'm') {
+        value *= 1024ULL * 1024;
+        p++;
+    } else if (*p == 'G' || *p == 'g') {
+        value *= 1024ULL * 1024 * 1024;
+        p++;
+    }
+    *end = p;
+    *size = value;
+    return 0;
+}
+
+/**
+ * @brief Parse a size distribution
+ */
+int treegen_parse_sizes(const char *text, TreegenSpec *spec) {
+    const char *end;
+    uint64_t min_size, max_size;
+    if (treegen_parse_size(text, &end, &min_size) != 0) {
+        return -1;
+    }
+    max_size = min_size;
+    if (*end == '-' && treegen_parse_size(end + 1, &end, &max_size) != 0) {
+        return -1;
+    }
+    if (*end != '\0' || max_size < min_size) {
+        return -1;
+    }
+    spec->min_size = min_size;
+    spec->max_size = max_size;
+    return 0;
+}
+
+/**
+ * @brief Write a file of generated content
+ */
+int treegen_write_file(const char *path, uint64_t size, TreegenData data, uint64_t seed) {
+    static unsigned char block[TREEGEN_BLOCK_SIZE];
+    uint64_t state = treegen_seed_state(seed);
+
+    FILE *file = fopen(path, "wb");
+    if (!file) {
+        fprintf(stderr, "Error: Cannot create %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    uint64_t remaining = size;
+    while (remaining > 0) {
+        size_t chunk = remaining < TREEGEN_BLOCK_SIZE ? (size_t)remaining : TREEGEN_BLOCK_SIZE;
+        fill_block(block, chunk, data, &state);
+        if (fwrite(block, 1, chunk, file) != chunk) {
+            fprintf(stderr, "Error: Cannot write %s: %s\n", path, strerror(errno));
+            fclose(file);
+            return -1;
+        }
+        remaining -= chunk;
+    }
+    if (fclose(file) != 0) {
+        fprintf(stderr, "Error: Cannot write %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Generate a tree in a new directory
+ */
+int treegen_build(const char *root, const TreegenSpec *spec, uint64_t *dirs, uint64_t *bytes) {
+    *dirs = 0;
+    *bytes = 0;
+
+    // Count the directories first to bound memory
+    uint64_t count = 1;
+    uint64_t level_size = 1;
+    for (int level = 0; level < spec->depth; level++) {
+        level_size *= (uint64_t)spec->fanout;
+        count += level_size;
+        if (level_size > TREEGEN_MAX_DIRS || count > TREEGEN_MAX_DIRS) {
+            fprintf(stderr, "Error: Tree of depth %d and fanout %d has more than %d directories\n",
+                    spec->depth, spec->fanout, TREEGEN_MAX_DIRS);
+            return -1;
+        }
+    }
+    if (create_directory_recursive(root) != 0) {
+        return -1;
+    }
+
+    // Directory paths relative to root, in breadth-first order
+    char **paths = calloc((size_t)count, sizeof(char *));
+    if (!paths) {
+        fprintf(stderr, "Error: Out of memory for %llu directories\n", (unsigned long long)count);
+        return -1;
+    }
+    paths[0] = strdup("");
+    uint64_t used = paths[0] ? 1 : 0;
+    int result = paths[0] ? 0 : -1;
+    char path[TREEGEN_MAX_PATH];
+
+    uint64_t level_start = 0;
+    uint64_t level_end = used;
+    for (int level = 0; level < spec->depth && result == 0; level++) {
+        for (uint64_t parent = level_start; parent < level_end && result == 0; parent++) {
+            for (int child = 0; child < spec->fanout && result == 0; child++) {
+                int n = snprintf(path, sizeof(path), "%s%sd%d", paths[parent], *paths[parent] ? "/" : "", child);
+                paths[used] = n > 0 && (size_t)n < sizeof(path) ? strdup(path) : NULL;
+                if (!paths[used]) {
+                    fprintf(stderr, "Error: Cannot name directory below %s/%s\n", root, paths[parent]);
+                    result = -1;
+                    break;
+                }
+                used++;
+
+                n = snprintf(path, sizeof(path), "%s/%s", root, paths[used - 1]);
+                if (n < 0 || (size_t)n >= sizeof(path) || (mkdir(path, 0755) != 0 && errno != EEXIST)) {
+                    fprintf(stderr, "Error: Cannot create %s: %s\n", path, strerror(errno));
+                    result = -1;
+                }
+            }
+        }
+        level_start = level_end;
+        level_end = used;
+    }
+
+    // Place and write the files
+    uint64_t state = treegen_seed_state(spec->seed);
+    for (uint64_t i = 0; i < spec->files && result == 0; i++) {
+        const char *dir = paths[treegen_random(&state) % used];
+        uint64_t size = draw_size(spec, &state);
+        int n = snprintf(path, sizeof(path), "%s/%s%sf%08llu.dat", root, dir, *dir ? "/" : "",
+                         (unsigned long long)i);
+        if (n < 0 || (size_t)n >= sizeof(path)) {
+            fprintf(stderr, "Error: Path too long below %s\n", root);
+            result = -1;
+        } else if (treegen_write_file(path, size, spec->data, spec->seed ^ (i + 1) * 0xD1B54A32D192ED03ULL) != 0) {
+            result = -1;
+        } else {
+            *bytes += size;
+        }
+    }
+
+    *dirs = used > 0 ? used - 1 : 0;
+    for (uint64_t i = 0; i < used; i++) {
+        free(paths[i]);
+    }
+    free(paths);
+    return result;
+}
@@ -0,0 +1,116 @@
+/**
+ * @file treegen.h
+ * @brief Reproducible synthetic files and directory trees for benchmarks
+ *
+ * Generates file content (zeros, pseudo-random bytes or compressible text)
+ * and whole directory trees of a given depth, fanout, file count and size
+ * distribution. Everything is derived from a seed: the same specification
+ * produces the same names, sizes and content on every machine, so results
+ * measured on different builds or hosts are comparable.
+ *
+ * Trees scale to millions of files; only the directory list is held in
+ * memory while a tree is generated.
+ */
+
+#ifndef TREEGEN_H
+#define TREEGEN_H
+
+#include <stdint.h>
+
+// Most directories a generated tree may have
+#define TREEGEN_MAX_DIRS 1000000
+
+// Default tree shape
+#define TREEGEN_DEFAULT_DEPTH 3
+#define TREEGEN_DEFAULT_FANOUT 8
+#define TREEGEN_DEFAULT_SIZES "512-16K"
+
+/**
+ * @brief Content of generated files
+ */
+typedef enum {
+    TREEGEN_DATA_ZEROS = 0,  // All zero bytes
+    TREEGEN_DATA_RANDOM,     // Pseudo-random bytes, distinct per file
+    TREEGEN_DATA_TEXT        // Compressible text made of common words
+} TreegenData;
+
+/**
+ * @brief Shape of a generated tree
+ *
+ * Directories form a complete tree: the root has fanout subdirectories, each
+ * of which has fanout subdirectories, down to depth levels. Files are spread
+ * over all directories (the root included) at random. File sizes are drawn
+ * log-uniformly between min_size and max_size: a power of two is picked
+ * uniformly, then a size within it, so small files dominate the count while
+ * large ones dominate the bytes, as in real trees.
+ */
+typedef struct {
+    int depth;          // Directory levels below the root
+    int fanout;         // Subdirectories per directory
+    uint64_t files;     // Files in the whole tree
+    uint64_t min_size;  // Smallest file size
+    uint64_t max_size;  // Largest file size (equal to min_size for a fixed size)
+    uint64_t seed;      // Seed for placement, sizes and content
+    TreegenData data;   // File content
+} TreegenSpec;
+
+/**
+ * @brief Initial state of the pseudo-random generator for a seed
+ *
+ * @param seed Any value, zero included
+ * @return Non-zero generator state
+ */
+uint64_t treegen_seed_state(uint64_t seed);
+
+/**
+ * @brief Next value of the pseudo-random generator (xorshift64*)
+ *
+ * Fast and reproducible on every platform, but not for cryptographic use.
+ *
+ * @param state Input/output: generator state from treegen_seed_state()
+ * @return Next pseudo-random value
+ */
+uint64_t treegen_random(uint64_t *state);
+
+/**
+ * @brief Parse a file size such as "4096", "4K", "1M" or "2G"
+ *
+ * @param text Size (suffixes K, M and G are powers of 1024)
+ * @param end Output: first character after the size
+ * @param size Output: size in bytes
+ * @return 0 on success, -1 if text does not start with a size
+ */
+int treegen_parse_size(const char *text, const char **end, uint64_t *size);
+
+/**
+ * @brief Parse a size distribution: a fixed size ("4K") or a range ("512-16K")
+ *
+ * @param text Size or range
+ * @param spec Specification to update (min_size and max_size)
+ * @return 0 on success, -1 on an invalid size or an empty range
+ */
+int treegen_parse_sizes(const char *text, TreegenSpec *spec);
+
+/**
+ * @brief Write a file of generated content
+ *
+ * @param path File to create
+ * @param size File size
+ * @param data Kind of content
+ * @param seed Distinguishes the content of random and text files
+ * @return 0 on success, -1 on error (message printed)
+ */
+int treegen_write_file(const char *path, uint64_t size, TreegenData data, uint64_t seed);
+
+/**
+ * @brief Generate a tree in a new directory
+ *
+ * @param root Directory to create the tree in (created if missing)
+ * @param spec Shape of the tree
+ * @param dirs Output: directories created below root
+ * @param bytes Output: total size of the files
+ * @return 0 on success, -1 on error (message printed)
+ */
+int treegen_build(const char *root, const TreegenSpec *spec, uint64_t *dirs, uint64_t *bytes);
+
+#endif // TREEGEN_H
@@ -0,0 +1,587 @@
+/**
+ * @file verify.c
+ * @brief Remote verification protocol implementation
+ *
+ * The verifying side walks its tree, hashes files in batches on a thread pool
+ * and streams the digests from a writer thread while the main thread reads
+ * and reports the receiver's answers, so hashing on both ends overlaps with
+ * the exchange. Only digests and mismatch lists cross the network.
+ */
+
+#define _GNU_SOURCE  // Enable strdup() on Linux systems
+#include "verify.h"
+#include "protocol.h"   // send_all/recv_all, byte order helpers, formatting
+#include "hash.h"       // Range hashing
+#include "filelist.h"   // Tree walking
+#include "hashcache.h"  // Persistent digest cache
+#include <pthread.h>
+#include <errno.h>
+
+/**
+ * @brief Shared state between the verify writer thread and the reader
+ */
+typedef struct {
+    SOCKET_T s;
+    const FileList *files;
+    uint64_t range_size;
+    HashCache *cache;        // Digest cache (NULL to always hash)
+    uint64_t bytes_hashed;   // Local bytes covered by digests
+    uint64_t bytes_sent;     // Digest bytes sent
+    uint64_t local_errors;   // Local files that could not be read
+    int failed;              // Set if the connection broke
+} VerifyWriter;
+
+/**
+ * @brief Send one verification entry (header, path, digests)
+ *
+ * Digests are converted to network byte order in place and sent in one call.
+ */
+static int send_verify_entry(VerifyWriter *w, const FileEntry *entry, uint64_t *digests, uint64_t range_count) {
+    uint64_t path_len = strlen(entry->relative_path);
+
+    VerifyEntryHeader header;
+    header.file_size = htonll(entry->size);
+    header.path_len = htonll(path_len);
+    header.range_count = htonll(range_count);
+
+    if (send_all(w->s, &header, VERIFY_ENTRY_HEADER_SIZE) != 0 ||
+        send_all(w->s, entry->relative_path, path_len) != 0) {
+        return -1;
+    }
+
+    for (uint64_t i = 0; i < range_count; i++) {
+        digests[i] = htonll(digests[i]);
+    }
+    if (range_count > 0 && send_all(w->s, digests, range_count * sizeof(uint64_t)) != 0) {
+        return -1;
+    }
+
+    w->bytes_sent += VERIFY_ENTRY_HEADER_SIZE + path_len + range_count * sizeof(uint64_t);
+    return 0;
+}
+
+/**
+ * @brief Writer thread: hash the local tree batch by batch and stream digests
+ */
+static void *verify_writer_thread(void *arg) {
+    VerifyWriter *w = (VerifyWriter *)arg;
+    const FileList *files = w->files;
+
+    for (size_t start = 0; start < files->count; start += VERIFY_BATCH_FILES) {
+        size_t batch = files->count - start;
+        if (batch > VERIFY_BATCH_FILES) {
+            batch = VERIFY_BATCH_FILES;
+        }
+
+        HashJob jobs[VERIFY_BATCH_FILES];
+        const FileEntry *entries[VERIFY_BATCH_FILES];
+        memset(jobs, 0, sizeof(jobs));
+
+        for (size_t i = 0; i < batch; i++) {
+            const FileEntry *entry = &files->entries[start + i];
+            entries[i] = entry;
+            jobs[i].path = entry->full_path;
+            jobs[i].file_size = entry->size;
+            jobs[i].range_count = hash_range_count(entry->size, w->range_size);
+            jobs[i].digests = calloc(jobs[i].range_count ? jobs[i].range_count : 1, sizeof(uint64_t));
+            if (!jobs[i].digests) {
+                perror("calloc");
+                for (size_t k = 0; k < i; k++) {
+                    free(jobs[k].digests);
+                }
+                w->failed = 1;
+                shutdown(w->s, SHUT_RDWR);  // Wake up the reader
+                return NULL;
+            }
+        }
+
+        // Unchanged files are served from the cache without being read
+        hashcache_hash_files(w->cache, entries, jobs, batch, w->range_size);
+
+        int send_failed = 0;
+        for (size_t i = 0; i < batch; i++) {
+            const FileEntry *entry = &files->entries[start + i];
+            if (jobs[i].status != 0) {
+                fprintf(stderr, "Error: Could not read local file '%s'\n", entry->full_path);
+                w->local_errors++;
+            } else {
+                w->bytes_hashed += entry->size;
+            }
+
+            if (!send_failed && send_verify_entry(w, entry, jobs[i].digests, jobs[i].range_count) != 0) {
+                send_failed = 1;
+            }
+            free(jobs[i].digests);
+        }
+
+        if (send_failed) {
+            w->failed = 1;
+            shutdown(w->s, SHUT_RDWR);  // Wake up the reader
+            return NULL;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Print the mismatching ranges of one file
+ */
+static void print_range_runs(const VerifyRangeRun *runs, uint32_t run_count, uint64_t range_size) {
+    const uint32_t max_shown = 8;
+    char size_str[32];
+    format_bytes(range_size, size_str, sizeof(size_str));
+
+    printf("    ranges (%s each):", size_str);
+    for (uint32_t i = 0; i < run_count && i < max_shown; i++) {
+        if (runs[i].range_count == 1) {
+            printf(" %llu", (unsigned long long)runs[i].first_range);
+        } else {
+            printf(" %llu-%llu", (unsigned long long)runs[i].first_range,
+                   (unsigned long long)(runs[i].first_range + runs[i].range_count - 1));
+        }
+    }
+    if (run_count > max_shown) {
+        printf(" ... (%u more runs)", run_count - max_shown);
+    }
+    printf("\n");
+}
+
+/**
+ * @brief Verify a local file or directory against a receiver
+ */
+int send_verify_protocol(SOCKET_T s, const char *path, const char *target_dir, int use_cache) {
+    // Validate and sanitize target directory
+    char sanitized_target[4096] = {0};
+    if (target_dir && validate_target_directory(target_dir, sanitized_target, sizeof(sanitized_target)) != 0) {
+        return -1;
+    }
+
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        perror("stat");
+        return -1;
+    }
+
+    // Relative paths mirror what the send protocols create on the receiver
+    char base_name[1024];
+    path_base_name(path, base_name, sizeof(base_name));
+
+    FileList files;
+    filelist_init(&files);
+    int list_result;
+    if (S_ISDIR(st.st_mode)) {
+        list_result = filelist_add_directory(&files, path, base_name);
+    } else {
+        list_result = filelist_add(&files, path, base_name, &st);
+    }
+    if (list_result != 0) {
+        filelist_free(&files);
+        return -1;
+    }
+
+    char total_str[32];
+    format_bytes(files.total_size, total_str, sizeof(total_str));
+    printf("Verifying %s (%llu files, %s)", base_name, (unsigned long long)files.count, total_str);
+    if (sanitized_target[0] != '\0') {
+        printf(" against %s/", sanitized_target);
+    }
+    printf("\n");
+
+    // Send magic number and session header
+    uint64_t target_dir_len = strlen(sanitized_target);
+    uint32_t magic = htonl(VERIFY_MAGIC);
+    VerifyHeader header;
+    header.total_files = htonll(files.count);
+    header.range_size = htonll(VERIFY_RANGE_SIZE);
+    header.target_dir_len = htonll(target_dir_len);
+
+    if (send_all(s, &magic, MAGIC_SIZE) != 0 ||
+        send_all(s, &header, VERIFY_HEADER_SIZE) != 0 ||
+        (target_dir_len > 0 && send_all(s, sanitized_target, target_dir_len) != 0)) {
+        filelist_free(&files);
+        return -1;
+    }
+
+    time_t start_time = time(NULL);
+
+    HashCache cache;
+    int cache_open = use_cache && hashcache_open(&cache) == 0;
+
+    // Stream digests from a writer thread while this thread reads the answers
+    VerifyWriter writer;
+    memset(&writer, 0, sizeof(writer));
+    writer.s = s;
+    writer.files = &files;
+    writer.range_size = VERIFY_RANGE_SIZE;
+    writer.cache = cache_open ? &cache : NULL;
+
+    pthread_t writer_thread;
+    if (pthread_create(&writer_thread, NULL, verify_writer_thread, &writer) != 0) {
+        fprintf(stderr, "Error: Could not start verify writer thread\n");
+        if (cache_open) {
+            hashcache_close(&cache);
+        }
+        filelist_free(&files);
+        return -1;
+    }
+
+    uint64_t identical = 0, differing = 0, missing = 0, remote_errors = 0;
+    uint64_t bytes_received = 0;
+    int failed = 0;
+
+    for (size_t i = 0; i < files.count; i++) {
+        const FileEntry *entry = &files.entries[i];
+        VerifyResult result;
+        if (recv_all(s, &result, VERIFY_RESULT_SIZE) != 0) {
+            failed = 1;
+            break;
+        }
+
+        uint32_t status = ntohl(result.status);
+        uint32_t run_count = ntohl(result.run_count);
+        uint64_t remote_size = ntohll(result.remote_size);
+        bytes_received += VERIFY_RESULT_SIZE + (uint64_t)run_count * VERIFY_RUN_SIZE;
+
+        VerifyRangeRun *runs = NULL;
+        if (run_count > 0) {
+            runs = malloc((size_t)run_count * sizeof(VerifyRangeRun));
+            if (!runs) {
+                perror("malloc");
+                failed = 1;
+                break;
+            }
+            if (recv_all(s, runs, (size_t)run_count * VERIFY_RUN_SIZE) != 0) {
+                free(runs);
+                failed = 1;
+                break;
+            }
+            for (uint32_t r = 0; r < run_count; r++) {
+                runs[r].first_range = ntohll(runs[r].first_range);
+                runs[r].range_count = ntohll(runs[r].range_count);
+            }
+        }
+
+        switch (status) {
+            case VERIFY_STATUS_MATCH:
+                identical++;
+                break;
+            case VERIFY_STATUS_MISMATCH:
+                differing++;
+                printf("  MISMATCH %s\n", entry->relative_path);
+                print_range_runs(runs, run_count, VERIFY_RANGE_SIZE);
+                break;
+            case VERIFY_STATUS_SIZE_MISMATCH:
+                differing++;
+                printf("  SIZE     %s (local %llu bytes, remote %llu bytes)\n", entry->relative_path,
+                       (unsigned long long)entry->size, (unsigned long long)remote_size);
+                print_range_runs(runs, run_count, VERIFY_RANGE_SIZE);
+                break;
+            case VERIFY_STATUS_MISSING:
+                missing++;
+                printf("  MISSING  %s\n", entry->relative_path);
+                break;
+            default:
+                remote_errors++;
+                printf("  ERROR    %s (receiver could not read its copy)\n", entry->relative_path);
+                break;
+        }
+
+        free(runs);
+    }
+
+    if (failed) {
+        shutdown(s, SHUT_RDWR);  // Unblock the writer if it is still sending
+    }
+    pthread_join(writer_thread, NULL);
+
+    // Digests computed before a lost connection are still valid
+    uint64_t cache_hits = 0;
+    if (cache_open) {
+        cache_hits = cache.hits;
+        hashcache_save(&cache);
+        hashcache_close(&cache);
+    }
+
+    if (failed || writer.failed) {
+        fprintf(stderr, "Error: Verification aborted (connection lost)\n");
+        filelist_free(&files);
+        return -1;
+    }
+
+    double elapsed_seconds = difftime(time(NULL), start_time);
+    char hashed_str[32], exchanged_str[32], elapsed_str[32];
+    format_bytes(writer.bytes_hashed, hashed_str, sizeof(hashed_str));
+    format_bytes(writer.bytes_sent + bytes_received, exchanged_str, sizeof(exchanged_str));
+    format_time((int)elapsed_seconds, elapsed_str, sizeof(elapsed_str));
+
+    printf("\nVerification complete: %llu identical, %llu differing, %llu missing, %llu errors\n",
+           (unsigned long long)identical, (unsigned long long)differing,
+           (unsigned long long)missing, (unsigned long long)(remote_errors + writer.local_errors));
+    printf("Checked %s locally, exchanged %s of digests in %s\n", hashed_str, exchanged_str, elapsed_str);
+    if (cache_hits > 0) {
+        printf("%llu of %llu files served from the hash cache\n",
+               (unsigned long long)cache_hits, (unsigned long long)files.count);
+    }
+
+    filelist_free(&files);
+    return (int)(differing + missing + remote_errors + writer.local_errors);
+}
+
+/**
+ * @brief One received entry awaiting comparison on the receiver
+ */
+typedef struct {
+    char *path;                // Relative path as received
+    uint64_t file_size;        // Sender's size
+    uint64_t range_count;      // Sender's range count
+    uint64_t *remote_digests;  // Sender's digests
+    uint64_t local_size;       // Receiver's size
+    uint64_t local_ranges;     // Receiver's ranges that overlap the sender's
+    uint64_t *local_digests;   // Receiver's digests (NULL if no local copy)
+    uint32_t status;           // Pre-hash status (MISSING/ERROR) or MATCH
+} PendingEntry;
+
+/**
+ * @brief Compare one entry and send its result with the mismatching ranges
+ */
+static int send_verify_result(SOCKET_T s, const PendingEntry *p, uint64_t *identical) {
+    uint32_t status = p->status;
+    VerifyRangeRun *runs = NULL;
+    uint32_t run_count = 0;
+
+    if (status == VERIFY_STATUS_MATCH) {
+        size_t run_capacity = 0;
+
+        // Both sides use the same range size, so compare range by range
+        if (p->local_size != p->file_size) {
+            status = VERIFY_STATUS_SIZE_MISMATCH;
+        }
+
+        for (uint64_t r = 0; r < p->range_count; r++) {
+            int differs = (r >= p->local_ranges) || (p->local_digests[r] != p->remote_digests[r]);
+            if (!differs) {
+                continue;
+            }
+
+            if (run_count > 0 && runs[run_count - 1].first_range + runs[run_count - 1].range_count == r) {
+                runs[run_count - 1].range_count++;
+                continue;
+            }
+
+            if (run_count == run_capacity) {
+                size_t new_capacity = run_capacity ? run_capacity * 2 : 16;
+                VerifyRangeRun *grown = realloc(runs, new_capacity * sizeof(VerifyRangeRun));
+                if (!grown) {
+                    perror("realloc");
+                    free(runs);
+                    return -1;
+                }
+                runs = grown;
+                run_capacity = new_capacity;
+            }
+            runs[run_count].first_range = r;
+            runs[run_count].range_count = 1;
+            run_count++;
+        }
+
+        if (status == VERIFY_STATUS_MATCH && run_count > 0) {
+            status = VERIFY_STATUS_MISMATCH;
+        }
+    }
+
+    if (status == VERIFY_STATUS_MATCH) {
+        (*identical)++;
+    }
+
+    VerifyResult result;
+    result.status = htonl(status);
+    result.run_count = htonl(run_count);
+    result.remote_size = htonll(p->local_size);
+
+    int rc = send_all(s, &result, VERIFY_RESULT_SIZE);
+    if (rc == 0 && run_count > 0) {
+        for (uint32_t i = 0; i < run_count; i++) {
+            runs[i].first_range = htonll(runs[i].first_range);
+            runs[i].range_count = htonll(runs[i].range_count);
+        }
+        rc = send_all(s, runs, (size_t)run_count * VERIFY_RUN_SIZE);
+    }
+
+    free(runs);
+    return rc;
+}
+
+/**
+ * @brief Answer a verification request (receiver side)
+ */
+int recv_verify_protocol(SOCKET_T s) {
+    VerifyHeader header;
+    if (recv_all(s, &header, VERIFY_HEADER_SIZE) != 0) {
+        return -1;
+    }
+
+    uint64_t total_files = ntohll(header.total_files);
+    uint64_t range_size = ntohll(header.range_size);
+    uint64_t target_dir_len = ntohll(header.target_dir_len);
+
+    if (range_size < VERIFY_MIN_RANGE_SIZE || range_size > VERIFY_MAX_RANGE_SIZE) {
+        fprintf(stderr, "Error: Unsupported verification range size %llu\n", (unsigned long long)range_size);
+        return -1;
+    }
+    if (target_dir_len >= 4096) {
+        fprintf(stderr, "Error: Target directory path too long\n");
+        return -1;
+    }
+
+    // Receive and validate target directory (if specified)
+    char target_dir[4096] = {0};
+    char sanitized_target[4096] = {0};
+    if (target_dir_len > 0) {
+        if (recv_all(s, target_dir, target_dir_len) != 0) {
+            return -1;
+        }
+        target_dir[target_dir_len] = '\0';
+        if (validate_target_directory(target_dir, sanitized_target, sizeof(sanitized_target)) != 0) {
+            return -1;
+        }
+    }
+
+    printf("Verification requested: %llu files", (unsigned long long)total_files);
+    if (sanitized_target[0] != '\0') {
+        printf(" in %s/", sanitized_target);
+    }
+    printf("\n");
+
+    uint64_t identical = 0;
+    uint64_t processed = 0;
+
+    while (processed < total_files) {
+        size_t batch = (size_t)(total_files - processed);
+        if (batch > VERIFY_BATCH_FILES) {
+            batch = VERIFY_BATCH_FILES;
+        }
+
+        PendingEntry pending[VERIFY_BATCH_FILES];
+        HashJob jobs[VERIFY_BATCH_FILES];
+        char full_paths[VERIFY_BATCH_FILES][4096];
+        size_t job_owner[VERIFY_BATCH_FILES];
+        size_t job_count = 0;
+        size_t received = 0;
+        int rc = 0;
+
+        memset(pending, 0, sizeof(pending));
+
+        // Receive the whole batch of entries
+        for (size_t i = 0; i < batch && rc == 0; i++) {
+            PendingEntry *p = &pending[i];
+            VerifyEntryHeader entry;
+            if (recv_all(s, &entry, VERIFY_ENTRY_HEADER_SIZE) != 0) {
+                rc = -1;
+                break;
+            }
+
+            p->file_size = ntohll(entry.file_size);
+            uint64_t path_len = ntohll(entry.path_len);
+            p->range_count = ntohll(entry.range_count);
+
+            // The range count is implied by the size; reject anything else
+            if (path_len == 0 || path_len >= 4096 ||
+                p->range_count != hash_range_count(p->file_size, range_size)) {
+                fprintf(stderr, "Error: Malformed verification entry\n");
+                rc = -1;
+                break;
+            }
+
+            p->path = malloc(path_len + 1);
+            p->remote_digests = malloc((p->range_count ? p->range_count : 1) * sizeof(uint64_t));
+            received++;
+            if (!p->path || !p->remote_digests) {
+                perror("malloc");
+                rc = -1;
+                break;
+            }
+
+            if (recv_all(s, p->path, path_len) != 0 ||
+                recv_all(s, p->remote_digests, p->range_count * sizeof(uint64_t)) != 0) {
+                rc = -1;
+                break;
+            }
+            p->path[path_len] = '\0';
+            for (uint64_t r = 0; r < p->range_count; r++) {
+                p->remote_digests[r] = ntohll(p->remote_digests[r]);
+            }
+
+            // Look up the local copy
+            if (!is_safe_relative_path(p->path)) {
+                fprintf(stderr, "Error: Rejected unsafe path '%s'\n", p->path);
+                p->status = VERIFY_STATUS_ERROR;
+                continue;
+            }
+
+            if (sanitized_target[0] != '\0') {
+                snprintf(full_paths[i], sizeof(full_paths[i]), "%s/%s", sanitized_target, p->path);
+            } else {
+                snprintf(full_paths[i], sizeof(full_paths[i]), "%s", p->path);
+            }
+
+            struct stat st;
+            if (stat(full_paths[i], &st) != 0 || !S_ISREG(st.st_mode)) {
+                p->status = VERIFY_STATUS_MISSING;
+                continue;
+            }
+
+            p->local_size = (uint64_t)st.st_size;
+            p->status = VERIFY_STATUS_MATCH;
+
+            // Hash only the ranges the sender has digests for
+            uint64_t local_ranges = hash_range_count(p->local_size, range_size);
+            if (local_ranges > p->range_count) {
+                local_ranges = p->range_count;
+            }
+            p->local_ranges = local_ranges;
+            p->local_digests = calloc(p->range_count ? p->range_count : 1, sizeof(uint64_t));
+            if (!p->local_digests) {
+                perror("calloc");
+                rc = -1;
+                break;
+            }
+
+            jobs[job_count].path = full_paths[i];
+            jobs[job_count].file_size = p->local_size < local_ranges * range_size ?
+                                        p->local_size : local_ranges * range_size;
+            jobs[job_count].range_count = local_ranges;
+            jobs[job_count].digests = p->local_digests;
+            job_owner[job_count] = i;
+            job_count++;
+        }
+
+        if (rc == 0) {
+            hash_run_jobs(jobs, job_count, range_size, 0);
+            for (size_t j = 0; j < job_count; j++) {
+                if (jobs[j].status != 0) {
+                    pending[job_owner[j]].status = VERIFY_STATUS_ERROR;
+                }
+            }
+
+            for (size_t i = 0; i < batch && rc == 0; i++) {
+                rc = send_verify_result(s, &pending[i], &identical);
+            }
+        }
+
+        for (size_t i = 0; i < received; i++) {
+            free(pending[i].path);
+            free(pending[i].remote_digests);
+            free(pending[i].local_digests);
+        }
+
+        if (rc != 0) {
+            return -1;
+        }
+        processed += batch;
+    }
+
+    printf("Verification answered: %llu identical, %llu differing or missing\n",
+           (unsigned long long)identical, (unsigned long long)(total_files - identical));
+    return 0;
+}
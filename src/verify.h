@@ -0,0 +1,111 @@
+/**
+ * @file verify.h
+ * @brief Remote verification protocol for NETTF file transfer tool
+ *
+ * Compares a local file or directory against the copy on a receiver without
+ * transferring file data. Both sides hash their copies in fixed-size ranges
+ * and only the range digests cross the network; the receiver answers every
+ * file with a status and the list of mismatching ranges.
+ *
+ * Wire format (all integers in network byte order):
+ *   "VRFY" magic, VerifyHeader, target directory
+ *   per file (sender):   VerifyEntryHeader, relative path, range_count digests
+ *   per file (receiver): VerifyResult, run_count VerifyRangeRun entries
+ */
+
+#ifndef VERIFY_H
+#define VERIFY_H
+
+#include "platform.h"  // Cross-platform socket types and functions
+#include "hash.h"      // HASH_RANGE_SIZE
+#include <stdint.h>
+
+/**
+ * @brief Default digest granularity (4 MB ranges)
+ */
+#define VERIFY_RANGE_SIZE HASH_RANGE_SIZE
+
+/**
+ * @brief Accepted range size bounds
+ */
+#define VERIFY_MIN_RANGE_SIZE (64 * 1024)
+#define VERIFY_MAX_RANGE_SIZE (64 * 1024 * 1024)
+
+/**
+ * @brief Number of files hashed per batch on each side
+ */
+#define VERIFY_BATCH_FILES 64
+
+// Wire sizes of the verification frames
+#define VERIFY_HEADER_SIZE 24
+#define VERIFY_ENTRY_HEADER_SIZE 24
+#define VERIFY_RESULT_SIZE 16
+#define VERIFY_RUN_SIZE 16
+
+// Per-file verification status
+#define VERIFY_STATUS_MATCH         0  // Every range matches
+#define VERIFY_STATUS_MISMATCH      1  // Same size, some ranges differ
+#define VERIFY_STATUS_SIZE_MISMATCH 2  // Sizes differ
+#define VERIFY_STATUS_MISSING       3  // File does not exist on the receiver
+#define VERIFY_STATUS_ERROR         4  // Receiver could not read its copy
+
+/**
+ * @brief Verification session header
+ */
+typedef struct {
+    uint64_t total_files;     // Number of entries that follow
+    uint64_t range_size;      // Digest granularity in bytes
+    uint64_t target_dir_len;  // Length of target directory path (0 for current directory)
+} VerifyHeader;
+
+/**
+ * @brief Per-file entry sent by the verifying side
+ */
+typedef struct {
+    uint64_t file_size;    // Size of the local copy
+    uint64_t path_len;     // Length of the relative path
+    uint64_t range_count;  // Number of range digests that follow
+} VerifyEntryHeader;
+
+/**
+ * @brief Per-file answer sent by the receiver
+ */
+typedef struct {
+    uint32_t status;       // VERIFY_STATUS_* value
+    uint32_t run_count;    // Number of VerifyRangeRun entries that follow
+    uint64_t remote_size;  // Size of the receiver's copy (0 if missing)
+} VerifyResult;
+
+/**
+ * @brief A run of consecutive mismatching ranges
+ */
+typedef struct {
+    uint64_t first_range;  // Index of the first mismatching range
+    uint64_t range_count;  // Number of consecutive mismatching ranges
+} VerifyRangeRun;
+
+/**
+ * @brief Verify a local file or directory against a receiver
+ *
+ * Hashes the local tree, streams the digests to the receiver and prints
+ * every file that is missing or differs on the remote side.
+ *
+ * @param s Connected socket descriptor
+ * @param path Local file or directory to verify
+ * @param target_dir Target directory on receiver (NULL for current directory)
+ * @param use_cache Nonzero to reuse and update the persistent hash cache
+ * @return Number of files that did not match, -1 on error
+ */
+int send_verify_protocol(SOCKET_T s, const char *path, const char *target_dir, int use_cache);
+
+/**
+ * @brief Answer a verification request (receiver side)
+ *
+ * Called after detect_transfer_type() has consumed the "VRFY" magic.
+ *
+ * @param s Socket descriptor
+ * @return 0 on success, -1 on error
+ */
+int recv_verify_protocol(SOCKET_T s);
+
+#endif // VERIFY_H
@@ -0,0 +1,142 @@
+/**
+ * @file zeroscan.c
+ * @brief Vectorized all-zero block detection implementation
+ *
+ * Every implementation ORs 128 bytes per iteration into one accumulator and
+ * tests it once, then finishes the tail with 64-bit words and bytes.
+ */
+
+#define _GNU_SOURCE  // Enable GNU extensions on Linux systems
+#include "zeroscan.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define ZEROSCAN_X86 1
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define ZEROSCAN_NEON 1
+#include <arm_neon.h>
+#endif
+
+/**
+ * @brief Portable tail and fallback: 64-bit words, then bytes
+ */
+static int is_zero_scalar(const unsigned char *p, size_t len) {
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        uint64_t w[4];
+        memcpy(w, p + i, sizeof(w));
+        if ((w[0] | w[1] | w[2] | w[3]) != 0) {
+            return 0;
+        }
+    }
+    for (; i < len; i++) {
+        if (p[i] != 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+#ifdef ZEROSCAN_X86
+__attribute__((target("avx2")))
+static int is_zero_avx2(const unsigned char *p, size_t len) {
+    size_t i = 0;
+    for (; i + 128 <= len; i += 128) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(p + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(p + i + 32));
+        __m256i c = _mm256_loadu_si256((const __m256i *)(p + i + 64));
+        __m256i d = _mm256_loadu_si256((const __m256i *)(p + i + 96));
+        __m256i acc = _mm256_or_si256(_mm256_or_si256(a, b), _mm256_or_si256(c, d));
+        if (!_mm256_testz_si256(acc, acc)) {
+            return 0;
+        }
+    }
+    return is_zero_scalar(p + i, len - i);
+}
+
+__attribute__((target("sse2")))
+static int is_zero_sse2(const unsigned char *p, size_t len) {
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 128 <= len; i += 128) {
+        __m128i acc = _mm_loadu_si128((const __m128i *)(p + i));
+        for (size_t k = 16; k < 128; k += 16) {
+            acc = _mm_or_si128(acc, _mm_loadu_si128((const __m128i *)(p + i + k)));
+        }
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(acc, zero)) != 0xFFFF) {
+            return 0;
+        }
+    }
+    return is_zero_scalar(p + i, len - i);
+}
+#endif
+
+#ifdef ZEROSCAN_NEON
+static int is_zero_neon(const unsigned char *p, size_t len) {
+    size_t i = 0;
+    for (; i + 128 <= len; i += 128) {
+        uint8x16_t acc = vld1q_u8(p + i);
+        for (size_t k = 16; k < 128; k += 16) {
+            acc = vorrq_u8(acc, vld1q_u8(p + i + k));
+        }
+        if (vmaxvq_u8(acc) != 0) {
+            return 0;
+        }
+    }
+    return is_zero_scalar(p + i, len - i);
+}
+#endif
+
+// Implementation selected for this CPU
+static int (*zero_impl)(const unsigned char *, size_t) = is_zero_scalar;
+static const char *zero_impl_name = "scalar";
+static pthread_once_t zero_once = PTHREAD_ONCE_INIT;
+
+/**
+ * @brief Pick the widest implementation the CPU supports
+ */
+static void zeroscan_select(void) {
+#ifdef ZEROSCAN_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        zero_impl = is_zero_avx2;
+        zero_impl_name = "avx2";
+    } else if (__builtin_cpu_supports("sse2")) {
+        zero_impl = is_zero_sse2;
+        zero_impl_name = "sse2";
+    }
+#elif defined(ZEROSCAN_NEON)
+    zero_impl = is_zero_neon;
+    zero_impl_name = "neon";
+#endif
+}
+
+/**
+ * @brief Check whether a buffer contains only zero bytes
+ */
+int buffer_is_zero(const void *data, size_t len) {
+    const unsigned char *p = (const unsigned char *)data;
+
+    // Most data blocks fail on their first word; skip the dispatch for them
+    if (len >= 8) {
+        uint64_t head;
+        memcpy(&head, p, sizeof(head));
+        if (head != 0) {
+            return 0;
+        }
+    }
+
+    pthread_once(&zero_once, zeroscan_select);
+    return zero_impl(p, len);
+}
+
+/**
+ * @brief Name of the implementation selected for this CPU
+ */
+const char *zeroscan_impl_name(void) {
+    pthread_once(&zero_once, zeroscan_select);
+    return zero_impl_name;
+}
@@ -0,0 +1,35 @@
+/**
+ * @file zeroscan.h
+ * @brief Vectorized all-zero block detection for NETTF file transfer tool
+ *
+ * Used by the sparse content stream to turn runs of zero bytes into holes
+ * even when the filesystem does not track them (densely copied images,
+ * filesystems without SEEK_HOLE). The implementation is picked once at run
+ * time: AVX2 or SSE2 on x86, NEON on ARM64, portable 64-bit words elsewhere.
+ */
+
+#ifndef ZEROSCAN_H
+#define ZEROSCAN_H
+
+#include <stddef.h>
+
+/**
+ * @brief Check whether a buffer contains only zero bytes
+ *
+ * Returns as soon as a non-zero byte is found, so data blocks cost little
+ * more than their first cache line.
+ *
+ * @param data Pointer to data
+ * @param len Number of bytes to check
+ * @return 1 if every byte is zero, 0 otherwise
+ */
+int buffer_is_zero(const void *data, size_t len);
+
+/**
+ * @brief Name of the implementation selected for this CPU
+ *
+ * @return "avx2", "sse2", "neon" or "scalar"
+ */
+const char *zeroscan_impl_name(void);
+
+#endif // ZEROSCAN_H
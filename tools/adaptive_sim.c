@@ -0,0 +1,403 @@
+/**
+ * @file adaptive_sim.c
+ * @brief Offline simulator for NETTF adaptive chunk sizing
+ *
+ * Replays chunk traces recorded with "nettf send/receive --trace-file"
+ * against chunk sizing policies (see adaptive.h) and predicts the time and
+ * throughput each policy would have achieved on the recorded link.
+ *
+ * Model: every chunk costs a fixed per-chunk overhead (the loop, the read
+ * and send or receive calls) plus its bytes at the link rate. The link rate
+ * over time comes from the trace: each recorded chunk, minus the overhead,
+ * is a segment of transfer time during which the link moved its bytes at a
+ * constant rate. A simulated chunk consumes these segments in order, so a
+ * slowdown in the recording slows the simulation at the same point of
+ * transfer time whatever chunk sizes are chosen. Pauses between files
+ * (headers, opens, directory creation) are replayed as recorded, and files
+ * recorded as one session (a directory transfer) share one controller. The
+ * controller sees the same second-resolution clock as in nettf, so replaying
+ * the recorded policy reproduces its decisions.
+ *
+ * Usage: adaptive-sim [--policy <list>] [--overhead-us <us>] <trace>...
+ */
+
+#define _GNU_SOURCE  // Enable strdup() on Linux systems
+#include "adaptive.h"
+#include "chunktrace.h"
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Default fixed cost of one chunk in microseconds
+#define SIM_DEFAULT_OVERHEAD_US 10.0
+
+// Most policies compared in one run
+#define SIM_MAX_POLICIES 8
+
+/**
+ * @brief A file of a trace
+ */
+typedef struct {
+    int next;             // Continues the previous file's adaptive state
+    uint64_t file_bytes;  // Size of the file
+    uint64_t bytes;       // Bytes recorded in its chunks
+    double gap;           // Seconds between the previous file's last chunk and this file
+} SimFile;
+
+/**
+ * @brief A loaded trace
+ */
+typedef struct {
+    double start;         // Wall-clock seconds of trace time 0
+    SimFile *files;
+    int file_count;
+    double *seg_len;      // Transfer seconds of each recorded chunk, overhead removed
+    double *seg_rate;     // Link rate during it in bytes per second
+    int seg_count;
+    double first_t;       // Trace seconds of the first file record
+    double last_t;        // Trace seconds of the last chunk record
+    uint64_t bytes;       // Bytes of all chunks
+    double rtt_sum;       // Sum of RTT samples in microseconds
+    int rtt_samples;      // RTT samples
+    int64_t max_cwnd;     // Largest congestion window seen
+    int64_t first_retrans;  // Retransmit counter at the first and last chunk
+    int64_t last_retrans;
+} SimTrace;
+
+/**
+ * @brief Outcome of replaying a trace with one policy
+ */
+typedef struct {
+    double seconds;       // Predicted transfer time
+    uint64_t chunks;      // Chunks moved
+    uint64_t changes;     // Chunk size changes
+    double chunk_sum;     // Sum of chunk sizes, for the mean
+} SimResult;
+
+/**
+ * @brief Print usage information
+ */
+static void print_usage(const char *program_name) {
+    printf("Usage: %s [--policy <list>] [--overhead-us <us>] <trace>...\n", program_name);
+    printf("\nReplays chunk traces recorded with \"nettf send/receive --trace-file <file>\"\n");
+    printf("against adaptive chunk sizing policies and predicts their throughput.\n");
+    printf("\nOptions:\n");
+    printf("  --policy <list>    Comma-separated policies: threshold, proportional, static\n");
+    printf("                     (default: all three; threshold is the one nettf uses)\n");
+    printf("  --overhead-us <us> Fixed cost of one chunk in microseconds (default: %.0f)\n",
+           SIM_DEFAULT_OVERHEAD_US);
+}
+
+/**
+ * @brief Append to a growing array, doubling its capacity when full
+ *
+ * @return 0 on success, -1 when out of memory
+ */
+static int grow(void **array, int count, int *capacity, size_t element) {
+    if (count < *capacity) {
+        return 0;
+    }
+    int new_capacity = *capacity > 0 ? *capacity * 2 : 256;
+    void *grown = realloc(*array, (size_t)new_capacity * element);
+    if (!grown) {
+        fprintf(stderr, "Error: Out of memory\n");
+        return -1;
+    }
+    *array = grown;
+    *capacity = new_capacity;
+    return 0;
+}
+
+/**
+ * @brief Free a loaded trace
+ */
+static void free_trace(SimTrace *trace) {
+    free(trace->files);
+    free(trace->seg_len);
+    free(trace->seg_rate);
+    memset(trace, 0, sizeof(*trace));
+}
+
+/**
+ * @brief Load a trace and turn its chunks into link rate segments
+ *
+ * @return 0 on success, -1 on error (message printed)
+ */
+static int load_trace(const char *path, double overhead, SimTrace *trace) {
+    memset(trace, 0, sizeof(*trace));
+    trace->first_retrans = -1;
+    trace->last_retrans = -1;
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        fprintf(stderr, "Error: Cannot open %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    int file_capacity = 0, seg_capacity = 0, seg_capacity_rate = 0;
+    int line = 0, status;
+    double last_chunk_t = -1;
+    ChunktraceRecord record;
+    while ((status = chunktrace_read(file, &trace->start, &record, &line)) == 1) {
+        double t = record.t_us / 1e6;
+        if (record.kind == 'F' || record.kind == 'N') {
+            if (grow((void **)&trace->files, trace->file_count, &file_capacity, sizeof(SimFile)) != 0) {
+                status = -1;
+                break;
+            }
+            SimFile *entry = &trace->files[trace->file_count++];
+            entry->next = record.kind == 'N';
+            entry->file_bytes = record.file_bytes;
+            entry->bytes = 0;
+            entry->gap = trace->file_count > 1 && last_chunk_t >= 0 && t > last_chunk_t ? t - last_chunk_t : 0;
+            if (trace->file_count == 1) {
+                trace->first_t = t;
+            }
+            continue;
+        }
+        if (trace->file_count == 0) {
+            fprintf(stderr, "Error: %s: chunk before the first file record on line %d\n", path, line);
+            status = -1;
+            break;
+        }
+        if (record.bytes == 0) {
+            continue;
+        }
+        if (grow((void **)&trace->seg_len, trace->seg_count, &seg_capacity, sizeof(double)) != 0 ||
+            grow((void **)&trace->seg_rate, trace->seg_count, &seg_capacity_rate, sizeof(double)) != 0) {
+            status = -1;
+            break;
+        }
+        double transfer = record.dur_us / 1e6 - overhead;
+        if (transfer < 1e-9) {
+            transfer = 1e-9;  // Faster than the overhead: the link was not the limit
+        }
+        trace->seg_len[trace->seg_count] = transfer;
+        trace->seg_rate[trace->seg_count] = record.bytes / transfer;
+        trace->seg_count++;
+        trace->files[trace->file_count - 1].bytes += record.bytes;
+        trace->bytes += record.bytes;
+        trace->last_t = t;
+        last_chunk_t = t;
+
+        if (record.rtt_us >= 0) {
+            trace->rtt_sum += (double)record.rtt_us;
+            trace->rtt_samples++;
+        }
+        if (record.cwnd > trace->max_cwnd) {
+            trace->max_cwnd = record.cwnd;
+        }
+        if (record.retrans >= 0) {
+            if (trace->first_retrans < 0) {
+                trace->first_retrans = record.retrans;
+            }
+            trace->last_retrans = record.retrans;
+        }
+    }
+    fclose(file);
+    if (status == 0 && trace->seg_count == 0) {
+        fprintf(stderr, "Error: %s has no chunk records\n", path);
+        status = -1;
+    }
+    if (status != 0) {
+        free_trace(trace);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Move bytes over the recorded link rate timeline
+ *
+ * @param trace Loaded trace
+ * @param seg Input/output: current segment
+ * @param pos Input/output: seconds already used of the current segment
+ * @param bytes Bytes to move
+ * @return Seconds it takes
+ */
+static double advance(const SimTrace *trace, int *seg, double *pos, double bytes) {
+    double seconds = 0;
+    while (bytes > 0 && *seg < trace->seg_count) {
+        double rate = trace->seg_rate[*seg];
+        double left = trace->seg_len[*seg] - *pos;
+        if (bytes <= rate * left) {
+            double dt = bytes / rate;
+            *pos += dt;
+            return seconds + dt;
+        }
+        bytes -= rate * left;
+        seconds += left;
+        (*seg)++;
+        *pos = 0;
+    }
+    // Past the end of the recording: the last rate holds
+    if (bytes > 0) {
+        seconds += bytes / trace->seg_rate[trace->seg_count - 1];
+    }
+    return seconds;
+}
+
+/**
+ * @brief Replay a trace with a policy
+ */
+static void simulate(const SimTrace *trace, AdaptivePolicy policy, double overhead, SimResult *result) {
+    memset(result, 0, sizeof(*result));
+    int seg = 0;
+    double pos = 0;
+    double wall = trace->start + trace->first_t;
+    double begin = wall;
+    AdaptiveState state;
+    size_t last_chunk_size = 0;
+
+    for (int f = 0; f < trace->file_count; f++) {
+        const SimFile *entry = &trace->files[f];
+        wall += entry->gap;
+
+        if (!entry->next || f == 0) {
+            adaptive_init(&state, entry->file_bytes);
+            state.policy = policy;
+            state.last_adjustment_time = (time_t)floor(wall);
+            state.transfer_start_time = state.last_adjustment_time;
+            last_chunk_size = adaptive_get_chunk_size(&state);
+        }
+
+        uint64_t remaining = entry->bytes;
+        double previous = wall;
+        while (remaining > 0) {
+            size_t chunk_size = adaptive_get_chunk_size(&state);
+            if (chunk_size != last_chunk_size) {
+                result->changes++;
+                last_chunk_size = chunk_size;
+            }
+            size_t n = remaining < chunk_size ? (size_t)remaining : chunk_size;
+            wall += overhead + advance(trace, &seg, &pos, (double)n);
+
+            // nettf measures chunks with a seconds clock, as does this replay
+            double elapsed = floor(wall) - floor(previous);
+            adaptive_update_at(&state, n, elapsed, (time_t)floor(wall));
+            previous = wall;
+            remaining -= n;
+            result->chunks++;
+            result->chunk_sum += (double)chunk_size;
+        }
+    }
+    result->seconds = wall - begin;
+}
+
+/**
+ * @brief Replay one trace with every policy and print the comparison
+ *
+ * @return 0 on success, -1 on error
+ */
+static int report_trace(const char *path, char **policy_names, AdaptivePolicy *policies, int policy_count,
+                        double overhead) {
+    SimTrace trace;
+    if (load_trace(path, overhead, &trace) != 0) {
+        return -1;
+    }
+
+    const double MB = 1024.0 * 1024.0;
+    double recorded = trace.last_t - trace.first_t;
+    double recorded_speed = recorded > 0 ? trace.bytes / MB / recorded : 0;
+    printf("Trace: %s\n", path);
+    printf("  Recorded: %d files, %.2f MB in %.3f s (%.1f MB/s), %d chunks\n", trace.file_count,
+           trace.bytes / MB, recorded, recorded_speed, trace.seg_count);
+    if (trace.rtt_samples > 0) {
+        printf("  Link: RTT %.2f ms average, congestion window up to %lld segments, %lld retransmits\n",
+               trace.rtt_sum / trace.rtt_samples / 1000.0, (long long)trace.max_cwnd,
+               (long long)(trace.last_retrans - trace.first_retrans));
+    } else {
+        printf("  Link: no TCP_INFO in the trace\n");
+    }
+    printf("  %-13s %10s %10s %10s %11s %8s %12s\n", "Policy", "Seconds", "MB/s", "Chunks", "Mean chunk",
+           "Changes", "vs recorded");
+
+    for (int p = 0; p < policy_count; p++) {
+        SimResult result;
+        simulate(&trace, policies[p], overhead, &result);
+        char mean_str[32];
+        adaptive_format_chunk_size(result.chunks > 0 ? (size_t)(result.chunk_sum / result.chunks) : 0, mean_str,
+                                   sizeof(mean_str));
+        double speed = result.seconds > 0 ? trace.bytes / MB / result.seconds : 0;
+        double versus = recorded > 0 && result.seconds > 0 ? (recorded / result.seconds - 1.0) * 100.0 : 0;
+        printf("  %-13s %10.3f %10.1f %10llu %11s %8llu %+11.1f%%\n", policy_names[p], result.seconds, speed,
+               (unsigned long long)result.chunks, mean_str, (unsigned long long)result.changes, versus);
+    }
+    free_trace(&trace);
+    return 0;
+}
+
+/**
+ * @brief Simulator entry point
+ */
+int main(int argc, char *argv[]) {
+    static char default_policies[] = "threshold,proportional,static";
+    char *policy_list = default_policies;
+    double overhead_us = SIM_DEFAULT_OVERHEAD_US;
+    int first_trace = argc;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--policy") == 0 && i + 1 < argc) {
+            policy_list = argv[++i];
+        } else if (strcmp(argv[i], "--overhead-us") == 0 && i + 1 < argc) {
+            char *end;
+            overhead_us = strtod(argv[++i], &end);
+            if (*end != '\0' || overhead_us < 0) {
+                fprintf(stderr, "Error: Overhead must be a non-negative number of microseconds\n");
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
+            print_usage(argv[0]);
+            return EXIT_SUCCESS;
+        } else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+            fprintf(stderr, "Error: Unknown option %s\n", argv[i]);
+            print_usage(argv[0]);
+            return EXIT_FAILURE;
+        } else {
+            first_trace = i;
+            break;
+        }
+    }
+    if (first_trace >= argc) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    // Resolve the policy names
+    char *names = strdup(policy_list);
+    char *policy_names[SIM_MAX_POLICIES];
+    AdaptivePolicy policies[SIM_MAX_POLICIES];
+    int policy_count = 0;
+    if (!names) {
+        fprintf(stderr, "Error: Out of memory\n");
+        return EXIT_FAILURE;
+    }
+    for (char *name = strtok(names, ","); name; name = strtok(NULL, ",")) {
+        if (policy_count == SIM_MAX_POLICIES) {
+            fprintf(stderr, "Error: At most %d policies at once\n", SIM_MAX_POLICIES);
+            free(names);
+            return EXIT_FAILURE;
+        }
+        if (adaptive_policy_by_name(name, &policies[policy_count]) != 0) {
+            fprintf(stderr, "Error: Unknown policy %s (threshold, proportional or static)\n", name);
+            free(names);
+            return EXIT_FAILURE;
+        }
+        policy_names[policy_count++] = name;
+    }
+    if (policy_count == 0) {
+        fprintf(stderr, "Error: No policy given\n");
+        free(names);
+        return EXIT_FAILURE;
+    }
+
+    int failed = 0;
+    for (int i = first_trace; i < argc; i++) {
+        if (report_trace(argv[i], policy_names, policies, policy_count, overhead_us / 1e6) != 0) {
+            failed = 1;
+        }
+    }
+    free(names);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}